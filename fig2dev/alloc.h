@@ -19,6 +19,8 @@
 #ifndef ALLOC_H
 #define ALLOC_H
 
+#include "arena.h"
+
 #define		Line_malloc(z)		((z) = malloc(LINOBJ_SIZE))
 #define		Pic_malloc(z)		((z) = malloc(PIC_SIZE))
 #define		Spline_malloc(z)	((z) = malloc(SPLOBJ_SIZE))
@@ -26,8 +28,11 @@
 #define		Arc_malloc(z)		((z) = malloc(ARCOBJ_SIZE))
 #define		Compound_malloc(z)	((z) = malloc(COMOBJ_SIZE))
 #define		Text_malloc(z)		((z) = malloc(TEXOBJ_SIZE))
-#define		Point_malloc(z)		((z) = malloc(POINT_SIZE))
-#define		Control_malloc(z)	((z) = malloc(CONTROL_SIZE))
-#define		Arrow_malloc(z)		((z) = malloc(ARROW_SIZE))
+
+/* the parts of objects come from the arena of the figure, see arena.c */
+#define		Point_malloc(z)		((z) = arena_alloc(POINT_SIZE))
+#define		Control_malloc(z)	((z) = arena_alloc(CONTROL_SIZE))
+#define		Arrow_malloc(z)		((z) = arena_alloc(ARROW_SIZE))
+#define		Comment_malloc(z)	((z) = arena_alloc(COMMENT_SIZE))
 
 #endif /* ALLOC_H */
@@ -0,0 +1,190 @@
+/*
+ * Fig2dev: Translate Fig code to various Devices
+ * Copyright (c) 1991 by Micah Beck
+ * Parts Copyright (c) 1985-1988 by Supoj Sutanthavibul
+ * Parts Copyright (c) 1989-2015 by Brian V. Smith
+ * Parts Copyright (c) 2015-2024 by Thomas Loimer
+ *
+ * Any party obtaining a copy of these files is granted, free of charge, a
+ * full and unrestricted irrevocable, world-wide, paid up, royalty-free,
+ * nonexclusive right and license to deal in this software and documentation
+ * files (the "Software"), including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense and/or sell copies
+ * of the Software, and to permit persons who receive copies from any such
+ * party to do so, with the only requirement being that the above copyright
+ * and this permission notice remain intact.
+ *
+ */
+
+/*
+ * arena.c: Allocate the small parts of a figure from large blocks.
+ *
+ * Points, spline control points, arrows and comments are allocated with
+ * arena_alloc() from the current arena. The arena belongs to the top-level
+ * compound of a figure, see readfp_fig(). It is released at once by
+ * free_compound(), the parts are never freed individually. Allocating
+ * without a current arena is an error.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "messages.h"
+
+#define BLOCK_SIZE	65536	/* bytes, excluding the header */
+
+/* the alignment of all allocations */
+union align {
+	long	l;
+	double	d;
+	void	*p;
+};
+
+struct block {
+	struct block	*next;
+	size_t		size;
+	size_t		used;
+	union align	data[];
+};
+
+struct arena {
+	struct block	*blocks;	/* the first block is being filled */
+};
+
+static struct arena	*cur_arena = NULL;
+
+static struct block *
+new_block(size_t size)
+{
+	struct block	*b;
+
+	if ((b = malloc(offsetof(struct block, data) + size)) == NULL)
+		return NULL;
+	b->next = NULL;
+	b->size = size;
+	b->used = 0;
+	return b;
+}
+
+struct arena *
+arena_new(void)
+{
+	struct arena	*arena;
+
+	if ((arena = malloc(sizeof(struct arena))) == NULL)
+		return NULL;
+	arena->blocks = NULL;
+	return arena;
+}
+
+void
+arena_free(struct arena *arena)
+{
+	struct block	*b, *next;
+
+	if (arena == NULL)
+		return;
+	for (b = arena->blocks; b != NULL; b = next) {
+		next = b->next;
+		free(b);
+	}
+	if (arena == cur_arena)
+		cur_arena = NULL;
+	free(arena);
+}
+
+/*
+ * Release all memory allocated from arena, but keep the arena. The first
+ * block is kept for further allocations.
+ */
+void
+arena_clear(struct arena *arena)
+{
+	struct block	*b, *next;
+
+	if (arena == NULL || arena->blocks == NULL)
+		return;
+	b = arena->blocks;
+	next = b->next;
+	if (b->size == BLOCK_SIZE) {
+		b->used = 0;
+		b->next = NULL;
+	} else {
+		free(b);
+		arena->blocks = NULL;
+	}
+	for (b = next; b != NULL; b = next) {
+		next = b->next;
+		free(b);
+	}
+}
+
+/*
+ * Allocate from arena in subsequent calls of arena_alloc().
+ */
+void
+arena_use(struct arena *arena)
+{
+	cur_arena = arena;
+}
+
+/*
+ * Return size bytes from the current arena, or NULL if no memory is left
+ * or if there is no current arena.
+ */
+void *
+arena_alloc(size_t size)
+{
+	struct block	*b;
+	void		*p;
+
+	if (cur_arena == NULL) {
+		put_msg("No arena to allocate memory from.");
+		return NULL;
+	}
+
+	size = (size + sizeof(union align) - 1) / sizeof(union align)
+						* sizeof(union align);
+
+	/* a large object gets a block of its own, behind the first block */
+	if (size > BLOCK_SIZE / 4) {
+		if ((b = new_block(size)) == NULL)
+			return NULL;
+		b->used = size;
+		if (cur_arena->blocks) {
+			b->next = cur_arena->blocks->next;
+			cur_arena->blocks->next = b;
+		} else {
+			cur_arena->blocks = b;
+		}
+		return b->data;
+	}
+
+	b = cur_arena->blocks;
+	if (b == NULL || b->size - b->used < size) {
+		if ((b = new_block(BLOCK_SIZE)) == NULL)
+			return NULL;
+		b->next = cur_arena->blocks;
+		cur_arena->blocks = b;
+	}
+	p = (char *)b->data + b->used;
+	b->used += size;
+	return p;
+}
+
+char *
+arena_strdup(const char *s)
+{
+	size_t	len = strlen(s) + 1;
+	char	*p;
+
+	if ((p = arena_alloc(len)))
+		memcpy(p, s, len);
+	return p;
+}
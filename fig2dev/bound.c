@@ -62,7 +62,7 @@
 
 static void	arrow_bound(int objtype, F_line *obj,
 			int *xmin, int *ymin, int *xmax, int *ymax);
-static void	points_bound(F_point *points,
+static void	points_bound(F_pos *pts, int n,
 			int *xmin, int *ymin, int *xmax, int *ymax);
 
 /************** ARRAY FOR ARROW SHAPES **************/
@@ -468,10 +468,14 @@ ellipse_bound(F_ellipse *e, int *xmin, int *ymin, int *xmax, int *ymax)
 void
 line_bound(F_line *l, int *xmin, int *ymin, int *xmax, int *ymax)
 {
-	points_bound(l->points, xmin, ymin, xmax, ymax);
+	F_pos	*pts;
+	int	n;
+
+	pts = line_points(l, &n);
+	points_bound(pts, n, xmin, ymin, xmax, ymax);
 	/* now add in the arrow (if any) boundaries but
 	   only if the line has two or more points */
-	if (l->points->next)
+	if (n > 1)
 		arrow_bound(OBJ_POLYLINE, l, xmin, ymin, xmax, ymax);
 }
 
@@ -694,15 +698,15 @@ text_bound(F_text *t, int *xmin, int *ymin, int *xmax, int *ymax, int inc_text)
 }
 
 static void
-points_bound(F_point *points, int *xmin, int *ymin, int *xmax, int *ymax)
+points_bound(F_pos *pts, int n, int *xmin, int *ymin, int *xmax, int *ymax)
 {
 	int	bx, by, sx, sy;
-	F_point	*p;
+	int	i;
 
-	bx = sx = points->x; by = sy = points->y;
-	for (p = points->next; p != NULL; p = p->next) {
-		sx = min(sx, p->x); sy = min(sy, p->y);
-		bx = max(bx, p->x); by = max(by, p->y);
+	bx = sx = pts[0].x; by = sy = pts[0].y;
+	for (i = 1; i < n; ++i) {
+		sx = min(sx, pts[i].x); sy = min(sy, pts[i].y);
+		bx = max(bx, pts[i].x); by = max(by, pts[i].y);
 	}
 	*xmin = sx; *ymin = sy;
 	*xmax = bx; *ymax = by;
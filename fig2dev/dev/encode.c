@@ -3,7 +3,7 @@
  * Copyright (c) 1991 by Micah Beck
  * Parts Copyright (c) 1985-1988 by Supoj Sutanthavibul
  * Parts Copyright (c) 1989-2015 by Brian V. Smith
- * Parts Copyright (c) 2015-2020 by Thomas Loimer
+ * Parts Copyright (c) 2015-2024 by Thomas Loimer
  *
  * Any party obtaining a copy of these files is granted, free of charge, a
  * full and unrestricted irrevocable, world-wide, paid up, royalty-free,
@@ -17,7 +17,7 @@
  */
 
 /*
- * encode.c: ascii85 encoding and deflate data
+ * encode.c: ascii85 and base64 encoding and deflate data
  * Author: Thomas Loimer, 2020-12-14
  *
 */
@@ -29,62 +29,80 @@
 
 #include <limits.h>	/* UINT_MAX */
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 #ifdef HAVE_ZLIB_H
 #include <zlib.h>
 #define	ZLIB_IN_MAX	UINT_MAX	/* maximum size zlib can read at once */
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#define	MAX_THREADS	16
+#endif
 #endif
 
 #include "messages.h"
 
 
 /*
- * convert the next four bytes to ascii85, writing five chars.
+ * The encoded data is written in lines of 16 groups of five characters, i.e.,
+ * 80 characters, or less if a group of four zeros is written as 'z'. The
+ * lines are collected in a buffer and written with one call to fwrite().
  */
-static int
-convertfourbytes(FILE *out, unsigned char *in)
+#define	GROUPS_PER_LINE	16
+#define	BYTES_PER_LINE	(GROUPS_PER_LINE * 4)
+#define	LINES_PER_WRITE	64
+#define	MAX_LINE_LEN	(GROUPS_PER_LINE * 5 + 1)
+
+/*
+ * Convert the next four bytes to ascii85, writing five chars to o, or 'z'.
+ * Return the position after the chars written.
+ */
+static char *
+convertfourbytes(char *o, const unsigned char *in)
 {
-	const unsigned long	power85[4] = {85L*85*85*85, 85L*85*85, 85L*85,
-						85L};
-	int			i, o;
-	unsigned long		word;
+	unsigned long	word;
 
-	word = ((unsigned long)(((unsigned int)(*in) << 8) + *(in+1)) << 16) +
-		(((unsigned int)(*(in+2)) << 8) + *(in+3));
+	word = (unsigned long)in[0] << 24 | (unsigned long)in[1] << 16 |
+		(unsigned long)in[2] << 8 | (unsigned long)in[3];
 	if (word == 0) {
-		fputc('z', out);
-		return 1;
-	} else {
-		for (i = 0; i < 4; ++i) {
-			o = (int)(word / power85[i]);
-			word -= o * power85[i];
-			fputc(o + '!', out);
-		}
-		fputc(word + '!', out);
-		return 5;
+		*o = 'z';
+		return o + 1;
 	}
+	/* the compiler replaces the division by a constant with a
+	   multiplication */
+	o[4] = (char)(word % 85 + '!');
+	word /= 85;
+	o[3] = (char)(word % 85 + '!');
+	word /= 85;
+	o[2] = (char)(word % 85 + '!');
+	word /= 85;
+	o[1] = (char)(word % 85 + '!');
+	o[0] = (char)(word / 85 + '!');
+	return o + 5;
 }
 
 /*
- * Convert the remaining 1 to 3 bytes.
+ * Convert the remaining 1 to 3 bytes, writing len + 1 chars.
  */
-static void
-convertremainder(FILE *out, unsigned char *in, unsigned len)
+static char *
+convertremainder(char *o, const unsigned char *in, unsigned len)
 {
-	const unsigned long	power85[4] = {85L*85*85*85, 85L*85*85, 85L*85,
-						85L};
-	int			o;
-	unsigned		i;
-	unsigned long		word;
-
-
-	word = (unsigned long)(*in) << 24;
-	for (i = 1; i < len; ++i)
-		word += (unsigned long)(*(in+i)) << 8 * (3 - i);
-	for (i = 0; i < len + 1; ++i) {
-		o = (int)(word / power85[i]);
-		word -= o * power85[i];
-		fputc(o + '!', out);
-	}
+	unsigned char	last[4] = {0, 0, 0, 0};
+	char		group[5];
+	unsigned	i;
+
+	for (i = 0; i < len; ++i)
+		last[i] = in[i];
+	/* a group of zeros must be written in full, not as 'z' */
+	if (convertfourbytes(group, last) == group + 1)
+		for (i = 0; i < 5; ++i)
+			group[i] = '!';
+	for (i = 0; i < len + 1; ++i)
+		*o++ = group[i];
+	return o;
 }
 
 /*
@@ -97,140 +115,453 @@ convertremainder(FILE *out, unsigned char *in, unsigned len)
 int
 ascii85encode(FILE *out, unsigned char *in, size_t len)
 {
-	size_t		i, n;
-	size_t		lines;
-				/* this yields 16 * 5 = 80 chars in a line */
-	const size_t	bytes_per_line = 16 * 4;
-
-	/* write full lines */
-	lines = len / bytes_per_line;
-	for (n = 0; n < lines; ++n) {
-		for (i = 0; i < 16; ++i)
-			convertfourbytes(out, in + n * bytes_per_line + i * 4);
-		fputc('\n', out);
-		if (ferror(out)) {
+	int		i, n;
+	char		buf[LINES_PER_WRITE * MAX_LINE_LEN];
+	char		*o;
+	const unsigned char	*end = in + len;
+
+	/* write full lines, LINES_PER_WRITE at a time */
+	while ((size_t)(end - in) >= BYTES_PER_LINE) {
+		o = buf;
+		for (n = 0; n < LINES_PER_WRITE &&
+				(size_t)(end - in) >= BYTES_PER_LINE; ++n) {
+			for (i = 0; i < GROUPS_PER_LINE; ++i, in += 4)
+				o = convertfourbytes(o, in);
+			*o++ = '\n';
+		}
+		if (fwrite(buf, 1, (size_t)(o - buf), out) != (size_t)(o - buf)){
 			err_msg("Error writing one line of encoded data");
 			return -1;
 		}
 	}
 
 	/* quick return */
-	if ((n = len - lines * bytes_per_line) == 0)
+	if (in == end)
 		return 0;
 
-	/* write remaining groups of four */
-	for (i = 0; i < n / 4; ++i)
-		convertfourbytes(out, in + lines * bytes_per_line + i * 4);
+	/* write remaining groups of four, and the remainder */
+	o = buf;
+	for (; end - in >= 4; in += 4)
+		o = convertfourbytes(o, in);
+	if (end > in)
+		o = convertremainder(o, in, (unsigned)(end - in));
 
-	/* write remainder */
-	if ((n -= i * 4) > 0)
-		convertremainder(out, in + lines * bytes_per_line + i * 4, n);
-
-	if (ferror(out)) {
+	if (fwrite(buf, 1, (size_t)(o - buf), out) != (size_t)(o - buf)) {
 		err_msg("Error writing encoded data");
 		return -1;
 	}
 	return 0;
 }
 
-#ifdef HAVE_ZLIB_H
 /*
- * Write the deflated and ascii85 encoded bitmap data to out.
+ * Base64 is written on one line, as used in data uris. The input is read
+ * in groups of three bytes, each converted with two lookups of twelve bits
+ * into four characters.
+ */
+#define	B64_GROUPS	2048
+static char	b64pairs[4096][2];
+
+static void
+init_b64pairs(void)
+{
+	static const char	alphabet[] =
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+		"0123456789+/";
+	int			i;
+
+	for (i = 0; i < 4096; ++i) {
+		b64pairs[i][0] = alphabet[i >> 6];
+		b64pairs[i][1] = alphabet[i & 63];
+	}
+}
+
+/*
+ * Write the len bytes at in base64-encoded to out, padded with '='.
+ * Return 0 on success, -1 on failure.
  */
 int
-deflate_ascii85encode(FILE *out, unsigned char *in, size_t len)
+base64encode(FILE *out, const unsigned char *in, size_t len)
+{
+	size_t		n, i;
+	unsigned long	word;
+	char		buf[B64_GROUPS * 4];
+	char		*o;
+
+	if (b64pairs[0][0] == '\0')
+		init_b64pairs();
+
+	while (len > 0) {
+		n = len / 3 < B64_GROUPS ? len / 3 : B64_GROUPS;
+		o = buf;
+		for (i = 0; i < n; ++i, in += 3, o += 4) {
+			word = (unsigned long)in[0] << 16 |
+				(unsigned long)in[1] << 8 | in[2];
+			memcpy(o, b64pairs[word >> 12], 2);
+			memcpy(o + 2, b64pairs[word & 0xfff], 2);
+		}
+		len -= 3 * n;
+
+		/* the remaining one or two bytes */
+		if (n < B64_GROUPS && len > 0) {
+			word = (unsigned long)in[0] << 16;
+			if (len == 2)
+				word |= (unsigned long)in[1] << 8;
+			memcpy(o, b64pairs[word >> 12], 2);
+			o[2] = len == 2 ? b64pairs[word & 0xfff][0] : '=';
+			o[3] = '=';
+			o += 4;
+			len = 0;
+		}
+
+		if (fwrite(buf, 1, (size_t)(o - buf), out) != (size_t)(o - buf)){
+			err_msg("Error writing base64 encoded data");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+#ifdef HAVE_ZLIB_H
+/*
+ * The compression level of deflate, 0 - 9, set with option -q, or -1 to use
+ * the defaults of the drivers.
+ */
+int	deflate_level = -1;
+
+/* a growing buffer for the output of deflate() */
+struct deflated {
+	unsigned char	*data;
+	size_t		len;
+	size_t		size;
+};
+
+/*
+ * Deflate the len bytes at in, appending to out. End with flush, either
+ * Z_FINISH or Z_SYNC_FLUSH. Return Z_OK on success, or a zlib error code.
+ */
+static int
+deflate_buf(z_stream *strm, unsigned char *in, size_t len, int flush,
+		struct deflated *out)
+{
+	int		ret;
+	size_t		avail;
+	unsigned char	*o;
+
+	strm->next_in = in;
+	strm->avail_in = 0;
+	for (;;) {
+		/* feed the input in pieces zlib can digest */
+		if (strm->avail_in == 0 && len > 0) {
+			strm->avail_in = len > ZLIB_IN_MAX ? ZLIB_IN_MAX :
+							(unsigned)len;
+			len -= strm->avail_in;
+		}
+		if (out->len == out->size) {
+			if ((o = realloc(out->data, out->size *= 2)) == NULL)
+				return Z_MEM_ERROR;
+			out->data = o;
+		}
+		avail = out->size - out->len;
+		strm->next_out = out->data + out->len;
+		strm->avail_out = avail > ZLIB_IN_MAX ? ZLIB_IN_MAX :
+							(unsigned)avail;
+		avail = strm->avail_out;
+		ret = deflate(strm, len > 0 ? Z_NO_FLUSH : flush);
+		out->len += avail - strm->avail_out;
+		if (ret == Z_STREAM_END)
+			return Z_OK;
+		if (ret != Z_OK && ret != Z_BUF_ERROR)
+			return ret;
+		/* a sync flush is complete, if output space is left */
+		if (flush != Z_FINISH && len == 0 && strm->avail_in == 0 &&
+				strm->avail_out != 0)
+			return Z_OK;
+	}
+}
+
+/*
+ * Large data is split into blocks, which are deflated independently, and
+ * possibly in parallel, as done by pigz. Each block is primed with the last
+ * 32 kB of the previous block as dictionary, and all but the last block end
+ * with a sync flush on a byte boundary. Concatenated, the blocks form a
+ * single deflate stream. The block size does not depend on the number of
+ * threads, hence the output is the same with or without threads.
+ */
+#define	BLOCK_SIZE	131072		/* 128 kB */
+#define	BLOCKS_MIN	8		/* the minimum number of blocks */
+#define	DICT_SIZE	32768		/* the window size of deflate */
+
+struct blocks {
+	unsigned char	*in;		/* the input, all blocks */
+	size_t		len;
+	size_t		n;		/* the number of blocks */
+	size_t		next;		/* the next block to deflate */
+	int		level;
+	int		memlevel;
+	int		strategy;
+	int		ret;		/* Z_OK, or the first error */
+	struct deflated	*out;		/* the deflated blocks */
+	uLong		*adler;		/* the checksums of the blocks */
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_t	lock;
+#endif
+};
+
+static int
+deflate_block(struct blocks *b, size_t i)
 {
 	int		ret;
-	int		flush;
+	size_t		start = i * BLOCK_SIZE;
+	size_t		len = i + 1 < b->n ? BLOCK_SIZE : b->len - start;
+	size_t		dict;
 	z_stream	strm;
-	unsigned char	buf[16384]; /* IMPORTANT, that this is a multiple of 4!
-				     * Nice, if a multiple of 16*4, see above */
-
-	/*
-	 * Initialize the zlib state object.
-	 * See zlib.h and the example zpipe.c.
-	 */
-	strm.zalloc = Z_NULL;	/* Have zlib use the standard system malloc().*/
-	strm.zfree = Z_NULL;	/* Have zlib use the standard system free(). */
-	strm.opaque = Z_NULL;	/* Not used, passed to zalloc() and zfree(). */
-	ret = deflateInit2(&strm,
-			Z_BEST_COMPRESSION,	/* 0 - 9, default 6 */
-			Z_DEFLATED,		/* method, must be Z_DEFLATED */
-			MAX_WBITS,		/* window size, max here */
-			MAX_MEM_LEVEL,		/* allocated memory for
-						   compression, use maximum */
-			Z_RLE); /* compression strategy used for png data */
-	if (ret != Z_OK) {
-		put_msg("Unable to initialize compression.");
-		if (strm.msg)
-			put_msg("Zlib error: %s", strm.msg);
-		else
-			put_msg("Zlib error = %d", ret);
+	struct deflated	*out = b->out + i;
+
+	b->adler[i] = adler32(adler32(0L, Z_NULL, 0), b->in + start,
+			(uInt)len);
+	out->size = len / 2 + 1024;
+	if ((out->data = malloc(out->size)) == NULL)
+		return Z_MEM_ERROR;
+	strm.zalloc = Z_NULL;
+	strm.zfree = Z_NULL;
+	strm.opaque = Z_NULL;
+	/* negative window bits, write raw deflate data without header */
+	if ((ret = deflateInit2(&strm, b->level, Z_DEFLATED, -MAX_WBITS,
+					b->memlevel, b->strategy)) != Z_OK)
 		return ret;
+	if (i > 0) {
+		dict = start < DICT_SIZE ? start : DICT_SIZE;
+		deflateSetDictionary(&strm, b->in + start - dict, (uInt)dict);
 	}
+	ret = deflate_buf(&strm, b->in + start, len,
+			i + 1 < b->n ? Z_SYNC_FLUSH : Z_FINISH, out);
+	deflateEnd(&strm);
+	return ret;
+}
+
+/*
+ * Deflate the blocks, until none are left or an error occurred.
+ */
+static void *
+deflate_worker(void *arg)
+{
+	int		ret = Z_OK;
+	size_t		i;
+	struct blocks	*b = arg;
+
+	for (;;) {
+#ifdef HAVE_PTHREAD_H
+		pthread_mutex_lock(&b->lock);
+#endif
+		if (ret != Z_OK && b->ret == Z_OK)
+			b->ret = ret;
+		i = b->ret == Z_OK ? b->next++ : b->n;
+#ifdef HAVE_PTHREAD_H
+		pthread_mutex_unlock(&b->lock);
+#endif
+		if (i >= b->n)
+			break;
+		ret = deflate_block(b, i);
+	}
+	return NULL;
+}
+
+#ifdef HAVE_PTHREAD_H
+/*
+ * Return the number of threads to use for n blocks.
+ */
+static int
+num_threads(size_t n)
+{
+	long	procs = 1;
+
+#if defined HAVE_UNISTD_H && defined _SC_NPROCESSORS_ONLN
+	procs = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	if (procs > MAX_THREADS)
+		procs = MAX_THREADS;
+	if ((size_t)procs > n)
+		procs = (long)n;
+	return procs > 1 ? (int)procs : 1;
+}
+#endif
+
+/*
+ * Deflate the len bytes at in, in blocks, into out.
+ */
+static int
+deflate_blocks(unsigned char *in, size_t len, int level, int memlevel,
+		int strategy, struct deflated *out)
+{
+	int		flevel;
+	size_t		i;
+	uLong		adler;
+	unsigned char	*o;
+	struct blocks	b;
+#ifdef HAVE_PTHREAD_H
+	int		t, nthreads;
+	pthread_t	thread[MAX_THREADS];
+#endif
 
-	/* Assign input and output for compression. */
-	strm.next_in = in;
-	strm.next_out = buf;
-	strm.avail_out = (unsigned) sizeof buf;
-
-	/*
-	 * strm.avail_in is of type unsigned int, hence it can hold a maximum
-	 * number of UINT_MAX (= ZLIB_IN_MAX, see above) bytes, equal 4 GiB. */
-	if (len > ZLIB_IN_MAX) {
-		flush = Z_NO_FLUSH;
-		strm.avail_in = ZLIB_IN_MAX;
-		len -= strm.avail_in;
-	} else {
-		flush = Z_FINISH;
-		strm.avail_in = len;
+	b.in = in;
+	b.len = len;
+	b.n = (len + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	b.next = 0;
+	b.level = level;
+	b.memlevel = memlevel;
+	b.strategy = strategy;
+	b.ret = Z_OK;
+	b.out = calloc(b.n, sizeof(struct deflated));
+	b.adler = malloc(b.n * sizeof(uLong));
+	if (b.out == NULL || b.adler == NULL) {
+		free(b.out);
+		free(b.adler);
+		return Z_MEM_ERROR;
 	}
 
-	/*
-	 * Start compression.
-	 * Loop, as long as the output buffer can be completely filled.
-	 * This rests on the assumption that deflate() writes a number of
-	 * completely filled output buffers, and only the last one is probably
-	 * partially filled.
-	 */
-	while ((ret = deflate(&strm, flush)) == Z_OK && strm.avail_out == 0){
-		ascii85encode(out, buf, sizeof buf);
-		strm.avail_out = (unsigned) sizeof buf;
-		strm.next_out = buf;
-		if (flush != Z_FINISH) {
-			unsigned	possible = ZLIB_IN_MAX - strm.avail_in;
-			if (possible > len) {
-				strm.avail_in += len;
-				flush = Z_FINISH;
-			} else {
-				strm.avail_in = ZLIB_IN_MAX;
-				len -= possible;
-			}
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_init(&b.lock, NULL);
+	/* the calling thread deflates, too */
+	nthreads = num_threads(b.n) - 1;
+	for (t = 0; t < nthreads; ++t)
+		if (pthread_create(thread + t, NULL, deflate_worker, &b))
+			break;
+	nthreads = t;
+	deflate_worker(&b);
+	for (t = 0; t < nthreads; ++t)
+		pthread_join(thread[t], NULL);
+	pthread_mutex_destroy(&b.lock);
+#else
+	deflate_worker(&b);
+#endif
+
+	/* concatenate the zlib header, the blocks and the checksum */
+	if (b.ret == Z_OK) {
+		for (i = 0; i < b.n; ++i)
+			out->len += b.out[i].len;
+		out->len += 6;
+		if ((out->data = malloc(out->len)) == NULL)
+			b.ret = Z_MEM_ERROR;
+	}
+	if (b.ret == Z_OK) {
+		o = out->data;
+		/* deflate, 32 kB window, and the level; see RFC 1950 */
+		flevel = level == Z_DEFAULT_COMPRESSION ? 2 : level < 2 ? 0 :
+			level < 6 ? 1 : level == 6 ? 2 : 3;
+		*o++ = 0x78;
+		*o++ = (unsigned char)(flevel << 6);
+		o[-1] += 31 - (0x78 * 256 + o[-1]) % 31;
+		adler = adler32(0L, Z_NULL, 0);
+		for (i = 0; i < b.n; ++i) {
+			memcpy(o, b.out[i].data, b.out[i].len);
+			o += b.out[i].len;
+			adler = adler32_combine(adler, b.adler[i],
+				i + 1 < b.n ? BLOCK_SIZE :
+						(z_off_t)(len - i * BLOCK_SIZE));
 		}
+		*o++ = (unsigned char)(adler >> 24);
+		*o++ = (unsigned char)(adler >> 16);
+		*o++ = (unsigned char)(adler >> 8);
+		*o = (unsigned char)adler;
+		out->size = out->len;
 	}
-	if (ret == Z_STREAM_ERROR) {
-		if (strm.msg)
-			put_msg("Error while compressing image: %s", strm.msg);
-		else
-			put_msg("Error while compressing image.");
-		return Z_STREAM_ERROR;
+
+	for (i = 0; i < b.n; ++i)
+		free(b.out[i].data);
+	free(b.out);
+	free(b.adler);
+	return b.ret;
+}
+
+/*
+ * Deflate the len bytes at in into out. Return Z_OK on success.
+ */
+static int
+deflate_data(unsigned char *in, size_t len, int level, int memlevel,
+		int strategy, struct deflated *out)
+{
+	int		ret;
+	z_stream	strm;
+
+	out->data = NULL;
+	out->len = out->size = 0;
+	if (len >= BLOCKS_MIN * BLOCK_SIZE)
+		return deflate_blocks(in, len, level, memlevel, strategy, out);
+
+	strm.zalloc = Z_NULL;
+	strm.zfree = Z_NULL;
+	strm.opaque = Z_NULL;
+	if ((ret = deflateInit2(&strm, level, Z_DEFLATED, MAX_WBITS, memlevel,
+					strategy)) != Z_OK)
+		return ret;
+	out->size = len / 2 + 1024;
+	if ((out->data = malloc(out->size)) == NULL) {
+		deflateEnd(&strm);
+		return Z_MEM_ERROR;
 	}
-	if (ret == Z_BUF_ERROR && strm.avail_out == 0) {
-		put_msg("An unexpected error occurred, avail_out == 0 && "
-			"ret == Z_BUF_ERROR.\nPlease report this error.");
+	ret = deflate_buf(&strm, in, len, Z_FINISH, out);
+	deflateEnd(&strm);
+	return ret;
+}
+
+/*
+ * Write the deflated and ascii85 encoded bitmap data to out.
+ * Return 0 on success.
+ */
+int
+deflate_ascii85encode(FILE *out, unsigned char *in, size_t len)
+{
+	int		ret;
+	struct deflated	d;
+
+	/* By default, use the run-length encoding, as for png data. */
+	if (deflate_level < 0)
+		ret = deflate_data(in, len, Z_BEST_COMPRESSION, MAX_MEM_LEVEL,
+				Z_RLE, &d);
+	else
+		ret = deflate_data(in, len, deflate_level, MAX_MEM_LEVEL,
+				Z_DEFAULT_STRATEGY, &d);
+	if (ret != Z_OK) {
+		if (ret == Z_MEM_ERROR)
+			put_msg(Err_mem);
+		else
+			put_msg("Error while compressing image, zlib error %d.",
+					ret);
+		free(d.data);
+		return ret;
 	}
-	/* output the remainder */
-	if (ret == Z_STREAM_END && strm.avail_out != 0)
-		ascii85encode(out, buf, sizeof buf - strm.avail_out);
-
-	/* clean up */
-	if (deflateEnd(&strm) != Z_OK) {
-		if (strm.msg)
-			put_msg("Error after compression of image: %s.",
-					strm.msg);
+	ret = ascii85encode(out, d.data, d.len);
+	free(d.data);
+	return ret;
+}
+
+/*
+ * Deflate the len bytes at in into a newly allocated buffer *out, holding
+ * *outlen bytes. Return 0 on success. On failure, a message is written, and
+ * *out is NULL.
+ */
+int
+deflate_mem(unsigned char *in, size_t len, unsigned char **out, size_t *outlen)
+{
+	int		ret;
+	struct deflated	d;
+
+	ret = deflate_data(in, len, deflate_level < 0 ?
+				Z_DEFAULT_COMPRESSION : deflate_level,
+			8 /* the default memlevel */, Z_DEFAULT_STRATEGY, &d);
+	if (ret != Z_OK) {
+		if (ret == Z_MEM_ERROR)
+			put_msg(Err_mem);
 		else
-			put_msg("Error after compression of image.");
+			put_msg("Error while compressing data, zlib error %d.",
+					ret);
+		free(d.data);
+		*out = NULL;
+		*outlen = 0;
+		return ret;
 	}
+	*out = d.data;
+	*outlen = d.len;
 	return 0;
 }
 #endif	/* HAVE_ZLIB_H */
@@ -3,7 +3,7 @@
  * Copyright (c) 1991 by Micah Beck
  * Parts Copyright (c) 1985-1988 by Supoj Sutanthavibul
  * Parts Copyright (c) 1989-2015 by Brian V. Smith
- * Parts Copyright (c) 2015-2020 by Thomas Loimer
+ * Parts Copyright (c) 2015-2024 by Thomas Loimer
  *
  * Any party obtaining a copy of these files is granted, free of charge, a
  * full and unrestricted irrevocable, world-wide, paid up, royalty-free,
@@ -25,8 +25,12 @@
 #include <stdio.h>
 
 extern int	ascii85encode(FILE *out, unsigned char *in, size_t len);
+extern int	base64encode(FILE *out, const unsigned char *in, size_t len);
 #ifdef HAVE_ZLIB_H
+extern int	deflate_level;
 extern int	deflate_ascii85encode(FILE *out, unsigned char *in, size_t len);
+extern int	deflate_mem(unsigned char *in, size_t len, unsigned char **out,
+				size_t *outlen);
 #endif
 
 #endif
@@ -26,6 +26,10 @@
  *	has a driver for that language, or to ppm if otherwise. If the
  *	latter, either ppmtoxx, convert or gm convert is then called to
  *	make the final xxx file.
+ *
+ *	Ppm and png images are rendered without ghostscript, by raster.c,
+ *	from the page content of the pdf driver. Figures containing
+ *	embedded eps, pdf or jpeg files are still converted by ghostscript.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -37,12 +41,18 @@
 #include <string.h>
 #include <signal.h>
 #include <sys/wait.h>
+#ifdef HAVE_PNG_H
+#include <png.h>
+#endif
 
 #include "bool.h"
 #include "fig2dev.h"	/* includes bool.h and object.h */
 #include "colors.h"	/* lookup_X_color(), rgb2luminance() */
+#include "genpdf.h"
 #include "genps.h"
 #include "messages.h"
+#include "probe.h"
+#include "raster.h"
 #include "xtmpfile.h"
 
 /*
@@ -95,6 +105,10 @@ static char	*errfname = errfname_buf;
 static int	jpeg_quality = 75;
 static int	border_margin = 0;
 static int	smooth = 0;
+static bool	correct_font_size = false;
+static bool	force_gs = false;	/* -w, always use ghostscript */
+static bool	native;			/* rendered by raster.c */
+static int	width, height;
 
 void
 genbitmaps_option(char opt, char *optarg)
@@ -106,6 +120,7 @@ genbitmaps_option(char opt, char *optarg)
 		break;
 
 	case 'F':
+		correct_font_size = true;
 		gen_ps_eps_option(opt, optarg);
 		break;
 
@@ -158,6 +173,10 @@ genbitmaps_option(char opt, char *optarg)
 		}
 		break;
 
+	case 'w':
+		force_gs = true;
+		break;
+
 	case 'G':
 	case 'L':
 		break;
@@ -177,39 +196,22 @@ genbitmaps_option(char opt, char *optarg)
 static bool
 has_netpbm(const char *cmd)
 {
-	FILE	      *f;
 	unsigned char img[] = "P6 2 2 255 \xff\xff\xff\xff\0\0\0\0\xff\0\0\0\n";
 
-	f = popen(cmd, "w");
-	if (f == NULL)
-		return false;
-
 	/* the terminating '\0' does not need to be written */
-	if (fwrite(img, sizeof img - 1, 1, f) != 1)
-		return false;
-
-	if (pclose(f) == 0)
-		return true;
-	else
-		return false;
+	return probe_pipe(cmd, img, sizeof img - 1);
 }
 
 static bool
 has_ImageMagick(void)
 {
-	if (system("convert -version >/dev/null") == 0)
-		return true;
-	else
-		return false;
+	return probe_command("convert -version >/dev/null");
 }
 
 static bool
 has_GraphicsMagick(void)
 {
-	if (system("gm version >/dev/null") == 0)
-		return true;
-	else
-		return false;
+	return probe_command("gm version >/dev/null");
 }
 
 static void
@@ -223,8 +225,52 @@ bitmaps_broken_pipe(int sig)
 }
 #endif /* GSEXE */
 
-void
-genbitmaps_start(F_compound *objects)
+/* return true, if visible text is among the objects */
+static bool
+has_text(F_compound *ob)
+{
+	F_text		*t;
+	F_compound	*c;
+
+	for (t = ob->texts; t != NULL; t = t->next)
+		if (depth_filter(t->depth) && !hidden_text(t))
+			return true;
+	for (c = ob->compounds; c != NULL; c = c->next)
+		if (has_text(c))
+			return true;
+	return false;
+}
+
+/*
+ * Return true, if the figure can be rendered without ghostscript. If
+ * ghostscript is available, it is used for the objects that raster.c can
+ * not draw. Without fonts, text is only drawn by ghostscript.
+ */
+static bool
+can_render(F_compound *objects)
+{
+	if (force_gs)
+		return false;
+	if (strcmp(lang, "ppm")
+#ifdef HAVE_PNG_H
+			&& strcmp(lang, "png")
+#endif
+			)
+		return false;
+	if (!raster_has_fonts() && has_text(objects))
+		return false;
+#ifdef GSEXE
+	if (genpdf_needs_gs(objects, true))
+		return false;
+#endif
+	return true;
+}
+
+/*
+ * Convert the figure with ghostscript, and possibly with a further program.
+ */
+static void
+start_gs(F_compound *objects)
 {
 #ifdef GSEXE /* bracket the entire function */
 	char	*gsdev;
@@ -239,15 +285,6 @@ genbitmaps_start(F_compound *objects)
 	char	*netend;
 	char	*gimend;	/* GrapicsMagick, ImageMagick End */
 	int	n;
-	int	width;
-	int	height;
-
-	n = (int)(border_margin * THICK_SCALE + 0.9);
-	llx -= n;	lly -= n;
-	urx += n;	ury += n;
-	width = (int)(mag * (urx - llx) / THICK_SCALE + 0.9),
-	height = (int)(mag * (ury - lly) / THICK_SCALE + 0.9);
-
 
 	/* set the format strings of the final output, depending on
 	   whether it goes to a file or to stdout */
@@ -275,6 +312,9 @@ genbitmaps_start(F_compound *objects)
 		*antialias = '\0';
 
 	/* create a temporary file to catch standard error */
+	com = com_buf;
+	strcpy(errfname_buf, "f2derrorXXXXXX");
+	errfname = errfname_buf;
 	if ((errfile = xtmpfile(&errfname, sizeof errfname_buf)) == NULL) {
 		fprintf(stderr, "Can't create error log file %s\n",
 				errfname);
@@ -512,17 +552,159 @@ genbitmaps_start(F_compound *objects)
 	epsflag = true;
 	genps_start(objects);
 #else
+	if (!raster_has_fonts() && has_text(objects))
+		fputs("This fig2dev is compiled without FreeType, text needs "
+				"ghostscript.\n", stderr);
 	fputs("Ghostscript command not available. Cannot create bitmaps.\n",
 		stderr);
 	exit(EXIT_FAILURE);
 #endif	/* #ifdef GSEXE */
 }
 
+void
+genbitmaps_start(F_compound *objects)
+{
+	int	n;
+
+	n = (int)(border_margin * THICK_SCALE + 0.9);
+	llx -= n;	lly -= n;
+	urx += n;	ury += n;
+	width = (int)(mag * (urx - llx) / THICK_SCALE + 0.9),
+	height = (int)(mag * (ury - lly) / THICK_SCALE + 0.9);
+
+	native = can_render(objects);
+	if (native) {
+		epsflag = true;
+		genpdf_raster_start(objects, correct_font_size);
+		return;
+	}
+	start_gs(objects);
+}
+
+static int
+write_ppm(struct raster *r)
+{
+	fprintf(tfp, "P6\n%d %d\n255\n", r->width, r->height);
+	fwrite(r->pixels, 3, (size_t)r->width * r->height, tfp);
+	if (fflush(tfp) || ferror(tfp)) {
+		err_msg("Error writing ppm output");
+		return -1;
+	}
+	return 0;
+}
+
+#ifdef HAVE_PNG_H
+static int
+write_png(struct raster *r)
+{
+	int		y;
+	png_structp	png_ptr;
+	png_infop	info_ptr;
+
+	png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING,
+			(png_voidp) NULL, NULL, NULL);
+	if (!png_ptr)
+		return -1;
+	info_ptr = png_create_info_struct(png_ptr);
+	if (!info_ptr) {
+		png_destroy_write_struct(&png_ptr, (png_infopp) NULL);
+		return -1;
+	}
+	if (setjmp(png_jmpbuf(png_ptr))) {
+		png_destroy_write_struct(&png_ptr, &info_ptr);
+		put_msg("Error writing png output");
+		return -1;
+	}
+	png_init_io(png_ptr, tfp);
+	png_set_IHDR(png_ptr, info_ptr, (png_uint_32)r->width,
+			(png_uint_32)r->height, 8, PNG_COLOR_TYPE_RGB,
+			PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
+			PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png_ptr, info_ptr);
+	for (y = 0; y < r->height; ++y)
+		png_write_row(png_ptr, r->pixels + 3 * (size_t)y * r->width);
+	png_write_end(png_ptr, info_ptr);
+	png_destroy_write_struct(&png_ptr, &info_ptr);
+	if (fflush(tfp) || ferror(tfp)) {
+		err_msg("Error writing png output");
+		return -1;
+	}
+	return 0;
+}
+#endif /* HAVE_PNG_H */
+
+/*
+ * Render the content written by the pdf driver, and write the image.
+ */
+static int
+render_end(void)
+{
+	int			status, missing;
+	size_t			i, len;
+	const char		*content;
+	unsigned char		bg[3] = {255, 255, 255};
+	const double		k = mag / THICK_SCALE;
+	/* Fig units to pixels, at 80 pixels per inch */
+	double			ctm[6] = {k, 0.0, 0.0, k, 0.0, 0.0};
+	struct raster		r;
+	/* the patterns are drawn in PostScript points, at 80 dpi */
+	struct raster_resources	res = {
+		genpdf_raster_pattern, genpdf_raster_image, genpdf_raster_font,
+		{80.0 / 72.0, 0.0, 0.0, -80.0 / 72.0, 0.0, 0.0}
+	};
+
+	ctm[4] = -llx * k;
+	ctm[5] = -lly * k;
+	r.width = width > 0 ? width : 1;
+	r.height = height > 0 ? height : 1;
+	res.pattern_matrix[5] = r.height;
+	if ((r.pixels = malloc(3 * (size_t)r.width * r.height)) == NULL) {
+		put_msg(Err_mem);
+		exit(EXIT_FAILURE);
+	}
+
+	if (bgspec) {
+		bg[0] = (unsigned char)(background.red >> 8);
+		bg[1] = (unsigned char)(background.green >> 8);
+		bg[2] = (unsigned char)(background.blue >> 8);
+	}
+	for (i = 0; i < (size_t)r.width * r.height; ++i)
+		memcpy(r.pixels + 3 * i, bg, 3);
+
+	content = genpdf_raster_content(&len);
+	missing = raster_render(&r, ctm, smooth > 1 ? smooth : 1, content, len,
+			&res);
+	if (genpdf_raster_end())
+		missing = -1;
+
+	/* the pictures are still in color */
+	if (grayonly) {
+		for (i = 0; i < 3 * (size_t)r.width * r.height; i += 3)
+			r.pixels[i] = r.pixels[i + 1] = r.pixels[i + 2] =
+				(unsigned char)(255.0 * rgb2luminance(
+						r.pixels[i] / 255.0,
+						r.pixels[i + 1] / 255.0,
+						r.pixels[i + 2] / 255.0) + 0.5);
+	}
+
+#ifdef HAVE_PNG_H
+	if (!strcmp(lang, "png"))
+		status = write_png(&r);
+	else
+#endif
+		status = write_ppm(&r);
+	free(r.pixels);
+	return status ? status : missing;
+}
+
 int
 genbitmaps_end(void)
 {
 	int	status;
 
+	if (native)
+		return render_end();
+
 	/* wrap up the postscript output */
 	if (genps_end() != 0) {
 		/* but genps_end() does not return anything else than 0! */
@@ -579,15 +761,70 @@ genbitmaps_end(void)
 	return status;
 }
 
+static void
+genbitmaps_grid(float major, float minor)
+{
+	if (native)
+		genpdf_grid(major, minor);
+	else
+		genps_grid(major, minor);
+}
+
+static void
+genbitmaps_arc(F_arc *a)
+{
+	if (native)
+		genpdf_arc(a);
+	else
+		genps_arc(a);
+}
+
+static void
+genbitmaps_ellipse(F_ellipse *e)
+{
+	if (native)
+		genpdf_ellipse(e);
+	else
+		genps_ellipse(e);
+}
+
+static void
+genbitmaps_line(F_line *l)
+{
+	if (native)
+		genpdf_line(l);
+	else
+		genps_line(l);
+}
+
+static void
+genbitmaps_spline(F_spline *s)
+{
+	if (native)
+		genpdf_spline(s);
+	else
+		genps_spline(s);
+}
+
+static void
+genbitmaps_text(F_text *t)
+{
+	if (native)
+		genpdf_text(t);
+	else
+		genps_text(t);
+}
+
 struct driver dev_bitmaps = {
 	genbitmaps_option,
 	genbitmaps_start,
-	genps_grid,
-	genps_arc,
-	genps_ellipse,
-	genps_line,
-	genps_spline,
-	genps_text,
+	genbitmaps_grid,
+	genbitmaps_arc,
+	genbitmaps_ellipse,
+	genbitmaps_line,
+	genbitmaps_spline,
+	genbitmaps_text,
 	genbitmaps_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	NO_STREAM
 };
@@ -74,5 +74,6 @@ struct driver dev_box = {
 	(void (*)(F_spline *))gendev_null,
 	(void (*)(F_text *))gendev_null,
 	genbox_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	STREAM_OBJECTS
 };
@@ -92,6 +92,23 @@ static	bool	 binary_output = false;	/* default is ASCII output */
 static	FILE	*saveofile;	/* used when piping to ralcgm for binary output */
 static	char	 *cgmcom;
 
+/* sets CGM interior style */
+typedef enum {SOLID, HOLLOW, HATCH, EMPTY, UNDEF} INTSTYLE;
+
+/* the attributes last written, see chkcache() */
+static struct attributes {
+	int	 linetype, edgetype;
+	int	 linewidth, edgewidth;
+	int	 linecolor, edgecolor;
+	int	 edgevis;
+	INTSTYLE intstyle;
+	int	 fillcolor, fillrgb;
+	int	 hatchindex;
+	int	 texttype, textfont, textcolor;
+	double	 textsize, textangle;
+} old;
+static void	reset_attributes(void);
+
 static struct	_rgb {
 	float r, g, b;
 }
@@ -147,6 +164,7 @@ gencgm_start(F_compound *objects)
 	char	*p, *figname;
 	char	*figname_buf = NULL;
 
+	reset_attributes();
 	if (from) {
 		figname_buf = strdup(from);
 		figname = figname_buf;
@@ -365,9 +383,7 @@ conv_linetype(int type)
 static void
 linetype(int type)
 {
-	static int oldtype = UNDEFVALUE;
-
-	chkcache(type, oldtype);
+	chkcache(type, old.linetype);
 	type = conv_linetype(type);
 	fprintf(tfp, "linetype %d;\n", type+1);
 }
@@ -375,9 +391,7 @@ linetype(int type)
 static void
 edgetype(int type)
 {
-	static int oldtype = UNDEFVALUE;
-
-	chkcache(type, oldtype);
+	chkcache(type, old.edgetype);
 	type = conv_linetype(type);
 	fprintf(tfp, "edgetype %d;\n", type+1);
 }
@@ -385,18 +399,14 @@ edgetype(int type)
 static void
 linewidth(int width)
 {
-	static int oldwidth = UNDEFVALUE;
-
-	chkcache(width, oldwidth);
+	chkcache(width, old.linewidth);
 	fprintf(tfp, "linewidth %d;\n", width);
 }
 
 static void
 edgewidth(int width)
 {
-	static int oldwidth = UNDEFVALUE;
-
-	chkcache(width, oldwidth);
+	chkcache(width, old.edgewidth);
 	fprintf(tfp, "edgewidth %d;\n", width);
 }
 
@@ -418,9 +428,7 @@ conv_color(int color)
 static void
 linecolr(int color)
 {
-	static int oldcolor = UNDEFVALUE;
-
-	chkcache(color, oldcolor);
+	chkcache(color, old.linecolor);
 	color = conv_color(color);
 	fprintf(tfp, "linecolr %d;\n", color);
 }
@@ -428,9 +436,7 @@ linecolr(int color)
 static void
 edgecolr(int color)
 {
-	static int oldcolor = UNDEFVALUE;
-
-	chkcache(color, oldcolor);
+	chkcache(color, old.edgecolor);
 	color = conv_color(color);
 	fprintf(tfp, "edgecolr %d;\n", color);
 }
@@ -438,12 +444,25 @@ edgecolr(int color)
 static void
 edgevis(int onoff)
 {
-	static int old = UNDEFVALUE;
-
-	chkcache(onoff, old);
+	chkcache(onoff, old.edgevis);
 	fprintf(tfp, "edgevis %s;\n", onoff ? "ON" : "OFF");
 }
 
+/* forget the attributes written to a previous output file */
+static void
+reset_attributes(void)
+{
+	old.linetype = old.edgetype = UNDEFVALUE;
+	old.linewidth = old.edgewidth = UNDEFVALUE;
+	old.linecolor = old.edgecolor = UNDEFVALUE;
+	old.edgevis = UNDEFVALUE;
+	old.intstyle = UNDEF;
+	old.fillcolor = old.fillrgb = UNDEFVALUE;
+	old.hatchindex = UNDEFVALUE;
+	old.texttype = old.textfont = old.textcolor = UNDEFVALUE;
+	old.textsize = old.textangle = UNDEFVALUE;
+}
+
 static void
 lineattr(int type, int width, int color)
 {
@@ -463,14 +482,10 @@ edgeattr(int vis, int type, int width, int color)
 
 /* sets CGM interior style */
 
-typedef enum {SOLID, HOLLOW, HATCH, EMPTY, UNDEF} INTSTYLE;
-
 static void
 intstyle(INTSTYLE style)
 {
-	static INTSTYLE oldstyle = UNDEF;
-
-	chkcache(style, oldstyle);
+	chkcache(style, old.intstyle);
 
 	switch (style) {
 	case HOLLOW:
@@ -490,14 +505,12 @@ intstyle(INTSTYLE style)
 				style); }
 }
 
-static int oldfillcolor = UNDEFVALUE;
-
 /* updates unconditionally */
 
 static void
 _fillcolr(int color)
 {
-	oldfillcolor = color;
+	old.fillcolor = color;
 	color = conv_color(color);
 	fprintf(tfp, "fillcolr %d;\n", color);
 }
@@ -507,7 +520,7 @@ _fillcolr(int color)
 static void
 fillcolr(int color)
 {
-	chkcache(color, oldfillcolor);
+	chkcache(color, old.fillcolor);
 	_fillcolr(color);
 }
 
@@ -516,10 +529,9 @@ fillcolr(int color)
 
 static void fillcolrgb(int r, int g, int b)
 {
-	static int oldrgb = UNDEFVALUE;
 	int rgb = (r * 256 + g) * 256 + b;
-	if (rgb != oldrgb) {
-		oldrgb = rgb;
+	if (rgb != old.fillrgb) {
+		old.fillrgb = rgb;
 		fprintf(tfp, "colrtable %d %d %d %d;\n",
 				conv_color(FILL_COLOR_INDEX), r, g, b);
 		_fillcolr(FILL_COLOR_INDEX);
@@ -539,9 +551,7 @@ static int conv_pattern_index(int index)
 static void
 hatchindex(int index)
 {
-	static int oldindex = UNDEFVALUE;
-
-	chkcache(index, oldindex);
+	chkcache(index, old.hatchindex);
 	index = conv_pattern_index(index);
 	fprintf(tfp, "hatchindex %d;\n", index);
 }
@@ -1373,8 +1383,7 @@ gencgm_arc(F_arc *_a)
 static void
 texttype(int type)
 {
-	static int oldtype = UNDEFVALUE;
-	chkcache(type, oldtype);
+	chkcache(type, old.texttype);
 	switch (type) {
 	case T_LEFT_JUSTIFIED:
 		fprintf(tfp, "textalign left base 0.0 0.0;\n");
@@ -1422,17 +1431,15 @@ conv_fontindex(int font, int flags)
 static void
 textfont(int font, int flags)
 {
-	static int oldfont = UNDEFVALUE;
 	font = conv_fontindex(font, flags);	/* first convert it ... */
-	chkcache(font, oldfont);
+	chkcache(font, old.textfont);
 	fprintf(tfp, "textfontindex %d;\n", font);
 }
 
 static void
 textcolr(int color)
 {
-	static int oldcolor = UNDEFVALUE;
-	chkcache(color, oldcolor);
+	chkcache(color, old.textcolor);
 	color = conv_color(color);
 	fprintf(tfp, "textcolr %d;\n", color);
 }
@@ -1440,8 +1447,7 @@ textcolr(int color)
 static void
 textsize(double size)
 {
-	static double oldsize = UNDEFVALUE;
-	chkcache(size, oldsize);
+	chkcache(size, old.textsize);
 	/* adjust for any differences in ppi (Fig 2.x vs 3.x) */
 	fprintf(tfp, "charheight %d;\n",
 			round( 10 * size * ppi / 1200.0 / fontmag));
@@ -1451,8 +1457,7 @@ static void
 textangle(double angle)
 {
 	int c, s;
-	static double oldangle = UNDEFVALUE;
-	chkcache(angle, oldangle);
+	chkcache(angle, old.textangle);
 	c = round(1200*cos(angle)); s = round(1200*sin(angle));
 	fprintf(tfp, "charori (%d,%d) (%d,%d);\n", -s, c, c, s);
 }
@@ -1498,5 +1503,6 @@ struct driver dev_cgm = {
 	gencgm_spline,
 	gencgm_text,
 	gencgm_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	NO_STREAM
 };
@@ -214,6 +214,9 @@ gendxf_start(F_compound *objects)
 	    exit(1);
 	    }
 
+	line_style = SOLID_LINE;
+	dash_length = DEFAULT;
+
 	if (metric) {
 		figtodxf = mag * 25.4 / ppi;	/* mm per fig unit */
 		cm = mag * 10;			/* mm per cm */
@@ -792,5 +795,6 @@ struct driver dev_dxf = {
 	gendxf_spline,
 	gendxf_text,
 	gendxf_end,
-	EXCLUDE_TEXT
+	EXCLUDE_TEXT,
+	NO_STREAM
 };
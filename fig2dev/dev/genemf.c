@@ -68,6 +68,7 @@
 #include "config.h"
 #endif
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -85,6 +86,7 @@
 #include "genemf.h"
 #include "messages.h"
 #include "pi.h"
+#include "piccache.h"
 #include "readpics.h"
 
 #define UNDEFVALUE	-100	/* UNDEFined attribute value */
@@ -102,6 +104,15 @@ static unsigned emh_nBytes;	/* Size of the metafile in bytes */
 static unsigned emh_nRecords;	/* Number of records in the metafile */
 static unsigned emh_nHandles;	/* Number of handles in the handle table */
 
+/*
+ * The records are collected in emh_buf and written in blocks of at least
+ * EMH_BLOCK bytes. The buffer grows, if a single record is larger.
+ */
+#define	EMH_BLOCK	65536
+static unsigned char *emh_buf = NULL;
+static size_t emh_len;		/* Number of bytes in emh_buf */
+static size_t emh_size;		/* Allocated size of emh_buf */
+
 /*
  * Limit maximum number of handles.
  * XXX limit to which number?
@@ -113,6 +124,13 @@ enum emfhandletype { EMFH_PEN, EMFH_BRUSH, EMFH_FONT, EMFH_MAX } type;
 
 static unsigned lasthandle[EMFH_MAX];	/* Last device handle */
 
+/* Last device context settings, see bkmode(), bkcolor(), textcolr() and
+   textalign() */
+static int oldbkmode;
+static int oldbkcolor;
+static int oldtextcolor;
+static int oldtextalign;
+
 struct emfhandle {
 	struct emfhandle *next;	/* This field must be first */
 	struct emfhandle **prev;
@@ -712,6 +730,8 @@ static int icprod(int x1, int y1, int x2, int y2);
 static int cwarc(F_arc *a);
 static int direction(F_point *p, F_point *q, Dir *dir, double *dist);
 static double distance(double x1, double y1, double x2, double y2);
+static void emh_flush(void);
+static unsigned char *emh_reserve(size_t n, emh_flag flag);
 static size_t emh_write(const void *ptr, size_t size, size_t nmemb,
 			emh_flag flag);
 static int is_flip(int rot, int flip);
@@ -1225,7 +1245,6 @@ edgevis(int onoff)
 static void
 bkmode(int mode)
 {
-	static int oldbkmode = 0;
 	EMRSETBKMODE em_bm;
 
 	chkcache(mode, oldbkmode);
@@ -1245,7 +1264,6 @@ bkmode(int mode)
 static void
 bkcolor(int rgb)
 {
-	static int oldbkcolor = UNDEFVALUE;
 	EMRSETBKCOLOR em_bc;
 
 	chkcache(rgb, oldbkcolor);
@@ -2232,6 +2250,7 @@ rotated_ellipse(F_ellipse *e)
 
 	/* setup other fields */
 	l.points = pnt;
+	l.pos = NULL;
 	l.type = T_POLYGON;
 
 	/* just in case... */
@@ -2295,14 +2314,49 @@ distance(double x1, double y1, double x2, double y2)
 }/* end distance */
 
 
-/* Write an enhanced metarecord and keep track of number of bytes written
- * and number of records written in the global header record "emh". */
+/* Write the buffered records to the output file. */
+static void
+emh_flush(void)
+{
+	if (emh_len > 0)
+		fwrite(emh_buf, (size_t)1, emh_len, tfp);
+	emh_len = 0;
+}/* end emh_flush */
+
+
+/* Reserve n bytes at the end of the buffered records and return their
+ * position. Keep track of number of bytes written and number of records
+ * written in the global header record "emh". */
+static unsigned char *
+emh_reserve(size_t n, emh_flag flag)
+{
+	unsigned char *p;
+
+	if (emh_len > 0 && emh_len + n > EMH_BLOCK)
+		emh_flush();
+	if (n > emh_size || emh_buf == NULL) {
+		emh_size = n > EMH_BLOCK ? n : EMH_BLOCK;
+		free(emh_buf);
+		if ((emh_buf = malloc(emh_size)) == NULL) {
+			put_msg(Err_mem);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (flag == EMH_RECORD) emh_nRecords++;
+	emh_nBytes += n;
+	p = emh_buf + emh_len;
+	emh_len += n;
+	return p;
+}/* end emh_reserve */
+
+
+/* Write an enhanced metarecord, or data belonging to a record. */
 static size_t
 emh_write(const void *ptr, size_t size, size_t nmemb, emh_flag flag)
 {
-	if (flag == EMH_RECORD) emh_nRecords++;
-	emh_nBytes += size * nmemb;
-	return fwrite(ptr, size, nmemb, tfp);
+	memcpy(emh_reserve(size * nmemb, flag), ptr, size * nmemb);
+	return nmemb;
 }/* end emh_write */
 
 
@@ -2313,19 +2367,24 @@ is_flip(int rot, int flip)
 }
 
 
+/*
+ * Write the scan lines of the bitmap. Each scan line is collected from the
+ * picture, which is possibly rotated or flipped, and packed into bytes in
+ * the buffer of the records.
+ */
 static void
 encode_bitmap(F_pic *pic, int bpp, int rot)
 {
 	int img_w = pic->bit_size.x;
 	int img_h = pic->bit_size.y;
 	int flip;
-	int i, initi, endi, diri;
+	int initi, diri, ncols, nrows;
 	int j, initj, endj, dirj;
-	int pos;
-	int freebits = 32;
-	unsigned bits = 0;
-	unsigned char cbits[4];
-	unsigned u;
+	int k;
+	size_t stride;		/* the length of a scan line, in bytes */
+	ptrdiff_t pos, step;
+	const unsigned char *bitmap = pic->bitmap;
+	unsigned char *row;
 
 	/*
 	 * Note: on EMF, you must output the image
@@ -2343,6 +2402,11 @@ encode_bitmap(F_pic *pic, int bpp, int rot)
 		/*NOTREACHED*/
 		break;
 	}
+	if (bpp != 1 && bpp != 4 && bpp != 8 && bpp != 24) {
+		/* should not happen */
+		fprintf(stderr, "unsupported bpp %d\n", bpp);
+		return;
+	}
 
 	if (pic->flipped && (rot == 0 || rot == 180)) {
 		diri = -diri;
@@ -2351,71 +2415,63 @@ encode_bitmap(F_pic *pic, int bpp, int rot)
 
 	flip = is_flip(rot, pic->flipped);
 
-	if (diri < 0) {
-		initi = img_w - 1; endi = 0;
-	} else {
-		initi = 0; endi = img_w - 1;
-	}
-	if (dirj < 0) {
-		initj = img_h - 1; endj = 0;
+	/*
+	 * normal: x: i, y: j, the scan lines are the rows of the picture
+	 * flip:   x: j, y: i, the scan lines are the columns
+	 */
+	if (flip) {
+		k = diri;
+		diri = dirj;
+		dirj = k;
+		ncols = img_h;
+		nrows = img_w;
+		step = (ptrdiff_t)diri * img_w;
 	} else {
-		initj = 0; endj = img_h - 1;
+		ncols = img_w;
+		nrows = img_h;
+		step = diri;
 	}
+	initi = diri < 0 ? ncols - 1 : 0;
+	initj = dirj < 0 ? nrows - 1 : 0;
+	endj = dirj < 0 ? -1 : nrows;
+
+	/* size of a line of EMF bitmap must be a multiple of 4 byte */
+	stride = ((size_t)ncols * bpp + 31) / 32 * 4;
 
-#   define SWAP(v1, v2) do { int tmp = v1; v1 = v2; v2 = tmp; } while (0)
-	if (flip) {
-		SWAP(initi, initj);
-		SWAP(endi, endj);
-		SWAP(diri, dirj);
-	}
-#   undef SWAP
-
-#   define WRITEBITS	\
-	do {/* MSB first */						\
-		cbits[0] = bits >> 24; cbits[1] = bits >> 16;		\
-		cbits[2] = bits >> 8; cbits[3] = bits;			\
-		emh_write(cbits, (size_t) 4, (size_t) 1, EMH_DATA);	\
-		freebits = 32;						\
-		bits = 0;						\
-	} while (0)
-
-	endi += diri;
-	endj += dirj;
 	for (j = initj; j != endj; j += dirj) {
-		for (i = initi; i != endi; i += diri) {
-			/*
-			 * normal: x: i, y: j
-			 * flip:   x: j, y: i
-			 */
-			pos = flip ? i * img_w + j : j * img_w + i;
-
-			switch (bpp) {
-			case 1: case 4: case 8:
-				freebits -= bpp;
-				bits |= pic->bitmap[pos] << freebits;
-				if (freebits == 0)
-					WRITEBITS;
-				break;
-			case 24:
-				for (u = 0; u < 3; u++) {
-					freebits -= 8;
-					bits |= pic->bitmap[pos*3 + u] <<
-								freebits;
-					if (freebits == 0)
-						WRITEBITS;
-				}
-				break;
-			default:
-				/* should not happen */
-				fprintf(stderr, "unsupported bpp %d\n", bpp);
+		/* the position of the first pixel of the scan line */
+		pos = flip ? (ptrdiff_t)initi * img_w + j :
+				(ptrdiff_t)j * img_w + initi;
+		row = emh_reserve(stride, EMH_DATA);
+		memset(row, 0, stride);
+
+		switch (bpp) {
+		case 1:		/* MSB first */
+			for (k = 0; k < ncols; ++k, pos += step)
+				row[k >> 3] |= (bitmap[pos] & 1) << (7 - (k & 7));
+			break;
+		case 4:
+			for (k = 0; k < ncols; ++k, pos += step)
+				row[k >> 1] |= (bitmap[pos] & 15) <<
+							(k & 1 ? 0 : 4);
+			break;
+		case 8:
+			for (k = 0; k < ncols; ++k, pos += step)
+				row[k] = bitmap[pos];
+			break;
+		case 24:
+			if (step == 1) {
+				memcpy(row, bitmap + 3 * pos, (size_t)ncols * 3);
 				break;
 			}
+			for (k = 0; k < ncols; ++k, pos += step) {
+				row[3*k] = bitmap[3*pos];
+				row[3*k + 1] = bitmap[3*pos + 1];
+				row[3*k + 2] = bitmap[3*pos + 2];
+			}
+			break;
 		}
-		/* size of a line of EMF bitmap must be a multiple of 4 byte */
-		if (freebits != 32)
-			WRITEBITS;
 	}
-#   undef WRITEBITS
 }
 
 
@@ -2434,6 +2490,7 @@ picbox(F_line *l)
 	static RGBQUAD coltab[256];
 	unsigned u;
 	int flip;
+	int pllx, plly;
 	struct xfig_stream	pic_stream;
 
 	dx = l->points->next->next->x - l->points->x;
@@ -2450,6 +2507,24 @@ picbox(F_line *l)
 
 	init_stream(&pic_stream);
 
+	if (find_stream(l->pic->file, &pic_stream)) {
+		put_msg("fig2dev: %s: No such picture file", l->pic->file);
+		free_stream(&pic_stream);
+		return;
+	}
+
+	memset(&em_sd, 0, sizeof(EMRSTRETCHDIBITS));
+	em_sd.emr.iType = htofl(EMR_STRETCHDIBITS);
+
+	memset(&bmi, 0, sizeof(BITMAPINFO));
+	bmi.bmiHeader.biSize = htofl(sizeof(BITMAPINFOHEADER));
+
+	/* re-use the image, if it was decoded before */
+	if (piccache_get(l->pic, pic_stream.name_on_disk, &pllx, &plly)) {
+		free_stream(&pic_stream);
+		goto decoded;
+	}
+
 	if (open_stream(l->pic->file, &pic_stream) == NULL) {
 		put_msg("fig2dev: %s: No such picture file", l->pic->file);
 		free_stream(&pic_stream);
@@ -2462,16 +2537,9 @@ picbox(F_line *l)
 		return;
 	}
 
-	memset(&em_sd, 0, sizeof(EMRSTRETCHDIBITS));
-	em_sd.emr.iType = htofl(EMR_STRETCHDIBITS);
-
-	memset(&bmi, 0, sizeof(BITMAPINFO));
-	bmi.bmiHeader.biSize = htofl(sizeof(BITMAPINFOHEADER));
-
 #ifdef HAVE_PNG_H
 	if (strncmp(buf, "\211\120\116\107\015\012\032\012", 8) == 0) {
 		/* png file */
-		int pllx, plly;
 		if (rewind_stream(&pic_stream) == NULL) {
 			err_msg("fig2dev: error rewinding image file %s",
 					l->pic->file);
@@ -2484,11 +2552,14 @@ picbox(F_line *l)
 			free_stream(&pic_stream);
 			return;
 		}
+		piccache_put(l->pic, pic_stream.name_on_disk, pllx, plly);
 	}
 #endif
 	close_stream(&pic_stream);
 	free_stream(&pic_stream);
 
+decoded:
+
 	if (l->pic->subtype == P_GIF || l->pic->subtype == P_PCX ||
 			l->pic->subtype == P_JPEG || l->pic->subtype == P_PNG) {
 
@@ -2727,7 +2798,8 @@ static int polyline_adjust(F_point *p, F_point *q, double l)
 static void
 polyline(F_line *l)
 {
-	F_point *p, *q, p0, pn;
+	F_pos *pts;
+	F_point p, q, p0, pn;
 	Dir dir;
 	double d;
 	EMRPOLYLINE em_pl;	/* Polyline in little endian format */
@@ -2738,20 +2810,29 @@ polyline(F_line *l)
 	int bbx_top, bbx_bottom, bbx_left, bbx_right;	/* Bounding box */
 	unsigned cpt;	/* Number of points in the array */
 	unsigned u;
+	int n, first;	/* Number of points, index of the first point drawn */
 
 	/* Calculate the number of points and the bounding box. */
-	if (!(p = l->points)) return;
-	bbx_left = p->x;
-	bbx_top  = p->y;
-	bbx_right  = p->x;
-	bbx_bottom = p->y;
-	for (cpt = 0, q = p; p; q = p, p = p->next) {
-		UPDATE_BBX_X(p->x);
-		UPDATE_BBX_Y(p->y);
-		cpt++;
-	}
-	p0 = *l->points;	/* first point */
-	pn = *q;		/* last point */
+	if (!(pts = line_points(l, &n))) return;
+	bbx_left = pts[0].x;
+	bbx_top  = pts[0].y;
+	bbx_right  = pts[0].x;
+	bbx_bottom = pts[0].y;
+	for (u = 1; u < (unsigned)n; u++) {
+		UPDATE_BBX_X(pts[u].x);
+		UPDATE_BBX_Y(pts[u].y);
+	}
+	cpt = n;
+	first = 0;
+	/* first point */
+	p0.x = pts[0].x;
+	p0.y = pts[0].y;
+	p0.next = NULL;
+	/* last point */
+	pn.x = pts[n-1].x;
+	pn.y = pts[n-1].y;
+	pn.next = NULL;
+	q.next = NULL;
 
 	if (cpt == 1) {
 		/* Draw single point as a short line. */
@@ -2764,41 +2845,50 @@ polyline(F_line *l)
 		if (l->back_arrow) {		/* First point with arrow */
 			alen = arrow_length(l->back_arrow);
 			while (cpt > 1) {
-				q = p0.next;
-				seglen = distance((double)p0.x, (double)p0.y, (double)q->x, (double)q->y);
+				q.x = pts[first+1].x;
+				q.y = pts[first+1].y;
+				seglen = distance((double)p0.x, (double)p0.y, (double)q.x, (double)q.y);
 				if (seglen > alen) {
 					break;
 				} else {
 					/* delete this segment */
 					cpt--;
-					p0 = *q;
+					first++;
+					p0 = q;
 					alen -= seglen;
 				}
 			}
 			if (cpt > 1)
 				/* shorten line segment */
-				polyline_adjust(&p0, p0.next, alen);
+				polyline_adjust(&p0, &q, alen);
 		}
 		if (l->for_arrow) {	/* Last point with arrow */
 			alen = arrow_length(l->for_arrow);
 			while (cpt > 1) {
-				for (p = &p0, u = cpt; --u > 0;
-						q = p, p = p->next)
-					;
-				seglen = distance((double)p->x, (double)p->y,
-						(double)q->x, (double)q->y);
+				/* the last and the one but last point */
+				u = first + cpt - 1;
+				p.x = pts[u].x;
+				p.y = pts[u].y;
+				if (cpt == 2) {
+					q = p0;
+				} else {
+					q.x = pts[u-1].x;
+					q.y = pts[u-1].y;
+				}
+				seglen = distance((double)p.x, (double)p.y,
+						(double)q.x, (double)q.y);
 				if (seglen > alen) {
 					break;
 				} else {
 					/* delete this segment */
 					cpt--;
-					pn = *q;
+					pn = q;
 					alen -= seglen;
 				}
 			}
 			if (cpt > 1)
 				/* shorten line segment */
-				polyline_adjust(&pn, q, alen);
+				polyline_adjust(&pn, &q, alen);
 		}
 		if (cpt <= 1)		/* if all line segments are removed, */
 			goto draw_arrows;	/* skip drawing line segments */
@@ -2830,12 +2920,14 @@ polyline(F_line *l)
 			perror("fig2dev: malloc");
 			exit(1);
 		}
-		for (p = &p0, u = 0; u + 1 < cpt; p= p->next, u++) {
-			apts[u].x = htofs(p->x);
-			apts[u].y = htofs(p->y);
+		apts[0].x = htofs(p0.x);
+		apts[0].y = htofs(p0.y);
+		for (u = 1; u + 1 < cpt; u++) {
+			apts[u].x = htofs(pts[first+u].x);
+			apts[u].y = htofs(pts[first+u].y);
 		}
-		apts[u].x = htofs(pn.x);
-		apts[u].y = htofs(pn.y);
+		apts[cpt-1].x = htofs(pn.x);
+		apts[cpt-1].y = htofs(pn.y);
 
 		em_pl.emr.iType = htofl(EMR_POLYLINE16);
 		HTOFL(em_pl.emr.nSize, sizeof(EMRPOLYLINE16) +
@@ -2859,12 +2951,14 @@ polyline(F_line *l)
 			perror("fig2dev: malloc");
 			exit(1);
 		}
-		for (p = &p0, u = 0; u + 1 < cpt; p= p->next, u++) {
-			aptl[u].x = htofl(p->x);
-			aptl[u].y = htofl(p->y);
+		aptl[0].x = htofl(p0.x);
+		aptl[0].y = htofl(p0.y);
+		for (u = 1; u + 1 < cpt; u++) {
+			aptl[u].x = htofl(pts[first+u].x);
+			aptl[u].y = htofl(pts[first+u].y);
 		}
-		aptl[u].x = htofl(pn.x);
-		aptl[u].y = htofl(pn.y);
+		aptl[cpt-1].x = htofl(pn.x);
+		aptl[cpt-1].y = htofl(pn.y);
 
 		em_pl.emr.iType = htofl(EMR_POLYLINE);
 		HTOFL(em_pl.emr.nSize,
@@ -2876,7 +2970,7 @@ polyline(F_line *l)
 	}
 
 draw_arrows:
-	if (!l->points->next) {
+	if (n < 2) {
 		if (l->for_arrow || l->back_arrow)
 			fprintf(stderr, "Warning: Arrow at "
 					"zero-length line segment omitted.\n");
@@ -2885,19 +2979,23 @@ draw_arrows:
 
 
 	if (l->back_arrow) {
-		p = l->points;
-		q = l->points->next;
-		if (direction(p, q, &dir, &d)) {
-			arrow(p, l->back_arrow, l, &dir);
+		p.x = pts[0].x;
+		p.y = pts[0].y;
+		q.x = pts[1].x;
+		q.y = pts[1].y;
+		if (direction(&p, &q, &dir, &d)) {
+			arrow(&p, l->back_arrow, l, &dir);
 		}
 	}
 
 	if (l->for_arrow) {
-		/* TODO: replace this by line->last[] points */
-		for (q=l->points, p=l->points->next; p->next; q=p, p=p->next) {}
+		p.x = pts[n-1].x;
+		p.y = pts[n-1].y;
 		/* q is the one but last point */
-		if (direction(p, q, &dir, &d)) {
-			arrow(p, l->for_arrow, l, &dir);
+		q.x = pts[n-2].x;
+		q.y = pts[n-2].y;
+		if (direction(&p, &q, &dir, &d)) {
+			arrow(&p, l->for_arrow, l, &dir);
 		}
 	}
 }/* end polyline */
@@ -3121,11 +3219,10 @@ text(
 static void
 textcolr(int color)
 {
-	static int oldcolor = UNDEFVALUE;
 	EMRSETTEXTCOLOR em_tc;
 
 	bkmode(TRANSPARENT);		/* fig doesn't have text background */
-	chkcache(color, oldcolor);
+	chkcache(color, oldtextcolor);
 
 	memset(&em_tc, 0, sizeof(EMRSETTEXTCOLOR));
 	em_tc.emr.iType = htofl(EMR_SETTEXTCOLOR);
@@ -3143,10 +3240,9 @@ textcolr(int color)
 static void
 textalign(int align)
 {
-	static int oldalign = TA_LEFT|TA_TOP|TA_NOUPDATECP;/* startup default */
 	EMRSETTEXTALIGN em_ta;
 
-	chkcache(align, oldalign);
+	chkcache(align, oldtextalign);
 	em_ta.emr.iType = htofl(EMR_SETTEXTALIGN);
 	em_ta.emr.nSize = htofl(sizeof(EMRSETTEXTALIGN));
 	em_ta.iMode = htofl(align);
@@ -3253,11 +3349,18 @@ genemf_start(F_compound *objects)
 
 	emh.dSignature = htofl(ENHMETA_SIGNATURE);
 	emh.nVersion = htofl(ENHMETA_VERSION);
+	emh_nBytes = 0;
+	emh_nRecords = 0;
 	emh_nHandles = 0;
+	emh_len = 0;
 	handles = NULL;
 	latesthandle = (void *) &handles;
 
 	memset(lasthandle, 0, sizeof(lasthandle));/* Initialize the DC handles*/
+	oldbkmode = 0;
+	oldbkcolor = UNDEFVALUE;
+	oldtextcolor = UNDEFVALUE;
+	oldtextalign = TA_LEFT|TA_TOP|TA_NOUPDATECP;	/* startup default */
 
 	/* Create a description string. */
 
@@ -3634,6 +3737,10 @@ genemf_end(void)
 			emh_nBytes, emh_nRecords, emh_nHandles);
 # endif
 
+	emh_flush();
+	free(emh_buf);
+	emh_buf = NULL;
+
 	/* Rewrite the updated header record at the beginning of the file. */
 
 	emh.nBytes   = htofl(emh_nBytes);
@@ -3670,5 +3777,6 @@ struct driver dev_emf = {
 	genemf_spline,
 	genemf_text,
 	genemf_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	STREAM_OBJECTS
 };
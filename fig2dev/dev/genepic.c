@@ -165,6 +165,7 @@ static char *FillCommands(int style, int color);
 /* Local to the file only */
 static double	Threshold;
 static bool	linew_spec = false;
+static int	linew_opt = 0;	/* line width given with -l */
 static bool	select_fontname = true;
 static int	CurWidth = 0;
 static int	LineStyle = SOLID_LINE;
@@ -210,7 +211,7 @@ int	Verbose = false;
 int	TopMargin = 5;
 int	BottomMargin = 10;
 int	DotDist = 5;
-int	LineThick = 0;	/* first use as flag to say whether user specified -l */
+int	LineThick = 0;
 int	TeXLang = EEpic;
 double	DashScale;
 int	EllipseCmd=0;
@@ -263,7 +264,7 @@ genepic_option(char opt, char *optarg)
 
 	case 'l':
 		linew_spec = true;
-		LineThick = atoi(optarg);	/* save user's argument here */
+		linew_opt = atoi(optarg);	/* save user's argument here */
 		break;
 
 	case 'L':
@@ -342,6 +343,11 @@ genepic_start(F_compound *objects)
 	texfontsizes[0] = texfontsizes[1] =
 		TEXFONTSIZE(font_size != 0.0? font_size : DEFAULT_FONT_SIZE);
 
+	CurWidth = 0;
+	LineStyle = SOLID_LINE;
+	PatternType = UNFILLED;
+	PatternColor = WHITE_COLOR;
+
 	/* print any whole-figure comments prefixed with "%" */
 	if (objects->comments) {
 		fprintf(tfp,"%%\n");
@@ -366,8 +372,7 @@ genepic_start(F_compound *objects)
 		fputs(Preamble, tfp);
 	}
 
-	if (linew_spec)
-		LineThick = LineThick * ppi/80.0;
+	LineThick = linew_spec ? linew_opt * ppi/80.0 : 0;
 	if (LineThick == 0)
 		LineThick = 2.0*ppi/80.0;
 	DashScale = ppi/80.0;
@@ -375,6 +380,7 @@ genepic_start(F_compound *objects)
 	pt1.y = lly;
 	pt2.x = urx;
 	pt2.y = ury;
+	LLX = LLY = 0;
 	convertCS(&pt1);
 	convertCS(&pt2);
 	if (pt1.x > pt2.x) {
@@ -1583,5 +1589,6 @@ struct driver dev_epic = {
 	genepic_spline,
 	genepic_text,
 	genepic_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	STREAM_OBJECTS
 };
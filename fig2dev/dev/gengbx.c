@@ -843,6 +843,14 @@ gengbx_start(F_compound *objects)
 
 	gbx_scale_factor=pow(10,gbx_after);
 
+	/* reset the apertures and codes of a previous conversion */
+	count_data_block = 0;
+	count_apertures = 0;
+	count_circ_aperture = 0;
+	count_square_aperture = 0;
+	last_code_type = -1;
+	last_code_value = -1;
+
 	write_comment("Gerber RS-274x file");
 
 	sprintf(outbuf, "Creator: %s",prog);   write_comment(outbuf);
@@ -1107,6 +1115,7 @@ gengbx_line (F_line *l)
 					p->x += round(dx);  p->y += round(dy);
 				}
 			}
+			line_changed(l);
 		}
 
 
@@ -1434,5 +1443,6 @@ struct driver dev_gbx = {
 	gengbx_spline,
 	gengbx_text,
 	gengbx_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	NO_STREAM
 };
@@ -496,5 +496,6 @@ driver dev_ge = {
 	genge_spline,
 	genge_text,
 	genge_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	NO_STREAM
 };
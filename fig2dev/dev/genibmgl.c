@@ -191,6 +191,59 @@ static struct {
 	/* "ZapfDingbats",		34 */ { 45, 0, 0 },
 };
 
+/* the current state of the plotter */
+static struct {
+	int	width;		/* line width */
+	int	pen;		/* 1 <= pen <= 8 */
+	double	pen_thickness;	/* in millimeters */
+	int	font;
+	int	size;		/* font size in points */
+	double	slant;		/* character slant in degrees */
+	double	angle;		/* label direction in radians */
+} plotter;
+
+/*
+ * Reset the values changed during a conversion, in case more than one file
+ * is converted (batch mode, option -I).
+ */
+static void
+reset_state(void)
+{
+	static bool	saved = false;
+	static double	page_h, page_w, x_l, x_u, y_l, y_u;
+
+	/* the first call comes after all options were parsed */
+	if (!saved) {
+		page_h = pageheight;
+		page_w = pagewidth;
+		x_l = xl;
+		x_u = xu;
+		y_l = yl;
+		y_u = yu;
+		saved = true;
+	} else {
+		pageheight = page_h;
+		pagewidth = page_w;
+		xl = x_l;
+		xu = x_u;
+		yl = y_l;
+		yu = y_u;
+	}
+
+	line_color = DEFAULT;
+	line_style = SOLID_LINE;
+	fill_pattern = DEFAULT;
+	dash_length = DEFAULT;
+
+	plotter.width = -1;
+	plotter.pen = 0;
+	plotter.pen_thickness = 0.3;
+	plotter.font = DEFAULT;
+	plotter.size = DEFAULT;
+	plotter.slant = 0.0;
+	plotter.angle = 0.0;
+}
+
 static void
 genibmgl_option(char opt, char *optarg)
 {
@@ -325,6 +378,8 @@ genibmgl_start(F_compound *objects)
 		exit(1);
 	}
 
+	reset_state();
+
 	if (paperspec) {
 		/* convert ledger (deprecated) to tabloid */
 		if (strcasecmp(papersize, "ledger") == 0)
@@ -597,16 +652,14 @@ set_style(int style, double length)
 static void
 set_width(int w)
 {
-	static int current_width=-1;
-
-	if (w == current_width) return;
+	if (w == plotter.width) return;
 
 	/* Default line width is 0.3 mm; back off to original xfig pen
 	   thickness number, and re-size.
 	 */
 	fprintf(tfp, "PW%.1f;\n", w*80/ppi * 0.3);
 
-	current_width = w;
+	plotter.width = w;
 }
 
 /*
@@ -615,17 +668,15 @@ set_width(int w)
 static void
 set_color(int color)
 {
-	static int	number = 0;	  /* 1 <= number <= 8 */
-	static double	thickness = 0.3;  /* pen thickness in millimeters */
 	if (line_color != color) {
 		line_color	= color;
 		color	= (colors + color)%colors;
-		if (number != pen_number[color]) {
-			number	= pen_number[color];
+		if (plotter.pen != pen_number[color]) {
+			plotter.pen = pen_number[color];
 			fprintf(tfp, "SP%d;\n", pen_number[color]);
 		}
-		if (thickness != pen_thickness[color]) {
-			thickness  = pen_thickness[color];
+		if (plotter.pen_thickness != pen_thickness[color]) {
+			plotter.pen_thickness = pen_thickness[color];
 			fprintf(tfp, "PW%.4f;\n", pen_thickness[color]);
 		}
 	}
@@ -1081,33 +1132,29 @@ genibmgl_spline(F_spline *s)
 void
 genibmgl_text(F_text *t)
 {
-	static int	font	= DEFAULT;	/* font			 */
-	static int	size	= DEFAULT;	/* font size	   in points */
-	static double	theta	= 0.0;		/* character slant in degrees */
-	static double	angle	 = 0.0;		/* label direction in radians */
 	double width;			/* character width  in centimeters */
 	double height;			/* character height in centimeters */
 	bool newfont=false, newsize=false;
 
-	if (font != FONT(t->font)) {
-		font  = FONT(t->font);
+	if (plotter.font != FONT(t->font)) {
+		plotter.font  = FONT(t->font);
 		/* Simulate italic fonts with a 10 degree slant */
-		if (theta != slant[font]) {
-			theta  = slant[font];
-			fprintf(tfp, "SL%.4f;", tan(theta*M_PI/180.0));
+		if (plotter.slant != slant[plotter.font]) {
+			plotter.slant  = slant[plotter.font];
+			fprintf(tfp, "SL%.4f;", tan(plotter.slant*M_PI/180.0));
 		}
 		newfont = true;
 	}
 
-	if (size != t->size) {
-		size  = t->size;	/* in points */
+	if (plotter.size != t->size) {
+		plotter.size  = t->size;	/* in points */
 		newsize = true;
 		if (!correct_font_size) {
 			/* HP Stick Font only:	use the 'SI' command to set the
 			   cap height and pitch.
 			 */
-			width	 = size*wcmpp*wide[font];
-			height	 = size*hcmpp*high[font];
+			width	 = plotter.size*wcmpp*wide[plotter.font];
+			height	 = plotter.size*hcmpp*high[plotter.font];
 			fprintf(tfp, "SI%.4f,%.4f;", width*mag, height*mag);
 		}
 	}
@@ -1115,14 +1162,17 @@ genibmgl_text(F_text *t)
 	if (correct_font_size && (newfont || newsize)) {
 		/* Use 'SD' command to set the font */
 		fprintf(tfp, "SD2,1,4,%d,5,%d,6,%d,7,%d;SS;\n",
-				(int)(size*mag+.5), psfont2hpgl[font].italic,
-				psfont2hpgl[font].bold, psfont2hpgl[font].font);
+				(int)(plotter.size*mag+.5),
+				psfont2hpgl[plotter.font].italic,
+				psfont2hpgl[plotter.font].bold,
+				psfont2hpgl[plotter.font].font);
 	}
 
-	if (angle != t->angle) {
-		angle  = t->angle;
+	if (plotter.angle != t->angle) {
+		plotter.angle  = t->angle;
 		fprintf(tfp, "DI%.4f,%.4f;",
-				cos(angle), sin(reflected ? -angle: angle));
+				cos(plotter.angle),
+				sin(reflected ? -plotter.angle: plotter.angle));
 	}
 	set_color(t->color);
 
@@ -1169,5 +1219,6 @@ struct driver dev_ibmgl = {
 	genibmgl_spline,
 	genibmgl_text,
 	genibmgl_end,
-	EXCLUDE_TEXT
+	EXCLUDE_TEXT,
+	NO_STREAM
 };
@@ -112,6 +112,7 @@ char		thick_ldot[] = THICK_LDOT;
 static bool	select_fontname = true;
 static	int	verbose = 0;
 double		dash_mag = 1.0;
+static double	dash_mag_opt = 1.0;	/* dash magnification, option -d */
 int		thick_width = 2;
 double		tolerance = 2.0;
 double		arc_tolerance = 1.0;
@@ -232,7 +233,7 @@ genlatex_option(char opt, char *optarg)
 		break;
 
 	case 'd':
-		dash_mag = atof(optarg);	/* set dash magnification */
+		dash_mag_opt = atof(optarg);	/* set dash magnification */
 		break;
 
 	case 'F':
@@ -279,20 +280,26 @@ void
 genlatex_start(F_compound *objects)
 {
 	int tmp;
+	int margin;
 
 	texfontsizes[0] = texfontsizes[1] =
 		TEXFONTSIZE(font_size != 0.0? font_size : DEFAULT_FONT_SIZE);
 
 	unitlength = mag/ppi;
-	dash_mag /= unitlength*80.0;
-	border_margin /= unitlength*72.0;
+	dash_mag = dash_mag_opt / (unitlength*80.0);
+	margin = border_margin / (unitlength*72.0);
+
+	/* reset the line width state */
+	cur_thickness = -1;
+	dot_cmd = thindot;
+	ldot_cmd = thin_ldot;
 
 	/* adjust for any border margin */
 
-	llx -= border_margin;
-	lly -= border_margin;
-	urx += border_margin;
-	ury += border_margin;
+	llx -= margin;
+	lly -= margin;
+	urx += margin;
+	ury += margin;
 
 	translate_coordinates = translate2;
 	translate_coordinates_d = translate2_d;
@@ -1147,5 +1154,6 @@ struct driver dev_latex = {
 	genlatex_spline,
 	genlatex_text,
 	genlatex_end,
-	EXCLUDE_TEXT
+	EXCLUDE_TEXT,
+	NO_STREAM
 };
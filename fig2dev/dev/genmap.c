@@ -241,6 +241,16 @@ genmap_end(void)
   fprintf(tfp, "</BODY>\n");
   fprintf(tfp, "</HTML>\n");
 
+  /* free the links, in case another file is converted */
+  while (last_link != 0) {
+    l = last_link;
+    last_link = l->prev;
+    free(l->url);
+    free(l->alt);
+    free(l->area);
+    free(l);
+  }
+
   /* all ok */
   return 0;
 }
@@ -400,5 +410,6 @@ struct driver dev_map = {
 	(void (*)(F_spline *))gendev_null,
 	genmap_text,
 	genmap_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	NO_STREAM
 };
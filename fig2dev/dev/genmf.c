@@ -94,6 +94,7 @@ genmf_start(F_compound *objects)
 		maxy = yu;
 
 	curchar = (int)code;
+	oldpen = 0;
 
 	fprintf(tfp,"%%\n%% fig2dev -L mf (Version %s)\n",
 			PACKAGE_VERSION);
@@ -296,5 +297,6 @@ struct driver dev_mf = {
 	genmf_spline,
 	genmf_text,
 	genmf_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	NO_STREAM
 };
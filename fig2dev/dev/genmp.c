@@ -304,6 +304,10 @@ void
 genmp_start(F_compound *objects)
 {
 	FILE *in;
+
+	fig_number = 0;
+	last_depth = 1001;
+
 	fprintf(tfp, "%%\n%% fig2dev (version %s) -L (m)mp version %.2lf --- "
 			"Preamble\n%%\n", PACKAGE_VERSION, GENMP_VERSION);
 	fprintf(tfp,"\n");
@@ -1411,5 +1415,6 @@ struct driver dev_mp = {
 	genmp_spline,
 	genmp_text,
 	genmp_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	NO_STREAM
 };
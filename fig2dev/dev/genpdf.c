@@ -22,43 +22,2205 @@
  * Author: Brian V. Smith
  *		Uses genps functions to generate PostScript output then
  *		calls ghostscript (device pdfwrite) to convert it to pdf.
+ *
+ * The pdf is now written directly, following the PostScript code in genps.c.
+ * Text is set in the standard 14 fonts, which a pdf viewer must provide;
+ * other PostScript fonts are replaced by the most similar standard font.
+ * Ghostscript is still used for figures that embed eps or pdf files or that
+ * contain text that can not be encoded in latin1, or if requested by -w.
+ *
+ * In raster mode, the page content is not written, but kept in memory
+ * together with the decoded pictures, and rendered by raster.c.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef	HAVE_STRINGS_H
+#include <strings.h>
+#endif
+#include <math.h>
+#include <signal.h>
+
+#include "fig2dev.h"	/* includes bool.h and object.h */
+#include "bound.h"	/* calc_arrow(), compute_arcarrow_angle() */
+#include "colors.h"	/* rgb2luminance() */
+#include "creationdate.h"
+#include "encode.h"
+#include "genpdf.h"
+#include "genps.h"
+#include "messages.h"
+#include "pi.h"
+#include "piccache.h"
+#include "psfonts.h"
+#include "readpics.h"
+#include "stdfontwidths.h"
+#include "textconvert.h"
+
+#define PDFMINORVERSION		5
+/*
+ * The ghostscript command line.
+ * With -dAutoFilterColorImages=false,
+ * -dColorImageFilter=/FlateEncode	produces a lossless but large image,
+ * -dColorImageFilter=/DCTEncode	produces a lossy but much smaller image.
+ * The default, -dAutoFilterColorImages=true is fine for e.g., png and jpg.
+ * -o also sets -dBATCH -dNOPAUSE
+ */
+#ifdef GSEXE
+#define	GSFMT	GSEXE " -q -dSAFER -dAutoRotatePages=/None -sDEVICE=pdfwrite " \
+		"-dCompatibilityLevel=1.%d -dPDFSETTINGS=/prepress -o '%s' -"
+#else
+#define GSFMT	""
+#endif
+
+/* String buffer for the ghostscript command. 82 chars for the filename */
+static char	com_buf[sizeof GSFMT + 80];
+static char	*com = com_buf;
+static int	pdfminorversion = PDFMINORVERSION;
+static bool	force_gs = false;	/* -w, always use ghostscript */
+static bool	use_gs;			/* this figure is converted by gs */
+static bool	raster = false;		/* keep the content for raster.c */
+static bool	omitted;		/* a picture or text needed ghostscript */
+
+/*
+ * The picture readers, see genps.c.
+ */
+#define READ_SIGNATURE \
+	F_pic *pic, struct xfig_stream *restrict pic_stream, int *llx, int *lly
+extern int  read_gif(READ_SIGNATURE);
+extern int  read_jpg(READ_SIGNATURE);
+extern int  JPEGcomponents(int *bits_per_component, bool *inverted);
+extern int  read_pcx(READ_SIGNATURE);
+#ifdef HAVE_PNG_H
+extern int  read_png(READ_SIGNATURE);
+#endif
+extern int  read_ppm(READ_SIGNATURE);
+extern int  read_tif(READ_SIGNATURE);
+extern int  read_xbm(READ_SIGNATURE);
+extern int  read_xpm(READ_SIGNATURE);
+
+extern int	v2_flag, v21_flag, v30_flag;		/* read.c */
+/* the standard colors, defined in genps.c */
+extern struct _rgb {
+	double r, g, b;
+} rgbcols[NUM_STD_COLS];
+
+#define		POINT_PER_INCH		72
+#define		ULIMIT_FONT_SIZE	300
+#define		SHADEVAL(F)		1.0*(F)/(NUMSHADES-1)
+#define		TINTVAL(F)		1.0*(F-NUMSHADES+1)/NUMTINTS
+#define		NEEDS_CLIPPING(obj)	((obj->for_arrow || obj->back_arrow) &&\
+							obj->thickness > 0)
+/* the control point distance of a bezier curve approximating a quarter
+   circle of radius 1 */
+#define		KAPPA			0.5522847498
+
+/* options, parsed again from those passed to gen_ps_eps_option() */
+static int	border_margin = 0;
+static bool	correct_font_size = false;
+static bool	useabsolutecoo = false;
+static int	xoff = 0;
+static int	yoff = 0;
+
+/*
+ * A growing buffer, holding the page content or a path.
+ */
+struct pdfbuf {
+	char	*s;
+	size_t	len;
+	size_t	size;
+};
+
+static struct pdfbuf	content = {NULL, 0, 0};	/* the figure */
+static struct pdfbuf	path = {NULL, 0, 0};	/* the current path */
+
+/* the output file, and the byte offsets of the objects written to it */
+static FILE	*pdf;
+static long	pdf_pos;
+static long	*obj_pos = NULL;
+static int	num_objs;
+static int	size_objs = 0;
+
+/* objects numbers reserved for the document structure */
+#define		CATALOG_OBJ	1
+#define		PAGES_OBJ	2
+#define		INFO_OBJ	3
+#define		RESOURCES_OBJ	4
+
+/* page geometry */
+static int	pagewidth, pageheight;
+static int	mediabox[4];
+static float	fllx, flly, furx, fury;
+static double	scalex, scaley;
+static double	origx, origy;
+
+/* graphics state */
+static double	cur_thickness;
+static int	cur_joinstyle;
+static int	cur_capstyle;
+static int	cur_hscale;
+
+/* arrowhead arrays */
+static F_pos	bpoints[50], fpoints[50];
+static int	nbpoints, nfpoints;
+static F_pos	bfillpoints[50], ffillpoints[50], clippoints[50];
+static int	nbfillpoints, nffillpoints, nclippoints;
+static int	fpntx1, fpnty1;	/* first point of object */
+static int	fpntx2, fpnty2;	/* second point of object */
+static int	lpntx1, lpnty1;	/* last point of object */
+static int	lpntx2, lpnty2;	/* second-to-last point of object */
+
+/*
+ * The standard 14 fonts. All other PostScript fonts are replaced by one of
+ * these. The font object is written at the end, if the font is used.
+ */
+static const char	*std_fonts[] = {
+	"Times-Roman", "Times-Italic", "Times-Bold", "Times-BoldItalic",
+	"Helvetica", "Helvetica-Oblique", "Helvetica-Bold",
+	"Helvetica-BoldOblique",
+	"Courier", "Courier-Oblique", "Courier-Bold", "Courier-BoldOblique",
+	"Symbol", "ZapfDingbats"
+};
+#define NUM_STD_FONTS	(int)(sizeof std_fonts / sizeof std_fonts[0])
+#define SYMBOL_FONT	12	/* this and the following have no encoding */
+static int	font_obj[NUM_STD_FONTS];
+
+/* the replacements for the PostScript fonts not among the standard 14 */
+static const struct {
+	const char	*name;
+	int		font;		/* index into std_fonts[] */
+	int		hscale;		/* horizontal scaling, percent */
+} font_subst[] = {
+	{"AvantGarde-Book",		4, 100},
+	{"AvantGarde-BookOblique",	5, 100},
+	{"AvantGarde-Demi",		6, 100},
+	{"AvantGarde-DemiOblique",	7, 100},
+	{"Bookman-Light",		0, 100},
+	{"Bookman-LightItalic",		1, 100},
+	{"Bookman-Demi",		2, 100},
+	{"Bookman-DemiItalic",		3, 100},
+	{"Helvetica-Narrow",		4, 82},
+	{"Helvetica-Narrow-Oblique",	5, 82},
+	{"Helvetica-Narrow-Bold",	6, 82},
+	{"Helvetica-Narrow-BoldOblique", 7, 82},
+	{"NewCenturySchlbk-Roman",	0, 100},
+	{"NewCenturySchlbk-Italic",	1, 100},
+	{"NewCenturySchlbk-Bold",	2, 100},
+	{"NewCenturySchlbk-BoldItalic",	3, 100},
+	{"Palatino-Roman",		0, 100},
+	{"Palatino-Italic",		1, 100},
+	{"Palatino-Bold",		2, 100},
+	{"Palatino-BoldItalic",		3, 100},
+	{"ZapfChancery-MediumItalic",	1, 100}
+};
+
+/* the fonts for the LaTeX font flags, as in genps.c */
+static const char	*latexfontnames[] = {
+	"Times-Roman", "Times-Roman",	/* default */
+	"Times-Roman",			/* roman */
+	"Times-Bold",			/* bold */
+	"Times-Italic",			/* italic */
+	"Helvetica",			/* sans serif */
+	"Courier"			/* typewriter */
+};
+
+#define PSFONTMAG(T)  (((T->size) <= ULIMIT_FONT_SIZE ? \
+		T->size :  ULIMIT_FONT_SIZE) \
+		* ppi/(correct_font_size? (metric ? 72*80/76.2 : 72): 80))
+
+/* the fill patterns, an object is written at the end for each used one */
+static int	pattern_obj[NUMPATTERNS];
+
+/*
+ * Each picture file is written once, as an image XObject, and drawn at each
+ * place it is used.
+ */
+struct pdf_image {
+	struct pdf_image	*next;
+	char			*file;	/* the picture file, as in the fig file */
+	int			obj;	/* the object number of the image */
+	int			llx, lly;
+	int			subtype;
+	struct f_pos		bit_size;
+	F_pic			*pic;	/* in raster mode, the decoded picture */
+};
+static struct pdf_image	*pdf_images = NULL;
+
+/* headers of the image files that can be embedded */
+static	 struct hdr {
+	    char	*type;
+	    char	*bytes;
+	    int		(*readfunc)(READ_SIGNATURE);
+	} headers[] = {	{"GIF", "GIF",			read_gif},
+			{"PCX", "\012\005\001",		read_pcx},
+			{"PPM", "P3",			read_ppm},
+			{"PPM", "P6",			read_ppm},
+			{"TIFF", "II*\000",		read_tif},
+			{"TIFF", "MM\000*",		read_tif},
+			{"XBM", "#define",		read_xbm},
+#ifdef HAVE_PNG_H
+			{"PNG", "\211\120\116\107\015\012\032\012", read_png},
+#endif
+			{"JPEG", "\377\330\377\340",	read_jpg},
+			{"JPEG", "\377\330\377\341",	read_jpg},
+			{"XPM", "/* XPM */",		read_xpm},
+};
+
+#define NUMHEADERS	(sizeof(headers)/sizeof(headers[0]))
+
+/* the signatures of the files that only ghostscript can embed */
+static const char	*ps_signatures[] = {
+	"%!", "\xc5\xd0\xd3\xc6", "%PDF"
+};
+/* ... and of those that only ghostscript can render, read_jpg() does not
+   decode the image */
+static const char	*jpeg_signatures[] = {
+	"\377\330\377"
+};
+
+
+/*******************************/
+/* writing the pdf file        */
+/*******************************/
+
+static void
+bufprintf(struct pdfbuf *b, const char *fmt, ...)
+{
+	int	n;
+	va_list	ap;
+
+	for (;;) {
+		if (b->size > b->len) {
+			va_start(ap, fmt);
+			n = vsnprintf(b->s + b->len, b->size - b->len, fmt, ap);
+			va_end(ap);
+			if (n < 0) {
+				err_msg("Error writing pdf output");
+				exit(EXIT_FAILURE);
+			}
+			if ((size_t)n < b->size - b->len) {
+				b->len += n;
+				return;
+			}
+		}
+		b->size = b->size ? 2 * b->size : BUFSIZ;
+		if ((b->s = realloc(b->s, b->size)) == NULL) {
+			put_msg(Err_mem);
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+static void
+pdf_printf(const char *fmt, ...)
+{
+	int	n;
+	va_list	ap;
+
+	va_start(ap, fmt);
+	n = vfprintf(pdf, fmt, ap);
+	va_end(ap);
+	if (n > 0)
+		pdf_pos += n;
+}
+
+static void
+pdf_write(const void *data, size_t len)
+{
+	pdf_pos += (long)fwrite(data, 1, len, pdf);
+}
+
+/* return a new object number */
+static int
+new_obj(void)
+{
+	if (num_objs + 1 >= size_objs) {
+		size_objs = size_objs ? 2 * size_objs : 64;
+		if ((obj_pos = realloc(obj_pos, size_objs * sizeof(long)))
+				== NULL) {
+			put_msg(Err_mem);
+			exit(EXIT_FAILURE);
+		}
+	}
+	obj_pos[++num_objs] = 0;
+	return num_objs;
+}
+
+static void
+begin_obj(int obj)
+{
+	obj_pos[obj] = pdf_pos;
+	pdf_printf("%d 0 obj\n", obj);
+}
+
+/*
+ * Write a stream object, with the entries dict in its dictionary.
+ * Compress the data, if it was not compressed already.
+ */
+static void
+write_stream(int obj, const char *dict, unsigned char *data, size_t len,
+		bool compressed)
+{
+	unsigned char	*deflated = NULL;
+
+#ifdef HAVE_ZLIB_H
+	/* flate compression requires pdf 1.2 */
+	if (!compressed && pdfminorversion > 1 &&
+			deflate_mem(data, len, &deflated, &len)) {
+		put_msg("Could not compress pdf stream.");
+		exit(EXIT_FAILURE);
+	}
+#endif
+	begin_obj(obj);
+	pdf_printf("<<%s /Length %lu%s >>\nstream\n", dict, (unsigned long)len,
+			deflated ? " /Filter /FlateDecode" : "");
+	pdf_write(deflated ? deflated : data, len);
+	pdf_printf("\nendstream\nendobj\n");
+	free(deflated);
+}
+
+/* write a pdf string, escaping the characters that need it */
+static void
+put_string(struct pdfbuf *b, const char *str)
+{
+	const unsigned char	*c;
+
+	bufprintf(b, "(");
+	for (c = (const unsigned char *)str; *c; ++c) {
+		if (*c == '(' || *c == ')' || *c == '\\')
+			bufprintf(b, "\\%c", *c);
+		else if (*c < 32 || *c == 127)
+			bufprintf(b, "\\%03o", *c);
+		else
+			bufprintf(b, "%c", *c);
+	}
+	bufprintf(b, ")");
+}
+
+
+/*******************************/
+/* colors and graphics state   */
+/*******************************/
+
+static void
+color_rgb(int color, double *r, double *g, double *b)
+{
+	if (color < NUM_STD_COLS) {
+		*r = rgbcols[color > 0 ? color : 0].r;
+		*g = rgbcols[color > 0 ? color : 0].g;
+		*b = rgbcols[color > 0 ? color : 0].b;
+	} else {
+		*r = user_colors[color - NUM_STD_COLS].r / 255.0;
+		*g = user_colors[color - NUM_STD_COLS].g / 255.0;
+		*b = user_colors[color - NUM_STD_COLS].b / 255.0;
+	}
+}
+
+/* set the color; op is "rg" for filling, "RG" for stroking */
+static void
+set_rgb(double r, double g, double b, const char *op)
+{
+	if (grayonly)
+		bufprintf(&content, "%.3f %c\n", rgb2luminance(r, g, b),
+				op[0] == 'r' ? 'g' : 'G');
+	else
+		bufprintf(&content, "%.3f %.3f %.3f %s\n", r, g, b, op);
+}
+
+static void
+set_color(int color, const char *op)
+{
+	double	r, g, b;
+
+	color_rgb(color, &r, &g, &b);
+	set_rgb(r, g, b, op);
+}
+
+/*
+ * Set the fill color for the area fill fill; shades and tints as
+ * by shd and tnt in the PostScript prolog.
+ */
+static void
+set_fill(int fill, int fill_color)
+{
+	double	r, g, b, v;
+
+	if (fill_color <= 0 && fill < NUMSHADES + NUMTINTS) {
+		/* gray levels for default and black shades and tints */
+		v = 1.0 - SHADEVAL(fill);
+		if (v < 0.0)
+			v = 0.0;
+		bufprintf(&content, "%.2f g\n", v);
+		return;
+	}
+	color_rgb(fill_color, &r, &g, &b);
+	if (fill < NUMSHADES) {
+		v = SHADEVAL(fill);
+		r *= v;
+		g *= v;
+		b *= v;
+	} else {
+		v = TINTVAL(fill);
+		r += v * (1.0 - r);
+		g += v * (1.0 - g);
+		b += v * (1.0 - b);
+	}
+	set_rgb(r, g, b, "rg");
+}
+
+static void
+set_style(int s, double v)
+{
+	v /= 80.0 / ppi;
+	if (v <= 0.0)
+		return;
+	if (s == DASH_LINE) {
+		bufprintf(&content, "[%d] 0 d\n", round(v));
+	} else if (s == DOTTED_LINE) {
+		bufprintf(&content, "[%d %d] %d d\n",
+				round(ppi/80.0), round(v), round(v));
+	} else if (s == DASH_DOT_LINE) {
+		bufprintf(&content, "[%d %d %d %d] 0 d\n",
+				round(v), round(v*0.5),
+				round(ppi/80.0), round(v*0.5));
+	} else if (s == DASH_2_DOTS_LINE) {
+		bufprintf(&content, "[%d %d %d %d %d %d] 0 d\n",
+				round(v), round(v*0.45),
+				round(ppi/80.0), round(v*0.333),
+				round(ppi/80.0), round(v*0.45));
+	} else if (s == DASH_3_DOTS_LINE) {
+		bufprintf(&content, "[%d %d %d %d %d %d %d %d] 0 d\n",
+				round(v), round(v*0.4),
+				round(ppi/80.0), round(v*0.3),
+				round(ppi/80.0), round(v*0.3),
+				round(ppi/80.0), round(v*0.4));
+	}
+}
+
+static void
+reset_style(int s, double v)
+{
+	if (v > 0.0 && s >= DASH_LINE && s <= DASH_3_DOTS_LINE)
+		bufprintf(&content, "[] 0 d\n");
+}
+
+static void
+set_linejoin(int j)
+{
+	if (j != cur_joinstyle) {
+		cur_joinstyle = j;
+		bufprintf(&content, "%d j\n", cur_joinstyle);
+	}
+}
+
+static void
+set_linecap(int j)
+{
+	if (j != cur_capstyle) {
+		cur_capstyle = j;
+		bufprintf(&content, "%d J\n", cur_capstyle);
+	}
+}
+
+static void
+set_linewidth(double w)
+{
+	if (w != cur_thickness) {
+		cur_thickness = w;
+		bufprintf(&content, "%.3f w\n",	/* make lines a little thinner */
+				cur_thickness <= THICK_SCALE ?
+				0.5* cur_thickness :
+				cur_thickness - THICK_SCALE);
+	}
+}
+
+/* forget the graphics state, e.g., after it was restored by Q */
+static void
+reset_gstate(void)
+{
+	cur_thickness = -1.0;
+	cur_joinstyle = -1;
+	cur_capstyle = -1;
+}
+
+
+/*******************************/
+/* paths                       */
+/*******************************/
+
+static void
+path_arc(double cx, double cy, double rx, double ry, double phi,
+		double a1, double a2, bool move)
+{
+	int	i, n;
+	double	t0, t1, dt, k;
+	double	u[4], v[4], x[4], y[4];
+	double	cphi = cos(phi), sphi = sin(phi);
+
+	n = (int)ceil(fabs(a2 - a1) / (M_PI / 2) - 1e-9);
+	if (n < 1)
+		n = 1;
+	dt = (a2 - a1) / n;
+	k = 4.0 / 3.0 * tan(dt / 4);
+	for (i = 0; i < n; ++i) {
+		int	j;
+
+		t0 = a1 + i * dt;
+		t1 = t0 + dt;
+		u[0] = cos(t0);			v[0] = sin(t0);
+		u[3] = cos(t1);			v[3] = sin(t1);
+		u[1] = u[0] - k * v[0];		v[1] = v[0] + k * u[0];
+		u[2] = u[3] + k * v[3];		v[2] = v[3] - k * u[3];
+		for (j = 0; j < 4; ++j) {
+			x[j] = cx + rx * u[j] * cphi - ry * v[j] * sphi;
+			y[j] = cy + rx * u[j] * sphi + ry * v[j] * cphi;
+		}
+		if (i == 0)
+			bufprintf(&path, "%.1f %.1f %c\n", x[0], y[0],
+					move ? 'm' : 'l');
+		bufprintf(&path, "%.1f %.1f %.1f %.1f %.1f %.1f c\n",
+				x[1], y[1], x[2], y[2], x[3], y[3]);
+	}
+}
+
+/*
+ * Append a path from the current point p0 to p1, rounding the corner c,
+ * as by the arcto operator of PostScript, for a right angle at c.
+ */
+static void
+path_corner(double x0, double y0, double cx, double cy, double x1, double y1)
+{
+	bufprintf(&path, "%.1f %.1f %.1f %.1f %.1f %.1f c\n",
+			x0 + KAPPA * (cx - x0), y0 + KAPPA * (cy - y0),
+			x1 + KAPPA * (cx - x1), y1 + KAPPA * (cy - y1), x1, y1);
+}
+
+/* copy the current path into the content */
+static void
+put_path(void)
+{
+	bufprintf(&content, "%.*s", (int)path.len, path.s);
+}
+
+/*
+ * Paint the current path. Fill it with fill, unless fill is UNFILLED,
+ * and stroke it, if stroke is true. The path is cleared afterwards.
+ */
+static void
+paint_path(int fill, int pen_color, int fill_color, bool stroke)
+{
+	if (fill != UNFILLED && fill >= NUMSHADES + NUMTINTS) {
+		/* one of the patterns */
+		int	patnum = fill - NUMSHADES - NUMTINTS + 1;
+		double	r, g, b;
+
+		if (pattern_obj[patnum - 1] == 0)
+			pattern_obj[patnum - 1] = new_obj();
+		/* first the pattern background color */
+		set_color(fill_color, "rg");
+		put_path();
+		bufprintf(&content, "f*\n");
+		/* then the pattern, in the pen color */
+		color_rgb(pen_color, &r, &g, &b);
+		if (grayonly)
+			bufprintf(&content, "/CsG cs %.3f /P%d scn\n",
+					rgb2luminance(r, g, b), patnum);
+		else
+			bufprintf(&content, "/CsP cs %.3f %.3f %.3f /P%d scn\n",
+					r, g, b, patnum);
+		put_path();
+		bufprintf(&content, "f*\n");
+		fill = UNFILLED;
+	}
+
+	if (fill != UNFILLED) {
+		set_fill(fill, fill_color);
+		if (stroke)
+			set_color(pen_color, "RG");
+		put_path();
+		bufprintf(&content, stroke ? "B*\n" : "f*\n");
+	} else if (stroke) {
+		set_color(pen_color, "RG");
+		put_path();
+		bufprintf(&content, "S\n");
+	}
+	path.len = 0;
+}
+
+
+/*******************************/
+/* fill patterns               */
+/*******************************/
+
+/*
+ * Append a moveto or lineto, given by op, to path. Exchange x and y if
+ * transpose is true.
+ */
+static void
+cell_point(bool transpose, int x, int y, char op)
+{
+	if (transpose)
+		bufprintf(&path, "%d %d %c\n", y, x, op);
+	else
+		bufprintf(&path, "%d %d %c\n", x, y, op);
+}
+
+static void
+cell_line(bool transpose, int x0, int y0, int x1, int y1)
+{
+	cell_point(transpose, x0, y0, 'm');
+	cell_point(transpose, x1, y1, 'l');
+}
+
+/*
+ * Write the pattern cell of pattern patnum into path, following the
+ * pattern definitions in psprolog.h. Return the line width.
+ */
+static double
+pattern_cell(int patnum, int *w, int *h)
+{
+	int	i, x, y;
+	double	lw = 1.0;
+
+	switch (patnum) {
+	case 1:		/* left30 */
+		*w = 48; *h = 24; lw = 0.7;
+		for (i = 3; i <= 24; i += 4)
+			bufprintf(&path, "-2 %d m %d -1 l\n", i, 2*i);
+		for (i = 1; i <= 22; i += 4)
+			bufprintf(&path, "%d 25 m 50 %d l\n", 2*i, i);
+		break;
+	case 2:		/* right30 */
+		*w = 48; *h = 24; lw = 0.7;
+		for (i = 3; i <= 24; i += 4)
+			bufprintf(&path, "-2 %d m %d 25 l\n", 24 - i, 2*i);
+		for (i = 1; i <= 22; i += 4)
+			bufprintf(&path, "%d -1 m 50 %d l\n", 2*i, 24 - i);
+		break;
+	case 3:		/* crosshatch30 */
+		*w = 48; *h = 24; lw = 0.7;
+		for (i = 3; i <= 24; i += 4)
+			bufprintf(&path, "-2 %d m %d -1 l -2 %d m %d 25 l\n",
+					i, 2*i, 24 - i, 2*i);
+		for (i = 1; i <= 22; i += 4)
+			bufprintf(&path, "%d 25 m 50 %d l %d -1 m 50 %d l\n",
+					2*i, i, 2*i, 24 - i);
+		break;
+	case 4:		/* left45 */
+		*w = 24; *h = 24;
+		for (i = 7; i <= 24; i += 8)
+			bufprintf(&path, "-1 %d m %d -1 l %d 25 m 25 %d l\n",
+					i, i, i - 2, i - 2);
+		break;
+	case 5:		/* right45 */
+	case 6:		/* crosshatch45 */
+		*w = 24; *h = 24;
+		for (i = 1; i <= 18; i += 8) {
+			bufprintf(&path, "%d -1 m 25 %d l -1 %d m %d 25 l\n",
+					i, 24 - i, i + 4, 20 - i);
+			if (patnum == 6)
+				bufprintf(&path, "-1 %d m %d -1 l "
+						"%d 25 m 25 %d l\n",
+						i + 6, i + 6, i + 4, i + 4);
+		}
+		break;
+	case 7:		/* bricks */
+	case 8:		/* vertical bricks */
+		*w = 32; *h = 32;
+		for (i = 2; i <= 26; i += 8)
+			cell_line(patnum == 8, -1, i, 33, i);
+		for (i = 2; i <= 18; i += 16) {
+			cell_line(patnum == 8, i, 2, i, 10);
+			cell_line(patnum == 8, i, 18, i, 26);
+			cell_line(patnum == 8, i + 8, -1, i + 8, 2);
+			cell_line(patnum == 8, i + 8, 10, i + 8, 18);
+			cell_line(patnum == 8, i + 8, 26, i + 8, 33);
+		}
+		break;
+	case 9:		/* horizontal lines */
+	case 10:	/* vertical lines */
+		if (patnum == 9) {
+			*w = 36; *h = 24;
+		} else {
+			*w = 24; *h = 36;
+		}
+		for (i = 2; i <= 22; i += 4)
+			cell_line(patnum == 10, -1, i, 37, i);
+		break;
+	case 11:	/* crosshatch lines */
+		*w = 36; *h = 36;
+		for (i = 2; i <= 34; i += 4)
+			bufprintf(&path, "-1 %d m 37 %d l %d -1 m %d 37 l\n",
+					i, i, i, i);
+		break;
+	case 12:	/* left-shingles */
+	case 13:	/* right-shingles */
+		*w = 24; *h = 24;
+		for (i = 2; i <= 18; i += 8)
+			bufprintf(&path, "-1 %d m 25 %d l\n", i, i);
+		bufprintf(&path, patnum == 12 ?
+			"2 10 m 6 18 l 10 2 m 14 10 l 18 18 m 22 26 l "
+				"20 -2 m 22 2 l\n" :
+			"2 26 m 6 18 l 14 2 m 10 10 l 18 18 m 22 10 l "
+				"2 2 m 4 -2 l\n");
+		break;
+	case 14:	/* vertical left-shingles */
+	case 15:	/* vertical right-shingles */
+		*w = 24; *h = 24;
+		for (i = 2; i <= 18; i += 8)
+			bufprintf(&path, "%d -1 m %d 25 l\n", i, i);
+		bufprintf(&path, patnum == 14 ?
+			"26 2 m 18 6 l 2 14 m 10 10 l 18 18 m 10 22 l "
+				"2 2 m -2 4 l\n" :
+			"10 2 m 18 6 l 2 10 m 10 14 l 18 18 m 26 22 l "
+				"-2 20 m 2 22 l\n");
+		break;
+	case 16:	/* fishscales */
+		{
+			static const int	c[7][2] = {{8, 9}, {8, 17},
+					{8, 25}, {0, 13}, {16, 13}, {0, 21},
+					{16, 21}};
+			*w = 16; *h = 8; lw = 0.7;
+			for (i = 0; i < 7; ++i)
+				path_arc(c[i][0], c[i][1], 11, 11, 0.,
+						223 * M_PI / 180,
+						317 * M_PI / 180, true);
+		}
+		break;
+	case 17:	/* small fishscales */
+		*w = 24; *h = 16; lw = 0.7;
+		bufprintf(&path, "2 j\n");
+		for (y = 2; y <= 18; y += 4) {
+			bool	move = true;
+			for (x = (y % 8 == 2 ? -6 : -2); x <= 27; x += 8) {
+				path_arc(x, y, 4, 4, 0., M_PI, 2 * M_PI, move);
+				move = false;
+			}
+		}
+		break;
+	case 18:	/* circles */
+		*w = 16; *h = 16; lw = 0.7;
+		path_arc(8, 8, 8, 8, 0., 0., 2 * M_PI, true);
+		break;
+	case 19:	/* hexagons */
+		*w = 26; *h = 16; lw = 0.7;
+		bufprintf(&path, "-1 8 m 2 8 l 6 0 l 15 0 l 19 8 l 15 16 l "
+				"6 16 l 2 8 l\n19 8 m 27 8 l\n");
+		break;
+	case 20:	/* octagons */
+		*w = 16; *h = 16; lw = 0.8;
+		bufprintf(&path, "5 0 m 11 0 l 16 5 l 16 11 l 11 16 l "
+				"5 16 l 0 11 l 0 5 l h\n");
+		break;
+	case 21:	/* horizontal sawtooth lines */
+	case 22:	/* vertical sawtooth lines */
+		*w = 24; *h = 24; lw = 0.8;
+		for (y = 5; y <= 21; y += 8) {
+			cell_point(patnum == 22, -1, y, 'm');
+			for (x = 2, i = 0; i < 7; x += 4, ++i)
+				cell_point(patnum == 22, x,
+						i % 2 ? y + 1 : y - 3, 'l');
+		}
+		break;
+	}
+	return lw;
+}
+
+/* write the content of the cell of pattern patnum into path */
+static void
+pattern_content(int patnum, int *w, int *h)
+{
+	double	lw;
+
+	path.len = 0;
+	bufprintf(&path, "0 J 0 j\n");
+	lw = pattern_cell(patnum, w, h);
+	bufprintf(&path, "%.1f w S\n", lw);
+}
+
+static void
+write_patterns(void)
+{
+	int	i, n, w = 0, h = 0;
+	char	dict[200];
+
+	for (i = 0; i < NUMPATTERNS; ++i) {
+		if (pattern_obj[i] == 0)
+			continue;
+		pattern_content(i + 1, &w, &h);
+		n = sprintf(dict, " /Type /Pattern /PatternType 1 "
+				"/PaintType 2 /TilingType 1 /BBox [0 0 %d %d] "
+				"/XStep %d /YStep %d /Resources << >>",
+				w, h, w, h);
+		/* in a form, the pattern space is the space of the form */
+		if (multi_page)
+			sprintf(dict + n, " /Matrix [%.5f 0 0 %.5f 0 0]",
+					1.0 / scalex, -1.0 / scaley);
+		write_stream(pattern_obj[i], dict, (unsigned char *)path.s,
+				path.len, false);
+	}
+	path.len = 0;
+}
+
+
+/*******************************/
+/* pictures                    */
+/*******************************/
+
+/*
+ * Return true, if the file starts with one of the num signatures.
+ */
+static bool
+has_signature(char *file, const char **signatures, size_t num)
+{
+	size_t			i, n;
+	char			buf[4];
+	bool			found = false;
+	struct xfig_stream	pic_stream;
+
+	init_stream(&pic_stream);
+	if (!find_stream(file, &pic_stream) &&
+			open_stream(file, &pic_stream) != NULL) {
+		n = fread(buf, 1, sizeof buf, pic_stream.fp);
+		for (i = 0; i < num; ++i)
+			if (n >= strlen(signatures[i]) && !memcmp(buf,
+					signatures[i], strlen(signatures[i])))
+				found = true;
+		close_stream(&pic_stream);
+	}
+	free_stream(&pic_stream);
+	return found;
+}
+
+/*
+ * Return true, if the file only can be embedded by ghostscript.
+ */
+static bool
+is_postscript(char *file)
+{
+	return has_signature(file, ps_signatures,
+			sizeof ps_signatures / sizeof ps_signatures[0]);
+}
+
+static bool
+is_jpeg(char *file)
+{
+	return has_signature(file, jpeg_signatures,
+			sizeof jpeg_signatures / sizeof jpeg_signatures[0]);
+}
+
+static struct pdf_image *
+find_image(const char *file)
+{
+	struct pdf_image	*img;
+
+	for (img = pdf_images; img != NULL; img = img->next)
+		if (!strcmp(img->file, file))
+			return img;
+	return NULL;
+}
+
+/*
+ * Write the decoded picture pic as image XObject.
+ */
+static int
+write_image(F_pic *pic, struct xfig_stream *pic_stream)
+{
+	int		i, obj;
+	size_t		len;
+	struct pdfbuf	dict = {NULL, 0, 0};
+
+	obj = new_obj();
+	bufprintf(&dict, " /Type /XObject /Subtype /Image /Width %d "
+			"/Height %d", pic->bit_size.x, pic->bit_size.y);
+
+	if (pic->subtype == P_JPEG) {
+		int		bits;
+		bool		inverted;
+		unsigned char	*data = NULL;
+		int		components = JPEGcomponents(&bits, &inverted);
+
+		bufprintf(&dict, " /ColorSpace /Device%s /BitsPerComponent %d "
+				"/Filter /DCTDecode",
+				components == 1 ? "Gray" :
+				(components == 4 ? "CMYK" : "RGB"), bits);
+		if (inverted)
+			bufprintf(&dict, " /Decode [1 0 1 0 1 0 1 0]");
+		/* copy the jpeg file */
+		len = 0;
+		if (rewind_stream(pic_stream)) {
+			size_t	n, size = 0;
+			do {
+				if (len == size && (data = realloc(data,
+						size = size ? 2*size : 65536))
+						== NULL) {
+					put_msg(Err_mem);
+					exit(EXIT_FAILURE);
+				}
+				n = fread(data + len, 1, size - len,
+						pic_stream->fp);
+				len += n;
+			} while (n > 0);
+		}
+		write_stream(obj, dict.s, data, len, true);
+		free(data);
+		free(dict.s);
+		return obj;
+	}
+
+	if (pic->subtype == P_XBM) {
+		bufprintf(&dict, " /ImageMask true /BitsPerComponent 1 "
+				"/Decode [1 0]");
+		len = (size_t)((pic->bit_size.x + 7) / 8) * pic->bit_size.y;
+	} else if (pic->numcols > 256) {
+		bufprintf(&dict, " /ColorSpace /DeviceRGB /BitsPerComponent 8");
+		if (pic->num_transp == TRANSP_COLOR)
+			bufprintf(&dict, " /Mask [%d %d %d %d %d %d]",
+				pic->transp_col[RED], pic->transp_col[RED],
+				pic->transp_col[GREEN], pic->transp_col[GREEN],
+				pic->transp_col[BLUE], pic->transp_col[BLUE]);
+		len = (size_t)pic->bit_size.x * pic->bit_size.y * 3;
+	} else {
+		bufprintf(&dict, " /ColorSpace [/Indexed /DeviceRGB %d <",
+				pic->numcols - 1);
+		for (i = 0; i < pic->numcols; ++i)
+			bufprintf(&dict, "%s%.2hhx%.2hhx%.2hhx",
+					i % 11 == 0 && i ? "\n" : "",
+					pic->cmap[RED][i], pic->cmap[GREEN][i],
+					pic->cmap[BLUE][i]);
+		bufprintf(&dict, ">] /BitsPerComponent 8");
+		if (pic->num_transp > 0)
+			bufprintf(&dict, " /Mask [%d %d]", pic->transp_cols[0],
+					pic->transp_cols[0]);
+		len = (size_t)pic->bit_size.x * pic->bit_size.y;
+	}
+	write_stream(obj, dict.s, pic->bitmap, len, false);
+	free(dict.s);
+	return obj;
+}
+
+/*
+ * Keep the decoded picture pic for the renderer, which takes over the
+ * bitmap. Only the first transparent color is used, as in write_image().
+ */
+static F_pic *
+keep_picture(F_pic *pic)
+{
+	F_pic	*p;
+
+	if ((p = malloc(sizeof(F_pic))) == NULL) {
+		put_msg(Err_mem);
+		exit(EXIT_FAILURE);
+	}
+	*p = *pic;
+	if (pic->num_transp > 0) {
+		p->transp_col[0] = pic->transp_cols[0];
+		p->transp_cols = p->transp_col;
+	}
+	pic->bitmap = NULL;
+	return p;
+}
+
+/*
+ * Decode the picture of l and write it as image XObject, or keep it in
+ * raster mode. Return the image, or NULL.
+ */
+static struct pdf_image *
+decode_picture(F_pic *pic)
+{
+	int			i;
+	char			buf[12];
+	struct pdf_image	*img;
+	struct xfig_stream	pic_stream;
+
+	if ((img = calloc(1, sizeof(struct pdf_image))) == NULL) {
+		put_msg(Err_mem);
+		exit(EXIT_FAILURE);
+	}
+
+	init_stream(&pic_stream);
+	if (find_stream(pic->file, &pic_stream)) {
+		put_msg("No such picture file: %s", pic->file);
+		goto fail;
+	}
+
+	/* re-use the image, if it was decoded before */
+	if (piccache_get(pic, pic_stream.name_on_disk, &img->llx, &img->lly))
+		goto decoded;
+
+	if (open_stream(pic->file, &pic_stream) == NULL) {
+		put_msg("No such picture file: %s", pic->file);
+		goto fail;
+	}
+	for (i = 0; i < (int)(sizeof buf); ++i) {
+		int	c;
+		if ((c = getc(pic_stream.fp)) == EOF)
+			break;
+		buf[i] = (char)c;
+	}
+	for (i = 0; i < (int)NUMHEADERS; ++i)
+		if (!memcmp(buf, headers[i].bytes, strlen(headers[i].bytes)))
+			break;
+	if (i == (int)NUMHEADERS) {
+		if (is_postscript(pic->file)) {
+			put_msg("%s: Embedding eps or pdf files needs "
+					"ghostscript", pic->file);
+			omitted = true;
+		} else {
+			put_msg("%s: Unknown image format", pic->file);
+		}
+		close_stream(&pic_stream);
+		goto fail;
+	}
+	if (raster && headers[i].readfunc == read_jpg) {
+		put_msg("%s: Rendering jpeg files needs ghostscript",
+				pic->file);
+		omitted = true;
+		close_stream(&pic_stream);
+		goto fail;
+	}
+
+	pic->num_transp = NO_TRANSPARENCY;
+	if (!headers[i].readfunc(pic, &pic_stream, &img->llx, &img->lly)) {
+		put_msg("%s: Bad %s format", pic->file, headers[i].type);
+		close_stream(&pic_stream);
+		goto fail;
+	}
+	piccache_put(pic, pic_stream.name_on_disk, img->llx, img->lly);
+
+decoded:
+	if (raster) {
+		img->obj = new_obj();
+		img->pic = keep_picture(pic);
+	} else {
+		img->obj = write_image(pic, &pic_stream);
+	}
+	close_stream(&pic_stream);
+	free_stream(&pic_stream);
+
+	img->file = pic->file;
+	img->subtype = pic->subtype;
+	img->bit_size = pic->bit_size;
+	img->next = pdf_images;
+	pdf_images = img;
+	/* the image is written, the bitmap not needed anymore */
+	free(pic->bitmap);
+	pic->bitmap = NULL;
+	return img;
+
+fail:
+	free_stream(&pic_stream);
+	free(img);
+	return NULL;
+}
+
+/*
+ * Place the picture of l, as in genps_line().
+ */
+static void
+draw_picture(F_line *l, int xmin, int ymin, int xmax, int ymax, F_pos *pts)
+{
+	int			dx, dy, rotation;
+	int			pic_w, pic_h;
+	int			pllx, plly, purx, pury;
+	struct pdf_image	*img;
+
+	if ((img = find_image(l->pic->file)) == NULL &&
+			(img = decode_picture(l->pic)) == NULL)
+		return;
+
+	dx = pts[2].x - pts[0].x;
+	dy = pts[2].y - pts[0].y;
+	rotation = 0;
+	if (dx < 0 && dy < 0)
+		   rotation = 180;
+	else if (dx < 0 && dy >= 0)
+		   rotation = 90;
+	else if (dy < 0 && dx >= 0)
+		   rotation = 270;
+
+	pllx = img->llx;
+	plly = img->lly;
+	purx = img->bit_size.x + pllx;
+	pury = img->bit_size.y + plly;
+
+	if (((rotation == 90 || rotation == 270) && !l->pic->flipped) ||
+	    (rotation != 90 && rotation != 270 && l->pic->flipped)) {
+		pic_w = pury - plly;
+		pic_h = purx - pllx;
+	} else {
+		pic_w = purx - pllx;
+		pic_h = pury - plly;
+	}
+
+	bufprintf(&content, "q\n1 0 0 1 %d %d cm\n", xmin, ymin);
+	bufprintf(&content, "%f 0 0 %f 0 0 cm\n",
+			fabs((double)(xmax-xmin)/pic_w),
+			-1.0*(double)(ymax-ymin)/pic_h);
+	switch (rotation) {
+	case 0:
+		if (l->pic->flipped)
+			bufprintf(&content, "1 0 0 1 %d 0 cm\n0 -1 1 0 0 0 cm\n"
+					"1 0 0 -1 0 0 cm\n", pic_w);
+		else
+			bufprintf(&content, "1 0 0 1 0 %d cm\n", -pic_h);
+		break;
+	case 90:
+		if (l->pic->flipped)
+			bufprintf(&content, "1 0 0 1 %d %d cm\n"
+					"-1 0 0 1 0 0 cm\n", pic_w, -pic_h);
+		else
+			bufprintf(&content, "0 -1 1 0 0 0 cm\n");
+		break;
+	case 180:
+		if (l->pic->flipped)
+			bufprintf(&content, "1 0 0 1 0 %d cm\n0 -1 1 0 0 0 cm\n"
+					"-1 0 0 1 0 0 cm\n", -pic_h);
+		else
+			bufprintf(&content, "1 0 0 1 %d 0 cm\n"
+					"-1 0 0 -1 0 0 cm\n", pic_w);
+		break;
+	case 270:
+		if (l->pic->flipped)
+			bufprintf(&content, "1 0 0 -1 0 0 cm\n");
+		else
+			bufprintf(&content, "1 0 0 1 %d %d cm\n"
+					"0 1 -1 0 0 0 cm\n", pic_w, -pic_h);
+		break;
+	}
+	bufprintf(&content, "1 0 0 1 %d %d cm\n%d 0 0 %d 0 0 cm\n",
+			-pllx, -plly, purx, pury);
+	/* a bitmap is painted in the pen color */
+	if (img->subtype == P_XBM)
+		set_color(l->pen_color, "rg");
+	bufprintf(&content, "/Im%d Do\nQ\n", img->obj);
+}
+
+
+/*******************************/
+/* arrows                      */
+/*******************************/
+
+/* append a polygon to path */
+static void
+path_points(F_pos *points, int npoints)
+{
+	int	i;
+
+	for (i = 0; i < npoints; ++i)
+		bufprintf(&path, "%d %d %c\n", points[i].x, points[i].y,
+				i == 0 ? 'm' : 'l');
+}
+
+static void
+draw_arrow(F_arrow *arrow, F_pos *points, int npoints,
+		F_pos *fillpoints, int nfillpoints, int col)
+{
+	int	type;
+
+	if (npoints < 2)
+		return;
+
+	set_linecap(0);			/* butt line cap for arrowheads */
+	set_linejoin(0);		/* miter join for sharp points */
+	set_linewidth(arrow->thickness);
+	path_points(points, npoints);
+
+	type = arrow->type;
+	if (type != 0 && type != 6 && type < 13) /* old heads, close the path */
+		bufprintf(&path, "h\n");
+	if (type == 0) {
+		paint_path(UNFILLED, col, col, true);
+	} else if (arrow->style == 0 && nfillpoints == 0) {
+		/* hollow, fill with white */
+		paint_path(NUMSHADES-1, col, WHITE_COLOR, true);
+	} else if (nfillpoints == 0) {
+		if (type < 13)
+			paint_path(NUMSHADES-1, col, arrow->style == 0 ?
+					WHITE_COLOR : col, true);
+		else
+			paint_path(UNFILLED, col, col, true);
+	} else {
+		/* special fill, first fill whole head with white */
+		paint_path(NUMSHADES-1, col, WHITE_COLOR, true);
+		/* then fill the special fill area */
+		path_points(fillpoints, nfillpoints);
+		paint_path(NUMSHADES-1, col, col, false);
+	}
+}
+
+/*
+ * Clip away the arrowheads of the object, computing the arrowheads, see
+ * clip_arrows() in genps.c. A rectangle enclosing the figure replaces
+ * the clippath of PostScript.
+ */
+static void
+clip_arrows(F_line *obj, int objtype)
+{
+	int	i;
+
+	bufprintf(&content, "q\n%d %d %d %d re\n", llx - round(ppi),
+			lly - round(ppi), urx - llx + 2 * round(ppi),
+			ury - lly + 2 * round(ppi));
+	if (obj->for_arrow) {
+		if (objtype == OBJ_ARC) {
+			F_arc  *a = (F_arc *) obj;
+			lpntx1 = a->point[2].x;
+			lpnty1 = a->point[2].y;
+			compute_arcarrow_angle(a->center.x, a->center.y,
+					(double)lpntx1, (double)lpnty1,
+					a->direction, a->for_arrow,
+					&lpntx2, &lpnty2);
+		}
+		calc_arrow(lpntx2, lpnty2, lpntx1, lpnty1, obj->thickness,
+				obj->for_arrow, fpoints, &nfpoints, ffillpoints,
+				&nffillpoints, clippoints, &nclippoints);
+		for (i = nclippoints - 1; i >= 0; --i)
+			bufprintf(&content, "%d %d %c\n", clippoints[i].x,
+					clippoints[i].y,
+					i == nclippoints - 1 ? 'm' : 'l');
+		bufprintf(&content, "h\n");
+	}
+	if (obj->back_arrow) {
+		if (objtype == OBJ_ARC) {
+			F_arc  *a = (F_arc *) obj;
+			fpntx1 = a->point[0].x;
+			fpnty1 = a->point[0].y;
+			compute_arcarrow_angle(a->center.x, a->center.y,
+					(double)fpntx1, (double)fpnty1,
+					a->direction ^ 1, a->back_arrow,
+					&fpntx2, &fpnty2);
+		}
+		calc_arrow(fpntx2, fpnty2, fpntx1, fpnty1, obj->thickness,
+				obj->back_arrow, bpoints, &nbpoints,bfillpoints,
+				&nbfillpoints, clippoints, &nclippoints);
+		for (i = nclippoints - 1; i >= 0; --i)
+			bufprintf(&content, "%d %d %c\n", clippoints[i].x,
+					clippoints[i].y,
+					i == nclippoints - 1 ? 'm' : 'l');
+		bufprintf(&content, "h\n");
+	}
+	bufprintf(&content, "W* n\n");
+}
+
+/* draw the arrowheads of obj, computed by clip_arrows() */
+static void
+draw_arrows(F_arrow *back_arrow, F_arrow *for_arrow, int thickness, int col)
+{
+	if (back_arrow && thickness > 0)
+		draw_arrow(back_arrow, bpoints, nbpoints, bfillpoints,
+				nbfillpoints, col);
+	if (for_arrow && thickness > 0)
+		draw_arrow(for_arrow, fpoints, nfpoints, ffillpoints,
+				nffillpoints, col);
+}
+
+
+/*******************************/
+/* the native pdf driver       */
+/*******************************/
+
+static void
+pdf_start(F_compound *objects)
+{
+	int			i;
+	const struct paperdef	*pd;
+	(void)objects;
+
+	pdf = tfp;
+	pdf_pos = 0;
+	num_objs = 0;
+	omitted = false;
+	for (i = 0; i < RESOURCES_OBJ; ++i)
+		(void)new_obj();
+	content.len = path.len = 0;
+	memset(font_obj, 0, sizeof font_obj);
+	memset(pattern_obj, 0, sizeof pattern_obj);
+	reset_gstate();
+	cur_hscale = 100;
+	pagewidth = pageheight = -1;
+
+	/* the geometry, as in genps_start() */
+	if (epsflag)
+		multi_page = false;
+
+	scalex = scaley = mag * POINT_PER_INCH / ppi;
+	fllx = llx * scalex - border_margin;
+	flly = lly * scaley - border_margin;
+	furx = urx * scalex + border_margin;
+	fury = ury * scaley + border_margin;
+
+	if (strcasecmp(papersize, "ledger") == 0)
+		strcpy(papersize, "tabloid");
+	for (pd = paperdef; pd->name != NULL; ++pd) {
+		if (strcasecmp(papersize, pd->name) == 0) {
+			pagewidth = pd->width;
+			pageheight = pd->height;
+			strcpy(papersize, pd->name);
+			break;
+		}
+	}
+	if (pagewidth < 0 || pageheight < 0) {
+		put_msg("Unknown paper size `%s'", papersize);
+		exit(EXIT_FAILURE);
+	}
+
+	if (epsflag) {
+		origx = -fllx;
+		origy = fury;
+		mediabox[0] = mediabox[1] = 0;
+		mediabox[2] = (int)ceil(furx - fllx);
+		mediabox[3] = (int)ceil(fury - flly);
+		if (boundingboxspec) {
+			double	w[4];
+			double	unit = POINT_PER_INCH / (metric ? 2.54 : 1.0);
+
+			switch (sscanf(boundingbox, "%lf %lf %lf %lf",
+						&w[0], &w[1], &w[2], &w[3])) {
+			case EOF:
+			case 0:
+				w[0] = 0.0;
+				/* intentionally fall through */
+			case 1:
+				w[1] = 0.0;
+				/* intentionally fall through */
+			case 2:
+				w[2] = 0.0;
+				/* intentionally fall through */
+			case 3:
+				w[3] = 0.0;
+			}
+			if (w[0] <= 0.0)
+				w[0] = (furx - fllx) / unit;
+			if (w[1] <= 0.0)
+				w[1] = (fury - flly) / unit;
+			mediabox[0] = (int)floor(w[2] * unit) - border_margin;
+			mediabox[1] = (int)floor(w[3] * unit) - border_margin;
+			mediabox[2] = (int)ceil((w[2] + w[0]) * unit) +
+				border_margin;
+			mediabox[3] = (int)ceil((w[3] + w[1]) * unit) +
+				border_margin;
+			if (useabsolutecoo) {
+				mediabox[0] += origx;
+				mediabox[2] += origx;
+			}
+		}
+	} else {
+		if (landscape) {
+			i = pageheight;
+			pageheight = pagewidth;
+			pagewidth = i;
+		}
+		if (center) {
+			origx = (pagewidth - furx - fllx)/2.0;
+			origy = (pageheight + fury + flly)/2.0;
+		} else {
+			origx = 0.0;
+			origy = pageheight;
+		}
+		origx += xoff;
+		origy += yoff;
+		mediabox[0] = mediabox[1] = 0;
+		mediabox[2] = pagewidth;
+		mediabox[3] = pageheight;
+	}
+
+	/* the header; the binary characters mark the file as binary */
+	if (!raster)
+		pdf_printf("%%PDF-1.%d\n%%\342\343\317\323\n",
+				pdfminorversion);
+
+	/* draw the figure in Fig units, with y pointing down */
+	if (!multi_page && !raster)
+		bufprintf(&content, "%.5f 0 0 %.5f %.2f %.2f cm\n",
+				scalex, -scaley, origx, origy);
+	bufprintf(&content, "10 M\n");	/* like X server (11 degrees) */
+	set_linejoin(0);
+	set_linecap(0);
+}
+
+static void
+pdf_grid(float major, float minor)
+{
+	float	lx, ly, ux, uy;
+	float	x, y;
+	double	thick, thin;
+	int	itick, ntick;
+	float	m;
+
+	if (minor == 0.0 && major == 0.0)
+		return;
+
+	m = minor;
+	if (minor == 0.0)
+		m = major;
+
+	if (epsflag) {
+		lx = floor((fllx / scalex) / m) * m;
+		ly = floor((flly / scaley) / m) * m;
+		ux = furx / scalex;
+		uy = fury / scaley;
+	} else {
+		lx = 0.0;
+		ly = 0.0;
+		ux = pagewidth / scalex;
+		uy = pageheight / scaley;
+	}
+	thin = THICK_SCALE;
+	thick = THICK_SCALE * 2.5;
+
+	bufprintf(&content, "q\n0.5 G\n");
+	if (metric)
+		bufprintf(&content, "%.5f 0 0 %.5f 0 0 cm\n", 450.0 / 472.0,
+				450.0 / 472.0);
+	/* the vertical lines, then the horizontal lines */
+	for (x = lx; x <= ux; x += m) {
+		if (major > 0.0) {
+			itick = (int)(x/major)*major;
+			if (itick == x) {
+				set_linewidth(thick);
+			} else {
+				ntick = (int)((x+minor)/major)*major;
+				if (ntick < x+minor) {
+					set_linewidth(thick);
+					bufprintf(&content, "%.1f %.1f m %.1f "
+						"%.1f l S\n", (float)ntick, ly,
+						(float)ntick, uy);
+				}
+				set_linewidth(thin);
+			}
+		} else {
+			set_linewidth(thin);
+		}
+		bufprintf(&content, "%.1f %.1f m %.1f %.1f l S\n",
+				x, ly, x, uy);
+	}
+	for (y = ly; y <= uy; y += m) {
+		if (major > 0.0) {
+			itick = (int)(y/major)*major;
+			if (itick == y) {
+				set_linewidth(thick);
+			} else {
+				ntick = (int)((y+minor)/major)*major;
+				if (ntick < y+minor) {
+					set_linewidth(thick);
+					bufprintf(&content, "%.1f %.1f m %.1f "
+						"%.1f l S\n", lx, (float)ntick,
+						ux, (float)ntick);
+				}
+				set_linewidth(thin);
+			}
+		} else {
+			set_linewidth(thin);
+		}
+		bufprintf(&content, "%.1f %.1f m %.1f %.1f l S\n",
+				lx, y, ux, y);
+	}
+	bufprintf(&content, "Q\n");
+	reset_gstate();
+}
+
+static void
+pdf_line(F_line *l)
+{
+	F_pos		*pts;
+	int		 n;
+	int		 radius;
+	int		 i;
+	int		 xmin,xmax,ymin,ymax;
+	float		 hf_wid;
+	bool		 clip;
+
+	pts = line_points(l, &n);
+
+	xmin = xmax = pts[0].x;
+	ymin = ymax = pts[0].y;
+	for (i = 1; i < n; ++i) { /* find lower left and upper right corners */
+		if (xmin > pts[i].x)
+			xmin = pts[i].x;
+		else if (xmax < pts[i].x)
+			xmax = pts[i].x;
+		if (ymin > pts[i].y)
+			ymin = pts[i].y;
+		else if (ymax < pts[i].y)
+			ymax = pts[i].y;
+	}
+
+	if (l->type == T_PIC_BOX) {
+		if (n > 2)
+			draw_picture(l, xmin, ymin, xmax, ymax, pts);
+		return;
+	}
+
+	set_linejoin(l->join_style);
+	set_linecap(l->cap_style);
+	set_linewidth((double)l->thickness);
+
+	if (n == 1) { /* A single point line */
+		if (l->cap_style > 0)
+			hf_wid = 1.0;
+		else if (l->thickness <= THICK_SCALE)
+			hf_wid = l->thickness/4.0;
+		else
+			hf_wid = (l->thickness-THICK_SCALE)/2.0;
+		bufprintf(&path, "%d %d m %d %d l\n",
+				round(pts[0].x-hf_wid), pts[0].y,
+				round(pts[0].x+hf_wid), pts[0].y);
+		paint_path(UNFILLED, l->pen_color, l->pen_color, true);
+		return;
+	}
+	set_style(l->style, l->style_val);
+
+	clip = false;
+	if (l->type == T_ARC_BOX) {
+		radius = l->radius;
+		if ((xmax - xmin) / 2 < radius)
+			radius = (xmax - xmin) / 2;
+		if ((ymax - ymin) / 2 < radius)
+			radius = (ymax - ymin) / 2;
+		bufprintf(&path, "%d %d m %d %d l\n", xmin + radius, ymin,
+				xmin + radius, ymin);
+		path_corner(xmin + radius, ymin, xmin, ymin,
+				xmin, ymin + radius);
+		bufprintf(&path, "%d %d l\n", xmin, ymax - radius);
+		path_corner(xmin, ymax - radius, xmin, ymax,
+				xmin + radius, ymax);
+		bufprintf(&path, "%d %d l\n", xmax - radius, ymax);
+		path_corner(xmax - radius, ymax, xmax, ymax,
+				xmax, ymax - radius);
+		bufprintf(&path, "%d %d l\n", xmax, ymin + radius);
+		path_corner(xmax, ymin + radius, xmax, ymin,
+				xmax - radius, ymin);
+		bufprintf(&path, "h\n");
+	} else {
+		fpntx1 = pts[0].x;
+		fpnty1 = pts[0].y;
+		fpntx2 = pts[1].x;
+		fpnty2 = pts[1].y;
+		lpntx2 = l->last[1].x;
+		lpnty2 = l->last[1].y;
+		lpntx1 = l->last[0].x;
+		lpnty1 = l->last[0].y;
+		if (l->type == T_POLYLINE && NEEDS_CLIPPING(l)) {
+			clip_arrows(l, OBJ_POLYLINE);
+			clip = true;
+		}
+		for (i = 0; i < n; ++i)
+			bufprintf(&path, "%d %d %c\n", pts[i].x, pts[i].y,
+					i == 0 ? 'm' : 'l');
+		/* close the path of a polygon, or of a polyline with
+		   coincident endpoints, so that the line join is used */
+		if (l->type != T_POLYLINE ||
+				(fpntx1 == lpntx1 && fpnty1 == lpnty1))
+			bufprintf(&path, "h\n");
+	}
+
+	paint_path(l->fill_style, l->pen_color, l->fill_color,
+			l->thickness > 0);
+	if (clip)
+		bufprintf(&content, "Q\n");
+	reset_style(l->style, l->style_val);
+	draw_arrows(l->back_arrow, l->for_arrow, l->thickness, l->pen_color);
+}
+
+static void
+pdf_itp_spline(F_spline *s)
+{
+	F_point		*p, *q;
+	F_control	*a, *b;
+	bool		clip = false;
+
+	a = s->controls;
+	p = s->points;
+	fpntx1 = p->x;
+	fpnty1 = p->y;
+	fpntx2 = round(a->rx);
+	fpnty2 = round(a->ry);
+	b = a;
+	for (q = p->next; q != NULL; p = q, q = q->next) {
+		b = a->next;
+		a = b;
+	}
+	lpntx2 = round(b->lx);
+	lpnty2 = round(b->ly);
+	lpntx1 = p->x;
+	lpnty1 = p->y;
+	if (NEEDS_CLIPPING(s)) {
+		clip_arrows((F_line *)s, OBJ_SPLINE);
+		clip = true;
+	}
+
+	a = s->controls;
+	p = s->points;
+	set_style(s->style, s->style_val);
+	bufprintf(&path, "%d %d m\n", p->x, p->y);
+	for (q = p->next; q != NULL; p = q, q = q->next) {
+		b = a->next;
+		bufprintf(&path, "%.1f %.1f %.1f %.1f %d %d c\n",
+				a->rx, a->ry, b->lx, b->ly, q->x, q->y);
+		a = b;
+	}
+	if (closed_spline(s))
+		bufprintf(&path, "h\n");
+	paint_path(s->fill_style, s->pen_color, s->fill_color,
+			s->thickness > 0);
+	if (clip)
+		bufprintf(&content, "Q\n");
+	reset_style(s->style, s->style_val);
+	draw_arrows(s->back_arrow, s->for_arrow, s->thickness, s->pen_color);
+}
+
+/* add a spline section, as DrawSplineSection in the PostScript prolog */
+static void
+path_spline_section(double x1, double y1, double x2, double y2,
+		double x3, double y3)
+{
+	bufprintf(&path, "%.1f %.1f l\n%.1f %.1f %.1f %.1f %.1f %.1f c\n",
+			x1, y1, x1 + (x2 - x1) * 0.666667,
+			y1 + (y2 - y1) * 0.666667, x3 + (x2 - x3) * 0.666667,
+			y3 + (y2 - y3) * 0.666667, x3, y3);
+}
+
+static void
+pdf_ctl_spline(F_spline *s)
+{
+	double		a, b, c, d, x1, y1, x2, y2, x3, y3;
+	F_point		*p, *q;
+	bool		clip = false;
+
+	p = s->points;
+	x1 = p->x;
+	y1 = p->y;
+	p = p->next;
+	c = p->x;
+	d = p->y;
+	x3 = a = (x1 + c) / 2;
+	y3 = b = (y1 + d) / 2;
+
+	fpntx1 = round(x1);
+	fpnty1 = round(y1);
+	fpntx2 = round(x3);
+	fpnty2 = round(y3);
+
+	x2 = x1; y2 = y1;
+	for (q = p->next; q != NULL; p = q, q = q->next) {
+		x1 = x3;
+		y1 = y3;
+		x2 = c;
+		y2 = d;
+		c = q->x;
+		d = q->y;
+		x3 = (x2 + c) / 2;
+		y3 = (y2 + d) / 2;
+	}
+	lpntx2 = round(x2);
+	lpnty2 = round(y2);
+	lpntx1 = round(c);
+	lpnty1 = round(d);
+	if (NEEDS_CLIPPING(s)) {
+		clip_arrows((F_line *)s, OBJ_SPLINE);
+		clip = true;
+	}
+
+	set_style(s->style, s->style_val);
+
+	p = s->points;
+	x1 = p->x;
+	y1 = p->y;
+	p = p->next;
+	c = p->x;
+	d = p->y;
+	x3 = a = (x1 + c) / 2;
+	y3 = b = (y1 + d) / 2;
+	if (closed_spline(s))
+		bufprintf(&path, "%.1f %.1f m\n", a, b);
+	else
+		bufprintf(&path, "%.1f %.1f m %.1f %.1f l\n", x1, y1, x3, y3);
+
+	for (q = p->next; q != NULL; p = q, q = q->next) {
+		x1 = x3;
+		y1 = y3;
+		x2 = c;
+		y2 = d;
+		c = q->x;
+		d = q->y;
+		x3 = (x2 + c) / 2;
+		y3 = (y2 + d) / 2;
+		path_spline_section(x1, y1, x2, y2, x3, y3);
+	}
+	if (closed_spline(s)) {
+		path_spline_section(x3, y3, c, d, a, b);
+		bufprintf(&path, "h\n");
+	} else {
+		bufprintf(&path, "%.1f %.1f l\n", c, d);
+	}
+	paint_path(s->fill_style, s->pen_color, s->fill_color,
+			s->thickness > 0);
+	if (clip)
+		bufprintf(&content, "Q\n");
+	reset_style(s->style, s->style_val);
+	draw_arrows(s->back_arrow, s->for_arrow, s->thickness, s->pen_color);
+}
+
+static void
+pdf_spline(F_spline *s)
+{
+	if (closed_spline(s)) {
+		if (s->style == DOTTED_LINE)
+			set_linecap(1);		/* round dots for dotted line */
+	} else {		/* open splines can explicitely set capstyle */
+		set_linecap(s->cap_style);
+	}
+	set_linewidth((double)s->thickness);
+	if (int_spline(s))
+		pdf_itp_spline(s);
+	else
+		pdf_ctl_spline(s);
+}
+
+static void
+pdf_arc(F_arc *a)
+{
+	double		angle1, angle2, radius;
+	double		cx, cy, sx, sy, ex, ey;
+	bool		clip = false;
+
+	cx = a->center.x; cy = a->center.y;
+	sx = a->point[0].x; sy = a->point[0].y;
+	ex = a->point[2].x; ey = a->point[2].y;
+
+	set_linewidth((double)a->thickness);
+	set_linecap(a->cap_style);
+	radius = sqrt((cx - sx) * (cx - sx) + (cy - sy) * (cy - sy));
+	if (cx == sx)
+		angle1 = (sy - cy > 0 ? 90.0 : -90.0);
+	else
+		angle1 = atan2(sy - cy, sx - cx) * 180.0 / M_PI;
+	if (cx == ex)
+		angle2 = (ey - cy > 0 ? 90.0 : -90.0);
+	else
+		angle2 = atan2(ey - cy, ex - cx) * 180.0 / M_PI;
+
+	/* workaround for arcs with start point = end point;
+	   make angles slightly different */
+	if (fabs(angle1 - angle2) < 0.001)
+		angle2 = angle1 + 0.01;
+	/* the angles swept by the arc and arcn operators of PostScript;
+	   direction = 1 -> Counterclockwise, drawn by arcn */
+	if (a->direction == 1) {
+		while (angle2 > angle1)
+			angle2 -= 360.0;
+	} else {
+		while (angle2 < angle1)
+			angle2 += 360.0;
+	}
+
+	if (a->type == T_OPEN_ARC && NEEDS_CLIPPING(a)) {
+		clip_arrows((F_line *)a, OBJ_ARC);
+		clip = true;
+	}
+	set_style(a->style, a->style_val);
+
+	path_arc(cx, cy, radius, radius, 0.0, angle1 * M_PI / 180.0,
+			angle2 * M_PI / 180.0, true);
+	if (a->type == T_PIE_WEDGE_ARC)
+		bufprintf(&path, "%.1f %.1f l %.1f %.1f l\n", cx, cy, sx, sy);
+
+	paint_path(a->fill_style, a->pen_color, a->fill_color,
+			a->thickness > 0);
+	if (clip)
+		bufprintf(&content, "Q\n");
+	reset_style(a->style, a->style_val);
+
+	if (a->type == T_OPEN_ARC)
+		draw_arrows(a->back_arrow, a->for_arrow, a->thickness,
+				a->pen_color);
+}
+
+static void
+pdf_ellipse(F_ellipse *e)
+{
+	set_linewidth((double)e->thickness);
+	set_style(e->style, e->style_val);
+	if (e->style == DOTTED_LINE)
+		set_linecap(1);	/* round dots */
+	else
+		set_linecap(0);
+	path_arc(e->center.x, e->center.y, e->radiuses.x, e->radiuses.y,
+			-e->angle, 0.0, 2 * M_PI, true);
+	bufprintf(&path, "h\n");
+	paint_path(e->fill_style, e->pen_color, e->fill_color,
+			e->thickness > 0);
+	reset_style(e->style, e->style_val);
+}
+
+/*
+ * Return the index into std_fonts[] of the font of text t, and its
+ * horizontal scaling.
  */
+static int
+text_font(F_text *t, int *hscale)
+{
+	int		i;
+	const char	*name;
 
-#ifdef HAVE_CONFIG_H
-#include "config.h"
-#endif
+	*hscale = 100;
+	if ((v2_flag && !(v21_flag || v30_flag)) || psfont_text(t))
+		name = t->font <= MAX_PSFONT ? PSfontnames[t->font + 1] :
+			PSfontnames[0];
+	else if (t->font <= 0)
+		name = PSfontnames[t->font + 1];	/* set by -f */
+	else
+		name = latexfontnames[t->font <= MAX_FONT ? t->font + 1 : 0];
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <signal.h>
+	for (i = 0; i < NUM_STD_FONTS; ++i)
+		if (!strcmp(name, std_fonts[i]))
+			return i;
+	for (i = 0; i < (int)(sizeof font_subst / sizeof font_subst[0]); ++i)
+		if (!strcmp(name, font_subst[i].name)) {
+			*hscale = font_subst[i].hscale;
+			return font_subst[i].font;
+		}
+	return 0;
+}
 
-#include "fig2dev.h"
-#include "object.h"
-#include "genps.h"
-#include "messages.h"
+/*
+ * Return the text of t, converted to latin1, in a newly allocated string.
+ * Return NULL, if the text contains characters beyond latin1.
+ */
+static char *
+latin1_text(F_text *t)
+{
+	char	*str;
+	char	*c;
+	int	hscale;
+
+	if (text_font(t, &hscale) >= SYMBOL_FONT) {
+		/* the symbol fonts use their own encoding */
+		if ((str = strdup(t->cstring)) == NULL) {
+			put_msg(Err_mem);
+			exit(EXIT_FAILURE);
+		}
+		if ((c = conv_textisutf8(str)))
+			(void)convertutf8tolatin1(c);
+		return str;
+	}
+
+	if (conv_textstring(&c, t->cstring, strlen(t->cstring))) {
+		/* the conversion failed, use the text as it is */
+		if (c != t->cstring)
+			free(c);
+		c = t->cstring;
+	}
+	if (c == t->cstring && (c = strdup(t->cstring)) == NULL) {
+		put_msg(Err_mem);
+		exit(EXIT_FAILURE);
+	}
+	if (conv_non_ascii(c) && convertutf8tolatin1(c)) {
+		free(c);
+		return NULL;
+	}
+	return c;
+}
 
-#define PDFMINORVERSION		5
 /*
- * The ghostscript command line.
- * With -dAutoFilterColorImages=false,
- * -dColorImageFilter=/FlateEncode	produces a lossless but large image,
- * -dColorImageFilter=/DCTEncode	produces a lossy but much smaller image.
- * The default, -dAutoFilterColorImages=true is fine for e.g., png and jpg.
- * -o also sets -dBATCH -dNOPAUSE
+ * Return the width of the string str in the font font, in thousandths of the
+ * font size.
  */
-#ifdef GSEXE
-#define	GSFMT	GSEXE " -q -dSAFER -dAutoRotatePages=/None -sDEVICE=pdfwrite " \
-		"-dCompatibilityLevel=1.%d -dPDFSETTINGS=/prepress -o '%s' -"
-#else
-#define GSFMT	""
-#endif
+static long
+text_width(const char *str, int font)
+{
+	long			w = 0;
+	const unsigned char	*c;
 
-/* String buffer for the ghostscript command. 82 chars for the filename */
-static char	com_buf[sizeof GSFMT + 80];
-static char	*com = com_buf;
-static int	pdfminorversion = PDFMINORVERSION;
+	for (c = (const unsigned char *)str; *c != '\0'; ++c)
+		if (*c >= 32)
+			w += std_widths[font][*c - 32];
+	return w;
+}
+
+static void
+pdf_text(F_text *t)
+{
+	int	font, hscale;
+	char	*str;
+	double	size, dx;
+
+	/* ignore hidden text (new for xfig3.2.3/fig2dev3.2.3) */
+	if (hidden_text(t))
+		return;
+
+	if ((str = latin1_text(t)) == NULL) {
+		put_msg("Text not representable in latin1 needs ghostscript: "
+				"%s", t->cstring);
+		omitted = true;
+		return;
+	}
+	font = text_font(t, &hscale);
+	if (font_obj[font] == 0)
+		font_obj[font] = new_obj();
+	size = PSFONTMAG(t);
+
+	set_color(t->color, "rg");
+	bufprintf(&content, "BT\n/F%d %.2f Tf\n", font, size);
+	if (hscale != cur_hscale) {
+		cur_hscale = hscale;
+		bufprintf(&content, "%d Tz\n", hscale);
+	}
+	/* the text is flipped, to have y pointing up again */
+	bufprintf(&content, "%.4f %.4f %.4f %.4f %d %d Tm\n",
+			cos(t->angle), -sin(t->angle), -sin(t->angle),
+			-cos(t->angle), t->base_x, t->base_y);
+	/* the horizontal scaling also applies to the advance of the glyphs */
+	if (t->type == T_CENTER_JUSTIFIED || t->type == T_RIGHT_JUSTIFIED) {
+		dx = text_width(str, font) * size * hscale / 100000.0;
+		if (t->type == T_CENTER_JUSTIFIED)
+			dx /= 2.0;
+		bufprintf(&content, "%.1f 0 Td\n", -dx);
+	} else if (t->type != T_LEFT_JUSTIFIED && t->type != DEFAULT) {
+		fprintf(stderr, "Text incorrectly positioned\n");
+	}
+	put_string(&content, str);
+	bufprintf(&content, " Tj\nET\n");
+	free(str);
+}
+
+static void
+write_page(int page, int contents)
+{
+	begin_obj(page);
+	pdf_printf("<< /Type /Page /Parent %d 0 R /MediaBox [%d %d %d %d]\n"
+			"   /Resources %d 0 R /Contents %d 0 R >>\nendobj\n",
+			PAGES_OBJ, mediabox[0], mediabox[1], mediabox[2],
+			mediabox[3], RESOURCES_OBJ, contents);
+}
+
+/* the background, if specified, in the coordinates of the page */
+static void
+put_background(struct pdfbuf *b)
+{
+	double	r = background.red / 65535.0;
+	double	g = background.green / 65535.0;
+	double	bl = background.blue / 65535.0;
+
+	if (!bgspec)
+		return;
+	if (grayonly)
+		bufprintf(b, "%.2f g\n", rgb2luminance(r, g, bl));
+	else
+		bufprintf(b, "%.2f %.2f %.2f rg\n", r, g, bl);
+	bufprintf(b, "%d %d %d %d re f\n", mediabox[0], mediabox[1],
+			mediabox[2] - mediabox[0], mediabox[3] - mediabox[1]);
+}
+
+/* free the images, for the next figure in batch mode */
+static void
+free_images(void)
+{
+	struct pdf_image	*img;
+
+	while ((img = pdf_images) != NULL) {
+		pdf_images = img->next;
+		if (img->pic) {
+			free(img->pic->bitmap);
+			free(img->pic);
+		}
+		free(img);
+	}
+}
+
+static int
+pdf_end(void)
+{
+	int			i, obj;
+	int			form = 0;
+	int			*pages = NULL;
+	int			num_pages = 0;
+	long			xref;
+	char			date_buf[CREATION_TIME_LEN];
+	struct pdfbuf		b = {NULL, 0, 0};
+	struct pdf_image	*img;
 
+	if (!multi_page) {
+		struct pdfbuf	page = {NULL, 0, 0};
+
+		if ((pages = malloc(sizeof(int))) == NULL) {
+			put_msg(Err_mem);
+			exit(EXIT_FAILURE);
+		}
+		put_background(&page);
+		bufprintf(&page, "%.*s", (int)content.len, content.s);
+		pages[num_pages++] = new_obj();
+		obj = new_obj();
+		write_stream(obj, "", (unsigned char *)page.s, page.len, false);
+		write_page(pages[0], obj);
+		free(page.s);
+	} else {
+		/* the figure is a form, drawn on each page, as in
+		   genps_end() */
+		double		dx, dy, mul;
+		const int	h = pageheight, w = pagewidth;
+
+		form = new_obj();
+		bufprintf(&b, " /Type /XObject /Subtype /Form /Resources %d 0 R"
+				" /BBox [%d %d %d %d]", RESOURCES_OBJ,
+				llx - round(ppi), lly - round(ppi),
+				urx + round(ppi), ury + round(ppi));
+		write_stream(form, b.s, (unsigned char *)content.s, content.len,
+				false);
+		mul = overlap ? 0.9 : 1.0;
+		for (dy = 0; (dy < (fury - h*0.1)) || num_pages == 0;
+				dy += h*mul) {
+			for (dx = 0; (dx < (furx - w*0.1)) || num_pages == 0;
+					dx += w*mul) {
+				if ((pages = realloc(pages, (num_pages + 1) *
+							sizeof(int))) == NULL) {
+					put_msg(Err_mem);
+					exit(EXIT_FAILURE);
+				}
+				pages[num_pages++] = new_obj();
+				b.len = 0;
+				put_background(&b);
+				bufprintf(&b, "q %.5f 0 0 %.5f %.1f %.1f cm "
+						"/Fm%d Do Q\n", scalex, -scaley,
+						-dx, dy + h*mul, form);
+				obj = new_obj();
+				write_stream(obj, "", (unsigned char *)b.s,
+						b.len, false);
+				write_page(pages[num_pages - 1], obj);
+			}
+		}
+	}
+
+	/* the resources */
+	for (i = 0; i < NUM_STD_FONTS; ++i) {
+		if (font_obj[i] == 0)
+			continue;
+		begin_obj(font_obj[i]);
+		pdf_printf("<< /Type /Font /Subtype /Type1 /BaseFont /%s%s >>\n"
+				"endobj\n", std_fonts[i], i < SYMBOL_FONT ?
+				" /Encoding /WinAnsiEncoding" : "");
+	}
+	write_patterns();
+
+	begin_obj(RESOURCES_OBJ);
+	pdf_printf("<<");
+	for (i = 0; i < NUM_STD_FONTS && font_obj[i] == 0; ++i)
+		;
+	if (i < NUM_STD_FONTS) {
+		pdf_printf(" /Font <<");
+		for (; i < NUM_STD_FONTS; ++i)
+			if (font_obj[i])
+				pdf_printf(" /F%d %d 0 R", i, font_obj[i]);
+		pdf_printf(" >>\n");
+	}
+	if (pdf_images != NULL || form) {
+		pdf_printf(" /XObject <<");
+		for (img = pdf_images; img != NULL; img = img->next)
+			pdf_printf(" /Im%d %d 0 R", img->obj, img->obj);
+		if (form)
+			pdf_printf(" /Fm%d %d 0 R", form, form);
+		pdf_printf(" >>\n");
+	}
+	for (i = 0; i < NUMPATTERNS && pattern_obj[i] == 0; ++i)
+		;
+	if (i < NUMPATTERNS) {
+		pdf_printf(" /ColorSpace << /CsP [/Pattern /DeviceRGB] "
+				"/CsG [/Pattern /DeviceGray] >>\n /Pattern <<");
+		for (; i < NUMPATTERNS; ++i)
+			if (pattern_obj[i])
+				pdf_printf(" /P%d %d 0 R", i + 1,
+						pattern_obj[i]);
+		pdf_printf(" >>\n");
+	}
+	pdf_printf(">>\nendobj\n");
+
+	begin_obj(PAGES_OBJ);
+	pdf_printf("<< /Type /Pages /Count %d /Kids [", num_pages);
+	for (i = 0; i < num_pages; ++i)
+		pdf_printf("%s%d 0 R", i % 8 ? " " : "\n", pages[i]);
+	pdf_printf(" ] >>\nendobj\n");
+	free(pages);
+
+	begin_obj(CATALOG_OBJ);
+	pdf_printf("<< /Type /Catalog /Pages %d 0 R >>\nendobj\n", PAGES_OBJ);
+
+	b.len = 0;
+	bufprintf(&b, "<< /Title ");
+	put_string(&b, name ? name : (from ? from : "stdin"));
+	bufprintf(&b, "\n   /Creator (%s Version %s)", prog, PACKAGE_VERSION);
+	if (creation_date_pdfmark(date_buf))
+		bufprintf(&b, "\n   /CreationDate (%s) /ModDate (%s)",
+				date_buf, date_buf);
+	bufprintf(&b, " >>\nendobj\n");
+	begin_obj(INFO_OBJ);
+	pdf_write(b.s, b.len);
+	free(b.s);
+
+	/* the cross-reference table */
+	xref = pdf_pos;
+	pdf_printf("xref\n0 %d\n0000000000 65535 f \n", num_objs + 1);
+	for (i = 1; i <= num_objs; ++i)
+		pdf_printf("%010ld 00000 n \n", obj_pos[i]);
+	pdf_printf("trailer\n<< /Size %d /Root %d 0 R /Info %d 0 R >>\n"
+			"startxref\n%ld\n%%%%EOF\n", num_objs + 1, CATALOG_OBJ,
+			INFO_OBJ, xref);
+
+	free_images();
+
+	if (fflush(pdf) || ferror(pdf)) {
+		err_msg("Error writing pdf output");
+		return -1;
+	}
+	/* the figure was written, but without some pictures or text */
+	return omitted ? -1 : 0;
+}
+
+/*
+ * Return true, if the objects can only be converted by ghostscript. These
+ * are embedded eps or pdf files, and text not representable in latin1.
+ * For rendering the objects, also embedded jpeg files.
+ */
+bool
+genpdf_needs_gs(F_compound *ob, bool rendering)
+{
+	F_line		*l;
+	F_text		*t;
+	F_compound	*c;
+	char		*str;
+
+	for (l = ob->lines; l != NULL; l = l->next)
+		if (l->type == T_PIC_BOX && l->pic != NULL &&
+				l->pic->file != NULL &&
+				depth_filter(l->depth) &&
+				(is_postscript(l->pic->file) ||
+				 (rendering && is_jpeg(l->pic->file))))
+			return true;
+
+	for (t = ob->texts; t != NULL; t = t->next) {
+		if (hidden_text(t) || !depth_filter(t->depth) ||
+				(!strcmp(lang, "pdftex") && special_text(t)))
+			continue;
+		if ((str = latin1_text(t)) == NULL)
+			return true;
+		free(str);
+	}
+
+	for (c = ob->compounds; c != NULL; c = c->next)
+		if (genpdf_needs_gs(c, rendering))
+			return true;
+	return false;
+}
+
+
+/*******************************/
+/* the driver                  */
+/*******************************/
 
 void
 genpdf_option(char opt, char *optarg)
@@ -81,10 +2243,33 @@ genpdf_option(char opt, char *optarg)
 		if (pdfminorversion < 1 || pdfminorversion > 7)
 			pdfminorversion = PDFMINORVERSION;
 		break;
+	case 'w':
+		force_gs = true;
+		return;
+	/* the options below are also needed in gen_ps_eps_option() */
+	case 'b':
+		sscanf(optarg, "%d", &border_margin);
+		break;
+	case 'B':
+		if (epsflag)
+			useabsolutecoo = true;
+		break;
+	case 'F':
+		correct_font_size = true;
+		break;
+	case 'x':
+		if (!epsflag)
+			xoff = atoi(optarg);
+		break;
+	case 'y':
+		if (!epsflag)
+			yoff = atoi(optarg);
+		break;
 	}
 	gen_ps_eps_option(opt, optarg);
 }
 
+#ifdef GSEXE
 static void
 pdf_broken_pipe(int sig)
 {
@@ -94,46 +2279,57 @@ pdf_broken_pipe(int sig)
 	fprintf(stderr, "command was: %s\n", com);
 	exit(EXIT_FAILURE);
 }
+#endif
 
 void
 genpdf_start(F_compound *objects)
 {
+	use_gs = false;
 #ifdef GSEXE
-	size_t	len;
-	char	*ofile;
+	use_gs = force_gs || genpdf_needs_gs(objects, false);
+	if (use_gs) {
+		size_t	len;
+		char	*ofile;
 
-	/* divert output from ps driver to the pipe into ghostscript */
-	/* but first close the output file that main() opened */
-	if (tfp != stdout) {
-		fclose(tfp);
-		ofile = to;
-	} else {
-		ofile = "-";
-	}
+		/* divert output from ps driver to the pipe into ghostscript */
+		/* but first close the output file that main() opened */
+		if (tfp != stdout) {
+			fclose(tfp);
+			ofile = to;
+		} else {
+			ofile = "-";
+		}
 
-	/* write command for conversion to pdf */
-	len = sizeof GSFMT + strlen(ofile) - 3;
-	if (len > sizeof com_buf && (com = malloc(len)) == NULL) {
-		put_msg(Err_mem);
-		exit(EXIT_FAILURE);
-	}
-	if (sprintf(com, GSFMT, pdfminorversion, ofile) < 0) {
-		err_msg("fig2dev: error when creating ghostscript command");
-		exit(EXIT_FAILURE);
-	}
+		/* write command for conversion to pdf */
+		com = com_buf;
+		len = sizeof GSFMT + strlen(ofile) - 3;
+		if (len > sizeof com_buf && (com = malloc(len)) == NULL) {
+			put_msg(Err_mem);
+			exit(EXIT_FAILURE);
+		}
+		if (sprintf(com, GSFMT, pdfminorversion, ofile) < 0) {
+			err_msg("fig2dev: error when creating ghostscript "
+					"command");
+			exit(EXIT_FAILURE);
+		}
 
-	(void) signal(SIGPIPE, pdf_broken_pipe);
-	if ((tfp = popen(com, "w")) == 0) {
-		err_msg("fig2dev: Cannot open pipe to ghostscript");
-		put_msg("Command was: %s", com);
-		exit(EXIT_FAILURE);
+		(void) signal(SIGPIPE, pdf_broken_pipe);
+		if ((tfp = popen(com, "w")) == 0) {
+			err_msg("fig2dev: Cannot open pipe to ghostscript");
+			put_msg("Command was: %s", com);
+			exit(EXIT_FAILURE);
+		}
+		genps_start(objects);
+		return;
 	}
-	genps_start(objects);
 #else /* GSEXE */
-	put_msg("This fig2dev is compiled without ghostscript support.\n"
-			"Cannot create pdf output.");
-	exit(EXIT_FAILURE);
+	if (force_gs) {
+		put_msg("This fig2dev is compiled without ghostscript support."
+				"\nCannot use ghostscript to create pdf output.");
+		exit(EXIT_FAILURE);
+	}
 #endif
+	pdf_start(objects);
 }
 
 int
@@ -141,6 +2337,9 @@ genpdf_end(void)
 {
 	int	 status;
 
+	if (!use_gs)
+		return pdf_end();
+
 	/* wrap up the postscript output */
 	if (genps_end() != 0) {
 		pclose(tfp);
@@ -164,15 +2363,127 @@ genpdf_end(void)
 	return status;
 }
 
+void
+genpdf_grid(float major, float minor)
+{
+	if (use_gs)
+		genps_grid(major, minor);
+	else
+		pdf_grid(major, minor);
+}
+
+void
+genpdf_arc(F_arc *a)
+{
+	if (use_gs)
+		genps_arc(a);
+	else
+		pdf_arc(a);
+}
+
+void
+genpdf_ellipse(F_ellipse *e)
+{
+	if (use_gs)
+		genps_ellipse(e);
+	else
+		pdf_ellipse(e);
+}
+
+void
+genpdf_line(F_line *l)
+{
+	if (use_gs)
+		genps_line(l);
+	else
+		pdf_line(l);
+}
+
+void
+genpdf_spline(F_spline *s)
+{
+	if (use_gs)
+		genps_spline(s);
+	else
+		pdf_spline(s);
+}
+
+void
+genpdf_text(F_text *t)
+{
+	if (use_gs)
+		genps_text(t);
+	else
+		pdf_text(t);
+}
+
+/*
+ * Raster mode. The objects are drawn by the functions above, which call
+ * pdf_line() etc.
+ */
+void
+genpdf_raster_start(F_compound *objects, bool font_size)
+{
+	raster = true;
+	use_gs = false;
+	correct_font_size = font_size;
+	pdf_start(objects);
+}
+
+const char *
+genpdf_raster_content(size_t *len)
+{
+	*len = content.len;
+	return content.s ? content.s : "";
+}
+
+/* the content of pattern n, valid until the next call */
+const char *
+genpdf_raster_pattern(int n, int *w, int *h, size_t *len)
+{
+	if (n < 1 || n > NUMPATTERNS)
+		return NULL;
+	pattern_content(n, w, h);
+	*len = path.len;
+	return path.s;
+}
+
+const F_pic *
+genpdf_raster_image(int n)
+{
+	struct pdf_image	*img;
+
+	for (img = pdf_images; img != NULL; img = img->next)
+		if (img->obj == n)
+			return img->pic;
+	return NULL;
+}
+
+const char *
+genpdf_raster_font(int n)
+{
+	return n >= 0 && n < NUM_STD_FONTS ? std_fonts[n] : NULL;
+}
+
+/* return -1, if a picture or text could not be rendered, otherwise 0 */
+int
+genpdf_raster_end(void)
+{
+	free_images();
+	raster = false;
+	return omitted ? -1 : 0;
+}
+
 struct driver dev_pdf = {
 	genpdf_option,
 	genpdf_start,
-	genps_grid,
-	genps_arc,
-	genps_ellipse,
-	genps_line,
-	genps_spline,
-	genps_text,
+	genpdf_grid,
+	genpdf_arc,
+	genpdf_ellipse,
+	genpdf_line,
+	genpdf_spline,
+	genpdf_text,
 	genpdf_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	NO_STREAM
 };
@@ -0,0 +1,49 @@
+/*
+ * Fig2dev: Translate Fig code to various Devices
+ * Copyright (c) 1991 by Micah Beck
+ * Parts Copyright (c) 1985-1988 by Supoj Sutanthavibul
+ * Parts Copyright (c) 1989-2015 by Brian V. Smith
+ * Parts Copyright (c) 2015-2024 by Thomas Loimer
+ *
+ * Any party obtaining a copy of these files is granted, free of charge, a
+ * full and unrestricted irrevocable, world-wide, paid up, royalty-free,
+ * nonexclusive right and license to deal in this software and documentation
+ * files (the "Software"), including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense and/or sell copies
+ * of the Software, and to permit persons who receive copies from any such
+ * party to do so, with the only requirement being that the above copyright
+ * and this permission notice remain intact.
+ *
+ */
+
+#ifndef GENPDF_H
+#define GENPDF_H
+
+#include <stddef.h>
+
+#include "bool.h"
+#include "object.h"
+
+extern void	genpdf_option(char opt, char *optarg);
+extern void	genpdf_start(F_compound *objects);
+extern int	genpdf_end(void);
+extern void	genpdf_grid(float major, float minor);
+extern void	genpdf_arc(F_arc *a);
+extern void	genpdf_ellipse(F_ellipse *e);
+extern void	genpdf_line(F_line *l);
+extern void	genpdf_spline(F_spline *s);
+extern void	genpdf_text(F_text *t);
+
+extern bool	genpdf_needs_gs(F_compound *objects, bool rendering);
+
+/* raster mode, the content is kept in memory and rendered by raster.c */
+extern void		genpdf_raster_start(F_compound *objects,
+					bool font_size);
+extern const char	*genpdf_raster_content(size_t *len);
+extern const char	*genpdf_raster_pattern(int n, int *w, int *h,
+					size_t *len);
+extern const F_pic	*genpdf_raster_image(int n);
+extern const char	*genpdf_raster_font(int n);
+extern int		genpdf_raster_end(void);
+
+#endif /* GENPDF_H */
@@ -59,6 +59,7 @@ static void genpic_closed_spline(F_spline *s);
 
 #define		TOP	10.5	/* top of page is 10.5 inch */
 static int LineThickness = 0;
+static float style_val = -1;	/* the current dash length, see set_style() */
 static int OptArcBox = 0;	/* Conditional use */
 static int OptLineThick = 0;
 static int OptEllipseFill = 0;
@@ -129,6 +130,8 @@ void
 genpic_start(F_compound *objects)
 {
 	ppi = ppi/mag;
+	LineThickness = 0;
+	style_val = -1;
 
 	/* print any whole-figure comments prefixed with '.\" ' */
 	if (objects->comments) {
@@ -176,8 +179,6 @@ AddThickness(void)
 static void
 set_style(int s, double v)
 {
-	static float	style_val = -1;
-
 	if (s == DASH_LINE || s == DOTTED_LINE) {
 	    if (v == style_val) return;
 	    if (v == 0.0) return;
@@ -658,5 +659,6 @@ struct driver dev_pic = {
 	genpic_spline,
 	genpic_text,
 	genpic_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	NO_STREAM
 };
@@ -556,18 +556,25 @@ colors_used(void)
 void
 genpict2e_start(F_compound *objects)
 {
+	int	margin;
+
 	texfontsizes[0] = texfontsizes[1]
 		= TEXFONTSIZE(font_size != 0.0? font_size : DEFAULT_FONT_SIZE);
 
+	cur_thickness = saved_thickness = 0;
+	cur_joinstyle = cur_capstyle = 0;
+	cur_color = DEFAULT;
+	cur_shade = NUMSHADES - 1;
+
 	unitlength = mag/ppi;
-	/* border_margin /=(int)(unitlength*72.0) lets a number of tests fail */
-	border_margin /= unitlength*72.0;
+	/* margin = border_margin / (int)(unitlength*72.0) lets tests fail */
+	margin = border_margin / (unitlength*72.0);
 
 	/* adjust for any border margin */
-	llx -= border_margin;
-	lly -= border_margin;
-	urx += border_margin;
-	ury += border_margin;
+	llx -= margin;
+	lly -= margin;
+	urx += margin;
+	ury += margin;
 
 	/* print any whole-figure comments prefixed with "%" */
 	if (objects->comments) {
@@ -2391,6 +2398,8 @@ put_patternarc(
 	o[3].next->next = o[4].next;
 	if (a->type == T_PIE_WEDGE_ARC)
 		l->points = o[0].next;
+	/* the arrows still belong to the arc */
+	l->for_arrow = l->back_arrow = NULL;
 	free_linestorage(l);
 }
 
@@ -2545,5 +2554,6 @@ struct driver dev_pict2e = {
 	genpict2e_spline,
 	genpict2e_text,
 	genpict2e_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	STREAM_OBJECTS
 };
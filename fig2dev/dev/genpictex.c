@@ -138,6 +138,10 @@ genpictex_start(F_compound *objects)
 	texfontsizes[0] = texfontsizes[1] =
 		TEXFONTSIZE(font_size != 0.0? font_size : DEFAULT_FONT_SIZE);
 
+	dash_length = -1;
+	line_style = SOLID_LINE;
+	cur_thickness = -1;
+
 	/* PiCTeX start */
 
 	/* announce filename, version etc */
@@ -929,5 +933,6 @@ struct driver dev_pictex = {
 	genpictex_spline,
 	genpictex_text,
 	genpictex_end,
-	EXCLUDE_TEXT
+	EXCLUDE_TEXT,
+	NO_STREAM
 };
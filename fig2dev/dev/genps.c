@@ -61,7 +61,9 @@
 #include "creationdate.h"
 #include "encode.h"
 #include "messages.h"
+#include "outbuf.h"
 #include "pi.h"
+#include "piccache.h"
 #include "psfonts.h"
 #include "readpics.h"
 #include "textconvert.h"
@@ -169,10 +171,33 @@ static int	lpntx2, lpnty2;	/* second-to-last point of object */
 static int	fig_number = 0;
 static int	last_depth = MAXDEPTH + 4;
 
+/*
+ * Images placed more than once are written once into the prolog, as a
+ * reusable stream xfig_img<id>, and each placement reads from that stream.
+ */
+struct ps_image {
+	struct ps_image	*next;
+	char		*file;		/* the picture file, as in the fig file */
+	int		uses;		/* the number of placements */
+	int		id;		/* > 0, if defined in the prolog */
+	int		llx, lly;
+	F_pic		pic;		/* the decoded image, without the bitmap */
+};
+static struct ps_image	*ps_images = NULL;
+
+/* the image types, indexed by pic->subtype */
+static const char	*pic_types[] = {
+	"EPS", "X11 Bitmap", "XPM", "GIF", "JPEG", "PCX", "PPM", "TIFF", "PNG"
+};
+
 /* local procedures */
 static int	append(const char *restrict infilename, FILE *restrict outfile);
 static void	appendhex(char *infilename,FILE *outfile,int width,int height);
 static bool	approx_spline_exist(F_compound *ob);
+static void	reset_state(void);
+static void	define_images(F_compound *objects);
+static struct ps_image	*find_image(const char *file);
+static int	open_picture(F_pic *pic, struct xfig_stream *pic_stream);
 static void	do_split(int actual_depth);/* split different depths' objects */
 					   /* but only as comment */
 static void	clip_arrows(F_line *obj, int objtype);
@@ -264,27 +289,28 @@ static	 struct hdr {
 	    char	*bytes;
 	    int		(*readfunc)(READ_SIGNATURE);
 	    bool	pipeok;
+	    bool	reuse;	/* may be defined once, see define_images() */
 	    /* buf[12] below must be large enough for the file signature */
-	} headers[] = {	{"GIF", "GIF",			read_gif,	false},
+	} headers[] = {	{"GIF", "GIF",		read_gif,	false,	true},
 #ifdef V4_0
-			{"FIG", "#FIG",			read_figure,	true},
+			{"FIG", "#FIG",		read_figure,	true,	false},
 #endif /* V4_0 */
-			{"PCX", "\012\005\001",		read_pcx,	true},
-			{"EPS", "%!",			read_eps,	true},
-			{"EPSI", "\xc5\xd0\xd3\xc6",	read_eps,	true},
-			{"PDF", "%PDF",			read_pdf,	true},
-			{"PPM", "P3",			read_ppm,	true},
-			{"PPM", "P6",			read_ppm,	true},
-			{"TIFF", "II*\000",		read_tif,	false},
-			{"TIFF", "MM\000*",		read_tif,	false},
-			{"XBM", "#define",		read_xbm,	true},
+			{"PCX", "\012\005\001",	read_pcx,	true,	true},
+			{"EPS", "%!",		read_eps,	true,	false},
+			{"EPSI", "\xc5\xd0\xd3\xc6", read_eps,	true,	false},
+			{"PDF", "%PDF",		read_pdf,	true,	false},
+			{"PPM", "P3",		read_ppm,	true,	true},
+			{"PPM", "P6",		read_ppm,	true,	true},
+			{"TIFF", "II*\000",	read_tif,	false,	true},
+			{"TIFF", "MM\000*",	read_tif,	false,	true},
+			{"XBM", "#define",	read_xbm,	true,	false},
 #ifdef HAVE_PNG_H
 			{"PNG", "\211\120\116\107\015\012\032\012",
-							read_png,	true},
+						read_png,	true,	true},
 #endif
-			{"JPEG", "\377\330\377\340",	read_jpg,	true},
-			{"JPEG", "\377\330\377\341",	read_jpg,	true},
-			{"XPM", "/* XPM */",		read_xpm,	false},
+			{"JPEG", "\377\330\377\340", read_jpg,	true,	false},
+			{"JPEG", "\377\330\377\341", read_jpg,	true,	false},
+			{"XPM", "/* XPM */",	read_xpm,	false,	true},
 };
 
 #define NUMHEADERS	(sizeof(headers)/sizeof(headers[0]))
@@ -312,6 +338,24 @@ write_data(FILE *out, char *name, unsigned char *in, size_t len)
 	fputs("~>\n", out);
 }
 
+/* write the coordinates "x y" */
+static void
+put_xy(struct outbuf *b, int x, int y)
+{
+	outbuf_int(b, x);
+	outbuf_char(b, ' ');
+	outbuf_int(b, y);
+}
+
+/* write "x y" with one decimal */
+static void
+put_xy1(struct outbuf *b, double x, double y)
+{
+	outbuf_fixed(b, x, 1);
+	outbuf_char(b, ' ');
+	outbuf_fixed(b, y, 1);
+}
+
 /*
  * the image dictionary string is needed twice,
  * here and in indexed_image() below
@@ -322,11 +366,24 @@ write_data(FILE *out, char *name, unsigned char *in, size_t len)
 #define DATASOURCE	"    /DataSource Data\n"
 #endif
 
+/*
+ * Let Data read the image data following in the file, or, if id > 0, the
+ * data of the image xfig_img<id> defined in the prolog.
+ */
+static void
+data_source(FILE *out, int id)
+{
+	if (id > 0)
+		fprintf(out, "/Data xfig_img%d dup 0 setfileposition def\n", id);
+	else
+		fputs("/Data currentfile /ASCII85Decode filter def\n", out);
+}
+
 static void
-write_rgbimage(FILE *out, F_pic *pic)
+write_rgbimage(FILE *out, F_pic *pic, int id)
 {
-	fputs(		"/Data currentfile /ASCII85Decode filter def\n"
-			"/DeviceRGB setcolorspace\n", out);
+	data_source(out, id);
+	fputs(		"/DeviceRGB setcolorspace\n", out);
 
 	if (pic->num_transp == NO_TRANSPARENCY ||
 			/* != TRANSP_COLOR should not happen */
@@ -347,18 +404,18 @@ write_rgbimage(FILE *out, F_pic *pic)
 			"    /BitsPerComponent 8 /Decode [0 1 0 1 0 1]\n"
 			" >> xfig_image\n", out);
 
-	write_data(out, pic->file, pic->bitmap,
-			(size_t)pic->bit_size.x * pic->bit_size.y * 3);
+	if (id == 0)
+		write_data(out, pic->file, pic->bitmap,
+				(size_t)pic->bit_size.x * pic->bit_size.y * 3);
 }
 
 static void
-indexed_image(FILE *out, F_pic *pic)
+indexed_image(FILE *out, F_pic *pic, int id)
 {
 	int	i = 0;
 
-	fprintf(out,
-			"/Data currentfile /ASCII85Decode filter def\n"
-			"[ /Indexed /DeviceRGB %d\n <", pic->numcols - 1);
+	data_source(out, id);
+	fprintf(out,	"[ /Indexed /DeviceRGB %d\n <", pic->numcols - 1);
 	/* write the hex-encoded colormap */
 	fprintf(out, "%.2hhx%.2hhx%.2hhx", pic->cmap[RED][i],
 			pic->cmap[GREEN][i], pic->cmap[BLUE][i]);
@@ -387,8 +444,158 @@ indexed_image(FILE *out, F_pic *pic)
 			"    /BitsPerComponent 8 /Decode [0 255]\n"
 			" >> xfig_image\n", out);
 
-	write_data(out, pic->file, pic->bitmap,
-			(size_t)pic->bit_size.x * pic->bit_size.y);
+	if (id == 0)
+		write_data(out, pic->file, pic->bitmap,
+				(size_t)pic->bit_size.x * pic->bit_size.y);
+}
+
+/*
+ * Open the picture file of pic, located by find_stream(), and return the
+ * index of its type in headers[]. On failure, return -1.
+ */
+static int
+open_picture(F_pic *pic, struct xfig_stream *pic_stream)
+{
+	int	i;
+	char	buf[12];
+	FILE	*picf;
+
+	/* open the file and read a few bytes of the header
+	   to see what it is */
+	if ((picf = open_stream(pic->file, pic_stream)) == NULL) {
+		put_msg("No such picture file: %s", pic->file);
+		return -1;
+	}
+
+	for (i = 0; i < (int)(sizeof buf); ++i) {
+		int	c;
+		if ((c = getc(picf)) == EOF)
+			break;
+		buf[i] = (char)c;
+	}
+
+	/* now find which header it is */
+	for (i = 0; i < (int)NUMHEADERS; ++i)
+		if (!memcmp(buf, headers[i].bytes, strlen(headers[i].bytes)))
+			return i;
+
+	put_msg("%s: Unknown image format", pic->file);
+	close_stream(pic_stream);
+	return -1;
+}
+
+static struct ps_image *
+find_image(const char *file)
+{
+	struct ps_image	*img;
+
+	for (img = ps_images; img != NULL; img = img->next)
+		if (!strcmp(img->file, file))
+			return img;
+	return NULL;
+}
+
+/* count the placements of each picture file */
+static void
+count_images(F_compound *ob)
+{
+	F_line		*l;
+	F_compound	*c;
+	struct ps_image	*img;
+
+	for (l = ob->lines; l != NULL; l = l->next) {
+		if (l->type != T_PIC_BOX || l->pic == NULL ||
+				l->pic->file == NULL || !depth_filter(l->depth))
+			continue;
+		if ((img = find_image(l->pic->file)) == NULL) {
+			if ((img = calloc(1, sizeof(struct ps_image))) == NULL)
+				return;
+			img->file = l->pic->file;
+			img->next = ps_images;
+			ps_images = img;
+		}
+		++img->uses;
+	}
+
+	for (c = ob->compounds; c != NULL; c = c->next)
+		count_images(c);
+}
+
+/*
+ * Write the raster images placed more than once into the prolog. Each image
+ * is read into a reusable stream, xfig_img1, xfig_img2,..., holding the data
+ * as it would otherwise follow the image operator.
+ */
+static void
+define_images(F_compound *objects)
+{
+	int			i;
+	int			id = 0;
+	bool			decoded;
+	size_t			len;
+	struct ps_image		*img;
+	struct xfig_stream	pic_stream;
+
+	count_images(objects);
+
+	for (img = ps_images; img != NULL; img = img->next) {
+		F_pic	*pic = &img->pic;
+
+		if (img->uses < 2)
+			continue;
+
+		pic->file = img->file;
+		pic->num_transp = NO_TRANSPARENCY;
+		init_stream(&pic_stream);
+		if (find_stream(pic->file, &pic_stream)) {
+			free_stream(&pic_stream);
+			continue;
+		}
+		decoded = piccache_get(pic, pic_stream.name_on_disk,
+							&img->llx, &img->lly);
+		if (!decoded && (i = open_picture(pic, &pic_stream)) >= 0) {
+			/* eps, pdf, jpeg and xbm images are not reused */
+			if (headers[i].reuse && headers[i].readfunc(pic,
+					&pic_stream, &img->llx, &img->lly)) {
+				decoded = true;
+				piccache_put(pic, pic_stream.name_on_disk,
+							img->llx, img->lly);
+			}
+			close_stream(&pic_stream);
+		}
+		free_stream(&pic_stream);
+
+		if (decoded && pic->subtype != P_EPS &&
+				pic->subtype != P_JPEG &&
+				pic->subtype != P_XBM) {
+			len = (size_t)pic->bit_size.x * pic->bit_size.y;
+			if (pic->numcols > 256)
+				len *= 3;
+			img->id = ++id;
+			fprintf(tfp, "%% %s, placed %d times\n", pic->file,
+					img->uses);
+			fprintf(tfp, "/xfig_img%d currentfile /ASCII85Decode "
+					"filter\n /ReusableStreamDecode filter "
+					"def\n", id);
+			write_data(tfp, pic->file, pic->bitmap, len);
+		}
+		free(pic->bitmap);
+		pic->bitmap = NULL;
+	}
+}
+
+/* fill in pic from the image img defined in the prolog */
+static void
+use_image(F_pic *pic, const struct ps_image *img)
+{
+	char	*file = pic->file;
+	int	flipped = pic->flipped;
+
+	*pic = img->pic;
+	pic->file = file;
+	pic->flipped = flipped;
+	if (img->pic.transp_cols == img->pic.transp_col)
+		pic->transp_cols = pic->transp_col;
 }
 
 
@@ -407,6 +614,49 @@ geneps_option(char opt, char *optarg)
 	gen_ps_eps_option(opt, optarg);
 }
 
+/*
+ * Reset the state changed during a conversion, in case more than one file
+ * is converted (batch mode, option -I).
+ */
+static void
+reset_state(void)
+{
+	static bool	saved = false;
+	static bool	ascii, tiff, composite;
+	int		i;
+	struct ps_image	*img;
+
+	/* the first call comes after all options were parsed */
+	if (!saved) {
+		ascii = asciipreview;
+		tiff = tiffpreview;
+		composite = enable_composite_font;
+		saved = true;
+	} else {
+		asciipreview = ascii;
+		tiffpreview = tiff;
+		enable_composite_font = composite;
+	}
+
+	strcpy(tmpeps_buf, "f2depsXXXXXX");
+	strcpy(tmpprev_buf, "f2dprevXXXXXX");
+	tmpeps = tmpeps_buf;
+	tmpprev = tmpprev_buf;
+	pagewidth = pageheight = -1;
+	cur_thickness = 0.0;
+	cur_joinstyle = cur_capstyle = 0;
+	no_obj = 0;
+	fig_number = 0;
+	last_depth = MAXDEPTH + 4;
+	for (i = 0; i < MAX_PSFONT + 2; ++i)
+		if (PSneedsutf8[i] == 1)
+			PSneedsutf8[i] = 0;
+	while ((img = ps_images) != NULL) {
+		ps_images = img->next;
+		free(img);
+	}
+}
+
 void
 genps_option(char opt, char *optarg)
 {
@@ -533,6 +783,17 @@ gen_ps_eps_option(char opt, char *optarg)
 		}
 		break;
 
+	case 'q':			/* compression level of images */
+#ifdef HAVE_ZLIB_H
+		deflate_level = atoi(optarg);
+		if (deflate_level < 0 || deflate_level > 9) {
+			fprintf(stderr, "fig2dev: bad value for -q option: %s, "
+					"should be between 0 and 9\n", optarg);
+			exit(EXIT_FAILURE);
+		}
+#endif
+		break;
+
 	case 'R':		       /* boundingbox in relative coordinates */
 		if (epsflag) {
 		    (void) strcpy (boundingbox, optarg);
@@ -585,6 +846,8 @@ genps_start(F_compound *objects)
 	const struct paperdef	*pd;
 	char		 psize[20];
 
+	reset_state();
+
 	/* make sure user isn't asking for both TIFF and ASCII preview */
 	if (tiffpreview && asciipreview) {
 		put_msg("Only one type of preview allowed: -A or -T/-C");
@@ -942,6 +1205,8 @@ genps_start(F_compound *objects)
 
 	fprintf(tfp, "%s\n", END_PROLOG);
 
+	define_images(objects);
+
 	fputs("/pageheader {\n", tfp);
 
 	/* must specify translation/rotation
@@ -1548,7 +1813,9 @@ set_linewidth(double w)
 void
 genps_line(F_line *l)
 {
-	F_point		*p, *q;
+	F_pos		*pts;
+	struct outbuf	 ob;
+	int		 n;
 	int		 radius;
 	int		 i;
 	int		 xmin,xmax,ymin,ymax;
@@ -1569,9 +1836,8 @@ genps_line(F_line *l)
 		set_linecap(l->cap_style);
 		set_linewidth((double)l->thickness);
 	}
-	p = l->points;
-	q = p->next;
-	if (q == NULL) { /* A single point line */
+	pts = line_points(l, &n);
+	if (n == 1) { /* A single point line */
 		if (l->cap_style > 0)
 			hf_wid = 1.0;
 		else if (l->thickness <= THICK_SCALE)
@@ -1579,8 +1845,8 @@ genps_line(F_line *l)
 		else
 			hf_wid = (l->thickness-THICK_SCALE)/2.0;
 		fprintf(tfp, "n %d %d m %d %d l gs col%d s gr\n",
-				round(p->x-hf_wid), p->y, round(p->x+hf_wid),
-				p->y, l->pen_color);
+				round(pts[0].x-hf_wid), pts[0].y,
+				round(pts[0].x+hf_wid), pts[0].y, l->pen_color);
 		if (multi_page)
 			fputs("} bind def\n", tfp);
 		return;
@@ -1589,18 +1855,17 @@ genps_line(F_line *l)
 		set_style(l->style, l->style_val);
 	}
 
-	xmin = xmax = p->x;
-	ymin = ymax = p->y;
-	while (p->next != NULL) { /* find lower left and upper right corners */
-		p=p->next;
-		if (xmin > p->x)
-			xmin = p->x;
-		else if (xmax < p->x)
-			xmax = p->x;
-		if (ymin > p->y)
-			ymin = p->y;
-		else if (ymax < p->y)
-			ymax = p->y;
+	xmin = xmax = pts[0].x;
+	ymin = ymax = pts[0].y;
+	for (i = 1; i < n; ++i) { /* find lower left and upper right corners */
+		if (xmin > pts[i].x)
+			xmin = pts[i].x;
+		else if (xmax < pts[i].x)
+			xmax = pts[i].x;
+		if (ymin > pts[i].y)
+			ymin = pts[i].y;
+		else if (ymax < pts[i].y)
+			ymax = pts[i].y;
 	}
 
 	if (l->type == T_ARC_BOX) {
@@ -1629,12 +1894,13 @@ genps_line(F_line *l)
 		int		dx, dy, rotation;
 		int		pllx, plly, purx, pury;
 		int		i, j;
-		char		buf[12];
-		FILE		*picf;
+		int		id = 0;
+		char		*pictype = "";
+		struct ps_image	*img;
 		struct xfig_stream	pic_stream;
 
-		dx = l->points->next->next->x - l->points->x;
-		dy = l->points->next->next->y - l->points->y;
+		dx = pts[2].x - pts[0].x;
+		dy = pts[2].y - pts[0].y;
 		rotation = 0;
 		if (dx < 0 && dy < 0)
 			   rotation = 180;
@@ -1654,31 +1920,27 @@ genps_line(F_line *l)
 
 		init_stream(&pic_stream);
 
-		/* open the file and read a few bytes of the header
-		   to see what it is */
-		if ((picf = open_stream(l->pic->file, &pic_stream)) == NULL) {
+		/* the image may be defined in the prolog */
+		if ((img = find_image(l->pic->file)) != NULL && img->id > 0) {
+			use_image(l->pic, img);
+			id = img->id;
+			pllx = img->llx;
+			plly = img->lly;
+			goto decoded;
+		}
+
+		if (find_stream(l->pic->file, &pic_stream)) {
 			put_msg("No such picture file: %s", l->pic->file);
 			free_stream(&pic_stream);
 			return;
 		}
 
-		for (i = 0; i < (int)(sizeof buf); ++i) {
-			int	c;
-			if ((c = getc(picf)) == EOF)
-				break;
-			buf[i] = (char)c;
-		}
-
-		/* now find which header it is */
-		for (i = 0; i < (int)(sizeof(headers)/sizeof(headers[0])); ++i)
-			if (!memcmp(buf, headers[i].bytes,
-						strlen(headers[i].bytes)))
-				break;
+		/* re-use the image, if it was decoded before */
+		if (piccache_get(l->pic, pic_stream.name_on_disk,
+							&pllx, &plly))
+			goto decoded;
 
-		if (i == sizeof(headers) / sizeof(headers[0])) {
-			/* not found */
-			put_msg("%s: Unknown image format", l->pic->file);
-			close_stream(&pic_stream);
+		if ((i = open_picture(l->pic, &pic_stream)) < 0) {
 			free_stream(&pic_stream);
 			return;
 		}
@@ -1694,6 +1956,15 @@ genps_line(F_line *l)
 			free_stream(&pic_stream);
 			return;
 		}
+		pictype = headers[i].type;
+		piccache_put(l->pic, pic_stream.name_on_disk, pllx, plly);
+
+decoded:
+		/* the eps reader writes its own comment */
+		if (l->pic->subtype != P_EPS)
+			fprintf(tfp, "%% Begin Imported %s File: %s\n\n",
+					pic_types[l->pic->subtype],
+					l->pic->file);
 
 		/* width, height of image bits (unrotated) */
 		img_w = l->pic->bit_size.x;
@@ -1841,6 +2112,7 @@ genps_line(F_line *l)
 				|| l->pic->subtype == P_JPEG
 				|| l->pic->subtype == P_PCX
 				|| l->pic->subtype == P_PPM
+				|| l->pic->subtype == P_TIF
 				|| l->pic->subtype == P_XPM) {
 			if (l->pic->subtype == P_GIF)
 				fputs("% GIF", tfp);
@@ -1850,6 +2122,8 @@ genps_line(F_line *l)
 				fputs("% JPEG", tfp);
 			else if (l->pic->subtype == P_PCX)
 				fputs("% PCX", tfp);
+			else if (l->pic->subtype == P_TIF)
+				fputs("% TIFF", tfp);
 			else if (l->pic->subtype == P_XPM)
 				fputs("% XPM", tfp);
 			else
@@ -1864,14 +2138,14 @@ genps_line(F_line *l)
 				JPEGtoPS(pic_stream.fp, tfp);
 			} else {
 				if (l->pic->numcols > 256)
-					write_rgbimage(tfp, l->pic);
+					write_rgbimage(tfp, l->pic, id);
 				else
-					indexed_image(tfp, l->pic);
+					indexed_image(tfp, l->pic, id);
 			}
 
 		/* EPS file */
 		} else if (l->pic->subtype == P_EPS &&
-				strcmp(headers[i].type, "PDF")) {
+				strcmp(pictype, "PDF")) {
 		    fputs("% EPS file follows:\n", tfp);
 		    if (!rewind_stream(&pic_stream)) {
 			    err_msg("Unable to open EPS file '%s'");
@@ -1881,7 +2155,7 @@ genps_line(F_line *l)
 
 		    /* flush buffer first */
 		    fflush(tfp);
-		    if (strcmp(headers[i].type, "EPSI") == 0) {
+		    if (strcmp(pictype, "EPSI") == 0) {
 			    /* currently, if append_epsi() returns with
 			       an error, it did not write anything */
 			    if (append_epsi(pic_stream.fp, l->pic->file, tfp))
@@ -1895,7 +2169,7 @@ genps_line(F_line *l)
 							    pic_stream.fp)))
 				    fwrite(buffer, 1, len, tfp);
 		    }
-		} else if (!strcmp(headers[i].type, "PDF")) {
+		} else if (!strcmp(pictype, "PDF")) {
 			fputs("% PDF file converted to EPS follows:\n", tfp);
 			fflush(tfp);
 			pdftops(&pic_stream, tfp);
@@ -1921,14 +2195,12 @@ genps_line(F_line *l)
 		fputs("%\n", tfp);
 	} else {
 		/* POLYLINE */
-		p = l->points;
-		q = p->next;
 		/* first point */
-		fpntx1 = p->x;
-		fpnty1 = p->y;
+		fpntx1 = pts[0].x;
+		fpnty1 = pts[0].y;
 		/* second point */
-		fpntx2 = q->x;
-		fpnty2 = q->y;
+		fpntx2 = pts[1].x;
+		fpnty2 = pts[1].y;
 		/* next to last point */
 		lpntx2 = l->last[1].x;
 		lpnty2 = l->last[1].y;
@@ -1942,23 +2214,25 @@ genps_line(F_line *l)
 		}
 
 		/* now output the points */
-		fprintf(tfp, "n %d %d m", p->x, p->y);
-		i=1;
-		while (q->next != NULL) {
-			p = q;
-			q = q->next;
-			fprintf(tfp, " %d %d l", p->x, p->y);
+		outbuf_init(&ob, tfp);
+		outbuf_str(&ob, "n ");
+		put_xy(&ob, pts[0].x, pts[0].y);
+		outbuf_str(&ob, " m");
+		for (i = 1; i < n - 1; ++i) {
+			outbuf_char(&ob, ' ');
+			put_xy(&ob, pts[i].x, pts[i].y);
+			outbuf_str(&ob, " l");
 			if (i%5 == 0)
-				fputs("\n", tfp);
-			++i;
+				outbuf_char(&ob, '\n');
 		}
-		fputs("\n", tfp);
+		outbuf_char(&ob, '\n');
+		outbuf_flush(&ob);
 	}
 
 	/* now fill it, draw the line and/or draw arrow heads */
 	if (l->type != T_PIC_BOX) {  /* make sure it isn't a picture object */
 		if (l->type == T_POLYLINE) {
-			fprintf(tfp, " %d %d l ", q->x, q->y);
+			fprintf(tfp, " %d %d l ", pts[n-1].x, pts[n-1].y);
 			if (fpntx1==lpntx1 && fpnty1==lpnty1)
 				fputs(" cp ", tfp);
 			/* endpoints are coincident, close path
@@ -2021,6 +2295,7 @@ genps_itp_spline(F_spline *s)
 {
 	F_point		*p, *q;
 	F_control	*a, *b;
+	struct outbuf	 ob;
 	int		 xmin, ymin;
 
 	fprintf(tfp, "%% Interp Spline\n");
@@ -2056,14 +2331,21 @@ genps_itp_spline(F_spline *s)
 	fprintf(tfp, "n %d %d m\n", p->x, p->y);
 	xmin = 999999;
 	ymin = 999999;
+	outbuf_init(&ob, tfp);
 	for (q = p->next; q != NULL; p = q, q = q->next) {
 		xmin = min(xmin, p->x);
 		ymin = min(ymin, p->y);
 		b = a->next;
-		fprintf(tfp, "\t%.1f %.1f %.1f %.1f %d %d curveto\n",
-				a->rx, a->ry, b->lx, b->ly, q->x, q->y);
+		outbuf_char(&ob, '\t');
+		put_xy1(&ob, a->rx, a->ry);
+		outbuf_char(&ob, ' ');
+		put_xy1(&ob, b->lx, b->ly);
+		outbuf_char(&ob, ' ');
+		put_xy(&ob, q->x, q->y);
+		outbuf_str(&ob, " curveto\n");
 		a = b;
 	}
+	outbuf_flush(&ob);
 	if (closed_spline(s)) fprintf(tfp, " cp ");
 	if (s->fill_style != UNFILLED)
 		fill_area(s->fill_style, s->pen_color, s->fill_color);
@@ -2090,6 +2372,7 @@ genps_ctl_spline(F_spline *s)
 {
 	double		a, b, c, d, x1, y1, x2, y2, x3, y3;
 	F_point		*p, *q;
+	struct outbuf	ob;
 	int		xmin, ymin;
 
 	if (closed_spline(s))
@@ -2158,6 +2441,7 @@ genps_ctl_spline(F_spline *s)
 	else
 		fprintf(tfp, "n %.1f %.1f m %.1f %.1f l\n", x1, y1, x3, y3);
 
+	outbuf_init(&ob, tfp);
 	for (q = p->next; q != NULL; p = q, q = q->next) {
 		xmin = min(xmin, p->x);
 		ymin = min(ymin, p->y);
@@ -2169,10 +2453,15 @@ genps_ctl_spline(F_spline *s)
 		d = q->y;
 		x3 = (x2 + c) / 2;
 		y3 = (y2 + d) / 2;
-		fprintf(tfp,
-			  "\t%.1f %.1f %.1f %.1f %.1f %.1f DrawSplineSection\n",
-				x1, y1, x2, y2, x3, y3);
-	}
+		outbuf_char(&ob, '\t');
+		put_xy1(&ob, x1, y1);
+		outbuf_char(&ob, ' ');
+		put_xy1(&ob, x2, y2);
+		outbuf_char(&ob, ' ');
+		put_xy1(&ob, x3, y3);
+		outbuf_str(&ob, " DrawSplineSection\n");
+	}
+	outbuf_flush(&ob);
 	/*
 	 * At this point, (x2,y2) and (c,d) are the position of the
 	 * next-to-last and last point respectively, in the point list
@@ -2837,7 +3126,8 @@ driver dev_ps = {
 	genps_spline,
 	genps_text,
 	genps_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	NO_STREAM
 };
 
 /* eps is just like ps except with no: pages, pagesize, orientation, offset */
@@ -2853,5 +3143,6 @@ driver dev_eps = {
 	genps_spline,
 	genps_text,
 	genps_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	NO_STREAM
 };
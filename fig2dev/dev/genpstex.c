@@ -70,6 +70,12 @@ extern int
 extern void	genpdf_option(char opt, char *optarg);	/* genpdf.c */
 extern void	genpdf_start(F_compound *objects);	/* genpdf.c */
 extern int	genpdf_end(void);			/* genpdf.c */
+extern void	genpdf_grid(float major, float minor);	/* genpdf.c */
+extern void	genpdf_arc(F_arc *a);			/* genpdf.c */
+extern void	genpdf_ellipse(F_ellipse *e);		/* genpdf.c */
+extern void	genpdf_line(F_line *l);			/* genpdf.c */
+extern void	genpdf_spline(F_spline *s);		/* genpdf.c */
+extern void	genpdf_text(F_text *t);			/* genpdf.c */
 extern void	genps_grid(float major, float minor);
 
 static char pstex_file[1000] = "";
@@ -116,6 +122,13 @@ genpstex_text(F_text *t)
 		genps_text(t);
 }
 
+void
+genpdftex_text(F_text *t)
+{
+	if (!special_text(t))
+		genpdf_text(t);
+}
+
 void
 genpstex_option(char opt, char *optarg)
 {
@@ -133,7 +146,8 @@ struct driver dev_pstex_t = {
 	(void (*)(F_spline *))gendev_null,
 	genpstex_t_text,
 	genlatex_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	NO_STREAM
 };
 
 struct driver dev_pdftex_t = {
@@ -146,7 +160,8 @@ struct driver dev_pdftex_t = {
 	(void (*)(F_spline *))gendev_null,
 	genpstex_t_text,
 	genlatex_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	NO_STREAM
 };
 
 struct driver dev_pstex = {
@@ -159,18 +174,20 @@ struct driver dev_pstex = {
 	genps_spline,
 	genpstex_text,
 	genps_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	NO_STREAM
 };
 
 struct driver dev_pdftex = {
 	genpdf_option,
 	genpdf_start,
-	genps_grid,
-	genps_arc,
-	genps_ellipse,
-	genps_line,
-	genps_spline,
-	genpstex_text,
+	genpdf_grid,
+	genpdf_arc,
+	genpdf_ellipse,
+	genpdf_line,
+	genpdf_spline,
+	genpdftex_text,
 	genpdf_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	NO_STREAM
 };
@@ -808,6 +808,8 @@ pp_find_text(F_compound *objects)
 static void
 preprocess(F_compound *objects)
 {
+  Preprocessed_data->extra_package_mask = 0;
+  Preprocessed_data->has_text_p = 0;
   pp_find_pstricks_extras(objects);
   pp_find_text(objects);
 }
@@ -869,6 +871,8 @@ define_setfont(FILE *tfp)
 #endif
 }
 
+static void reset_color_table(void);
+
 void
 genpstrx_start(F_compound *objects)
 {
@@ -877,6 +881,7 @@ genpstrx_start(F_compound *objects)
 
   /* Run the preprocessor. */
   preprocess(objects);
+  reset_color_table();
 
   /* If user gave font size, set up tables */
   texfontsizes[0] = texfontsizes[1] =
@@ -965,6 +970,8 @@ genpstrx_start(F_compound *objects)
 int
 genpstrx_end(void)
 {
+  int status;
+
   if (Page_mode != PM_BARE)
     fprintf(tfp, "\\end{pspicture}\n");
 
@@ -976,7 +983,11 @@ genpstrx_end(void)
   issue_warnings(stderr);
 
   /* return is determined by warning mechanism above */
-  return rtn_val;
+  status = rtn_val;
+  /* start afresh, in case another file is converted */
+  warn_flags = 0;
+  rtn_val = 0;
+  return status;
 }
 
 /**********************************************************************/
@@ -1033,14 +1044,34 @@ struct color_table_entry_t {
 #define CT_BLACK  0
 #define CT_WHITE  7
 
+/* the user colors are set up, see setup_color_table() */
+static int color_table_done_p = 0;
+
+/* names of the declared grays, see gray_name_after_declare_gray() */
+static char gray_names[20][16]; /* grayxviii */
+
+/* forget the colors declared in a previous output file */
+static void
+reset_color_table(void)
+{
+  int i;
+
+  for (i = 0; i < ARRAY_SIZE(color_table); i++) {
+    if (i > CT_WHITE)
+      color_table[i].defined_p = 0;
+    color_table[i].shades = color_table[i].tints = 0u;
+  }
+  color_table_done_p = 0;
+  memset(gray_names, 0, sizeof gray_names);
+}
+
 static void
 setup_color_table(void)
 {
   int i;
   char rn[100];
-  static int done_p = 0;
 
-  if (done_p) return;
+  if (color_table_done_p) return;
 
   for (i = 0; i < num_usr_cols; i++) {
     int iuc = i + NUM_STD_COLS;
@@ -1049,7 +1080,7 @@ setup_color_table(void)
     color_table[iuc].g = user_colors[i].g / 256.0;
     color_table[iuc].b = user_colors[i].b / 256.0;
   }
-  done_p = 1;
+  color_table_done_p = 1;
 }
 
 /* die if a bad color index is seen */
@@ -1160,7 +1191,6 @@ shade_or_tint_name_after_declare_color(char *name, int ist, int ic)
 static char *
 gray_name_after_declare_gray(int ig)
 {
-  static char names[20][16]; /* grayxviii */
   char rn[100];
 
   if (ig < 0 || ig > 20) {
@@ -1174,13 +1204,13 @@ gray_name_after_declare_gray(int ig)
     return color_name_after_declare_color(CT_WHITE);
 
   /* check if gray level declaration is needed */
-  if (names[ig][0] == '\0') {
+  if (gray_names[ig][0] == '\0') {
     if (Verbose)
       fprintf(tfp, "%% declare gray %d\n", ig);
-    sprintf(names[ig], "gray%s", roman_numeral_from_int(rn, ig));
-    fprintf(tfp, "\\newgray{%s}{"DBL"}%%\n", names[ig], (double)ig/20.0);
+    sprintf(gray_names[ig], "gray%s", roman_numeral_from_int(rn, ig));
+    fprintf(tfp, "\\newgray{%s}{"DBL"}%%\n", gray_names[ig], (double)ig/20.0);
   }
-  return names[ig];
+  return gray_names[ig];
 }
 
 /* print points, 4 per line */
@@ -2876,5 +2906,6 @@ struct driver dev_pstricks = {
   genpstrx_spline,
   genpstrx_text,
   genpstrx_end,
-  INCLUDE_TEXT
+  INCLUDE_TEXT,
+  NO_STREAM
 };
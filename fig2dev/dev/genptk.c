@@ -76,6 +76,8 @@ static char tiffRequired = 0;
 
 #define		TOP	8.5 /* inches */
 static int	full_page = false;
+static int	inQuote = 0;	/* state of niceLine() */
+static int	pos = 0;
 static bool	wrap = false;
 
 /*
@@ -166,6 +168,8 @@ genptk_start(F_compound *objects)
 	const struct paperdef	*pd;
 
 	ppi = ppi / mag;
+	pngRequired = jpegRequired = tiffRequired = 0;
+	inQuote = pos = 0;
 
 	/* print any whole-figure comments prefixed with "#" */
 	if (objects->comments) {
@@ -1429,8 +1433,6 @@ niceLine(char *s)
 {
 	extern FILE	*tfp;	/* File descriptor of Tk file. */
 	size_t		i, len;
-	static int	inQuote = 0;
-	static int	pos = 0;
 
 	len = strlen(s);
 	for (i = 0; i < len; ++i) {
@@ -1468,5 +1470,6 @@ struct driver   dev_ptk = {
 	genptk_spline,
 	genptk_text,
 	genptk_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	NO_STREAM
 };
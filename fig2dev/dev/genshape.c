@@ -58,6 +58,7 @@
 #define	SHAPE_LEN	16	/* length of the text buffer */
 
 static char	*macroname = NULL;
+static char	*macroname_opt = NULL;	/* given by option -n */
 static bool	scaleset = false;
 static bool	centerset = false;
 static bool	was_horizontal = false;
@@ -124,6 +125,9 @@ die(const char *msg) {
 static void
 alloc_arrays(void) {
  /* reserve initial space for data structures */
+ num_points = num_shapes = num_shapegroups = 0;
+ line_start = true;
+ was_horizontal = false;
  points=malloc(sizeof(points[0])*MAX_POINTS);
  shapes=malloc(sizeof(shapes[0])*MAX_SHAPES);
  shapegroups=malloc(sizeof(shapegroups[0])*MAX_SHAPEGROUPS);
@@ -221,7 +225,7 @@ genshape_option(char opt, char *optarg)
 {
   switch (opt) {
   case 'n': /* macro name */
-    macroname = strdup(optarg);
+    macroname_opt = strdup(optarg);
     break;
   case 'G': /* ignore language and grid */
   case 'L':
@@ -374,6 +378,7 @@ void
 genshape_start(F_compound *objects)
 
 {  F_comment* comment=objects->comments;
+  macroname = macroname_opt;
   alloc_arrays();
   /* Arrays for holding lines, shapes and groups */
   if (comment==NULL) return;
@@ -1458,5 +1463,6 @@ struct driver dev_shape = {
 	(void (*)(F_spline *))gendev_null,
 	genshape_text,
 	genshape_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	NO_STREAM
 };
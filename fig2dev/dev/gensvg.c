@@ -248,21 +248,86 @@
 #endif
 #include <math.h>
 
+#ifdef HAVE_PNG_H
+#include <png.h>
+#endif
+
 #include "fig2dev.h"	/* includes bool.h and object.h */
 //#include "object.h"
 #include "bound.h"
 #include "creationdate.h"
+#include "encode.h"
 #include "messages.h"
+#include "outbuf.h"
 #include "pi.h"
+#include "piccache.h"
+#include "readpics.h"
 
 static bool svg_arrows(int line_thickness, F_arrow *for_arrow, F_arrow *back_arrow,
 	F_pos *forw1, F_pos *forw2, F_pos *back1, F_pos *back2, int pen_color);
 static void generate_tile(int number, int colorIndex);
 static void svg_dash(int, double);
+static void put_points(F_pos *pts, int n, int chars);
+static void end_joined(void);
 
 #define PREAMBLE "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>"
 #define	SVG_LINEWIDTH	76
 
+/*
+ * With -e, pictures are embedded as data uris. Each picture is written once,
+ * as <image id="img%d"> in <defs>, and placed with <use>.
+ */
+static bool	embed_images = false;
+
+struct svg_image {
+    struct svg_image	*next;
+    char		*file;
+    int			pen_color;	/* xbm bitmaps are drawn with the pen
+					   color, -1 for other pictures */
+    int			id;		/* -1, if it cannot be embedded */
+};
+static struct svg_image	*svg_images = NULL;
+static int		imgno;
+
+/*
+ * The picture readers, see genps.c.
+ */
+#define READ_SIGNATURE \
+	F_pic *pic, struct xfig_stream *restrict pic_stream, int *llx, int *lly
+extern int  read_gif(READ_SIGNATURE);
+extern int  read_pcx(READ_SIGNATURE);
+#ifdef HAVE_PNG_H
+extern int  read_png(READ_SIGNATURE);
+#endif
+extern int  read_ppm(READ_SIGNATURE);
+extern int  read_tif(READ_SIGNATURE);
+extern int  read_xbm(READ_SIGNATURE);
+extern int  read_xpm(READ_SIGNATURE);
+
+/*
+ * Pictures in formats that browsers display are copied into the svg, others
+ * are decoded and converted to png. A NULL readfunc marks the former.
+ */
+static	 struct hdr {
+	    char	*type;
+	    char	*bytes;
+	    char	*mime;
+	    int		(*readfunc)(READ_SIGNATURE);
+	} headers[] = {	{"PNG", "\211\120\116\107\015\012\032\012",
+				"image/png",		NULL},
+			{"JPEG", "\377\330\377",	"image/jpeg",	NULL},
+			{"GIF", "GIF",			"image/gif",	NULL},
+			{"PCX", "\012\005\001",	"image/png",	read_pcx},
+			{"PPM", "P3",			"image/png",	read_ppm},
+			{"PPM", "P6",			"image/png",	read_ppm},
+			{"TIFF", "II*\000",		"image/png",	read_tif},
+			{"TIFF", "MM\000*",		"image/png",	read_tif},
+			{"XBM", "#define",		"image/png",	read_xbm},
+			{"XPM", "/* XPM */",		"image/png",	read_xpm},
+};
+
+#define NUMHEADERS	(sizeof(headers)/sizeof(headers[0]))
+
 static unsigned int symbolchar[256]=
 {0,0,0,0,0,0,0,0,0,0,
 0,0,0,0,0,0,0,0,0,0,
@@ -321,6 +386,25 @@ static int	tileno = -1;	/* number of current tile */
 static int	pathno = -1;	/* number of current path */
 static int	clipno = -1;	/* number of current clip path */
 
+/*
+ * With -c, the output is compact: Comments are omitted, polylines and
+ * polygons are written as paths with relative coordinates, and consecutive
+ * lines and boxes, unfilled and drawn with the same solid stroke, are
+ * joined into one path.
+ */
+static bool		compact = false;
+static const char	*sep = "\n\t";	/* precedes the stroke attributes */
+
+/* the stroke of the joined path, which is not yet ended */
+static struct {
+    bool	open;
+    int		pen_color;
+    int		width;
+    int		join_style;
+    int		cap_style;
+    F_pos	cur;		/* the current point at the end of the path */
+} joined = {false, 0, 0, 0, 0, {0, 0}};
+
 static void
 put_capstyle(int c)
 {
@@ -440,6 +524,9 @@ void
 print_svgcomments(char *s1, F_comment *comments, char *s2)
 {
 	unsigned char	*c;
+
+	if (compact)
+		return;
 	while (comments) {
 		fputs(s1, tfp);
 		for (c = (unsigned char *)comments->comment; *c; ++c)
@@ -456,6 +543,13 @@ gensvg_option(char opt, char *optarg)
 	case 'G':		/* ignore language and grid */
 	case 'L':
 	    break;
+	case 'c':
+	    compact = true;
+	    sep = " ";
+	    break;
+	case 'e':
+	    embed_images = true;
+	    break;
 	case 'z':
 	    (void) strcpy (papersize, optarg);
 	    paperspec = true;
@@ -474,13 +568,19 @@ gensvg_start(F_compound *objects)
     int     vw, vh;
     char    date_buf[CREATION_TIME_LEN];
 
+    tileno = pathno = clipno = -1;
+    imgno = -1;
+    joined.open = false;
+
     fprintf(tfp, "%s\n", PREAMBLE);
-    fprintf(tfp, "<!-- Creator: %s Version %s -->\n",
+    if (!compact) {
+	fprintf(tfp, "<!-- Creator: %s Version %s -->\n",
 		  prog, PACKAGE_VERSION);
 
-    if (creation_date(date_buf))
-	fprintf(tfp, "<!-- CreationDate: %s -->\n", date_buf);
-    fprintf(tfp, "<!-- Magnification: %.3g -->\n", mag);
+	if (creation_date(date_buf))
+	    fprintf(tfp, "<!-- CreationDate: %s -->\n", date_buf);
+	fprintf(tfp, "<!-- Magnification: %.3g -->\n", mag);
+    }
 
 
     if (paperspec) {
@@ -522,7 +622,16 @@ gensvg_start(F_compound *objects)
 int
 gensvg_end(void)
 {
+    struct svg_image	*img;
+
+    end_joined();
     fprintf(tfp, "</g>\n</svg>\n");
+
+    while ((img = svg_images)) {
+	svg_images = img->next;
+	free(img->file);
+	free(img);
+    }
     return 0;
 }
 
@@ -624,25 +733,426 @@ continue_paint_w_clip(int fill_style, int pen_color, int fill_color)
     fprintf(tfp, " clip-path=\"url(#cp%d)\"", clipno);
 }
 
+/*
+ * Write the n points " x,y". Break lines longer than SVG_LINEWIDTH, chars
+ * is the length of the current line.
+ */
+static void
+put_points(F_pos *pts, int n, int chars)
+{
+    int		    i;
+    struct outbuf   ob;
+
+    outbuf_init(&ob, tfp);
+    for (i = 0; i < n; ++i) {
+	outbuf_char(&ob, ' ');
+	chars += outbuf_int(&ob, pts[i].x) + 2;
+	outbuf_char(&ob, ',');
+	chars += outbuf_int(&ob, pts[i].y);
+	if (chars > SVG_LINEWIDTH && !compact) {
+	    outbuf_char(&ob, '\n');
+	    chars = 0;
+	}
+    }
+    outbuf_flush(&ob);
+}
+
+/* write the comment <!-- name -->, except in compact mode */
+static void
+put_comment(const char *name)
+{
+    if (!compact)
+	fprintf(tfp, "<!-- %s -->\n", name);
+}
+
+/*
+ * Write the number n in path data. A separating blank is only needed before
+ * a non-negative number that follows another number.
+ */
+static void
+put_num(struct outbuf *ob, int n, bool follows)
+{
+    if (follows && n >= 0)
+	outbuf_char(ob, ' ');
+    (void)outbuf_int(ob, n);
+}
+
+/*
+ * Write the n points as path data with relative coordinates, e.g.,
+ * "m10 20l5-3 0 4z". The path starts with a move relative to from, or with
+ * an absolute move, if move is 'M'. Close the path, if closed. Return the
+ * current point at the end of the path.
+ */
+static F_pos
+put_path(F_pos *pts, int n, bool closed, char move, F_pos from)
+{
+    int		    i;
+    struct outbuf   ob;
+
+    if (move == 'M')
+	from.x = from.y = 0;
+    outbuf_init(&ob, tfp);
+    outbuf_char(&ob, move);
+    put_num(&ob, pts[0].x - from.x, false);
+    put_num(&ob, pts[0].y - from.y, true);
+    if (n > 1) {
+	outbuf_char(&ob, 'l');
+	put_num(&ob, pts[1].x - pts[0].x, false);
+	put_num(&ob, pts[1].y - pts[0].y, true);
+	for (i = 2; i < n; ++i) {
+	    put_num(&ob, pts[i].x - pts[i-1].x, true);
+	    put_num(&ob, pts[i].y - pts[i-1].y, true);
+	}
+    }
+    if (closed)
+	outbuf_char(&ob, 'z');
+    outbuf_flush(&ob);
+    /* after closepath, the current point is the start of the subpath */
+    return closed ? pts[0] : pts[n-1];
+}
+
+/* end the joined path, if one is open */
+static void
+end_joined(void)
+{
+    if (!joined.open)
+	return;
+    fprintf(tfp, "\"%sstroke=\"#%6.6x\" stroke-width=\"%dpx\"", sep,
+	    rgbColorVal(joined.pen_color), joined.width);
+    put_joinstyle(joined.join_style);
+    put_capstyle(joined.cap_style);
+    fputs("/>\n", tfp);
+    joined.open = false;
+}
+
+/*
+ * In compact mode, join the line l to the previous one, if both are unfilled
+ * and drawn with the same solid stroke. Return false, if l cannot be joined.
+ */
+static bool
+join_line(F_line *l, F_pos *pts, int n)
+{
+    int	    width;
+    bool    closed;
+
+    if (!compact || l->fill_style != UNFILLED || l->thickness <= 0 ||
+	    l->style > SOLID_LINE || l->for_arrow || l->back_arrow ||
+	    (l->type != T_POLYLINE && l->type != T_POLYGON &&
+	     l->type != T_BOX) || n < 1)
+	return false;
+
+    /* the last point of polygons and boxes repeats the first one */
+    closed = l->type != T_POLYLINE;
+    if (closed && n > 1)
+	--n;
+    width = (int) ceil(linewidth_adj(l->thickness));
+    if (joined.open && joined.pen_color == l->pen_color &&
+	    joined.width == width && joined.join_style == l->join_style &&
+	    joined.cap_style == l->cap_style) {
+	joined.cur = put_path(pts, n, closed, 'm', joined.cur);
+    } else {
+	end_joined();
+	fputs("<path d=\"", tfp);
+	joined.cur = put_path(pts, n, closed, 'M', joined.cur);
+	joined.open = true;
+	joined.pen_color = l->pen_color;
+	joined.width = width;
+	joined.join_style = l->join_style;
+	joined.cap_style = l->cap_style;
+    }
+    return true;
+}
+
+/*
+ * Read the stream fp into memory. Return the data, and its length in len.
+ */
+static unsigned char *
+read_all(FILE *fp, size_t *len)
+{
+    size_t		n, size = 0;
+    unsigned char	*data = NULL;
+
+    *len = 0;
+    do {
+	if (*len == size && (data = realloc(data, size = size ? 2*size : 65536))
+		== NULL) {
+	    put_msg(Err_mem);
+	    exit(EXIT_FAILURE);
+	}
+	n = fread(data + *len, 1, size - *len, fp);
+	*len += n;
+    } while (n > 0);
+    return data;
+}
+
+#ifdef HAVE_PNG_H
+/* a growing buffer for the png written by libpng */
+struct pngbuf {
+    unsigned char	*data;
+    size_t		len;
+    size_t		size;
+};
+
+static void
+pngbuf_write(png_structp png_ptr, png_bytep data, png_size_t length)
+{
+    struct pngbuf	*b = png_get_io_ptr(png_ptr);
+
+    if (b->len + length > b->size) {
+	while (b->len + length > b->size)
+	    b->size = b->size ? 2 * b->size : 65536;
+	if ((b->data = realloc(b->data, b->size)) == NULL) {
+	    put_msg(Err_mem);
+	    exit(EXIT_FAILURE);
+	}
+    }
+    memcpy(b->data + b->len, data, length);
+    b->len += length;
+}
+
+static void
+pngbuf_flush(png_structp png_ptr)
+{
+    (void)png_ptr;
+}
+
+/*
+ * Convert the decoded picture pic to png, into b. Xbm bitmaps are drawn with
+ * the color pen_color. Return true on success.
+ */
+static bool
+pic_to_png(F_pic *pic, int pen_color, struct pngbuf *b)
+{
+    int			i, y;
+    int			w = pic->bit_size.x, h = pic->bit_size.y;
+    size_t		stride;
+    unsigned		rgb;
+    png_structp		png_ptr;
+    png_infop		info_ptr;
+    png_color		palette[256];
+    png_byte		alpha[256];
+    png_color_16	transp;
+
+    if (pic->bitmap == NULL || w <= 0 || h <= 0)
+	return false;
+
+    png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING,
+	    (png_voidp) NULL, NULL, NULL);
+    if (!png_ptr)
+	return false;
+    info_ptr = png_create_info_struct(png_ptr);
+    if (!info_ptr) {
+	png_destroy_write_struct(&png_ptr, (png_infopp) NULL);
+	return false;
+    }
+    if (setjmp(png_jmpbuf(png_ptr))) {
+	png_destroy_write_struct(&png_ptr, &info_ptr);
+	return false;
+    }
+    png_set_write_fn(png_ptr, b, pngbuf_write, pngbuf_flush);
+
+    if (pic->subtype == P_XBM) {
+	/* a set bit is painted with the pen color, the others are clear */
+	rgb = rgbColorVal(pen_color);
+	palette[0].red = palette[0].green = palette[0].blue = 255;
+	palette[1].red = rgb >> 16;
+	palette[1].green = rgb >> 8 & 255;
+	palette[1].blue = rgb & 255;
+	alpha[0] = 0;
+	png_set_IHDR(png_ptr, info_ptr, (png_uint_32)w, (png_uint_32)h, 1,
+		PNG_COLOR_TYPE_PALETTE, PNG_INTERLACE_NONE,
+		PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_set_PLTE(png_ptr, info_ptr, palette, 2);
+	png_set_tRNS(png_ptr, info_ptr, alpha, 1, NULL);
+	stride = (size_t)(w + 7) / 8;
+    } else if (pic->numcols > 256) {
+	png_set_IHDR(png_ptr, info_ptr, (png_uint_32)w, (png_uint_32)h, 8,
+		PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
+		PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	if (pic->num_transp == TRANSP_COLOR) {
+	    transp.red = pic->transp_col[RED];
+	    transp.green = pic->transp_col[GREEN];
+	    transp.blue = pic->transp_col[BLUE];
+	    png_set_tRNS(png_ptr, info_ptr, NULL, 0, &transp);
+	}
+	stride = (size_t)w * 3;
+    } else {
+	int	num_alpha = 0;
+
+	for (i = 0; i < pic->numcols; ++i) {
+	    palette[i].red = pic->cmap[RED][i];
+	    palette[i].green = pic->cmap[GREEN][i];
+	    palette[i].blue = pic->cmap[BLUE][i];
+	    alpha[i] = 255;
+	}
+	for (i = 0; i < pic->num_transp; ++i) {
+	    alpha[pic->transp_cols[i]] = 0;
+	    if (pic->transp_cols[i] >= num_alpha)
+		num_alpha = pic->transp_cols[i] + 1;
+	}
+	png_set_IHDR(png_ptr, info_ptr, (png_uint_32)w, (png_uint_32)h, 8,
+		PNG_COLOR_TYPE_PALETTE, PNG_INTERLACE_NONE,
+		PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_set_PLTE(png_ptr, info_ptr, palette,
+		pic->numcols > 0 ? pic->numcols : 1);
+	if (num_alpha > 0)
+	    png_set_tRNS(png_ptr, info_ptr, alpha, num_alpha, NULL);
+	stride = (size_t)w;
+    }
+
+    png_write_info(png_ptr, info_ptr);
+    for (y = 0; y < h; ++y)
+	png_write_row(png_ptr, pic->bitmap + (size_t)y * stride);
+    png_write_end(png_ptr, info_ptr);
+    png_destroy_write_struct(&png_ptr, &info_ptr);
+    return true;
+}
+#endif /* HAVE_PNG_H */
+
+/*
+ * Write the picture of the picture box l as <image id="img%d">, embedded as
+ * data uri. Return false, if the picture cannot be
+ * embedded.
+ */
+static bool
+write_image_def(F_line *l, int id)
+{
+    int			i, c;
+    char		buf[12];
+    size_t		len = 0;
+    unsigned char	*data = NULL;
+    F_pic		*pic = l->pic;
+    struct xfig_stream	pic_stream;
+
+    init_stream(&pic_stream);
+    if (find_stream(pic->file, &pic_stream) ||
+	    open_stream(pic->file, &pic_stream) == NULL) {
+	put_msg("No such picture file: %s", pic->file);
+	free_stream(&pic_stream);
+	return false;
+    }
+
+    for (i = 0; i < (int)(sizeof buf); ++i) {
+	if ((c = getc(pic_stream.fp)) == EOF)
+	    break;
+	buf[i] = (char)c;
+    }
+    for (i = 0; i < (int)NUMHEADERS; ++i)
+	if (!memcmp(buf, headers[i].bytes, strlen(headers[i].bytes)))
+	    break;
+
+    if (i == (int)NUMHEADERS) {
+	put_msg("%s: Cannot embed this picture, refer to the file instead",
+		pic->file);
+    } else if (headers[i].readfunc == NULL) {
+	/* copy the file */
+	if (rewind_stream(&pic_stream))
+	    data = read_all(pic_stream.fp, &len);
+    } else {
+#ifdef HAVE_PNG_H
+	int		llx, lly;
+	bool		decoded = false;
+	struct pngbuf	png = {NULL, 0, 0};
+
+	if (!piccache_get(pic, pic_stream.name_on_disk, &llx, &lly)) {
+	    pic->num_transp = NO_TRANSPARENCY;
+	    if (headers[i].readfunc(pic, &pic_stream, &llx, &lly))
+		decoded = true;
+	    else
+		put_msg("%s: Bad %s format", pic->file, headers[i].type);
+	    if (decoded)
+		piccache_put(pic, pic_stream.name_on_disk, llx, lly);
+	} else {
+	    decoded = true;
+	}
+	if (decoded && pic_to_png(pic, l->pen_color, &png)) {
+	    data = png.data;
+	    len = png.len;
+	} else {
+	    free(png.data);
+	}
+	free(pic->bitmap);
+	pic->bitmap = NULL;
+#else
+	put_msg("%s: Embedding %s pictures needs libpng, refer to the file "
+		"instead", pic->file, headers[i].type);
+#endif
+    }
+    close_stream(&pic_stream);
+    free_stream(&pic_stream);
+
+    if (data == NULL)
+	return false;
+
+    /* the image fills the unit square, <use> scales it to the box */
+    fprintf(tfp, "<defs>\n<image id=\"img%d\" width=\"1\" height=\"1\" "
+	    "preserveAspectRatio=\"none\"\n\txlink:href=\"data:%s;base64,",
+	    id, headers[i].mime);
+    base64encode(tfp, data, len);
+    fputs("\"/>\n</defs>\n", tfp);
+    free(data);
+    return true;
+}
+
+/*
+ * Return the number of the image of the picture of l, write it, if it is
+ * placed the first time. Return -1, if it cannot be embedded.
+ */
+static int
+embed_image(F_line *l)
+{
+    struct svg_image	*img;
+
+    for (img = svg_images; img; img = img->next)
+	if (!strcmp(img->file, l->pic->file) &&
+		(img->pen_color == -1 || img->pen_color == l->pen_color))
+	    return img->id;
+
+    if ((img = malloc(sizeof(struct svg_image))) == NULL) {
+	put_msg(Err_mem);
+	exit(EXIT_FAILURE);
+    }
+    /* with -Q, the picture is freed after it is drawn */
+    if ((img->file = strdup(l->pic->file)) == NULL) {
+	put_msg(Err_mem);
+	exit(EXIT_FAILURE);
+    }
+    img->id = ++imgno;
+    if (!write_image_def(l, img->id)) {
+	img->id = -1;
+	--imgno;
+    }
+    img->pen_color = l->pic->subtype == P_XBM ? l->pen_color : -1;
+    img->next = svg_images;
+    svg_images = img;
+    return img->id;
+}
+
 void
 gensvg_line(F_line *l)
 {
     char	chars;
     int		px,py;
     int		px2,py2,width,height,rotation;
-    F_point	*p;
+    int		i, n;
+    F_pos	*pts;
 
 
+    pts = line_points(l, &n);
     if (l->type == T_PIC_BOX ) {
-	fprintf(tfp,"<!-- Image -->\n");
-	fprintf(tfp,
-	    "<image xlink:href=\"file:%s\" preserveAspectRatio=\"none\"\n",
-	    l->pic->file);
-	p = l->points;
-	px = p->x;
-	py = p->y;
-	px2 = p->next->next->x;
-	py2 = p->next->next->y;
+	end_joined();
+	i = embed_images ? embed_image(l) : -1;
+	put_comment("Image");
+	if (i >= 0)
+	    fprintf(tfp, "<use xlink:href=\"#img%d\"\n", i);
+	else
+	    fprintf(tfp,
+		"<image xlink:href=\"file:%s\" preserveAspectRatio=\"none\"\n",
+		l->pic->file);
+	px = pts[0].x;
+	py = pts[0].y;
+	px2 = pts[2].x;
+	py2 = pts[2].y;
 	width = px2 - px;
 	height = py2 - py;
 	rotation = 0;
@@ -663,14 +1173,22 @@ gensvg_line(F_line *l)
 	}
 	px2 = px + width/2;
 	py2 = py + height/2;
+	/* an embedded image fills the unit square, scale it to the box */
 	if (l->pic->flipped) {
 	    fprintf(tfp,
-		"transform=\"rotate(%d %d %d) scale(-1,1) translate(%d,%d)\"\n",
-		rotation, px2, py2, -2*px2, 0);
+		"transform=\"rotate(%d %d %d) scale(-1,1) translate(%d,%d)%s",
+		rotation, px2, py2, -2*px2, 0, i >= 0 ? " " : "\"\n");
 	} else if (rotation !=0) {
-	fprintf(tfp,"transform=\"rotate(%d %d %d)\"\n",rotation,px2,py2);
+	fprintf(tfp,"transform=\"rotate(%d %d %d)%s",rotation,px2,py2,
+		i >= 0 ? " " : "\"\n");
+	} else if (i >= 0) {
+	    fputs("transform=\"", tfp);
 	}
 
+	if (i >= 0)
+	    fprintf(tfp, "translate(%d,%d) scale(%d,%d)\"/>\n",
+		px, py, width, height);
+	else
 	fprintf(tfp,"x=\"%d\" y=\"%d\" width=\"%d\" height=\"%d\"/>\n",
 	px, py, width, height);
     return;
@@ -680,35 +1198,37 @@ gensvg_line(F_line *l)
 			!l->for_arrow && !l->back_arrow)
 	return;
 
+    if (join_line(l, pts, n))
+	return;
+    end_joined();
+
     /* l->type == T_BOX, T_ARC_BOX, T_POLYGON or T_POLYLINE */
-    fprintf(tfp, "<!-- Line -->\n");
+    put_comment("Line");
     print_svgcomments("<!-- ", l->comments, " -->\n");
 
     if (l->type == T_BOX || l->type == T_ARC_BOX || l->type == T_POLYGON) {
 
 	INIT_PAINT(l->fill_style);
 
-	if (l->type == T_POLYGON) {
+	if (l->type == T_POLYGON && compact) {
+	    fputs("<path d=\"", tfp);
+	    (void) put_path(pts, n - 1, true, 'M', pts[0]);
+	    fputc('\"', tfp);
+	} else if (l->type == T_POLYGON) {
 	    chars = fputs("<polygon points=\"", tfp);
-	    for (p = l->points; p->next; p = p->next) {
-		chars += fprintf(tfp, " %d,%d", p->x , p->y);
-		if (chars > SVG_LINEWIDTH) {
-		    fputc('\n', tfp);
-		    chars = 0;
-		}
-	    }
+	    put_points(pts, n - 1, chars);
 	    fputc('\"', tfp);
 	} else {	/* T_BOX || T_ARC_BOX */
-	    px = l->points->next->next->x;
-	    py = l->points->next->next->y;
-	    width = l->points->x - px;
-	    height = l->points->y - py;
+	    px = pts[2].x;
+	    py = pts[2].y;
+	    width = pts[0].x - px;
+	    height = pts[0].y - py;
 	    if (width < 0) {
-		px = l->points->x;
+		px = pts[0].x;
 		width = -width;
 	    }
 	    if (height < 0) {
-		py = l->points->y;
+		py = pts[0].y;
 		height = -height;
 	    }
 
@@ -723,7 +1243,7 @@ gensvg_line(F_line *l)
     /* http://jwatt.org/SVG Authoring Guidelines.html recommends to
        use px unit for stroke width */
     if (l->thickness) {
-	fprintf(tfp, "\n\tstroke=\"#%6.6x\" stroke-width=\"%dpx\"",
+	fprintf(tfp, "%sstroke=\"#%6.6x\" stroke-width=\"%dpx\"", sep,
 		rgbColorVal(l->pen_color),
 		(int) ceil(linewidth_adj(l->thickness)));
 	put_joinstyle(l->join_style);
@@ -741,12 +1261,12 @@ gensvg_line(F_line *l)
 
 	if (l->for_arrow || l->back_arrow) {
 	    has_clip = svg_arrows(l->thickness, l->for_arrow, l->back_arrow,
-			    &(l->last[1]), l->last, (F_pos *)l->points->next,
-			    (F_pos *)l->points, INIT);
+			    &(l->last[1]), l->last, &pts[1],
+			    pts, INIT);
 	    if (l->fill_style == UNFILLED && l->thickness <= 0) {
 		(void) svg_arrows(l->thickness, l->for_arrow, l->back_arrow,
-			    &(l->last[1]), l->last, (F_pos *)l->points->next,
-			    (F_pos *)l->points, l->pen_color);
+			    &(l->last[1]), l->last, &pts[1],
+			    pts, l->pen_color);
 		return;
 	    }
 	}
@@ -754,18 +1274,17 @@ gensvg_line(F_line *l)
 	if (has_clip) {
 	    INIT_PAINT_W_CLIP(l->fill_style, l->thickness, l->for_arrow,
 		    l->back_arrow, &(l->last[1]), l->last,
-		    (F_pos *)l->points->next, (F_pos *)l->points);
+		    &pts[1], pts);
 	} else {
 	    INIT_PAINT(l->fill_style);
 	}
 
-	chars = fputs("<polyline points=\"", tfp);
-	for (p = l->points; p; p = p->next) {
-	    chars += fprintf(tfp, " %d,%d", p->x , p->y);
-	    if (chars > SVG_LINEWIDTH) {
-		fputc('\n', tfp);
-		chars = 0;
-	    }
+	if (compact) {
+	    fputs("<path d=\"", tfp);
+	    (void) put_path(pts, n, false, 'M', pts[0]);
+	} else {
+	    chars = fputs("<polyline points=\"", tfp);
+	    put_points(pts, n, chars);
 	}
 	fputc('\"', tfp);
 
@@ -775,7 +1294,7 @@ gensvg_line(F_line *l)
 	    continue_paint(l->fill_style, l->pen_color, l->fill_color);
 
 	if (l->thickness) {
-	    fprintf(tfp, "\n\tstroke=\"#%6.6x\" stroke-width=\"%dpx\"",
+	    fprintf(tfp, "%sstroke=\"#%6.6x\" stroke-width=\"%dpx\"", sep,
 		    rgbColorVal(l->pen_color),
 		    (int) ceil(linewidth_adj(l->thickness)));
 	    put_joinstyle(l->join_style);
@@ -787,8 +1306,8 @@ gensvg_line(F_line *l)
 	fputs("/>\n", tfp);
 	if (l->for_arrow || l->back_arrow)
 	    (void) svg_arrows(l->thickness, l->for_arrow, l->back_arrow,
-			&(l->last[1]), l->last, (F_pos *)l->points->next,
-			(F_pos *)l->points, l->pen_color);
+			&(l->last[1]), l->last, &pts[1],
+			pts, l->pen_color);
     }	/* l->type == T_POLYLINE */
 }
 
@@ -797,7 +1316,8 @@ gensvg_spline( /* not used by fig2dev */
 	F_spline *s)
 {
     F_point *p;
-    fprintf(tfp, "<!-- Spline -->\n");
+    end_joined();
+    put_comment("Spline");
     print_svgcomments("<!-- ", s->comments, " -->\n");
 
     fprintf(tfp, "<path style=\"stroke:#%6.6x;stroke-width:%d\" d=\"",
@@ -821,7 +1341,8 @@ gensvg_arc(F_arc *a)
 	    !a->for_arrow && !a->back_arrow)
 	return;
 
-    fputs("<!-- Arc -->\n", tfp);
+    end_joined();
+    put_comment("Arc");
     print_svgcomments("<!-- ", a->comments, " -->\n");
 
     if (a->for_arrow || a->back_arrow) {
@@ -894,7 +1415,7 @@ gensvg_arc(F_arc *a)
 	continue_paint(a->fill_style, a->pen_color, a->fill_color);
 
     if (a->thickness) {
-	fprintf(tfp, "\n\tstroke=\"#%6.6x\" stroke-width=\"%dpx\"",
+	fprintf(tfp, "%sstroke=\"#%6.6x\" stroke-width=\"%dpx\"", sep,
 		rgbColorVal(a->pen_color),
 		(int) ceil(linewidth_adj(a->thickness)));
 	put_capstyle(a->cap_style);
@@ -914,9 +1435,11 @@ gensvg_ellipse(F_ellipse *e)
     int cx = e->center.x ;
     int cy = e->center.y ;
 
+    end_joined();
+
     if (e->type == T_CIRCLE_BY_RAD || e->type == T_CIRCLE_BY_DIA) {
 	int r = e->radiuses.x ;
-	fputs("<!-- Circle -->\n", tfp);
+	put_comment("Circle");
 	print_svgcomments("<!-- ", e->comments, " -->\n");
 
 	INIT_PAINT(e->fill_style);
@@ -927,7 +1450,7 @@ gensvg_ellipse(F_ellipse *e)
     } else { /* T_ELLIPSE_BY_RAD or T_ELLIPSE_BY_DIA */
 	int rx = e->radiuses.x ;
 	int ry = e->radiuses.y ;
-	fputs("<!-- Ellipse -->\n", tfp);
+	put_comment("Ellipse");
 	print_svgcomments("<!-- ", e->comments, " -->\n");
 
 	INIT_PAINT(e->fill_style);
@@ -945,7 +1468,7 @@ gensvg_ellipse(F_ellipse *e)
     continue_paint(e->fill_style, e->pen_color, e->fill_color);
 
     if (e->thickness) {
-	fprintf(tfp, "\n\tstroke=\"#%6.6x\" stroke-width=\"%dpx\"",
+	fprintf(tfp, "%sstroke=\"#%6.6x\" stroke-width=\"%dpx\"", sep,
 		rgbColorVal(e->pen_color),
 		(int) ceil(linewidth_adj(e->thickness)));
 	if (e->style > SOLID_LINE)
@@ -970,7 +1493,8 @@ gensvg_text(F_text *t)
 	int dy = 0;
 #endif
 
-	fprintf(tfp, "<!-- Text -->\n");
+	end_joined();
+	put_comment("Text");
 	print_svgcomments("<!-- ", t->comments, " -->\n");
 
 	if (t->angle != 0.) {
@@ -1072,7 +1596,8 @@ gensvg_text(F_text *t)
 }
 
 static void
-arrow_path(F_arrow *arrow, F_pos *arrow2, int pen_color, int npoints,
+arrow_path(const char *name, F_arrow *arrow, F_pos *arrow2, int pen_color,
+	int npoints,
 	F_pos points[], int nfillpoints, F_pos *fillpoints
 #ifdef DEBUG
 	, int nclippoints, F_pos clippoints[]
@@ -1081,21 +1606,16 @@ arrow_path(F_arrow *arrow, F_pos *arrow2, int pen_color, int npoints,
 {
     int	    i, chars;
 
-    fprintf(tfp, " to point %d,%d -->\n", arrow2->x, arrow2->y);
+    if (!compact)
+	fprintf(tfp, "<!-- %s arrow to point %d,%d -->\n", name, arrow2->x,
+		arrow2->y);
     chars = fprintf(tfp, "<%s points=\"",
 	    (points[0].x == points[npoints-1].x &&
 	     points[0].y == points[npoints-1].y ? "polygon" : "polyline"));
-    for (i = 0; i < npoints; ++i) {
-	chars += fprintf(tfp, " %d,%d", points[i].x ,
-		points[i].y );
-	if (chars > SVG_LINEWIDTH) {
-	    fputc('\n', tfp);
-	    chars = 0;
-	}
-    }
+    put_points(points, npoints, chars);
     fprintf(tfp,
-	"\"\n\tstroke=\"#%6.6x\" stroke-width=\"%dpx\" stroke-miterlimit=\"8\"",
-	rgbColorVal(pen_color),
+	"\"%sstroke=\"#%6.6x\" stroke-width=\"%dpx\" stroke-miterlimit=\"8\"",
+	sep, rgbColorVal(pen_color),
 	(int) ceil(linewidth_adj((int)arrow->thickness)));
     if (arrow->type < 13 && (arrow->style != 0 || nfillpoints != 0)) {
 	if (nfillpoints == 0)
@@ -1106,8 +1626,8 @@ arrow_path(F_arrow *arrow, F_pos *arrow2, int pen_color, int npoints,
 		fprintf(tfp, "%d,%d ", fillpoints[i].x ,
 			fillpoints[i].y );
 	    }
-	    fprintf(tfp, "z\"\n\tstroke=\"#%6.6x\" stroke-width=\"%dpx\"",
-		    rgbColorVal(pen_color),
+	    fprintf(tfp, "z\"%sstroke=\"#%6.6x\" stroke-width=\"%dpx\"",
+		    sep, rgbColorVal(pen_color),
 		    (int) ceil(linewidth_adj((int)arrow->thickness)));
 	    fprintf(tfp, " stroke-miterlimit=\"8\" fill=\"#%6.6x\"/>\n",
 		    rgbColorVal(pen_color));
@@ -1136,6 +1656,9 @@ svg_arrows(int line_thickness, F_arrow *for_arrow, F_arrow *back_arrow,
     int			i;
 
     if (pen_color == INIT) {
+	/* forget the arrows of a previous object */
+	fnpoints = fnfillpoints = fnclippoints = 0;
+	bnpoints = bnfillpoints = bnclippoints = 0;
 	if (for_arrow) {
 	    calc_arrow(forw1->x, forw1->y, forw2->x, forw2->y,
 		    line_thickness, for_arrow, fpoints, &fnpoints,
@@ -1174,8 +1697,7 @@ svg_arrows(int line_thickness, F_arrow *for_arrow, F_arrow *back_arrow,
     }
 
     if (for_arrow && fnpoints > 1) {
-	fputs("<!-- Forward arrow", tfp);
-	arrow_path(for_arrow, forw2, pen_color, fnpoints, fpoints,
+	arrow_path("Forward", for_arrow, forw2, pen_color, fnpoints, fpoints,
 		fnfillpoints, ffillpoints
 #ifdef DEBUG
 		, fnclippoints, fclippoints
@@ -1183,8 +1705,7 @@ svg_arrows(int line_thickness, F_arrow *for_arrow, F_arrow *back_arrow,
 		);
     }
     if (back_arrow && bnpoints > 1) {
-	fputs("<!-- Backward arrow", tfp);
-	arrow_path(back_arrow, back2, pen_color, bnpoints, bpoints,
+	arrow_path("Backward", back_arrow, back2, pen_color, bnpoints, bpoints,
 		bnfillpoints, bfillpoints
 #ifdef DEBUG
 		, bnclippoints, bclippoints
@@ -1327,5 +1848,6 @@ struct driver dev_svg = {
 	gensvg_spline,
 	gensvg_text,
 	gensvg_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	STREAM_OBJECTS
 };
@@ -128,6 +128,7 @@ gentextyl_start(F_compound *objects)
 
 	texfontsizes[0] = texfontsizes[1] = texfontsizes[
 		(font_size != 0.0 ? (int) font_size : DEFAULT_FONT_SIZE) + 1];
+	line_style = 0;
 
 	/* print any whole-figure comments prefixed with "%" */
 	if (objects->comments) {
@@ -595,5 +596,6 @@ struct driver dev_textyl = {
 	gentextyl_spline,
 	gentextyl_text,
 	gentextyl_end,
-	EXCLUDE_TEXT
+	EXCLUDE_TEXT,
+	NO_STREAM
 };
@@ -40,6 +40,7 @@
 #include "bound.h"
 #include "gentikz.h"
 #include "messages.h"
+#include "outbuf.h"
 #include "psfonts.h"
 #include "texfonts.h"	/* texfontnames[], select_font(), put_string() */
 
@@ -194,6 +195,7 @@ struct tikzarrow {
 	int	flags;
 	struct settings	s;
 };
+#define	NOARROW	    -1
 
 /* Variables */
 static bool	select_fontsize = true;
@@ -214,9 +216,17 @@ static int	cur_pencolor = DEFAULT;
 static int	cur_patcolor = DEFAULT;
 static int	cur_fillcolor = DEFAULT;
 static int	cur_fillstyle = BLACK_FILL;	/* really, a solid color: NUMSHADES - 1 */
+static int	cur_thickness = 0;
+static int	cur_style = SOLID_LINE;
+static double	cur_styleval = 0.;
+static int	cur_capstyle = 0;
+static int	cur_joinstyle = 0;
 static int	border_margin = 0;
 static struct options	default_options;
 static struct options	alt_options;
+/* the currently active arrows, see set_arrows() */
+static struct tikzarrow	cur_b = {NOARROW,0,0,{0,0.0,0.0,0.0,0,0}};
+static struct tikzarrow	cur_f = {NOARROW,0,0,{0,0.0,0.0,0.0,0,0}};
 
 /* Macros */
 #define	PREC1(f)	floor(f) == f ? 0 : 1
@@ -669,20 +679,31 @@ void
 gentikz_start(F_compound *objects)
 {
 	int	i;
+	int	margin;
 	double	splength;   /* unitlength expressed in TeX scaled points */
 
 	texfontsizes[0] = texfontsizes[1]
 		= TEXFONTSIZE(font_size != 0.0? font_size : DEFAULT_FONT_SIZE);
 
 	unitlength = mag/ppi;
-	border_margin /= unitlength*72.0;
+	margin = border_margin / (unitlength*72.0);
 	splength = 4736286.72*unitlength;	/* 1 in = 72.27 x 65536 sp */
 
 	/* adjust for any border margin */
-	llx -= border_margin;
-	lly -= border_margin;
-	urx += border_margin;
-	ury += border_margin;
+	llx -= margin;
+	lly -= margin;
+	urx += margin;
+	ury += margin;
+
+	cur_pencolor = cur_patcolor = cur_fillcolor = DEFAULT;
+	cur_fillstyle = BLACK_FILL;
+	cur_thickness = 0;
+	cur_style = SOLID_LINE;
+	cur_styleval = 0.;
+	cur_capstyle = cur_joinstyle = 0;
+	memset(&cur_b, 0, sizeof cur_b);
+	memset(&cur_f, 0, sizeof cur_f);
+	cur_b.type = cur_f.type = NOARROW;
 
 	xshift = shift_coordinate(llx);
 	yshift = shift_coordinate(-ury);
@@ -860,33 +881,46 @@ gentikz_end(void)
 	return 0;
 }
 
+/*
+ * Write "--(x,y)" for the points from p, up to, but not including last.
+ */
 static void
-points_all(F_point *p)
+points_until(F_point *p, F_point *last)
 {
-	int len = 6;	/* "\draw " is 6 chars */
-	while (p != NULL) {
+	int		len = 6;	/* "\draw " is 6 chars */
+	struct outbuf	ob;
+
+	outbuf_init(&ob, tfp);
+	while (p != last) {
 		if (len > MINLINELENGTH) {
-			fputs("\n  ", tfp);
+			outbuf_str(&ob, "\n  ");
 			len = 2;
 		}
-		len += fprintf(tfp, "--(%d,%d)", XCOORD(p->x), YCOORD(p->y));
+		len += outbuf_str(&ob, "--(");
+		len += outbuf_int(&ob, XCOORD(p->x));
+		outbuf_char(&ob, ',');
+		len += outbuf_int(&ob, YCOORD(p->y)) + 2;
+		outbuf_char(&ob, ')');
 		p = p->next;
 	}
+	outbuf_flush(&ob);
+}
+
+static void
+points_all(F_point *p)
+{
+	points_until(p, NULL);
 	fputs(";\n", tfp);
 }
 
 static void
 points_penultimate(F_point *p)
 {
-	int len = 6;	/* "\draw " is 6 chars */
-	while (p->next != NULL) {
-		if (len > MINLINELENGTH) {
-			fputs("\n  ", tfp);
-			len = 2;
-		}
-		len += fprintf(tfp, "--(%d,%d)", XCOORD(p->x), YCOORD(p->y));
-		p = p->next;
-	}
+	F_point	*last = p;
+
+	while (last->next != NULL)
+		last = last->next;
+	points_until(p, last);
 }
 
 static void
@@ -966,7 +1000,6 @@ put_picture(F_point *p, F_point *r, F_pic *pic)
 static void
 set_width(int w)
 {
-	static int	cur_thickness = 0;
 	int	l;
 	double	v;
 
@@ -984,8 +1017,6 @@ set_width(int w)
 static void
 set_stipple(int s, double v)
 {
-	static int	cur_style = SOLID_LINE;
-	static double	cur_styleval = 0.;
 	int	l;
 
 	if (s == cur_style && v == cur_styleval)
@@ -1042,7 +1073,6 @@ set_stipple(int s, double v)
 static void
 set_capstyle(int c)
 {
-	static int	cur_capstyle = 0;
 	const char	*capcmd[] = {
 		"\\pgfsetbuttcap\n",
 		"\\pgfsetroundcap\n",
@@ -1059,7 +1089,6 @@ set_capstyle(int c)
 static void
 set_joinstyle(int j)
 {
-	static int	cur_joinstyle = 0;
 	const char	*joincmd[] = {
 		"\\pgfsetmiterjoin\n",
 		"\\pgfsetroundjoin\n",
@@ -1489,8 +1518,6 @@ assign_settings(struct settings *s, struct options *o)
 		o->flags = s->flags | (o->flags & ~s->setflags);
 }
 
-#define	NOARROW	    -1
-
 static void
 assign_arrow(struct tikzarrow *a, struct tikzarrow *o)
 {
@@ -1516,8 +1543,6 @@ assign_arrow(struct tikzarrow *a, struct tikzarrow *o)
 static void
 set_arrows(F_arrow *back, F_arrow *forw)
 {
-	static struct tikzarrow      cur_b = {NOARROW,0,0,{0,0.0,0.0,0.0,0,0}};
-	static struct tikzarrow      cur_f = {NOARROW,0,0,{0,0.0,0.0,0.0,0,0}};
 	struct tikzarrow    b, f;
 	struct settings	    *d = NULL;
 	bool		    set_back, set_forw;
@@ -1866,5 +1891,6 @@ struct driver dev_tikz = {
 	gentikz_spline,
 	gentikz_text,
 	gentikz_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	STREAM_OBJECTS
 };
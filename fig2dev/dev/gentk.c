@@ -72,6 +72,8 @@ static char *patname = "xfigp";
 
 #define		TOP	8.5 /* inches */
 static int	full_page = false;
+static int	inQuote = 0;	/* state of niceLine() */
+static int	pos = 0;
 
 /*
  * Create files containing the stipple bitmaps, if they do not yet exist.
@@ -163,6 +165,7 @@ gentk_start(F_compound *objects)
 	float		wid = -1., ht = -1., swap;
 	const struct paperdef	*pd;
 
+	inQuote = pos = 0;
 	fprintf(tfp, "# Produced by fig2dev Version %s\n", PACKAGE_VERSION);
 	ppi = ppi / mag * 80/72.0;
 
@@ -1386,8 +1389,6 @@ niceLine(char *s)
 {
 	extern FILE	*tfp;	/* File descriptor of Tk file. */
 	int		i, len;
-	static int	inQuote = 0;
-	static int	pos = 0;
 
 	len = strlen(s);
 	for (i = 0; i < len; ++i) {
@@ -1425,5 +1426,6 @@ struct driver	dev_tk = {
 	gentk_spline,
 	gentk_text,
 	gentk_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	NO_STREAM
 };
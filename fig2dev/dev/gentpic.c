@@ -92,6 +92,9 @@
 #define			TOP	10.5	/* top of page is 10.5 inch */
 static int		line_width = 8;	/* milli-inches */
 static int		vfont = 0; /* true if using a virtual TeX font */
+static int		cur_thickness = -1;
+static float		style_val = -1;
+static int		cur_baseline = -1;
 
 static char	*texfontnames[] = {
 	"rm",			/* default */
@@ -267,6 +270,9 @@ void
 gentpic_start(F_compound *objects)
 {
 	ppi = ppi/mag;
+	cur_thickness = -1;
+	style_val = -1;
+	cur_baseline = -1;
 
 	if (objects->comments) {
 		fputs(".\\\"\n", tfp);
@@ -292,8 +298,6 @@ gentpic_end(void)
 static void
 set_linewidth(int w)
 {
-	static int	cur_thickness = -1;
-
 	if (w == 0) return;
 	if (w != cur_thickness) {
 		cur_thickness = w;
@@ -305,8 +309,6 @@ set_linewidth(int w)
 static void
 set_style(int s, float v)
 {
-	static float	style_val = -1;
-
 	if (s == DASH_LINE || s == DOTTED_LINE) {
 		if (v == style_val || v == 0.0) return;
 		style_val = v;
@@ -317,8 +319,6 @@ set_style(int s, float v)
 static void
 set_baseline(int b)
 {
-	static int	cur_baseline = -1;
-
 	if (b != cur_baseline) {
 		fprintf(tfp, ".baseline %d\n", b);
 		cur_baseline = b;
@@ -933,5 +933,6 @@ struct driver dev_tpic = {
 	gentpic_spline,
 	gentpic_text,
 	gentpic_end,
-	INCLUDE_TEXT
+	INCLUDE_TEXT,
+	NO_STREAM
 };
@@ -0,0 +1,172 @@
+/*
+ * Fig2dev: Translate Fig code to various Devices
+ * Copyright (c) 1991 by Micah Beck
+ * Parts Copyright (c) 1985-1988 by Supoj Sutanthavibul
+ * Parts Copyright (c) 1989-2015 by Brian V. Smith
+ * Parts Copyright (c) 2015-2024 by Thomas Loimer
+ *
+ * Any party obtaining a copy of these files is granted, free of charge, a
+ * full and unrestricted irrevocable, world-wide, paid up, royalty-free,
+ * nonexclusive right and license to deal in this software and documentation
+ * files (the "Software"), including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense and/or sell copies
+ * of the Software, and to permit persons who receive copies from any such
+ * party to do so, with the only requirement being that the above copyright
+ * and this permission notice remain intact.
+ *
+ */
+
+/*
+ * outbuf.c: collect output in a buffer, with fast number formatting.
+ *
+ * The drivers write the coordinates of polylines and splines point by
+ * point. Formatting numbers with fprintf() means parsing the format string
+ * for each number; here, integers and fixed-point numbers are converted
+ * directly. The output is identical to that of fprintf() with "%d" and
+ * "%.*f", in the "C" locale.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "outbuf.h"
+
+/* powers of ten, exactly representable as double */
+static const double	powers10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+					1e8, 1e9};
+#define	MAX_PREC	(int)(sizeof powers10 / sizeof powers10[0] - 1)
+/* above, the fraction of x * powers10[prec] can not be represented */
+#define	MAX_SCALED	4503599627370496.0	/* 2^52 */
+
+void
+outbuf_init(struct outbuf *b, FILE *fp)
+{
+	b->fp = fp;
+	b->p = b->buf;
+}
+
+void
+outbuf_flush(struct outbuf *b)
+{
+	/* write errors are detected by ferror() when the output is closed */
+	if (b->p > b->buf)
+		fwrite(b->buf, 1, (size_t)(b->p - b->buf), b->fp);
+	b->p = b->buf;
+}
+
+/* make room for a number */
+static void
+reserve(struct outbuf *b)
+{
+	if (b->p + OUTBUF_NUM > b->buf + OUTBUF_SIZE)
+		outbuf_flush(b);
+}
+
+int
+outbuf_str(struct outbuf *b, const char *s)
+{
+	const char	*c;
+
+	for (c = s; *c; ++c)
+		outbuf_char(b, *c);
+	return (int)(c - s);
+}
+
+/*
+ * Write the digits of n, from the back, ending before end.
+ * Return the position of the first digit.
+ */
+static char *
+digits(char *end, unsigned long long n)
+{
+	do {
+		*--end = (char)('0' + n % 10);
+		n /= 10;
+	} while (n);
+	return end;
+}
+
+int
+outbuf_int(struct outbuf *b, int n)
+{
+	char			num[OUTBUF_NUM];
+	char			*start;
+	unsigned long long	u;
+	int			len;
+
+	reserve(b);
+	u = n < 0 ? 0ULL - (unsigned long long)n : (unsigned long long)n;
+	start = digits(num + sizeof num, u);
+	if (n < 0)
+		*--start = '-';
+	len = (int)(num + sizeof num - start);
+	memcpy(b->p, start, (size_t)len);
+	b->p += len;
+	return len;
+}
+
+/*
+ * Write x with prec digits after the decimal point, as "%.*f" would.
+ */
+int
+outbuf_fixed(struct outbuf *b, double x, int prec)
+{
+	char			num[OUTBUF_NUM];
+	char			*start, *end;
+	double			ax, scaled, r, err;
+	unsigned long long	u;
+	int			i, len;
+
+	reserve(b);
+	ax = fabs(x);
+	if (prec < 0 || prec > MAX_PREC ||
+			!(ax * powers10[prec] < MAX_SCALED)) {
+		/* large numbers, nan and inf */
+		len = snprintf(b->p, OUTBUF_NUM, "%.*f", prec, x);
+		if (len >= OUTBUF_NUM) {
+			outbuf_flush(b);
+			return fprintf(b->fp, "%.*f", prec, x);
+		}
+		b->p += len;
+		return len;
+	}
+
+	/*
+	 * Round to nearest, like printf(), which rounds the exact decimal value
+	 * of x. Only if scaled lies exactly half-way between two integers,
+	 * the exact product may differ from it; fma() yields the rounding
+	 * error of the product. Ties of the exact product go to even.
+	 */
+	scaled = ax * powers10[prec];
+	r = floor(scaled);
+	if (scaled - r > 0.5) {
+		r += 1.0;
+	} else if (scaled - r == 0.5) {
+		err = fma(ax, powers10[prec], -scaled);
+		if (err > 0.0 || (err == 0.0 && fmod(r, 2.0) != 0.0))
+			r += 1.0;
+	}
+	u = (unsigned long long)r;
+
+	end = num + sizeof num;
+	start = end;
+	if (prec > 0) {
+		for (i = 0; i < prec; ++i) {
+			*--start = (char)('0' + u % 10);
+			u /= 10;
+		}
+		*--start = '.';
+	}
+	start = digits(start, u);
+	if (signbit(x))
+		*--start = '-';
+	len = (int)(end - start);
+	memcpy(b->p, start, (size_t)len);
+	b->p += len;
+	return len;
+}
@@ -0,0 +1,56 @@
+/*
+ * Fig2dev: Translate Fig code to various Devices
+ * Copyright (c) 1991 by Micah Beck
+ * Parts Copyright (c) 1985-1988 by Supoj Sutanthavibul
+ * Parts Copyright (c) 1989-2015 by Brian V. Smith
+ * Parts Copyright (c) 2015-2024 by Thomas Loimer
+ *
+ * Any party obtaining a copy of these files is granted, free of charge, a
+ * full and unrestricted irrevocable, world-wide, paid up, royalty-free,
+ * nonexclusive right and license to deal in this software and documentation
+ * files (the "Software"), including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense and/or sell copies
+ * of the Software, and to permit persons who receive copies from any such
+ * party to do so, with the only requirement being that the above copyright
+ * and this permission notice remain intact.
+ *
+ */
+
+/*
+ * outbuf.h: collect output in a buffer, with fast number formatting.
+ */
+
+#ifndef OUTBUF_H
+#define OUTBUF_H
+
+#include <stdio.h>
+
+#define	OUTBUF_SIZE	8192
+#define	OUTBUF_NUM	32	/* the longest number written, plus margin */
+
+/*
+ * The output is collected in buf and written to fp with fwrite(), when the
+ * buffer is full or outbuf_flush() is called. Flush the buffer before
+ * writing to fp by other means, e.g., with fprintf(). Like fprintf(), the
+ * functions return the number of characters written.
+ */
+struct outbuf {
+	FILE	*fp;
+	char	*p;		/* the next position to write to */
+	char	buf[OUTBUF_SIZE];
+};
+
+extern void	outbuf_init(struct outbuf *b, FILE *fp);
+extern void	outbuf_flush(struct outbuf *b);
+extern int	outbuf_str(struct outbuf *b, const char *s);
+extern int	outbuf_int(struct outbuf *b, int n);
+extern int	outbuf_fixed(struct outbuf *b, double x, int prec);
+
+/* write the character c */
+#define	outbuf_char(b, c)	do {					\
+		if ((b)->p == (b)->buf + OUTBUF_SIZE)			\
+			outbuf_flush(b);				\
+		*(b)->p++ = (c);					\
+	} while (0)
+
+#endif /* OUTBUF_H */
@@ -0,0 +1,181 @@
+/*
+ * Fig2dev: Translate Fig code to various Devices
+ * Copyright (c) 1991 by Micah Beck
+ * Parts Copyright (c) 1985-1988 by Supoj Sutanthavibul
+ * Parts Copyright (c) 1989-2015 by Brian V. Smith
+ * Parts Copyright (c) 2015-2023 by Thomas Loimer
+ *
+ * Any party obtaining a copy of these files is granted, free of charge, a
+ * full and unrestricted irrevocable, world-wide, paid up, royalty-free,
+ * nonexclusive right and license to deal in this software and documentation
+ * files (the "Software"), including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense and/or sell copies
+ * of the Software, and to permit persons who receive copies from any such
+ * party to do so, with the only requirement being that the above copyright
+ * and this permission notice remain intact.
+ *
+ */
+
+/*
+ * piccache.c: keep decoded images for re-use.
+ *
+ * An image embedded many times, e.g., a logo in a batch of figures converted
+ * with -I, is decoded only once. The cache is keyed by the file on disk, its
+ * size and its modification time, and holds the bitmap, the colormap and the
+ * transparency information. Images that the drivers copy from the file, eps,
+ * pdf and jpeg, are not cached. The cache lives as long as the process.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "bool.h"
+#include "object.h"
+#include "piccache.h"
+
+/* the total size of the cached bitmaps */
+#define PICCACHE_MAX	(64L << 20)
+
+struct cached_pic {
+	struct cached_pic	*next;
+	char			*path;
+	dev_t			dev;
+	ino_t			ino;
+	off_t			size;
+	time_t			mtime;
+	int			llx, lly;
+	size_t			len;		/* size of pic.bitmap */
+	F_pic			pic;
+};
+
+static struct cached_pic	*cache = NULL;
+static size_t			cache_len = 0;
+
+/*
+ * Return the number of bytes of the bitmap, or 0, if the image is not cached.
+ */
+static size_t
+bitmap_len(const F_pic *pic)
+{
+	size_t	pixels = (size_t)pic->bit_size.x * pic->bit_size.y;
+
+	if (pic->bitmap == NULL || pic->bit_size.x <= 0 || pic->bit_size.y <= 0)
+		return 0;
+
+	switch (pic->subtype) {
+	case P_XBM:
+		return (size_t)((pic->bit_size.x + 7) / 8) * pic->bit_size.y;
+	case P_GIF:
+	case P_PCX:
+	case P_PNG:
+	case P_PPM:
+	case P_TIF:
+	case P_XPM:
+		return pic->numcols > 256 ? 3 * pixels : pixels;
+	default:
+		return 0;
+	}
+}
+
+static struct cached_pic *
+find_pic(const char *path, const struct stat *st)
+{
+	struct cached_pic	*c;
+
+	for (c = cache; c; c = c->next)
+		if (c->ino == st->st_ino && c->dev == st->st_dev &&
+				c->size == st->st_size &&
+				c->mtime == st->st_mtime &&
+				!strcmp(c->path, path))
+			return c;
+	return NULL;
+}
+
+/*
+ * If the image in the file path was decoded before, fill in pic and the
+ * offsets llx, lly, and return true. Otherwise, return false.
+ */
+bool
+piccache_get(F_pic *pic, const char *path, int *llx, int *lly)
+{
+	struct stat		st;
+	struct cached_pic	*c;
+	unsigned char		*bitmap;
+
+	if (cache == NULL || stat(path, &st) || (c = find_pic(path, &st)) ==
+			NULL || (bitmap = malloc(c->len)) == NULL)
+		return false;
+
+	memcpy(bitmap, c->pic.bitmap, c->len);
+	pic->bitmap = bitmap;
+	pic->subtype = c->pic.subtype;
+	memcpy(pic->cmap, c->pic.cmap, sizeof pic->cmap);
+	pic->numcols = c->pic.numcols;
+	pic->num_transp = c->pic.num_transp;
+	memcpy(pic->transp_col, c->pic.transp_col, sizeof pic->transp_col);
+	/* transp_cols points to transp_col, if there are at most three */
+	if (c->pic.num_transp > 0 && c->pic.num_transp <= 3)
+		pic->transp_cols = pic->transp_col;
+	else
+		pic->transp_cols = c->pic.transp_cols;
+	pic->hw_ratio = c->pic.hw_ratio;
+	pic->bit_size = c->pic.bit_size;
+	*llx = c->llx;
+	*lly = c->lly;
+	return true;
+}
+
+/*
+ * Remember the image decoded into pic from the file path.
+ */
+void
+piccache_put(const F_pic *pic, const char *path, int llx, int lly)
+{
+	struct stat		st;
+	struct cached_pic	*c;
+	size_t			len;
+
+	if ((len = bitmap_len(pic)) == 0 || len > PICCACHE_MAX - cache_len ||
+			stat(path, &st) || find_pic(path, &st))
+		return;
+
+	if ((c = malloc(sizeof *c)) == NULL)
+		return;
+	c->pic = *pic;
+	c->pic.file = NULL;
+	c->pic.transp_cols = NULL;
+	c->path = malloc(strlen(path) + 1);
+	c->pic.bitmap = malloc(len);
+	if (pic->num_transp > 3)
+		c->pic.transp_cols = malloc((size_t)pic->num_transp);
+	if (c->path == NULL || c->pic.bitmap == NULL ||
+			(pic->num_transp > 3 && c->pic.transp_cols == NULL)) {
+		free(c->path);
+		free(c->pic.bitmap);
+		free(c->pic.transp_cols);
+		free(c);
+		return;
+	}
+	strcpy(c->path, path);
+	memcpy(c->pic.bitmap, pic->bitmap, len);
+	if (pic->num_transp > 3)
+		memcpy(c->pic.transp_cols, pic->transp_cols,
+				(size_t)pic->num_transp);
+
+	c->dev = st.st_dev;
+	c->ino = st.st_ino;
+	c->size = st.st_size;
+	c->mtime = st.st_mtime;
+	c->llx = llx;
+	c->lly = lly;
+	c->len = len;
+	c->next = cache;
+	cache = c;
+	cache_len += len;
+}
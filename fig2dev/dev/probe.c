@@ -0,0 +1,308 @@
+/*
+ * Fig2dev: Translate Fig code to various Devices
+ * Copyright (c) 1991 by Micah Beck
+ * Parts Copyright (c) 1985-1988 by Supoj Sutanthavibul
+ * Parts Copyright (c) 1989-2015 by Brian V. Smith
+ * Parts Copyright (c) 2015-2023 by Thomas Loimer
+ *
+ * Any party obtaining a copy of these files is granted, free of charge, a
+ * full and unrestricted irrevocable, world-wide, paid up, royalty-free,
+ * nonexclusive right and license to deal in this software and documentation
+ * files (the "Software"), including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense and/or sell copies
+ * of the Software, and to permit persons who receive copies from any such
+ * party to do so, with the only requirement being that the above copyright
+ * and this permission notice remain intact.
+ *
+ */
+
+/*
+ * probe.c: find out whether external programs are available.
+ *
+ * Many drivers and image readers test for the presence of external programs,
+ * e.g., by calling system("convert -version"). Each test starts a shell. The
+ * results are remembered in $XDG_CACHE_HOME/fig2dev/probes, or in
+ * ~/.cache/fig2dev/probes, and re-used in later runs of fig2dev. The cached
+ * results are discarded if PATH changes, or if a directory in PATH changes,
+ * e.g., because a program was installed or removed. With option -U,
+ * fig2dev probes again and renews the cache.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined HAVE_SYS_STAT_H && defined HAVE_UNISTD_H
+#include <errno.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define PROBE_CACHE	1
+#endif
+
+#ifndef HAVE_GETLINE
+#include "lib/getline.h"
+#endif
+
+#include "bool.h"
+#include "probe.h"
+
+#define CACHE_DIR	"fig2dev"
+#define CACHE_FILE	"probes"
+#define CACHE_MAGIC	"fig2dev probes 1"
+
+bool	probe_refresh = false;
+
+struct probe {
+	char	*command;
+	bool	available;
+};
+
+static struct probe	*probes = NULL;
+static size_t		num_probes = 0;
+static size_t		max_probes = 0;
+static bool		loaded = false;
+#ifdef PROBE_CACHE
+static char		*cache_name = NULL;
+static char		*path_env = NULL;	/* PATH */
+static char		stamp[32];	/* latest change of a PATH directory */
+#endif
+
+static struct probe *
+find_probe(const char *command)
+{
+	size_t	i;
+
+	for (i = 0; i < num_probes; ++i)
+		if (!strcmp(probes[i].command, command))
+			return probes + i;
+	return NULL;
+}
+
+static void
+add_probe(const char *command, bool available)
+{
+	struct probe	*p;
+	char		*s;
+
+	if (num_probes == max_probes) {
+		max_probes = max_probes ? 2 * max_probes : 16;
+		if ((p = realloc(probes, max_probes * sizeof *p)) == NULL) {
+			max_probes = num_probes;
+			return;
+		}
+		probes = p;
+	}
+	if ((s = malloc(strlen(command) + 1)) == NULL)
+		return;
+	strcpy(s, command);
+	probes[num_probes].command = s;
+	probes[num_probes].available = available;
+	++num_probes;
+}
+
+#ifdef PROBE_CACHE
+/*
+ * Compose the name of the cache file and create its directory. Compute the
+ * time stamp of the directories in PATH. Return false, if there is no place
+ * for the cache.
+ */
+static bool
+init_cache(void)
+{
+	const char	*dir;
+	const char	*sub = "";
+	char		*d, *end;
+	size_t		len;
+	time_t		latest = 0;
+	struct stat	st;
+
+	if ((dir = getenv("XDG_CACHE_HOME")) == NULL || *dir != '/') {
+		if ((dir = getenv("HOME")) == NULL || *dir == '\0')
+			return false;
+		sub = "/.cache";
+	}
+	len = strlen(dir) + strlen(sub) + sizeof CACHE_DIR + sizeof CACHE_FILE;
+	if ((cache_name = malloc(len + 1)) == NULL)
+		return false;
+
+	/* create the directories, if necessary */
+	sprintf(cache_name, "%s%s", dir, sub);
+	if (mkdir(cache_name, 0700) && errno != EEXIST)
+		return false;
+	strcat(cache_name, "/" CACHE_DIR);
+	if (mkdir(cache_name, 0700) && errno != EEXIST)
+		return false;
+	strcat(cache_name, "/" CACHE_FILE);
+
+	/* an empty entry in PATH denotes the current directory */
+	if ((d = getenv("PATH")) == NULL)
+		d = "";
+	if ((path_env = malloc(strlen(d) + 1)) == NULL)
+		return false;
+	strcpy(path_env, d);
+	for (;;) {
+		end = strchr(d, ':');
+		if (end)
+			*end = '\0';
+		if (!stat(*d ? d : ".", &st) && st.st_mtime > latest)
+			latest = st.st_mtime;
+		if (!end)
+			break;
+		*end = ':';
+		d = end + 1;
+	}
+	sprintf(stamp, "%ld", (long)latest);
+
+	return true;
+}
+
+/*
+ * Read the cached results, if they were obtained with the same PATH.
+ */
+static void
+read_cache(void)
+{
+	FILE	*f;
+	char	*line = NULL;
+	size_t	n = 0;
+	ssize_t	len;
+	int	i = 0;
+	bool	valid = true;
+
+	if ((f = fopen(cache_name, "r")) == NULL)
+		return;
+
+	while (valid && (len = getline(&line, &n, f)) > 0) {
+		if (line[len - 1] == '\n')
+			line[--len] = '\0';
+		switch (i++) {
+		case 0:
+			valid = !strcmp(line, CACHE_MAGIC);
+			break;
+		case 1:
+			valid = !strncmp(line, "path ", 5) &&
+				!strcmp(line + 5, path_env);
+			break;
+		case 2:
+			valid = !strncmp(line, "stamp ", 6) &&
+				!strcmp(line + 6, stamp);
+			break;
+		default:
+			if (len > 2 && (line[0] == '0' || line[0] == '1') &&
+					line[1] == ' ' && !find_probe(line + 2))
+				add_probe(line + 2, line[0] == '1');
+			break;
+		}
+	}
+	free(line);
+	fclose(f);
+}
+
+/*
+ * Write all results to the cache. Write to a temporary file first, so that
+ * concurrent runs of fig2dev never read a partial file.
+ */
+static void
+write_cache(void)
+{
+	FILE	*f;
+	char	*tmp;
+	size_t	i;
+
+	if ((tmp = malloc(strlen(cache_name) + 24)) == NULL)
+		return;
+	sprintf(tmp, "%s.%ld", cache_name, (long)getpid());
+	if ((f = fopen(tmp, "w")) == NULL) {
+		free(tmp);
+		return;
+	}
+	fprintf(f, CACHE_MAGIC "\npath %s\nstamp %s\n", path_env, stamp);
+	for (i = 0; i < num_probes; ++i)
+		fprintf(f, "%d %s\n", probes[i].available ? 1 : 0,
+				probes[i].command);
+	if (fclose(f) || rename(tmp, cache_name))
+		remove(tmp);
+	free(tmp);
+}
+#endif /* PROBE_CACHE */
+
+/*
+ * Return the cached result for command, or NULL.
+ */
+static struct probe *
+cached(const char *command)
+{
+	if (!loaded) {
+		loaded = true;
+#ifdef PROBE_CACHE
+		if (!init_cache()) {
+			free(cache_name);
+			cache_name = NULL;
+		} else if (!probe_refresh) {
+			read_cache();
+		}
+#endif
+	}
+	return find_probe(command);
+}
+
+static bool
+remember(const char *command, bool available)
+{
+	add_probe(command, available);
+#ifdef PROBE_CACHE
+	if (cache_name)
+		write_cache();
+#endif
+	return available;
+}
+
+/*
+ * Return true, if command exits successfully.
+ */
+bool
+probe_command(const char *command)
+{
+	struct probe	*p;
+
+	if ((p = cached(command)))
+		return p->available;
+	return remember(command, system(command) == 0);
+}
+
+/*
+ * Return true, if command reads input[0..len-1] from a pipe and exits
+ * successfully.
+ */
+bool
+probe_pipe(const char *command, const void *input, size_t len)
+{
+	struct probe	*p;
+	FILE		*f;
+	bool		available;
+#ifdef SIGPIPE
+	void		(*handler)(int);
+#endif
+
+	if ((p = cached(command)))
+		return p->available;
+#ifdef SIGPIPE
+	/* the command may exit before reading all of the input */
+	handler = signal(SIGPIPE, SIG_IGN);
+#endif
+	if ((f = popen(command, "w")) == NULL)
+		available = false;
+	else {
+		available = fwrite(input, 1, len, f) == len;
+		available = pclose(f) == 0 && available;
+	}
+#ifdef SIGPIPE
+	(void)signal(SIGPIPE, handler);
+#endif
+	return remember(command, available);
+}
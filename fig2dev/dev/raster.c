@@ -0,0 +1,1648 @@
+/*
+ * Fig2dev: Translate Fig code to various Devices
+ * Copyright (c) 1991 by Micah Beck
+ * Parts Copyright (c) 1985-1988 by Supoj Sutanthavibul
+ * Parts Copyright (c) 1989-2015 by Brian V. Smith
+ * Parts Copyright (c) 2015-2024 by Thomas Loimer
+ *
+ * Any party obtaining a copy of these files is granted, free of charge, a
+ * full and unrestricted irrevocable, world-wide, paid up, royalty-free,
+ * nonexclusive right and license to deal in this software and documentation
+ * files (the "Software"), including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense and/or sell copies
+ * of the Software, and to permit persons who receive copies from any such
+ * party to do so, with the only requirement being that the above copyright
+ * and this permission notice remain intact.
+ *
+ */
+
+/*
+ * raster.c: render pdf page content into a pixel buffer
+ *
+ * Interpret the page content written by genpdf.c in raster mode. Paths are
+ * flattened in device space, strokes are expanded into polygons, and areas
+ * are filled by a scanline renderer with the nonzero or the even-odd rule.
+ * Each pixel is sampled at samples x samples points. Text is drawn with the
+ * outlines of fonts found by fontconfig and loaded by FreeType, if fig2dev
+ * is compiled with these libraries.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef HAVE_FREETYPE
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_OUTLINE_H
+#include <fontconfig/fontconfig.h>
+#endif
+
+#include "bool.h"
+#include "object.h"
+#include "messages.h"
+#include "pi.h"
+#include "raster.h"
+
+#define FLATNESS	0.1	/* maximum distance of a flattened curve from
+				   the curve, in pixels */
+#define MAX_OPERANDS	16
+#define MAX_DASH	16
+#define MAX_FONTS	16
+
+struct point {
+	double	x, y;
+};
+
+/* a subpath, n points starting at pts[first] */
+struct subpath {
+	int	first;
+	int	n;
+	bool	closed;
+};
+
+/* an edge of a polygon, with y0 < y1; dir is +1 or -1 */
+struct edge {
+	double	x0, y0, x1, y1;
+	double	dxdy;
+	int	dir;
+};
+
+struct crossing {
+	double	x;
+	int	dir;
+};
+
+struct gstate {
+	double		ctm[6];
+	double		fill[3];
+	double		stroke[3];
+	int		pattern;	/* the fill pattern /Pn, or 0 */
+	double		lw;
+	int		cap;
+	int		join;
+	double		miter;
+	double		dash[MAX_DASH];
+	int		ndash;
+	double		dash_phase;
+	unsigned char	*clip;		/* the clip mask, or NULL */
+	bool		own_clip;	/* clip was set in this state */
+	int		font;
+	double		font_size;
+	double		hscale;
+};
+
+/* the device */
+static struct raster			*canvas;
+static int				W, H;
+static int				ss;		/* samples per pixel */
+static const struct raster_resources	*resources;
+
+/* the graphics state and the saved states */
+static struct gstate	g;
+static struct gstate	*stack = NULL;
+static int		nstack = 0, size_stack = 0;
+
+/* text state */
+static double		tm[6], tlm[6];
+
+/* the current path, in device space */
+static struct point	*pts = NULL;
+static int		npts = 0, size_pts = 0;
+static struct subpath	*subs = NULL;
+static int		nsubs = 0, size_subs = 0;
+static struct point	cur;
+static bool		cur_closed = false;
+static int		pending_clip = 0;	/* 1 for W, 2 for W* */
+static bool		omitted = false;	/* text could not be drawn */
+
+/* the polygon edges to be filled, and the scanline buffers */
+static struct edge	*edges = NULL;
+static int		nedges = 0, size_edges = 0;
+static int		*active = NULL;
+static struct crossing	*crossings = NULL;
+static int		size_active = 0;
+static int		*cov = NULL, *diff = NULL;
+
+/* called for each row of covered pixels, cov[x] in 0..ss*ss */
+typedef void (*row_sink)(int y, int x0, int x1, const int *cov, void *data);
+
+static void	interpret(const char *s, size_t len);
+
+
+static void *
+grow(void *p, int *size, int need, size_t elsize)
+{
+	if (need <= *size)
+		return p;
+	*size = *size ? 2 * *size : 256;
+	if (*size < need)
+		*size = need;
+	if ((p = realloc(p, (size_t)*size * elsize)) == NULL) {
+		put_msg(Err_mem);
+		exit(EXIT_FAILURE);
+	}
+	return p;
+}
+
+
+/*******************************/
+/* matrices                    */
+/*******************************/
+
+/* r = a x b, r may be equal to a or b */
+static void
+concat(double r[6], const double a[6], const double b[6])
+{
+	double	t[6];
+
+	t[0] = a[0] * b[0] + a[1] * b[2];
+	t[1] = a[0] * b[1] + a[1] * b[3];
+	t[2] = a[2] * b[0] + a[3] * b[2];
+	t[3] = a[2] * b[1] + a[3] * b[3];
+	t[4] = a[4] * b[0] + a[5] * b[2] + b[4];
+	t[5] = a[4] * b[1] + a[5] * b[3] + b[5];
+	memcpy(r, t, sizeof t);
+}
+
+static bool
+invert(const double m[6], double r[6])
+{
+	double	det = m[0] * m[3] - m[1] * m[2];
+
+	if (fabs(det) < 1e-12)
+		return false;
+	r[0] = m[3] / det;
+	r[1] = -m[1] / det;
+	r[2] = -m[2] / det;
+	r[3] = m[0] / det;
+	r[4] = -(m[4] * r[0] + m[5] * r[2]);
+	r[5] = -(m[4] * r[1] + m[5] * r[3]);
+	return true;
+}
+
+static struct point
+transform(const double m[6], double x, double y)
+{
+	struct point	p;
+
+	p.x = m[0] * x + m[2] * y + m[4];
+	p.y = m[1] * x + m[3] * y + m[5];
+	return p;
+}
+
+/* the factor, by which lengths are scaled by m */
+static double
+scale_of(const double m[6])
+{
+	return sqrt(fabs(m[0] * m[3] - m[1] * m[2]));
+}
+
+
+/*******************************/
+/* paths                       */
+/*******************************/
+
+static void
+add_point(struct point p)
+{
+	pts = grow(pts, &size_pts, npts + 1, sizeof(struct point));
+	pts[npts++] = p;
+	++subs[nsubs - 1].n;
+	cur = p;
+}
+
+static void
+path_move(struct point p)
+{
+	/* a moveto replaces a preceding moveto */
+	if (nsubs > 0 && subs[nsubs - 1].n == 1) {
+		pts[npts - 1] = p;
+		cur = p;
+		cur_closed = false;
+		return;
+	}
+	subs = grow(subs, &size_subs, nsubs + 1, sizeof(struct subpath));
+	subs[nsubs].first = npts;
+	subs[nsubs].n = 0;
+	subs[nsubs].closed = false;
+	++nsubs;
+	add_point(p);
+	cur_closed = false;
+}
+
+static void
+path_line(struct point p)
+{
+	if (nsubs == 0 || cur_closed)
+		path_move(cur);
+	add_point(p);
+}
+
+/* append a cubic bezier curve from the current point, flattened */
+static void
+path_curve(struct point p1, struct point p2, struct point p3)
+{
+	int		i, n;
+	double		d1, d2, t, u;
+	struct point	p0, p;
+
+	if (nsubs == 0 || cur_closed)
+		path_move(cur);
+	p0 = cur;
+	d1 = hypot(p0.x - 2 * p1.x + p2.x, p0.y - 2 * p1.y + p2.y);
+	d2 = hypot(p1.x - 2 * p2.x + p3.x, p1.y - 2 * p2.y + p3.y);
+	n = (int)ceil(sqrt(0.75 * (d1 > d2 ? d1 : d2) / FLATNESS));
+	if (n < 1)
+		n = 1;
+	else if (n > 500)
+		n = 500;
+	for (i = 1; i < n; ++i) {
+		t = (double)i / n;
+		u = 1.0 - t;
+		p.x = u*u*u * p0.x + 3*u*u*t * p1.x + 3*u*t*t * p2.x +
+			t*t*t * p3.x;
+		p.y = u*u*u * p0.y + 3*u*u*t * p1.y + 3*u*t*t * p2.y +
+			t*t*t * p3.y;
+		add_point(p);
+	}
+	add_point(p3);
+}
+
+static void
+path_close(void)
+{
+	if (nsubs == 0 || cur_closed)
+		return;
+	subs[nsubs - 1].closed = true;
+	cur = pts[subs[nsubs - 1].first];
+	cur_closed = true;
+}
+
+static void
+path_clear(void)
+{
+	npts = nsubs = 0;
+	cur_closed = false;
+}
+
+
+/*******************************/
+/* scan conversion             */
+/*******************************/
+
+static void
+add_edge(struct point a, struct point b, int dir)
+{
+	struct edge	*e;
+
+	if (a.y == b.y)
+		return;
+	edges = grow(edges, &size_edges, nedges + 1, sizeof(struct edge));
+	e = edges + nedges++;
+	if (a.y < b.y) {
+		e->x0 = a.x; e->y0 = a.y; e->x1 = b.x; e->y1 = b.y;
+		e->dir = dir;
+	} else {
+		e->x0 = b.x; e->y0 = b.y; e->x1 = a.x; e->y1 = a.y;
+		e->dir = -dir;
+	}
+	e->dxdy = (e->x1 - e->x0) / (e->y1 - e->y0);
+}
+
+/* add the edges of the subpaths of the current path, closing each */
+static void
+add_path_edges(void)
+{
+	int		i, j;
+	struct point	*p;
+
+	for (i = 0; i < nsubs; ++i) {
+		p = pts + subs[i].first;
+		for (j = 1; j < subs[i].n; ++j)
+			add_edge(p[j - 1], p[j], 1);
+		if (subs[i].n > 1)
+			add_edge(p[subs[i].n - 1], p[0], 1);
+	}
+}
+
+/*
+ * Add a closed polygon. Polygons are oriented alike, so that the union of
+ * overlapping polygons is filled with the nonzero rule.
+ */
+static void
+add_polygon(const struct point *p, int n)
+{
+	int	i;
+	double	area = 0.0;
+
+	for (i = 0; i < n; ++i)
+		area += p[i].x * p[(i + 1) % n].y - p[(i + 1) % n].x * p[i].y;
+	if (area == 0.0)
+		return;
+	for (i = 0; i < n; ++i)
+		add_edge(p[i], p[(i + 1) % n], area > 0.0 ? 1 : -1);
+}
+
+static int
+cmp_edges(const void *a, const void *b)
+{
+	const struct edge	*e = a, *f = b;
+
+	return e->y0 < f->y0 ? -1 : (e->y0 > f->y0 ? 1 : 0);
+}
+
+/* accumulate the samples in [a, b) of the current row */
+static void
+add_span(double xa, double xb, int *lo, int *hi)
+{
+	int	a, b, pa, pb;
+
+	if (xa < -1.0)
+		xa = -1.0;
+	if (xb > W + 1.0)
+		xb = W + 1.0;
+	a = (int)ceil(xa * ss - 0.5);
+	b = (int)ceil(xb * ss - 0.5);
+	if (a < 0)
+		a = 0;
+	if (b > W * ss)
+		b = W * ss;
+	if (a >= b)
+		return;
+	if (a < *lo)
+		*lo = a;
+	if (b > *hi)
+		*hi = b;
+	pa = a / ss;
+	pb = b / ss;
+	if (pa == pb) {
+		cov[pa] += b - a;
+	} else {
+		/* the full pixels in between are summed up later */
+		cov[pa] += ss - a % ss;
+		diff[pa + 1] += ss;
+		diff[pb] -= ss;
+		if (b % ss)
+			cov[pb] += b % ss;
+	}
+}
+
+/*
+ * Fill the edges collected with add_edge(), with the even-odd or the
+ * nonzero winding rule, and pass each row of covered pixels to sink.
+ * The edges are removed.
+ */
+static void
+scan(bool evenodd, row_sink sink, void *data)
+{
+	int	i, j, k, y, y0, y1, x, x0, x1;
+	int	lo, hi, w, run;
+	int	next = 0, nactive = 0;
+	double	ymin, ymax, sy, xa = 0.0;
+
+	if (nedges == 0)
+		return;
+	ymin = edges[0].y0;
+	ymax = edges[0].y1;
+	for (i = 1; i < nedges; ++i) {
+		if (edges[i].y0 < ymin)
+			ymin = edges[i].y0;
+		if (edges[i].y1 > ymax)
+			ymax = edges[i].y1;
+	}
+	y0 = ymin < 0.0 ? 0 : (int)floor(ymin);
+	y1 = ymax > H ? H : (int)ceil(ymax);
+	if (y0 >= y1) {
+		nedges = 0;
+		return;
+	}
+	qsort(edges, (size_t)nedges, sizeof(struct edge), cmp_edges);
+	active = grow(active, &size_active, nedges, sizeof(int));
+	if ((crossings = realloc(crossings, (size_t)size_active *
+					sizeof(struct crossing))) == NULL) {
+		put_msg(Err_mem);
+		exit(EXIT_FAILURE);
+	}
+
+	for (y = y0; y < y1; ++y) {
+		lo = W * ss;
+		hi = 0;
+		for (k = 0; k < ss; ++k) {
+			sy = y + (k + 0.5) / ss;
+			while (next < nedges && edges[next].y0 <= sy)
+				active[nactive++] = next++;
+			for (i = j = 0; i < nactive; ++i)
+				if (edges[active[i]].y1 > sy)
+					active[j++] = active[i];
+			nactive = j;
+
+			/* the crossings, sorted by x */
+			for (i = 0; i < nactive; ++i) {
+				struct edge	*e = edges + active[i];
+				struct crossing	c;
+
+				c.x = e->x0 + (sy - e->y0) * e->dxdy;
+				c.dir = e->dir;
+				for (j = i; j > 0 && crossings[j - 1].x > c.x;
+						--j)
+					crossings[j] = crossings[j - 1];
+				crossings[j] = c;
+			}
+
+			for (i = 0, w = 0; i < nactive; ++i) {
+				bool	was = evenodd ? w & 1 : w != 0;
+				bool	is;
+
+				w += crossings[i].dir;
+				is = evenodd ? w & 1 : w != 0;
+				if (!was && is)
+					xa = crossings[i].x;
+				else if (was && !is)
+					add_span(xa, crossings[i].x, &lo, &hi);
+			}
+		}
+		if (lo >= hi)
+			continue;
+
+		x0 = lo / ss;
+		x1 = (hi - 1) / ss + 1;
+		for (x = x0, run = 0; x < x1; ++x) {
+			run += diff[x];
+			cov[x] += run;
+		}
+		sink(y, x0, x1, cov, data);
+		memset(cov + x0, 0, (size_t)(x1 - x0) * sizeof(int));
+		memset(diff + x0, 0, (size_t)(x1 - x0 + 1) * sizeof(int));
+	}
+	nedges = 0;
+}
+
+/* blend the color rgb with alpha a, 0..255, into the pixel p */
+static void
+blend(unsigned char *p, const unsigned char rgb[3], int a)
+{
+	if (a >= 255) {
+		p[0] = rgb[0];
+		p[1] = rgb[1];
+		p[2] = rgb[2];
+	} else if (a > 0) {
+		p[0] = (unsigned char)((p[0] * (255 - a) + rgb[0] * a + 127)
+				/ 255);
+		p[1] = (unsigned char)((p[1] * (255 - a) + rgb[1] * a + 127)
+				/ 255);
+		p[2] = (unsigned char)((p[2] * (255 - a) + rgb[2] * a + 127)
+				/ 255);
+	}
+}
+
+struct paint {
+	unsigned char		rgb[3];
+	const unsigned char	*clip;
+};
+
+static void
+paint_row(int y, int x0, int x1, const int *c, void *data)
+{
+	int		x, a;
+	const int	full = ss * ss;
+	struct paint	*paint = data;
+	unsigned char	*p = canvas->pixels + 3 * ((size_t)y * W + x0);
+
+	for (x = x0; x < x1; ++x, p += 3) {
+		if (c[x] == 0)
+			continue;
+		a = c[x] * 255 / full;
+		if (paint->clip)
+			a = (a * paint->clip[(size_t)y * W + x] + 127) / 255;
+		blend(p, paint->rgb, a);
+	}
+}
+
+static void
+mask_row(int y, int x0, int x1, const int *c, void *data)
+{
+	int		x;
+	const int	full = ss * ss;
+	unsigned char	*m = (unsigned char *)data + (size_t)y * W;
+
+	for (x = x0; x < x1; ++x)
+		m[x] = (unsigned char)(c[x] * 255 / full);
+}
+
+/* paint the collected edges in the color rgb, 0..1 */
+static void
+paint_edges(bool evenodd, const double rgb[3])
+{
+	int		i;
+	struct paint	paint;
+
+	for (i = 0; i < 3; ++i)
+		paint.rgb[i] = (unsigned char)(rgb[i] <= 0.0 ? 0 :
+				(rgb[i] >= 1.0 ? 255 : rgb[i] * 255.0 + 0.5));
+	paint.clip = g.clip;
+	scan(evenodd, paint_row, &paint);
+}
+
+/* return the collected edges as mask, intersected with the clip */
+static unsigned char *
+mask_edges(bool evenodd)
+{
+	size_t		i;
+	unsigned char	*mask;
+
+	if ((mask = calloc((size_t)W * H, 1)) == NULL) {
+		put_msg(Err_mem);
+		exit(EXIT_FAILURE);
+	}
+	scan(evenodd, mask_row, mask);
+	if (g.clip)
+		for (i = 0; i < (size_t)W * H; ++i)
+			mask[i] = (unsigned char)((mask[i] * g.clip[i] + 127)
+					/ 255);
+	return mask;
+}
+
+
+/*******************************/
+/* painting                    */
+/*******************************/
+
+/* fill the current path with the fill pattern, tile by tile */
+static void
+fill_pattern(bool evenodd)
+{
+	int		i, j, w, h;
+	int		i0, i1, j0, j1;
+	size_t		len;
+	double		inv[6], cell[6];
+	double		xmin, xmax, ymin, ymax;
+	const char	*content;
+	unsigned char	*mask;
+	struct point	p;
+	struct gstate	save;
+	struct point	*save_pts = pts;
+	struct subpath	*save_subs = subs;
+	int		save_n[4] = {npts, size_pts, nsubs, size_subs};
+
+	if ((content = resources->pattern(g.pattern, &w, &h, &len)) == NULL ||
+			w <= 0 || h <= 0 || nsubs == 0 ||
+			!invert(resources->pattern_matrix, inv))
+		return;
+
+	/* the device box of the path, in pattern space */
+	xmin = xmax = pts[0].x;
+	ymin = ymax = pts[0].y;
+	for (i = 1; i < npts; ++i) {
+		if (pts[i].x < xmin) xmin = pts[i].x;
+		if (pts[i].x > xmax) xmax = pts[i].x;
+		if (pts[i].y < ymin) ymin = pts[i].y;
+		if (pts[i].y > ymax) ymax = pts[i].y;
+	}
+	if (xmax < 0.0 || ymax < 0.0 || xmin > W || ymin > H)
+		return;
+	i0 = j0 = 0x7fffffff;
+	i1 = j1 = -0x7fffffff;
+	for (i = 0; i < 4; ++i) {
+		p = transform(inv, i & 1 ? xmax : xmin, i & 2 ? ymax : ymin);
+		if ((int)floor(p.x / w) < i0) i0 = (int)floor(p.x / w);
+		if ((int)floor(p.x / w) > i1) i1 = (int)floor(p.x / w);
+		if ((int)floor(p.y / h) < j0) j0 = (int)floor(p.y / h);
+		if ((int)floor(p.y / h) > j1) j1 = (int)floor(p.y / h);
+	}
+
+	add_path_edges();
+	mask = mask_edges(evenodd);
+
+	/* draw the tiles into the mask, with a path of their own */
+	save = g;
+	pts = NULL; subs = NULL;
+	npts = size_pts = nsubs = size_subs = 0;
+	g.clip = mask;
+	g.own_clip = false;
+	g.pattern = 0;
+	memcpy(g.stroke, g.fill, sizeof g.stroke);
+	for (j = j0 - 1; j <= j1 + 1; ++j) {
+		for (i = i0 - 1; i <= i1 + 1; ++i) {
+			cell[0] = 1.0; cell[1] = 0.0;
+			cell[2] = 0.0; cell[3] = 1.0;
+			cell[4] = i * w; cell[5] = j * h;
+			concat(g.ctm, cell, resources->pattern_matrix);
+			g.lw = 1.0;
+			g.cap = g.join = 0;
+			g.ndash = 0;
+			interpret(content, len);
+		}
+	}
+	free(pts);
+	free(subs);
+	pts = save_pts; subs = save_subs;
+	npts = save_n[0]; size_pts = save_n[1];
+	nsubs = save_n[2]; size_subs = save_n[3];
+	g = save;
+	free(mask);
+}
+
+static void
+fill(bool evenodd)
+{
+	if (g.pattern) {
+		fill_pattern(evenodd);
+		return;
+	}
+	add_path_edges();
+	paint_edges(evenodd, g.fill);
+}
+
+/* add a circle, or a polygon approximating it */
+static void
+add_circle(struct point c, double r)
+{
+	int		i, n;
+	struct point	p[256];
+
+	n = r > FLATNESS ? (int)ceil(M_PI / acos(1.0 - FLATNESS / r)) : 4;
+	if (n < 4)
+		n = 4;
+	else if (n > 256)
+		n = 256;
+	for (i = 0; i < n; ++i) {
+		p[i].x = c.x + r * cos(2 * M_PI * i / n);
+		p[i].y = c.y + r * sin(2 * M_PI * i / n);
+	}
+	add_polygon(p, n);
+}
+
+/* add the join at v between the unit directions d1 and d2 */
+static void
+add_join(struct point v, struct point d1, struct point d2, double hw)
+{
+	double		cross = d1.x * d2.y - d1.y * d2.x;
+	double		dot = d1.x * d2.x + d1.y * d2.y;
+	double		s;
+	struct point	p[4];
+
+	if (fabs(cross) < 1e-9 && dot > 0.0)
+		return;
+	if (g.join == 1) {
+		add_circle(v, hw);
+		return;
+	}
+	/* the normals on the outer side of the corner */
+	s = cross > 0.0 ? -hw : hw;
+	p[0] = v;
+	p[1].x = v.x - s * d1.y;	p[1].y = v.y + s * d1.x;
+	p[3].x = v.x - s * d2.y;	p[3].y = v.y + s * d2.x;
+	if (g.join == 0 && 1.0 + dot > 1e-9 &&
+			sqrt(2.0 / (1.0 + dot)) <= g.miter) {
+		p[2].x = v.x + (p[1].x - v.x + p[3].x - v.x) / (1.0 + dot);
+		p[2].y = v.y + (p[1].y - v.y + p[3].y - v.y) / (1.0 + dot);
+		add_polygon(p, 4);
+	} else {
+		p[2] = p[3];
+		add_polygon(p, 3);
+	}
+}
+
+/* add the cap at the end e of a line going in the unit direction d */
+static void
+add_cap(struct point e, struct point d, double hw)
+{
+	struct point	p[4];
+
+	if (g.cap == 1) {
+		add_circle(e, hw);
+	} else if (g.cap == 2) {
+		p[0].x = e.x - hw * d.y;	p[0].y = e.y + hw * d.x;
+		p[1].x = p[0].x + hw * d.x;	p[1].y = p[0].y + hw * d.y;
+		p[3].x = e.x + hw * d.y;	p[3].y = e.y - hw * d.x;
+		p[2].x = p[3].x + hw * d.x;	p[2].y = p[3].y + hw * d.y;
+		add_polygon(p, 4);
+	}
+}
+
+/* add the outline of the polyline p[0..n-1], of half width hw */
+static void
+stroke_polyline(struct point *p, int n, bool closed, double hw)
+{
+	int		i, m;
+	double		len;
+	struct point	d, first = {0.0, 0.0}, prev = {0.0, 0.0}, q[4];
+
+	/* remove repeated points */
+	for (i = m = 1; i < n; ++i)
+		if (fabs(p[i].x - p[m - 1].x) > 1e-9 ||
+				fabs(p[i].y - p[m - 1].y) > 1e-9)
+			p[m++] = p[i];
+	n = m;
+	if (closed && n > 1 && fabs(p[n - 1].x - p[0].x) < 1e-9 &&
+			fabs(p[n - 1].y - p[0].y) < 1e-9)
+		--n;
+
+	if (n == 1) {
+		/* a degenerate line, only round and square caps are drawn */
+		d.x = 1.0; d.y = 0.0;
+		if (g.cap == 1) {
+			add_circle(p[0], hw);
+		} else if (g.cap == 2) {
+			add_cap(p[0], d, hw);
+			d.x = -1.0;
+			add_cap(p[0], d, hw);
+		}
+		return;
+	}
+
+	m = closed ? n : n - 1;		/* the number of segments */
+	for (i = 0; i < m; ++i) {
+		struct point	a = p[i], b = p[(i + 1) % n];
+
+		len = hypot(b.x - a.x, b.y - a.y);
+		d.x = (b.x - a.x) / len;
+		d.y = (b.y - a.y) / len;
+		q[0].x = a.x - hw * d.y;	q[0].y = a.y + hw * d.x;
+		q[1].x = b.x - hw * d.y;	q[1].y = b.y + hw * d.x;
+		q[2].x = b.x + hw * d.y;	q[2].y = b.y - hw * d.x;
+		q[3].x = a.x + hw * d.y;	q[3].y = a.y - hw * d.x;
+		add_polygon(q, 4);
+		if (i == 0)
+			first = d;
+		else
+			add_join(a, prev, d, hw);
+		prev = d;
+	}
+	if (closed) {
+		add_join(p[0], prev, first, hw);
+	} else {
+		add_cap(p[n - 1], prev, hw);
+		first.x = -first.x;
+		first.y = -first.y;
+		add_cap(p[0], first, hw);
+	}
+}
+
+/* add the dashes of the polyline p[0..n-1] */
+static void
+stroke_dashed(const struct point *p, int n, bool closed, double hw,
+		double scale)
+{
+	int		i, k, m, nd = 0;
+	bool		on = true;
+	double		left, len, t, total = 0.0;
+	struct point	*dash;
+
+	for (k = 0; k < g.ndash; ++k)
+		total += g.dash[k];
+	if (total <= 0.0)
+		return;
+	if ((dash = malloc((size_t)(n + 2) * sizeof(struct point))) == NULL) {
+		put_msg(Err_mem);
+		exit(EXIT_FAILURE);
+	}
+
+	/* find the start of the pattern, as given by the phase */
+	left = fmod(g.dash_phase, total * (g.ndash % 2 ? 2 : 1)) * scale;
+	for (k = 0; left >= g.dash[k] * scale; k = (k + 1) % g.ndash) {
+		left -= g.dash[k] * scale;
+		on = !on;
+	}
+	left = g.dash[k] * scale - left;
+
+	m = closed ? n : n - 1;
+	if (on)
+		dash[nd++] = p[0];
+	for (i = 0; i < m; ++i) {
+		struct point	a = p[i], b = p[(i + 1) % n];
+
+		len = hypot(b.x - a.x, b.y - a.y);
+		t = 0.0;
+		while (len - t > left) {
+			struct point	c;
+
+			t += left;
+			c.x = a.x + (b.x - a.x) * t / len;
+			c.y = a.y + (b.y - a.y) * t / len;
+			if (on) {
+				dash[nd++] = c;
+				stroke_polyline(dash, nd, false, hw);
+				nd = 0;
+			} else {
+				dash[nd++] = c;
+			}
+			on = !on;
+			k = (k + 1) % g.ndash;
+			left = g.dash[k] * scale;
+		}
+		left -= len - t;
+		if (on)
+			dash[nd++] = b;
+	}
+	if (on && nd > 1)
+		stroke_polyline(dash, nd, false, hw);
+	free(dash);
+}
+
+static void
+stroke(void)
+{
+	int	i;
+	double	scale = scale_of(g.ctm);
+	double	hw = g.lw * scale;
+
+	/* the thinnest line is one pixel wide */
+	hw = (hw < 1.0 ? 1.0 : hw) / 2.0;
+	for (i = 0; i < nsubs; ++i) {
+		if (subs[i].n < 2)
+			continue;
+		if (g.ndash > 0)
+			stroke_dashed(pts + subs[i].first, subs[i].n,
+					subs[i].closed, hw, scale);
+		else
+			stroke_polyline(pts + subs[i].first, subs[i].n,
+					subs[i].closed, hw);
+	}
+	paint_edges(false, g.stroke);
+}
+
+static void
+clip(bool evenodd)
+{
+	unsigned char	*mask;
+
+	add_path_edges();
+	mask = mask_edges(evenodd);
+	if (g.own_clip)
+		free(g.clip);
+	g.clip = mask;
+	g.own_clip = true;
+}
+
+/* end the path, after painting it */
+static void
+end_path(void)
+{
+	if (pending_clip)
+		clip(pending_clip == 2);
+	pending_clip = 0;
+	path_clear();
+}
+
+
+/*******************************/
+/* images                      */
+/*******************************/
+
+/* draw the picture pic into the unit square of user space */
+static void
+draw_image(const F_pic *pic)
+{
+	int			x, y, x0, x1, y0, y1, col, row, i;
+	int			w = pic->bit_size.x, h = pic->bit_size.y;
+	double			inv[6], u, v;
+	struct point		p;
+	unsigned char		rgb[3], fill[3];
+	const unsigned char	*s;
+
+	if (pic->bitmap == NULL || w <= 0 || h <= 0 || !invert(g.ctm, inv))
+		return;
+	x0 = W; y0 = H; x1 = y1 = 0;
+	for (i = 0; i < 4; ++i) {
+		p = transform(g.ctm, i & 1, i >> 1);
+		if (floor(p.x) < x0) x0 = (int)floor(p.x);
+		if (ceil(p.x) > x1) x1 = (int)ceil(p.x);
+		if (floor(p.y) < y0) y0 = (int)floor(p.y);
+		if (ceil(p.y) > y1) y1 = (int)ceil(p.y);
+	}
+	if (x0 < 0) x0 = 0;
+	if (y0 < 0) y0 = 0;
+	if (x1 > W) x1 = W;
+	if (y1 > H) y1 = H;
+	for (i = 0; i < 3; ++i)
+		fill[i] = (unsigned char)(g.fill[i] * 255.0 + 0.5);
+
+	for (y = y0; y < y1; ++y) {
+		for (x = x0; x < x1; ++x) {
+			u = inv[0] * (x + 0.5) + inv[2] * (y + 0.5) + inv[4];
+			v = inv[1] * (x + 0.5) + inv[3] * (y + 0.5) + inv[5];
+			if (u < 0.0 || u >= 1.0 || v <= 0.0 || v > 1.0)
+				continue;
+			/* the first row of the image is at the top */
+			col = (int)(u * w);
+			row = (int)((1.0 - v) * h);
+			if (col >= w || row >= h)
+				continue;
+			if (pic->subtype == P_XBM) {
+				if (!(pic->bitmap[row * ((w + 7) / 8) + col / 8]
+						& (0x80 >> (col % 8))))
+					continue;
+				s = fill;
+			} else if (pic->numcols > 256) {
+				s = pic->bitmap + 3 * ((size_t)row * w + col);
+				if (pic->num_transp == TRANSP_COLOR &&
+					    !memcmp(s, pic->transp_col, 3))
+					continue;
+			} else {
+				i = pic->bitmap[(size_t)row * w + col];
+				if (pic->num_transp > 0 &&
+						i == pic->transp_cols[0])
+					continue;
+				rgb[0] = pic->cmap[RED][i];
+				rgb[1] = pic->cmap[GREEN][i];
+				rgb[2] = pic->cmap[BLUE][i];
+				s = rgb;
+			}
+			blend(canvas->pixels + 3 * ((size_t)y * W + x), s,
+				g.clip ? g.clip[(size_t)y * W + x] : 255);
+		}
+	}
+}
+
+
+/*******************************/
+/* text                        */
+/*******************************/
+
+#ifdef HAVE_FREETYPE
+enum encoding { LATIN1, SYMBOL, DINGBATS };
+
+static struct raster_font {
+	bool		tried;
+	FT_Face		face;
+	bool		unicode;	/* the face has a unicode charmap */
+	enum encoding	encoding;
+	double		matrix[4];	/* slant or distort the glyphs */
+	bool		embolden;
+} fonts[MAX_FONTS];
+
+static FT_Library	library = NULL;
+
+/* the unicode characters of the Symbol font, from 0x20 to 0xff */
+static const unsigned short	symbol_unicode[] = {
+	0x0020, 0x0021, 0x2200, 0x0023, 0x2203, 0x0025, 0x0026, 0x220b,
+	0x0028, 0x0029, 0x2217, 0x002b, 0x002c, 0x2212, 0x002e, 0x002f,
+	0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,
+	0x0038, 0x0039, 0x003a, 0x003b, 0x003c, 0x003d, 0x003e, 0x003f,
+	0x2245, 0x0391, 0x0392, 0x03a7, 0x0394, 0x0395, 0x03a6, 0x0393,
+	0x0397, 0x0399, 0x03d1, 0x039a, 0x039b, 0x039c, 0x039d, 0x039f,
+	0x03a0, 0x0398, 0x03a1, 0x03a3, 0x03a4, 0x03a5, 0x03c2, 0x03a9,
+	0x039e, 0x03a8, 0x0396, 0x005b, 0x2234, 0x005d, 0x22a5, 0x005f,
+	0x203e, 0x03b1, 0x03b2, 0x03c7, 0x03b4, 0x03b5, 0x03c6, 0x03b3,
+	0x03b7, 0x03b9, 0x03d5, 0x03ba, 0x03bb, 0x03bc, 0x03bd, 0x03bf,
+	0x03c0, 0x03b8, 0x03c1, 0x03c3, 0x03c4, 0x03c5, 0x03d6, 0x03c9,
+	0x03be, 0x03c8, 0x03b6, 0x007b, 0x007c, 0x007d, 0x223c, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0x20ac, 0x03d2, 0x2032, 0x2264, 0x2044, 0x221e, 0x0192, 0x2663,
+	0x2666, 0x2665, 0x2660, 0x2194, 0x2190, 0x2191, 0x2192, 0x2193,
+	0x00b0, 0x00b1, 0x2033, 0x2265, 0x00d7, 0x221d, 0x2202, 0x2022,
+	0x00f7, 0x2260, 0x2261, 0x2248, 0x2026, 0x23d0, 0x23af, 0x21b5,
+	0x2135, 0x2111, 0x211c, 0x2118, 0x2297, 0x2295, 0x2205, 0x2229,
+	0x222a, 0x2283, 0x2287, 0x2284, 0x2282, 0x2286, 0x2208, 0x2209,
+	0x2220, 0x2207, 0x00ae, 0x00a9, 0x2122, 0x220f, 0x221a, 0x22c5,
+	0x00ac, 0x2227, 0x2228, 0x21d4, 0x21d0, 0x21d1, 0x21d2, 0x21d3,
+	0x25ca, 0x2329, 0x00ae, 0x00a9, 0x2122, 0x2211, 0x239b, 0x239c,
+	0x239d, 0x23a1, 0x23a2, 0x23a3, 0x23a7, 0x23a8, 0x23a9, 0x23aa,
+	0, 0x232a, 0x222b, 0x2320, 0x23ae, 0x2321, 0x239e, 0x239f,
+	0x23a0, 0x23a4, 0x23a5, 0x23a6, 0x23ab, 0x23ac, 0x23ad, 0
+};
+
+/*
+ * Return the unicode character of c in the ZapfDingbats font. Most of the
+ * dingbats are in the same order in the dingbats block of unicode.
+ */
+static unsigned
+dingbats_unicode(unsigned c)
+{
+	switch (c) {
+	case 0x20: return 0x20;
+	case 0x25: return 0x260e;
+	case 0x2a: return 0x261b;
+	case 0x2b: return 0x261e;
+	case 0x48: return 0x2605;
+	case 0x6c: return 0x25cf;
+	case 0x6e: return 0x25a0;
+	case 0x73: return 0x25b2;
+	case 0x74: return 0x25bc;
+	case 0x75: return 0x25c6;
+	case 0x77: return 0x25d7;
+	case 0xa8: return 0x2663;
+	case 0xa9: return 0x2666;
+	case 0xaa: return 0x2665;
+	case 0xab: return 0x2660;
+	case 0xd5: return 0x2192;
+	case 0xd6: return 0x2194;
+	case 0xd7: return 0x2195;
+	}
+	if (c > 0x20 && c < 0x7f)
+		return 0x26e0 + c;
+	if (c >= 0xac && c <= 0xb5)
+		return 0x2460 + c - 0xac;	/* circled digits */
+	if (c > 0xa0 && c < 0xff && c != 0xf0)
+		return 0x26c0 + c;
+	return 0;
+}
+
+static unsigned
+unicode_of(const struct raster_font *f, unsigned char c)
+{
+	if (f->encoding == SYMBOL)
+		return c >= 0x20 ? symbol_unicode[c - 0x20] : 0;
+	if (f->encoding == DINGBATS)
+		return dingbats_unicode(c);
+	return c;	/* latin1 */
+}
+
+/*
+ * Find a font similar to the PostScript font n with fontconfig, and load
+ * it. Return NULL, if no font is found.
+ */
+static struct raster_font *
+load_font(int n)
+{
+	int			index, weight, slant;
+	char			family[32];
+	const char		*name, *c;
+	FcChar8			*file;
+	FcBool			embolden;
+	FcMatrix		*m;
+	FcPattern		*pat, *match;
+	FcResult		result;
+	struct raster_font	*f;
+
+	if (n < 0 || n >= MAX_FONTS)
+		return NULL;
+	f = fonts + n;
+	if (f->tried)
+		return f->face ? f : NULL;
+	f->tried = true;
+	if ((name = resources->font(n)) == NULL)
+		return NULL;
+	if (library == NULL && FT_Init_FreeType(&library)) {
+		library = NULL;
+		put_msg("Cannot initialize the FreeType library, "
+				"text omitted.");
+		return NULL;
+	}
+
+	/* Times-BoldItalic gives Times, bold and italic */
+	for (c = name; *c && *c != '-' && c - name < 31; ++c)
+		;
+	memcpy(family, name, (size_t)(c - name));
+	family[c - name] = '\0';
+	f->encoding = LATIN1;
+	if (!strcmp(family, "Symbol")) {
+		f->encoding = SYMBOL;
+	} else if (!strcmp(family, "ZapfDingbats")) {
+		f->encoding = DINGBATS;
+		strcpy(family, "Dingbats");
+	}
+	weight = strstr(name, "Bold") ? FC_WEIGHT_BOLD : FC_WEIGHT_REGULAR;
+	slant = strstr(name, "Italic") ? FC_SLANT_ITALIC :
+		(strstr(name, "Oblique") ? FC_SLANT_OBLIQUE : FC_SLANT_ROMAN);
+
+	if ((pat = FcPatternCreate()) == NULL) {
+		put_msg(Err_mem);
+		exit(EXIT_FAILURE);
+	}
+	FcPatternAddString(pat, FC_FAMILY, (const FcChar8 *)family);
+	FcPatternAddInteger(pat, FC_WEIGHT, weight);
+	FcPatternAddInteger(pat, FC_SLANT, slant);
+	FcPatternAddBool(pat, FC_OUTLINE, FcTrue);
+	FcConfigSubstitute(NULL, pat, FcMatchPattern);
+	FcDefaultSubstitute(pat);
+	match = FcFontMatch(NULL, pat, &result);
+	FcPatternDestroy(pat);
+	if (match == NULL || FcPatternGetString(match, FC_FILE, 0, &file) !=
+			FcResultMatch) {
+		put_msg("No font found for %s, text omitted.", name);
+		if (match)
+			FcPatternDestroy(match);
+		return NULL;
+	}
+	if (FcPatternGetInteger(match, FC_INDEX, 0, &index) != FcResultMatch)
+		index = 0;
+	if (FT_New_Face(library, (const char *)file, index, &f->face) ||
+			!FT_IS_SCALABLE(f->face)) {
+		put_msg("Cannot load the font %s for %s, text omitted.",
+				file, name);
+		if (f->face)
+			FT_Done_Face(f->face);
+		f->face = NULL;
+		FcPatternDestroy(match);
+		return NULL;
+	}
+
+	/* fontconfig may slant or embolden a font lacking that style */
+	f->matrix[0] = f->matrix[3] = 1.0;
+	f->matrix[1] = f->matrix[2] = 0.0;
+	if (FcPatternGetMatrix(match, FC_MATRIX, 0, &m) == FcResultMatch) {
+		f->matrix[0] = m->xx;
+		f->matrix[1] = m->yx;
+		f->matrix[2] = m->xy;
+		f->matrix[3] = m->yy;
+	}
+	f->embolden = FcPatternGetBool(match, FC_EMBOLDEN, 0, &embolden) ==
+		FcResultMatch && embolden;
+	f->unicode = !FT_Select_Charmap(f->face, FT_ENCODING_UNICODE);
+	FcPatternDestroy(match);
+	return f;
+}
+
+static int
+move_to(const FT_Vector *to, void *user)
+{
+	path_move(transform(user, (double)to->x, (double)to->y));
+	return 0;
+}
+
+static int
+line_to(const FT_Vector *to, void *user)
+{
+	path_line(transform(user, (double)to->x, (double)to->y));
+	return 0;
+}
+
+static int
+conic_to(const FT_Vector *control, const FT_Vector *to, void *user)
+{
+	struct point	p0 = cur;
+	struct point	c = transform(user, (double)control->x,
+					(double)control->y);
+	struct point	p = transform(user, (double)to->x, (double)to->y);
+	struct point	c1, c2;
+
+	c1.x = p0.x + 2.0 / 3.0 * (c.x - p0.x);
+	c1.y = p0.y + 2.0 / 3.0 * (c.y - p0.y);
+	c2.x = p.x + 2.0 / 3.0 * (c.x - p.x);
+	c2.y = p.y + 2.0 / 3.0 * (c.y - p.y);
+	path_curve(c1, c2, p);
+	return 0;
+}
+
+static int
+cubic_to(const FT_Vector *control1, const FT_Vector *control2,
+		const FT_Vector *to, void *user)
+{
+	path_curve(transform(user, (double)control1->x, (double)control1->y),
+		transform(user, (double)control2->x, (double)control2->y),
+		transform(user, (double)to->x, (double)to->y));
+	return 0;
+}
+
+static const FT_Outline_Funcs	outline_funcs = {
+	move_to, line_to, conic_to, cubic_to, 0, 0
+};
+#endif /* HAVE_FREETYPE */
+
+bool
+raster_has_fonts(void)
+{
+#ifdef HAVE_FREETYPE
+	return true;
+#else
+	return false;
+#endif
+}
+
+/* show the string s[0..len-1], with the escapes of a pdf string */
+static void
+show_text(const char *s, size_t len)
+{
+#ifdef HAVE_FREETYPE
+	size_t			i;
+	unsigned		c, code, glyph;
+	double			upem, size, tx, m[6], trm[6];
+	struct raster_font	*f;
+	FT_Face			face;
+
+	if ((f = load_font(g.font)) == NULL) {
+		omitted = true;
+		return;
+	}
+	face = f->face;
+	upem = face->units_per_EM;
+	size = g.font_size;
+	tx = 0.0;
+	path_clear();
+	for (i = 0; i < len; ++i) {
+		c = (unsigned char)s[i];
+		if (c == '\\' && i + 1 < len) {
+			c = (unsigned char)s[++i];
+			if (c >= '0' && c <= '7') {
+				int	k;
+				for (c -= '0', k = 1; k < 3 && i + 1 < len &&
+						s[i + 1] >= '0' &&
+						s[i + 1] <= '7'; ++k)
+					c = 8 * c + (unsigned)(s[++i] - '0');
+			} else if (c == 'n') {
+				c = '\n';
+			} else if (c == 'r') {
+				c = '\r';
+			} else if (c == 't') {
+				c = '\t';
+			}
+		}
+		c &= 0xff;
+
+		if (f->unicode)
+			code = unicode_of(f, (unsigned char)c);
+		else if (face->charmap && face->charmap->encoding ==
+				FT_ENCODING_MS_SYMBOL)
+			code = 0xf000 + c;
+		else
+			code = c;
+		glyph = code ? FT_Get_Char_Index(face, code) : 0;
+		if (FT_Load_Glyph(face, glyph, FT_LOAD_NO_SCALE))
+			continue;
+
+		/* font units to text space to device space */
+		m[0] = f->matrix[0] * size * g.hscale / upem;
+		m[1] = f->matrix[1] * size / upem;
+		m[2] = f->matrix[2] * size * g.hscale / upem;
+		m[3] = f->matrix[3] * size / upem;
+		m[4] = tx;
+		m[5] = 0.0;
+		concat(trm, m, tm);
+		concat(trm, trm, g.ctm);
+		if (glyph && face->glyph->format == FT_GLYPH_FORMAT_OUTLINE) {
+			if (f->embolden)
+				FT_Outline_Embolden(&face->glyph->outline,
+						face->units_per_EM / 24);
+			FT_Outline_Decompose(&face->glyph->outline,
+					&outline_funcs, trm);
+		}
+		tx += face->glyph->metrics.horiAdvance * size * g.hscale /
+			upem;
+	}
+	add_path_edges();
+	paint_edges(false, g.fill);
+	path_clear();
+
+	/* move to the end of the string */
+	m[0] = m[3] = 1.0;
+	m[1] = m[2] = m[5] = 0.0;
+	m[4] = tx;
+	concat(tm, m, tm);
+#else
+	static bool	warned = false;
+
+	(void)s;
+	(void)len;
+	omitted = true;
+	if (!warned) {
+		put_msg("This fig2dev is compiled without FreeType, "
+				"text omitted.");
+		warned = true;
+	}
+#endif /* HAVE_FREETYPE */
+}
+
+static void
+free_fonts(void)
+{
+#ifdef HAVE_FREETYPE
+	int	i;
+
+	for (i = 0; i < MAX_FONTS; ++i) {
+		if (fonts[i].face)
+			FT_Done_Face(fonts[i].face);
+		fonts[i].face = NULL;
+		fonts[i].tried = false;
+	}
+	if (library)
+		FT_Done_FreeType(library);
+	library = NULL;
+#endif
+}
+
+
+/*******************************/
+/* the content interpreter     */
+/*******************************/
+
+enum operand_type { NUMBER, NAME, STRING, ARRAY };
+
+struct operand {
+	enum operand_type	type;
+	double			num;
+	const char		*s;	/* names and strings */
+	size_t			len;
+};
+
+static bool
+is_delimiter(char c)
+{
+	return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '/' ||
+		c == '(' || c == ')' || c == '[' || c == ']' || c == '%' ||
+		c == '<' || c == '>';
+}
+
+/* parse a number, without reading beyond end */
+static const char *
+parse_number(const char *p, const char *end, double *num)
+{
+	double	v = 0.0, f = 0.1;
+	bool	neg = false;
+
+	if (*p == '-' || *p == '+')
+		neg = *p++ == '-';
+	while (p < end && *p >= '0' && *p <= '9')
+		v = 10.0 * v + (*p++ - '0');
+	if (p < end && *p == '.')
+		for (++p; p < end && *p >= '0' && *p <= '9'; f /= 10.0)
+			v += f * (*p++ - '0');
+	*num = neg ? -v : v;
+	return p;
+}
+
+/* the number n of the name /Xn, with the prefix X */
+static int
+name_number(const struct operand *o, const char *prefix)
+{
+	size_t	len = strlen(prefix);
+
+	if (o->type != NAME || o->len <= len || strncmp(o->s, prefix, len))
+		return -1;
+	return atoi(o->s + len);
+}
+
+static void
+execute(const char *op, size_t oplen, struct operand *o, int n,
+		const double *arr, int narr)
+{
+	int	i;
+	char	name[4];
+	double	m[6];
+
+	if (oplen >= sizeof name)
+		return;
+	memcpy(name, op, oplen);
+	name[oplen] = '\0';
+	/* all operands must be numbers, except for those of a few operators */
+	for (i = 0; i < n; ++i)
+		if (o[i].type != NUMBER && strcmp(name, "Tf") &&
+				strcmp(name, "Do") && strcmp(name, "scn") &&
+				strcmp(name, "cs") && strcmp(name, "Tj") &&
+				strcmp(name, "d"))
+			return;
+#define NUM(i)	(o[i].num)
+
+	if (!strcmp(name, "m") && n == 2) {
+		path_move(transform(g.ctm, NUM(0), NUM(1)));
+	} else if (!strcmp(name, "l") && n == 2) {
+		path_line(transform(g.ctm, NUM(0), NUM(1)));
+	} else if (!strcmp(name, "c") && n == 6) {
+		path_curve(transform(g.ctm, NUM(0), NUM(1)),
+				transform(g.ctm, NUM(2), NUM(3)),
+				transform(g.ctm, NUM(4), NUM(5)));
+	} else if (!strcmp(name, "h")) {
+		path_close();
+	} else if (!strcmp(name, "re") && n == 4) {
+		path_move(transform(g.ctm, NUM(0), NUM(1)));
+		path_line(transform(g.ctm, NUM(0) + NUM(2), NUM(1)));
+		path_line(transform(g.ctm, NUM(0) + NUM(2), NUM(1) + NUM(3)));
+		path_line(transform(g.ctm, NUM(0), NUM(1) + NUM(3)));
+		path_close();
+	} else if (!strcmp(name, "S")) {
+		stroke();
+		end_path();
+	} else if (!strcmp(name, "f") || !strcmp(name, "F") ||
+			!strcmp(name, "f*")) {
+		fill(name[1] == '*');
+		end_path();
+	} else if (!strcmp(name, "B") || !strcmp(name, "B*")) {
+		fill(name[1] == '*');
+		stroke();
+		end_path();
+	} else if (!strcmp(name, "n")) {
+		end_path();
+	} else if (!strcmp(name, "W") || !strcmp(name, "W*")) {
+		pending_clip = name[1] == '*' ? 2 : 1;
+	} else if (!strcmp(name, "q")) {
+		stack = grow(stack, &size_stack, nstack + 1,
+				sizeof(struct gstate));
+		stack[nstack++] = g;
+		g.own_clip = false;
+	} else if (!strcmp(name, "Q")) {
+		if (nstack > 0) {
+			if (g.own_clip)
+				free(g.clip);
+			g = stack[--nstack];
+		}
+	} else if (!strcmp(name, "cm") && n == 6) {
+		for (i = 0; i < 6; ++i)
+			m[i] = NUM(i);
+		concat(g.ctm, m, g.ctm);
+	} else if (!strcmp(name, "w") && n == 1) {
+		g.lw = NUM(0);
+	} else if (!strcmp(name, "J") && n == 1) {
+		g.cap = (int)NUM(0);
+	} else if (!strcmp(name, "j") && n == 1) {
+		g.join = (int)NUM(0);
+	} else if (!strcmp(name, "M") && n == 1) {
+		g.miter = NUM(0);
+	} else if (!strcmp(name, "d") && n == 2 && o[0].type == ARRAY) {
+		g.ndash = narr;
+		memcpy(g.dash, arr, (size_t)narr * sizeof(double));
+		g.dash_phase = NUM(1);
+	} else if (!strcmp(name, "rg") && n == 3) {
+		for (i = 0; i < 3; ++i)
+			g.fill[i] = NUM(i);
+		g.pattern = 0;
+	} else if (!strcmp(name, "RG") && n == 3) {
+		for (i = 0; i < 3; ++i)
+			g.stroke[i] = NUM(i);
+	} else if (!strcmp(name, "g") && n == 1) {
+		g.fill[0] = g.fill[1] = g.fill[2] = NUM(0);
+		g.pattern = 0;
+	} else if (!strcmp(name, "G") && n == 1) {
+		g.stroke[0] = g.stroke[1] = g.stroke[2] = NUM(0);
+	} else if (!strcmp(name, "scn") && (n == 2 || n == 4)) {
+		/* a pattern, with one gray or three rgb components */
+		if (n == 2)
+			g.fill[0] = g.fill[1] = g.fill[2] = NUM(0);
+		else
+			for (i = 0; i < 3; ++i)
+				g.fill[i] = NUM(i);
+		g.pattern = name_number(o + n - 1, "P");
+		if (g.pattern < 0)
+			g.pattern = 0;
+	} else if (!strcmp(name, "BT")) {
+		tm[0] = tm[3] = 1.0;
+		tm[1] = tm[2] = tm[4] = tm[5] = 0.0;
+		memcpy(tlm, tm, sizeof tlm);
+	} else if (!strcmp(name, "Tf") && n == 2 && o[1].type == NUMBER) {
+		g.font = name_number(o, "F");
+		g.font_size = NUM(1);
+	} else if (!strcmp(name, "Tz") && n == 1) {
+		g.hscale = NUM(0) / 100.0;
+	} else if (!strcmp(name, "Tm") && n == 6) {
+		for (i = 0; i < 6; ++i)
+			tm[i] = tlm[i] = NUM(i);
+	} else if (!strcmp(name, "Td") && n == 2) {
+		m[0] = m[3] = 1.0;
+		m[1] = m[2] = 0.0;
+		m[4] = NUM(0);
+		m[5] = NUM(1);
+		concat(tlm, m, tlm);
+		memcpy(tm, tlm, sizeof tm);
+	} else if (!strcmp(name, "Tj") && n == 1 && o[0].type == STRING) {
+		show_text(o[0].s, o[0].len);
+	} else if (!strcmp(name, "Do") && n == 1) {
+		const F_pic	*pic;
+
+		if ((i = name_number(o, "Im")) > 0 &&
+				(pic = resources->image(i)) != NULL)
+			draw_image(pic);
+	}
+	/* other operators, e.g., cs and ET, need not be interpreted */
+#undef NUM
+}
+
+static void
+interpret(const char *s, size_t len)
+{
+	int		n = 0, narr = 0;
+	double		arr[MAX_DASH];
+	const char	*p = s, *q, *end = s + len;
+	struct operand	o[MAX_OPERANDS];
+
+	while (p < end) {
+		if (n == MAX_OPERANDS)
+			n = 0;		/* not a valid content stream */
+		switch (*p) {
+		case ' ': case '\n': case '\r': case '\t':
+			++p;
+			break;
+		case '%':
+			while (p < end && *p != '\n')
+				++p;
+			break;
+		case '/':
+			for (q = ++p; p < end && !is_delimiter(*p); ++p)
+				;
+			o[n].type = NAME;
+			o[n].s = q;
+			o[n++].len = (size_t)(p - q);
+			break;
+		case '(':
+			{
+				int	depth = 1;
+
+				for (q = ++p; p < end; ++p) {
+					if (*p == '\\')
+						++p;
+					else if (*p == '(')
+						++depth;
+					else if (*p == ')' && --depth == 0)
+						break;
+				}
+				if (p > end)
+					p = end;
+				o[n].type = STRING;
+				o[n].s = q;
+				o[n++].len = (size_t)(p - q);
+				if (p < end)
+					++p;
+			}
+			break;
+		case '[':
+			for (++p, narr = 0; p < end && *p != ']';) {
+				if ((*p >= '0' && *p <= '9') || *p == '.' ||
+						*p == '-' || *p == '+') {
+					double	v;
+					p = parse_number(p, end, &v);
+					if (narr < MAX_DASH)
+						arr[narr++] = v;
+				} else {
+					++p;
+				}
+			}
+			if (p < end)
+				++p;
+			o[n].type = ARRAY;
+			o[n++].num = 0.0;
+			break;
+		default:
+			if ((*p >= '0' && *p <= '9') || *p == '.' ||
+					*p == '-' || *p == '+') {
+				o[n].type = NUMBER;
+				p = parse_number(p, end, &o[n++].num);
+			} else {
+				for (q = p; p < end && !is_delimiter(*p); ++p)
+					;
+				if (p == q) {
+					++p;	/* e.g., < or > */
+					break;
+				}
+				execute(q, (size_t)(p - q), o, n, arr, narr);
+				n = 0;
+			}
+			break;
+		}
+	}
+}
+
+/*
+ * Render the content content[0..len-1] into r, which must hold the
+ * background. The matrix ctm maps user space to the pixels of r.
+ * Return -1, if some text could not be drawn, otherwise 0.
+ */
+int
+raster_render(struct raster *r, const double ctm[6], int samples,
+		const char *content, size_t len,
+		const struct raster_resources *res)
+{
+	canvas = r;
+	W = r->width;
+	H = r->height;
+	ss = samples < 1 ? 1 : samples;
+	resources = res;
+
+	if ((cov = calloc((size_t)W + 2, sizeof(int))) == NULL ||
+			(diff = calloc((size_t)W + 2, sizeof(int))) == NULL) {
+		put_msg(Err_mem);
+		exit(EXIT_FAILURE);
+	}
+	memset(&g, 0, sizeof g);
+	memcpy(g.ctm, ctm, sizeof g.ctm);
+	g.lw = 1.0;
+	g.miter = 10.0;
+	g.hscale = 1.0;
+	g.font = -1;
+	nstack = 0;
+	path_clear();
+	pending_clip = 0;
+	omitted = false;
+
+	interpret(content, len);
+
+	while (nstack > 0) {
+		if (g.own_clip)
+			free(g.clip);
+		g = stack[--nstack];
+	}
+	if (g.own_clip)
+		free(g.clip);
+	free_fonts();
+	free(stack);
+	free(pts);
+	free(subs);
+	free(edges);
+	free(active);
+	free(crossings);
+	free(cov);
+	free(diff);
+	stack = NULL;
+	pts = NULL;
+	subs = NULL;
+	edges = NULL;
+	active = NULL;
+	crossings = NULL;
+	size_stack = size_pts = size_subs = size_edges = size_active = 0;
+	npts = nsubs = nedges = 0;
+	return omitted ? -1 : 0;
+}
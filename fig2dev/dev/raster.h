@@ -0,0 +1,58 @@
+/*
+ * Fig2dev: Translate Fig code to various Devices
+ * Copyright (c) 1991 by Micah Beck
+ * Parts Copyright (c) 1985-1988 by Supoj Sutanthavibul
+ * Parts Copyright (c) 1989-2015 by Brian V. Smith
+ * Parts Copyright (c) 2015-2024 by Thomas Loimer
+ *
+ * Any party obtaining a copy of these files is granted, free of charge, a
+ * full and unrestricted irrevocable, world-wide, paid up, royalty-free,
+ * nonexclusive right and license to deal in this software and documentation
+ * files (the "Software"), including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense and/or sell copies
+ * of the Software, and to permit persons who receive copies from any such
+ * party to do so, with the only requirement being that the above copyright
+ * and this permission notice remain intact.
+ *
+ */
+
+/*
+ * raster.h: render pdf page content into a pixel buffer, see raster.c.
+ */
+
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <stddef.h>
+
+#include "bool.h"
+#include "object.h"
+
+/* an rgb image, three bytes per pixel, stored row by row from the top */
+struct raster {
+	int		width;
+	int		height;
+	unsigned char	*pixels;
+};
+
+/*
+ * The resources referenced by the content. The pattern /Pn, the image /Imn
+ * and the font /Fn are looked up by their number n.
+ */
+struct raster_resources {
+	/* the cell content of pattern n, its width and height */
+	const char	*(*pattern)(int n, int *w, int *h, size_t *len);
+	/* the decoded picture of image n */
+	const F_pic	*(*image)(int n);
+	/* the PostScript name of font n */
+	const char	*(*font)(int n);
+	/* the matrix from pattern space to the device */
+	double		pattern_matrix[6];
+};
+
+extern bool	raster_has_fonts(void);
+extern int	raster_render(struct raster *r, const double ctm[6],
+				int samples, const char *content, size_t len,
+				const struct raster_resources *res);
+
+#endif /* RASTER_H */
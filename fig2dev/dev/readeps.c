@@ -34,6 +34,7 @@
 #include "fig2dev.h"	/* includes bool.h and object.h */
 //#include "object.h"
 #include "messages.h"
+#include "probe.h"
 #include "readpics.h"
 
 int	read_eps(F_pic *pic, struct xfig_stream *restrict pic_stream,
@@ -367,41 +368,20 @@ read_eps(F_pic *pic, struct xfig_stream *restrict pic_stream, int *llx,int *lly)
 static int
 has_pdftops(void)
 {
-	static int	res = -1;
-	if (res != -1)
-		return res;
-	if (system("pdftops -v 2>/dev/null"))
-		res = 0;
-	else
-		res = 1;
-	return res;
+	return probe_command("pdftops -v 2>/dev/null");
 }
 
 static int
 has_pdftocairo(void)
 {
-	static int	res = -1;
-	if (res != -1)
-		return res;
-	if (system("pdftocairo -v 2>/dev/null"))
-		res = 0;
-	else
-		res = 1;
-	return res;
+	return probe_command("pdftocairo -v 2>/dev/null");
 }
 
 #ifdef GSEXE
 static int
 has_gs(void)
 {
-	static int	res = -1;
-	if (res != -1)
-		return res;
-	if (system(GSEXE " -v >/dev/null"))
-		res = 0;
-	else
-		res = 1;
-	return res;
+	return probe_command(GSEXE " -v >/dev/null");
 }
 #endif
 
@@ -19,6 +19,9 @@
 /*
  * readgif.c: import gif into PostScript
  *
+ * The image data is decoded here. Only if that fails, the gif file is
+ * converted to pcx with an external program.
+ *
  */
 
 /* Some of the following code is extracted from giftoppm.c,
@@ -47,13 +50,18 @@
 
 #include "fig2dev.h"	/* includes "bool.h" */
 #include "object.h"
+#include "colors.h"	/* rgb2luminance() */
 #include "messages.h"
+#include "probe.h"
 #include "readpics.h"
 #include "xtmpfile.h"
 
 extern	int	 _read_pcx(FILE *pcxfile, F_pic *pic);		/* readpcx.c */
 
 #define LOCALCOLORMAP		0x80
+#define INTERLACE		0x40
+#define MAX_LZW_BITS		12
+#define MAX_LZW_CODES		(1 << MAX_LZW_BITS)
 #define	ReadOK(file,buffer,len)	(fread(buffer, len, 1, file) != 0)
 #define BitSet(byte, bit)	(((byte) & (bit)) == (bit))
 
@@ -80,6 +88,10 @@ static bool	 ReadColorMap(FILE *, unsigned int,
 				unsigned char cmap[3][MAXCOLORMAPSIZE]);
 static bool	 DoGIFextension(FILE *, struct _Gif89 *, int);
 static int	 GetDataBlock(FILE *, unsigned char *);
+static bool	 ReadImage(FILE *, unsigned char *, unsigned int, unsigned int,
+				bool);
+static int	 gif_to_pcx(F_pic *, struct xfig_stream *restrict,
+				unsigned char [3]);
 
 /* return codes:  1 : success
 		  0 : invalid file
@@ -89,46 +101,22 @@ int
 read_gif(F_pic *pic, struct xfig_stream *restrict pic_stream, int *llx,int *lly)
 {
 	char		buf[BUFSIZ];
-	char		pcxname_buf[128] = "f2dpcxXXXXXX";
-	char		*pcxname = pcxname_buf;
-	char		*cmd = buf;
-	static char	*cmd_fmt = NULL;
-	int		 i, stat;
+	int		 i;
 	int		 useGlobalColormap;
-	unsigned int	 bitPixel;
+	bool		 haveColormap = false;
+	bool		 interlace;
+	unsigned int	 bitPixel = 0;
+	unsigned int	 width, height;
 	unsigned char	 c;
-	size_t		size;
+	unsigned char	*desc = (unsigned char *)buf;
 	char		 version[4];
 	unsigned char    transp[3]; /* RGB of transparent color (if any) */
-	FILE		*pcx;
-	FILE		*giftopcx;
 	struct _Gif89	Gif89 = { -1, -1, -1, 0};
 	struct _GifScreen	GifScreen;
 
 	if (!rewind_stream(pic_stream))
 		return 0;
 
-	/* command string to convert gif to pcx */
-
-	if (cmd_fmt == NULL) {
-		if (!system("{ giftopnm -version && ppmtopcx -version; } "
-								"2>/dev/null"))
-			cmd_fmt = "giftopnm -quiet | ppmtopcx -quiet >'%s'";
-		else if (!system("convert -version >/dev/null"))
-			cmd_fmt = "convert - pcx:'%s'";
-		else if (!system("gm -version >/dev/null"))
-			cmd_fmt = "gm convert - pcx:'%s'";
-		else {
-			cmd_fmt = "";
-			put_msg("Cannot read gif files.\n"
-	"To read gif files, install either the netpbm, or the imagemagick,\n"
-	"or the graphicsmagick package.");
-			return 0;
-		}
-	}
-	if (*cmd_fmt == '\0')
-		return 0;
-
 	*llx = *lly = 0;
 
 	/* first read header to look for any transparent color extension */
@@ -152,8 +140,8 @@ read_gif(F_pic *pic, struct xfig_stream *restrict pic_stream, int *llx,int *lly)
 		return 0;		/* failed to read screen descriptor */
 	}
 
-	GifScreen.Width           = LM_to_uint(buf[0],buf[1]);
-	GifScreen.Height          = LM_to_uint(buf[2],buf[3]);
+	GifScreen.Width           = LM_to_uint(desc[0],desc[1]);
+	GifScreen.Height          = LM_to_uint(desc[2],desc[3]);
 	GifScreen.BitPixel        = 2<<(buf[4]&0x07);
 	GifScreen.ColorResolution = (((((int)buf[4])&0x70)>>3)+1);
 	GifScreen.Background      = (unsigned int) buf[5];
@@ -164,6 +152,8 @@ read_gif(F_pic *pic, struct xfig_stream *restrict pic_stream, int *llx,int *lly)
 								pic->cmap)) {
 			return 0;	/* error reading global colormap */
 		}
+		haveColormap = true;
+		bitPixel = GifScreen.BitPixel;
 	}
 
 	/* assume no transparent color for now */
@@ -175,7 +165,7 @@ read_gif(F_pic *pic, struct xfig_stream *restrict pic_stream, int *llx,int *lly)
 		}
 
 		if (c == ';') {		/* GIF terminator, finish up */
-			break;		/* all done */
+			return 0;	/* no image in the file */
 		}
 
 		if (c == '!') {		/* Extension */
@@ -196,19 +186,20 @@ read_gif(F_pic *pic, struct xfig_stream *restrict pic_stream, int *llx,int *lly)
 
 		useGlobalColormap = ! BitSet(buf[8], LOCALCOLORMAP);
 
-		bitPixel = 1<<((buf[8]&0x07)+1);
-
 		if (! useGlobalColormap) {
+		    bitPixel = 1<<((buf[8]&0x07)+1);
 		    if (!ReadColorMap(pic_stream->fp, bitPixel, pic->cmap)) {
 			fprintf(stderr, "error reading local GIF colormap\n");
 			return 0;
 		    }
+		    haveColormap = true;
 		}
 		break;			/* image starts here, header is done */
 	}
 
-	/* output PostScript comment */
-	fprintf(tfp, "%% Originally from a GIF File: %s\n\n", pic->file);
+	width = LM_to_uint(desc[4],desc[5]);
+	height = LM_to_uint(desc[6],desc[7]);
+	interlace = BitSet(buf[8], INTERLACE);
 
 	/* save transparent indicator */
 	if (Gif89.transparent != -1) {
@@ -222,6 +213,186 @@ read_gif(F_pic *pic, struct xfig_stream *restrict pic_stream, int *llx,int *lly)
 		pic->num_transp = NO_TRANSPARENCY;
 	}
 
+	/* decode the image data in-process, if possible */
+	if (haveColormap && width > 0 && height > 0 &&
+			(pic->bitmap = malloc((size_t)width * height)) != NULL) {
+		if (ReadImage(pic_stream->fp, pic->bitmap, width, height,
+								interlace)) {
+			pic->subtype = P_GIF;
+			pic->numcols = bitPixel;
+			pic->bit_size.x = width;
+			pic->bit_size.y = height;
+			if (grayonly)
+				for (i = 0; i < pic->numcols; ++i)
+					pic->cmap[RED][i] = pic->cmap[GREEN][i]
+						= pic->cmap[BLUE][i] =
+					(int)(rgb2luminance(
+						pic->cmap[RED][i] / 255.0,
+						pic->cmap[GREEN][i] / 255.0,
+						pic->cmap[BLUE][i] / 255.0)
+						* 255.0);
+			return 1;
+		}
+		free(pic->bitmap);
+		pic->bitmap = NULL;
+	}
+
+	/* otherwise, convert the file to pcx with an external program */
+	return gif_to_pcx(pic, pic_stream, transp);
+}
+
+/*
+ * Decode the LZW-compressed raster data of a gif image into one byte per
+ * pixel. The stream must be positioned at the initial code size. Return
+ * false, if the data is corrupt or incomplete.
+ */
+static bool
+ReadImage(FILE *fd, unsigned char *image, unsigned int width,
+		unsigned int height, bool interlace)
+{
+	static const unsigned int	start[4] = {0, 4, 2, 1};
+	static const unsigned int	step[4] = {8, 8, 4, 2};
+	unsigned char	block[256];
+	unsigned short	prefix[MAX_LZW_CODES];
+	unsigned char	suffix[MAX_LZW_CODES];
+	unsigned char	stack[MAX_LZW_CODES + 1];
+	unsigned char	first = 0;
+	unsigned long	bits = 0;
+	int		nbits = 0;
+	int		count = 0, pos = 0;
+	int		c, min_size, code_size, clear, eoi, next, old, code, in;
+	int		sp;
+	unsigned int	x = 0, y = 0, pass = 0;
+	size_t		npix = 0;
+	size_t		total = (size_t)width * height;
+
+	if ((c = getc(fd)) == EOF || c < 1 || c > 8)
+		return false;
+	min_size = c;
+	clear = 1 << min_size;
+	eoi = clear + 1;
+	for (code = 0; code < clear; ++code) {
+		prefix[code] = 0;
+		suffix[code] = (unsigned char)code;
+	}
+	code_size = min_size + 1;
+	next = clear + 2;
+	old = -1;
+
+	while (npix < total) {
+		/* fetch the next code, least significant bit first */
+		while (nbits < code_size) {
+			if (pos == count) {
+				if ((count = GetDataBlock(fd, block)) <= 0)
+					return false;
+				pos = 0;
+			}
+			bits |= (unsigned long)block[pos++] << nbits;
+			nbits += 8;
+		}
+		code = (int)(bits & ((1UL << code_size) - 1));
+		bits >>= code_size;
+		nbits -= code_size;
+
+		if (code == clear) {
+			code_size = min_size + 1;
+			next = clear + 2;
+			old = -1;
+			continue;
+		}
+		if (code == eoi)
+			break;
+
+		sp = 0;
+		if (old == -1) {
+			if (code >= clear)
+				return false;
+			first = (unsigned char)code;
+			stack[sp++] = first;
+			old = code;
+		} else {
+			in = code;
+			if (code > next || (code == next && next >= MAX_LZW_CODES))
+				return false;
+			if (code == next) {	/* the KwKwK case */
+				stack[sp++] = first;
+				code = old;
+			}
+			while (code >= clear) {
+				stack[sp++] = suffix[code];
+				code = prefix[code];
+			}
+			first = (unsigned char)code;
+			stack[sp++] = first;
+			if (next < MAX_LZW_CODES) {
+				prefix[next] = (unsigned short)old;
+				suffix[next] = first;
+				if (++next == 1 << code_size &&
+						code_size < MAX_LZW_BITS)
+					++code_size;
+			}
+			old = in;
+		}
+
+		/* write the decoded string */
+		while (sp > 0 && npix < total) {
+			image[(size_t)y * width + x] = stack[--sp];
+			++npix;
+			if (++x == width) {
+				x = 0;
+				if (interlace) {
+					y += step[pass];
+					while (y >= height && pass < 3)
+						y = start[++pass];
+				} else {
+					++y;
+				}
+			}
+		}
+	}
+
+	return npix == total;
+}
+
+/*
+ * Convert the gif file to pcx with giftopnm and ppmtopcx, or with
+ * ImageMagick or GraphicsMagick, and read the pcx file.
+ */
+static int
+gif_to_pcx(F_pic *pic, struct xfig_stream *restrict pic_stream,
+		unsigned char transp[3])
+{
+	char		buf[BUFSIZ];
+	char		pcxname_buf[128] = "f2dpcxXXXXXX";
+	char		*pcxname = pcxname_buf;
+	char		*cmd = buf;
+	static char	*cmd_fmt = NULL;
+	int		 i, stat;
+	size_t		size;
+	FILE		*pcx;
+	FILE		*giftopcx;
+
+	/* command string to convert gif to pcx */
+
+	if (cmd_fmt == NULL) {
+		if (probe_command("{ giftopnm -version && ppmtopcx -version; }"
+								" 2>/dev/null"))
+			cmd_fmt = "giftopnm -quiet | ppmtopcx -quiet >'%s'";
+		else if (probe_command("convert -version >/dev/null"))
+			cmd_fmt = "convert - pcx:'%s'";
+		else if (probe_command("gm -version >/dev/null"))
+			cmd_fmt = "gm convert - pcx:'%s'";
+		else {
+			cmd_fmt = "";
+			put_msg("Cannot read gif file '%s'.\n"
+	"To read this gif file, install either the netpbm, or the imagemagick,\n"
+	"or the graphicsmagick package.", pic_stream->name);
+			return 0;
+		}
+	}
+	if (*cmd_fmt == '\0')
+		return 0;
+
 	/* create a temporary file */
 	if ((pcx = xtmpfile(&pcxname, sizeof pcxname_buf)) == NULL) {
 		if (pcxname != pcxname_buf)
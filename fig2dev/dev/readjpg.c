@@ -119,14 +119,24 @@ read_jpg(F_pic *pic, struct xfig_stream *restrict pic_stream, int *llx,int *lly)
 	pic->bit_size.x = image.width;
 	pic->bit_size.y = image.height;
 
-	/* output PostScript comment */
-	fprintf(tfp, "%% Begin Imported JPEG File: %s\n\n", pic->file);
-
 	/* number of colors, size and bitmap is put in by read_JPEG_file() */
 	pic->subtype = P_JPEG;
 	return 1;			/* all ok */
 }
 
+/*
+ * Return the number of color components of the jpeg file analyzed by
+ * read_jpg() and its bits per component. Set *inverted, if the colors of a
+ * cmyk image are inverted, as in files produced by Adobe Photoshop.
+ */
+int
+JPEGcomponents(int *bits_per_component, bool *inverted)
+{
+	*bits_per_component = image.bits_per_component;
+	*inverted = image.adobe && image.components == 4;
+	return image.components;
+}
+
 /* here's where we read the rest of the jpeg file and format for PS */
 void
 JPEGtoPS(FILE *f, FILE *PSfile) {
@@ -94,7 +94,6 @@ _read_pcx(FILE *pcxfile, F_pic *pic)
 	byte		 inbyte,inbyte2;
 	int		 real_bpp;		/* how many bpp file really is */
 
-	fprintf(tfp, "%% Begin Imported PCX File: %s\n\n", pic->file);
 	pic->subtype = P_PCX;
 
 	fread(&header,1,sizeof(struct pcxhed),pcxfile);
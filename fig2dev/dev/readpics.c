@@ -32,6 +32,15 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#ifdef HAVE_ZLIB_H
+#include <zlib.h>
+#endif
+#ifdef HAVE_BZLIB_H
+#include <bzlib.h>
+#endif
+#ifdef HAVE_LZMA_H
+#include <lzma.h>
+#endif
 
 #include "messages.h"
 #include "xtmpfile.h"
@@ -44,6 +53,8 @@ init_stream(struct xfig_stream *restrict xf_stream)
 	xf_stream->name = xf_stream->name_buf;
 	xf_stream->name_on_disk = xf_stream->name_on_disk_buf;
 	xf_stream->uncompress = NULL;
+	xf_stream->buf = NULL;
+	xf_stream->buf_len = 0;
 	xf_stream->content = xf_stream->content_buf;
 	*xf_stream->content = '\0';
 }
@@ -69,6 +80,9 @@ free_stream(struct xfig_stream *restrict xf_stream)
 		free(xf_stream->name_on_disk);
 		xf_stream->name_on_disk = xf_stream->name_on_disk_buf;
 	}
+	free(xf_stream->buf);
+	xf_stream->buf = NULL;
+	xf_stream->buf_len = 0;
 }
 
 /*
@@ -191,11 +205,12 @@ file_on_disk(char *restrict name, char **restrict found, size_t len,
 }
 
 /*
- * Return a file stream, either to a pipe or to a regular file.
- * If xf_stream->uncompress[0] == '\0', it is a regular file, otherwise a pipe.
+ * Find the file on disk for name, but do not open it. Set xf_stream->name,
+ * xf_stream->name_on_disk and xf_stream->uncompress.
+ * Return 0 on success, -1 on failure.
  */
-FILE *
-open_stream(char *restrict name, struct xfig_stream *restrict xf_stream)
+int
+find_stream(char *restrict name, struct xfig_stream *restrict xf_stream)
 {
 	size_t	len;
 
@@ -205,21 +220,246 @@ open_stream(char *restrict name, struct xfig_stream *restrict xf_stream)
 		if (len >= sizeof xf_stream->name_buf) {
 			if ((xf_stream->name = malloc(len + 1)) == NULL) {
 				put_msg(Err_mem);
-				return NULL;
+				return -1;
 			}
 		}
 		memcpy(xf_stream->name, name, len + 1);
 	}
 
+	/* the stream may be re-opened, see rewind_stream() */
+	if (xf_stream->name_on_disk != xf_stream->name_on_disk_buf) {
+		free(xf_stream->name_on_disk);
+		xf_stream->name_on_disk = xf_stream->name_on_disk_buf;
+	}
+
 	if (file_on_disk(name, &xf_stream->name_on_disk,
 				sizeof xf_stream->name_on_disk_buf,
 				&xf_stream->uncompress)) {
 
 		free_stream(xf_stream);
-		return NULL;
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Make room for at least one more byte in the output buffer *out of size
+ * *size. Return 0 on success, -1 on failure.
+ */
+static int
+grow_buf(unsigned char **out, size_t *size)
+{
+	unsigned char	*p;
+	size_t		n = *size ? 2 * *size : BUFSIZ;
+
+	if (n < *size || (p = realloc(*out, n)) == NULL)
+		return -1;
+	*out = p;
+	*size = n;
+	return 0;
+}
+
+#ifdef HAVE_ZLIB_H
+/* uncompress gzip data, possibly several concatenated members */
+static int
+gunzip_buf(unsigned char *in, size_t in_len, unsigned char **out,
+		size_t *out_len)
+{
+	int		ret = Z_MEM_ERROR;
+	size_t		size = 0;
+	z_stream	z;
+
+	z.zalloc = Z_NULL;
+	z.zfree = Z_NULL;
+	z.opaque = Z_NULL;
+	z.next_in = in;
+	z.avail_in = (uInt)in_len;
+	if (z.avail_in != in_len || inflateInit2(&z, 15 + 16) != Z_OK)
+		return -1;
+
+	*out_len = 0;
+	do {
+		if (*out_len == size && grow_buf(out, &size))
+			break;
+		z.next_out = *out + *out_len;
+		z.avail_out = (uInt)(size - *out_len);
+		ret = inflate(&z, Z_NO_FLUSH);
+		*out_len = size - z.avail_out;
+		/* another gzip member may follow */
+		if (ret == Z_STREAM_END && z.avail_in > 1 &&
+				z.next_in[0] == 0x1f && z.next_in[1] == 0x8b)
+			ret = inflateReset(&z);
+	} while (ret == Z_OK);
+	inflateEnd(&z);
+
+	return ret == Z_STREAM_END ? 0 : -1;
+}
+#endif /* HAVE_ZLIB_H */
+
+#ifdef HAVE_BZLIB_H
+/* uncompress bzip2 data, possibly several concatenated streams */
+static int
+bunzip2_buf(unsigned char *in, size_t in_len, unsigned char **out,
+		size_t *out_len)
+{
+	int		ret = BZ_MEM_ERROR;
+	size_t		size = 0;
+	bz_stream	b;
+
+	b.bzalloc = NULL;
+	b.bzfree = NULL;
+	b.opaque = NULL;
+	b.next_in = (char *)in;
+	b.avail_in = (unsigned)in_len;
+	if (b.avail_in != in_len || BZ2_bzDecompressInit(&b, 0, 0) != BZ_OK)
+		return -1;
+
+	*out_len = 0;
+	do {
+		if (*out_len == size && grow_buf(out, &size))
+			break;
+		b.next_out = (char *)*out + *out_len;
+		b.avail_out = (unsigned)(size - *out_len);
+		ret = BZ2_bzDecompress(&b);
+		*out_len = size - b.avail_out;
+		if (ret == BZ_STREAM_END && b.avail_in > 2 &&
+				!memcmp(b.next_in, "BZh", 3)) {
+			BZ2_bzDecompressEnd(&b);
+			ret = BZ2_bzDecompressInit(&b, 0, 0);
+		}
+	} while (ret == BZ_OK && (b.avail_in > 0 || b.avail_out == 0));
+	BZ2_bzDecompressEnd(&b);
+
+	return ret == BZ_STREAM_END ? 0 : -1;
+}
+#endif /* HAVE_BZLIB_H */
+
+#ifdef HAVE_LZMA_H
+/* uncompress xz data, possibly several concatenated streams */
+static int
+unxz_buf(unsigned char *in, size_t in_len, unsigned char **out,
+		size_t *out_len)
+{
+	lzma_ret	ret = LZMA_MEM_ERROR;
+	size_t		size = 0;
+	lzma_stream	x = LZMA_STREAM_INIT;
+
+	if (lzma_stream_decoder(&x, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+		return -1;
+	x.next_in = in;
+	x.avail_in = in_len;
+
+	*out_len = 0;
+	do {
+		if (*out_len == size && grow_buf(out, &size))
+			break;
+		x.next_out = *out + *out_len;
+		x.avail_out = size - *out_len;
+		ret = lzma_code(&x, LZMA_FINISH);
+		*out_len = size - x.avail_out;
+	} while (ret == LZMA_OK);
+	lzma_end(&x);
+
+	return ret == LZMA_STREAM_END ? 0 : -1;
+}
+#endif /* HAVE_LZMA_H */
+
+/*
+ * Uncompress the file xf_stream->name_on_disk into xf_stream->buf, if it
+ * is compressed with gzip, bzip2 or xz and the respective library is
+ * available. Return 0 on success, -1 otherwise.
+ */
+static int
+uncompress_buf(struct xfig_stream *restrict xf_stream)
+{
+	int		ret = -1;
+	int		(*uncompress)(unsigned char *, size_t,
+					unsigned char **, size_t *) = NULL;
+	size_t		in_len;
+	unsigned char	*in;
+	unsigned char	*out = NULL;
+	struct stat	st;
+	FILE		*f;
+
+	if ((f = fopen(xf_stream->name_on_disk, "rb")) == NULL)
+		return -1;
+	if (fstat(fileno(f), &st) || st.st_size < 6 ||
+			(in = malloc((size_t)st.st_size)) == NULL) {
+		fclose(f);
+		return -1;
 	}
+	in_len = fread(in, 1, (size_t)st.st_size, f);
+	fclose(f);
+
+	/* decide by the magic number, not by the suffix */
+#ifdef HAVE_ZLIB_H
+	if (in[0] == 0x1f && in[1] == 0x8b)
+		uncompress = gunzip_buf;
+#endif
+#ifdef HAVE_BZLIB_H
+	if (!memcmp(in, "BZh", 3))
+		uncompress = bunzip2_buf;
+#endif
+#ifdef HAVE_LZMA_H
+	if (!memcmp(in, "\3757zXZ", 6))
+		uncompress = unxz_buf;
+#endif
+	if (in_len == (size_t)st.st_size && uncompress &&
+			(ret = uncompress(in, in_len, &out, &xf_stream->buf_len))
+			== 0)
+		xf_stream->buf = (char *)out;
+	else
+		free(out);
+	free(in);
+	return ret;
+}
+
+/*
+ * Return a stream to read the content uncompressed into xf_stream->buf.
+ */
+static FILE *
+open_buf(struct xfig_stream *restrict xf_stream)
+{
+	FILE	*fp = NULL;
 
-	if (xf_stream->uncompress && *xf_stream->uncompress) {
+#ifdef HAVE_FMEMOPEN
+	/* some fmemopen() do not accept an empty buffer */
+	if (xf_stream->buf_len > 0)
+		fp = fmemopen(xf_stream->buf, xf_stream->buf_len, "r");
+#endif
+	if (fp == NULL && (fp = tmpfile()) != NULL) {
+		if (fwrite(xf_stream->buf, 1, xf_stream->buf_len, fp) ==
+				xf_stream->buf_len) {
+			rewind(fp);
+		} else {
+			fclose(fp);
+			fp = NULL;
+		}
+	}
+	return fp;
+}
+
+/*
+ * Return a file stream, either to a pipe or to a regular file.
+ * If xf_stream->uncompress[0] == '\0', it is a regular file, otherwise a pipe.
+ * Files compressed with gzip, bzip2 or xz are uncompressed in memory, if
+ * possible; then, xf_stream->buf is set and the file stream reads from
+ * memory, or from a temporary file.
+ */
+FILE *
+open_stream(char *restrict name, struct xfig_stream *restrict xf_stream)
+{
+	size_t	len;
+
+	if (find_stream(name, xf_stream))
+		return NULL;
+
+	if (xf_stream->buf || (xf_stream->uncompress &&
+				*xf_stream->uncompress &&
+				!uncompress_buf(xf_stream))) {
+		/* uncompressed in memory */
+		xf_stream->fp = open_buf(xf_stream);
+	} else if (xf_stream->uncompress && *xf_stream->uncompress) {
 		/* a compressed file */
 		char	command_buf[256];
 		char	*command = command_buf;
@@ -254,8 +494,8 @@ close_stream(struct xfig_stream *restrict xf_stream)
 	if (xf_stream->fp == NULL)
 		return -1;
 
-	if (xf_stream->uncompress[0] == '\0') {
-		/* a regular file */
+	if (xf_stream->uncompress[0] == '\0' || xf_stream->buf) {
+		/* a regular file, or a stream from memory */
 		return fclose(xf_stream->fp);
 	} else {
 		/* a pipe */
@@ -280,8 +520,8 @@ rewind_stream(struct xfig_stream *restrict xf_stream)
 	if (xf_stream->fp == NULL)
 		return NULL;
 
-	if (xf_stream->uncompress[0] == '\0') {
-		/* a regular file */
+	if (xf_stream->uncompress[0] == '\0' || xf_stream->buf) {
+		/* a regular file, or a stream from memory */
 		rewind(xf_stream->fp);
 		return xf_stream->fp;
 	} else  {
@@ -328,11 +568,24 @@ uncompressed_content(struct xfig_stream *restrict xf_stream)
 	/* create a temporary file */
 	strcpy(xf_stream->content, "f2dXXXXXX");
 	f = xtmpfile(&xf_stream->content, sizeof xf_stream->content_buf);
-	if (f)
-		fclose(f);
-	else
+	if (f == NULL)
 		return ret;
 
+	/* write the content uncompressed in memory */
+	if (xf_stream->buf) {
+		if (fwrite(xf_stream->buf, 1, xf_stream->buf_len, f) ==
+				xf_stream->buf_len)
+			ret = 0;
+		if (fclose(f))
+			ret = -1;
+		if (ret)
+			err_msg("Could not write the uncompressed content of "
+					"%s to %s", xf_stream->name_on_disk,
+					xf_stream->content);
+		return ret;
+	}
+	fclose(f);
+
 	/* uncompress to a temporary file */
 	len = snprintf(command, sizeof command_buf, uncompress_fmt,
 			xf_stream->uncompress, xf_stream->name_on_disk,
@@ -343,7 +596,7 @@ uncompressed_content(struct xfig_stream *restrict xf_stream)
 			return ret;
 		}
 		len = sprintf(command, uncompress_fmt, xf_stream->uncompress,
-				xf_stream->name_on_disk, xf_stream->uncompress);
+				xf_stream->name_on_disk, xf_stream->content);
 	}
 	if (len < 0) {
 		err_msg("Unable to write command to uncompress file");
@@ -27,7 +27,8 @@
 #include "bool.h"
 
 /*
- * The xfig_stream struct either refers to a file, or to a pipe obtained by
+ * The xfig_stream struct either refers to a file, to the content of a
+ * compressed file uncompressed in memory, or to a pipe obtained by
  * uncompressing a compressed file. In addition, the uncompressed content
  * may be provided.
  */
@@ -39,6 +40,9 @@ struct xfig_stream {
 				   uncompressed content of name */
 	const char *uncompress;	/* e.g., "gunzip -c", "", or NULL
 				   NULL if compression status is undecided */
+	char	*buf;		/* the uncompressed content, if uncompressed
+				   in memory, otherwise NULL */
+	size_t	buf_len;
 	char	name_buf[128];
 	char	name_on_disk_buf[128];
 	char	content_buf[128];
@@ -47,6 +51,8 @@ struct xfig_stream {
 
 
 extern void	init_stream(struct xfig_stream *restrict xf_stream);
+extern int	find_stream(char *restrict name,
+				struct xfig_stream *restrict xf_stream);
 extern FILE	*open_stream(char *restrict name,
 				struct xfig_stream *restrict xf_stream);
 extern int	close_stream(struct xfig_stream *restrict xf_stream);
@@ -25,6 +25,7 @@
 #include "config.h"
 #endif
 
+#include <signal.h>
 #include <stdio.h>
 #include <stdint.h>		/* INT16_MAX */
 #include <stdlib.h>
@@ -270,6 +271,9 @@ read_ppm(F_pic *pic, struct xfig_stream *restrict pic_stream, int *llx,int *lly)
 	char	*const cmd_fmt = "ppmtopcx -quiet >%s 2>/dev/null";
 	char	pcxname_buf[128] = "f2dpcxXXXXXX";
 	char	*pcxname = pcxname_buf;
+#ifdef SIGPIPE
+	void	(*handler)(int);
+#endif
 
 	*llx = *lly = 0;
 
@@ -301,7 +305,10 @@ read_ppm(F_pic *pic, struct xfig_stream *restrict pic_stream, int *llx,int *lly)
 		return 0;
 	}
 
-	/* pipe to ppmtopcx */
+	/* pipe to ppmtopcx; if it does not exist, the shell exits at once */
+#ifdef SIGPIPE
+	handler = signal(SIGPIPE, SIG_IGN);
+#endif
 	if ((f = popen(cmd, "w"))) {
 		while ((size=fread(buf, 1, sizeof buf, pic_stream->fp)) != 0)
 			fwrite(buf, size, 1, f);
@@ -312,12 +319,13 @@ read_ppm(F_pic *pic, struct xfig_stream *restrict pic_stream, int *llx,int *lly)
 		remove(pcxname);
 		stat = -1;
 	}
+#ifdef SIGPIPE
+	signal(SIGPIPE, handler);
+#endif
 
 	/* ppmtopcx succeeded */
 	if (stat == 0) {
 	       if ((f = fopen(pcxname, "rb"))) {
-		       fprintf(tfp, "%% Originally from a PPM File: %s\n\n",
-				       pic->file);
 		       stat = _read_pcx(f, pic);
 		       fclose(f);
 	       } else {	/* f == NULL */
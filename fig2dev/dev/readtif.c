@@ -19,6 +19,10 @@
 /*
  * readtif.c: import tiff into PostScript
  *
+ * Strips of 1, 2, 4 or 8-bit grayscale or palette images and of 8-bit rgb
+ * images, uncompressed or compressed with PackBits, LZW or Deflate, are
+ * decoded here. Other images are read with libtiff, if available, or
+ * converted to pcx with an external program.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -28,20 +32,647 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef HAVE_TIFFIO_H
+#include <stdint.h>
+#include <tiffio.h>
+#endif
+#ifdef HAVE_ZLIB_H
+#include <zlib.h>
+#endif
 
 #include "fig2dev.h"
 #include "object.h"
+#include "colors.h"	/* rgb2luminance() */
 #include "messages.h"
+#include "probe.h"
 #include "readpics.h"
 
 extern	int	_read_pcx(FILE *pcxfile, F_pic *pic);	/* readpcx.c */
 
+/* tiff tags read by the built-in decoder */
+#define TAG_WIDTH		256
+#define TAG_HEIGHT		257
+#define TAG_BITS		258
+#define TAG_COMPRESSION		259
+#define TAG_PHOTOMETRIC		262
+#define TAG_FILLORDER		266
+#define TAG_STRIPOFFSETS	273
+#define TAG_SAMPLES		277
+#define TAG_ROWSPERSTRIP	278
+#define TAG_STRIPBYTECOUNTS	279
+#define TAG_PLANAR		284
+#define TAG_PREDICTOR		317
+#define TAG_COLORMAP		320
+
+#define COMPRESSION_NONE	1
+#define COMPRESSION_LZW		5
+#define COMPRESSION_DEFLATE	8
+#define COMPRESSION_PACKBITS	32773
+#define COMPRESSION_OLDDEFLATE	32946
+
+#define PHOTOMETRIC_WHITEISZERO	0
+#define PHOTOMETRIC_BLACKISZERO	1
+#define PHOTOMETRIC_RGB		2
+#define PHOTOMETRIC_PALETTE	3
+
+#define MAX_LZW_CODES		4096
+#define MAX_PIXELS		(1UL << 28)
+
+struct tiff {
+	const unsigned char	*data;
+	size_t			size;
+	bool			msb;		/* "MM", big-endian */
+	unsigned long		width;
+	unsigned long		height;
+	unsigned long		bits;
+	unsigned long		samples;
+	unsigned long		compression;
+	unsigned long		photometric;
+	unsigned long		fillorder;
+	unsigned long		rowsperstrip;
+	unsigned long		planar;
+	unsigned long		predictor;
+	const unsigned char	*offsets;	/* ifd entries */
+	const unsigned char	*counts;
+	const unsigned char	*colormap;
+};
+
+static int	decode_tiff(F_pic *pic, const unsigned char *data, size_t size);
+static int	tif_to_pcx(F_pic *pic, struct xfig_stream *restrict pic_stream);
+#ifdef HAVE_TIFFIO_H
+static int	read_libtiff(F_pic *pic, const char *file);
+#endif
+
 /* return codes:  1 : success
 		  0 : invalid file
 */
 
 int
 read_tif(F_pic *pic, struct xfig_stream *restrict pic_stream, int *llx,int *lly)
+{
+	unsigned char	*data = NULL;
+	unsigned char	*tmp;
+	size_t		size = 0;
+	size_t		alloc = 0;
+	size_t		n;
+	int		stat;
+
+	if (!rewind_stream(pic_stream))
+		return 0;
+
+	*llx = *lly = 0;
+
+	/* read the file into memory, it may come through a pipe */
+	do {
+		if (size == alloc) {
+			alloc = alloc ? 2 * alloc : BUFSIZ;
+			if ((tmp = realloc(data, alloc)) == NULL) {
+				free(data);
+				put_msg(Err_mem);
+				return 0;
+			}
+			data = tmp;
+		}
+		n = fread(data + size, 1, alloc - size, pic_stream->fp);
+		size += n;
+	} while (n > 0);
+
+	if (size < 8 || (memcmp(data, "II*\0", 4) && memcmp(data, "MM\0*", 4))){
+		free(data);
+		return 0;
+	}
+
+	stat = decode_tiff(pic, data, size);
+	free(data);
+	if (stat)
+		return stat;
+
+#ifdef HAVE_TIFFIO_H
+	/* libtiff needs a regular file */
+	if (!uncompressed_content(pic_stream) &&
+			read_libtiff(pic, pic_stream->content))
+		return 1;
+#endif
+
+	return tif_to_pcx(pic, pic_stream);
+}
+
+static unsigned long
+get16(const struct tiff *t, const unsigned char *p)
+{
+	return t->msb ? (unsigned long)p[0] << 8 | p[1] :
+			(unsigned long)p[1] << 8 | p[0];
+}
+
+static unsigned long
+get32(const struct tiff *t, const unsigned char *p)
+{
+	return t->msb ? get16(t, p) << 16 | get16(t, p + 2) :
+			get16(t, p + 2) << 16 | get16(t, p);
+}
+
+/*
+ * Store the i-th value of the ifd entry in val. Return false, if the entry
+ * has less than i + 1 values, is not an integer, or points beyond the file.
+ */
+static bool
+entry_value(const struct tiff *t, const unsigned char *entry, unsigned long i,
+		unsigned long *val)
+{
+	unsigned long	type = get16(t, entry + 2);
+	unsigned long	count = get32(t, entry + 4);
+	unsigned long	off;
+	size_t		len;
+	const unsigned char	*p;
+
+	if (type == 1)			/* BYTE */
+		len = 1;
+	else if (type == 3)		/* SHORT */
+		len = 2;
+	else if (type == 4)		/* LONG */
+		len = 4;
+	else
+		return false;
+	if (i >= count)
+		return false;
+
+	if (count <= 4 / len) {
+		p = entry + 8;
+	} else {
+		off = get32(t, entry + 8);
+		if (off > t->size || count > (t->size - off) / len)
+			return false;
+		p = t->data + off;
+	}
+	p += i * len;
+
+	*val = len == 1 ? *p : len == 2 ? get16(t, p) : get32(t, p);
+	return true;
+}
+
+static unsigned long
+entry_count(const struct tiff *t, const unsigned char *entry)
+{
+	return get32(t, entry + 4);
+}
+
+/*
+ * Read the first image file directory. Return false, if the image can not be
+ * decoded here.
+ */
+static bool
+read_ifd(struct tiff *t)
+{
+	unsigned long	off, n, tag, val;
+	const unsigned char	*entry;
+
+	t->width = t->height = 0;
+	t->bits = t->samples = t->compression = t->fillorder = t->planar =
+		t->predictor = 1;
+	t->photometric = t->rowsperstrip = ~0UL;
+	t->offsets = t->counts = t->colormap = NULL;
+
+	off = get32(t, t->data + 4);
+	if (off > t->size - 2)
+		return false;
+	n = get16(t, t->data + off);
+	if (n > (t->size - off - 2) / 12)
+		return false;
+
+	for (entry = t->data + off + 2; n > 0; --n, entry += 12) {
+		tag = get16(t, entry);
+		switch (tag) {
+		case TAG_STRIPOFFSETS:
+			t->offsets = entry;
+			continue;
+		case TAG_STRIPBYTECOUNTS:
+			t->counts = entry;
+			continue;
+		case TAG_COLORMAP:
+			t->colormap = entry;
+			continue;
+		case TAG_WIDTH: case TAG_HEIGHT: case TAG_BITS:
+		case TAG_COMPRESSION: case TAG_PHOTOMETRIC: case TAG_FILLORDER:
+		case TAG_SAMPLES: case TAG_ROWSPERSTRIP: case TAG_PLANAR:
+		case TAG_PREDICTOR:
+			break;
+		default:
+			continue;
+		}
+		/* all bits per sample must be equal, just look at the first */
+		if (!entry_value(t, entry, 0, &val))
+			return false;
+		switch (tag) {
+		case TAG_WIDTH:		t->width = val; break;
+		case TAG_HEIGHT:	t->height = val; break;
+		case TAG_BITS:		t->bits = val; break;
+		case TAG_COMPRESSION:	t->compression = val; break;
+		case TAG_PHOTOMETRIC:	t->photometric = val; break;
+		case TAG_FILLORDER:	t->fillorder = val; break;
+		case TAG_SAMPLES:	t->samples = val; break;
+		case TAG_ROWSPERSTRIP:	t->rowsperstrip = val; break;
+		case TAG_PLANAR:	t->planar = val; break;
+		case TAG_PREDICTOR:	t->predictor = val; break;
+		}
+	}
+
+	if (t->width == 0 || t->height == 0 ||
+			t->width > MAX_PIXELS / t->height ||
+			t->offsets == NULL || t->counts == NULL ||
+			entry_count(t, t->offsets) != entry_count(t, t->counts))
+		return false;
+	if (t->rowsperstrip == 0 || t->rowsperstrip > t->height)
+		t->rowsperstrip = t->height;
+	if (entry_count(t, t->offsets) <
+			(t->height + t->rowsperstrip - 1) / t->rowsperstrip)
+		return false;
+
+	if (t->compression != COMPRESSION_NONE &&
+			t->compression != COMPRESSION_LZW &&
+#ifdef HAVE_ZLIB_H
+			t->compression != COMPRESSION_DEFLATE &&
+			t->compression != COMPRESSION_OLDDEFLATE &&
+#endif
+			t->compression != COMPRESSION_PACKBITS)
+		return false;
+	if (t->predictor != 1 && (t->predictor != 2 || t->bits != 8))
+		return false;
+	if (t->fillorder != 1 && t->bits < 8)
+		return false;
+
+	switch (t->photometric) {
+	case PHOTOMETRIC_WHITEISZERO:
+	case PHOTOMETRIC_BLACKISZERO:
+	case PHOTOMETRIC_PALETTE:
+		if (t->samples != 1 || (t->bits != 1 && t->bits != 2 &&
+					t->bits != 4 && t->bits != 8))
+			return false;
+		if (t->photometric == PHOTOMETRIC_PALETTE &&
+				(t->colormap == NULL || entry_count(t,
+					t->colormap) != 3UL << t->bits))
+			return false;
+		break;
+	case PHOTOMETRIC_RGB:
+		/* ignore extra samples, e.g., alpha */
+		if (t->bits != 8 || t->samples < 3 || t->samples > 8 ||
+				(t->planar != 1))
+			return false;
+		break;
+	default:
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Uncompress PackBits data in src[0..len-1] into dst[0..size-1].
+ * Return the number of bytes written.
+ */
+static size_t
+unpackbits(const unsigned char *src, size_t len, unsigned char *dst,
+		size_t size)
+{
+	const unsigned char	*end = src + len;
+	size_t	n = 0;
+	size_t	run;
+	int	c;
+
+	while (src < end && n < size) {
+		c = (signed char)*src++;
+		if (c >= 0) {
+			run = (size_t)c + 1;
+			if (run > (size_t)(end - src) || run > size - n)
+				return n;
+			memcpy(dst + n, src, run);
+			src += run;
+			n += run;
+		} else if (c != -128) {
+			run = (size_t)(1 - c);
+			if (src == end || run > size - n)
+				return n;
+			memset(dst + n, *src++, run);
+			n += run;
+		}
+	}
+	return n;
+}
+
+/*
+ * Uncompress tiff LZW data in src[0..len-1] into dst[0..size-1].
+ * Codes are stored most significant bit first, and the code width increases
+ * one code earlier than in gif files. Return the number of bytes written.
+ */
+static size_t
+unlzw(const unsigned char *src, size_t len, unsigned char *dst, size_t size)
+{
+	unsigned short	prefix[MAX_LZW_CODES];
+	unsigned char	suffix[MAX_LZW_CODES];
+	unsigned char	stack[MAX_LZW_CODES + 1];
+	unsigned char	first = 0;
+	unsigned long	bits = 0;
+	int		nbits = 0;
+	int		code_size = 9, next = 258, old = -1, code, in, sp;
+	size_t		n = 0;
+	size_t		i = 0;
+
+	/* the old, lsb-first variant is not supported */
+	if (len >= 2 && src[0] == 0 && (src[1] & 1))
+		return 0;
+
+	for (code = 0; code < 256; ++code) {
+		prefix[code] = 0;
+		suffix[code] = (unsigned char)code;
+	}
+
+	while (n < size) {
+		while (nbits < code_size) {
+			if (i == len)
+				return n;
+			bits = (bits << 8 | src[i++]) & 0xffffffUL;
+			nbits += 8;
+		}
+		code = (int)(bits >> (nbits - code_size)) &
+							((1 << code_size) - 1);
+		nbits -= code_size;
+
+		if (code == 256) {		/* clear */
+			code_size = 9;
+			next = 258;
+			old = -1;
+			continue;
+		}
+		if (code == 257)		/* end of information */
+			break;
+
+		sp = 0;
+		if (old == -1) {
+			if (code > 255)
+				return n;
+			first = (unsigned char)code;
+			stack[sp++] = first;
+		} else {
+			in = code;
+			if (code > next)
+				return n;
+			if (code == next) {
+				stack[sp++] = first;
+				code = old;
+			}
+			while (code > 257) {
+				stack[sp++] = suffix[code];
+				code = prefix[code];
+			}
+			first = (unsigned char)code;
+			stack[sp++] = first;
+			if (next < MAX_LZW_CODES) {
+				prefix[next] = (unsigned short)old;
+				suffix[next] = first;
+				if (++next == (1 << code_size) - 1 &&
+						code_size < 12)
+					++code_size;
+			}
+			code = in;
+		}
+		old = code;
+
+		while (sp > 0 && n < size)
+			dst[n++] = stack[--sp];
+	}
+	return n;
+}
+
+#ifdef HAVE_ZLIB_H
+/*
+ * Uncompress zlib data in src[0..len-1] into dst[0..size-1].
+ * Return the number of bytes written.
+ */
+static size_t
+unflate(const unsigned char *src, size_t len, unsigned char *dst, size_t size)
+{
+	z_stream	strm;
+	size_t		n;
+
+	strm.zalloc = Z_NULL;
+	strm.zfree = Z_NULL;
+	strm.opaque = Z_NULL;
+	strm.next_in = (unsigned char *)src;
+	strm.avail_in = (uInt)len;
+	strm.next_out = dst;
+	strm.avail_out = (uInt)size;
+	if (inflateInit(&strm) != Z_OK)
+		return 0;
+	(void)inflate(&strm, Z_FINISH);
+	n = size - strm.avail_out;
+	inflateEnd(&strm);
+	return n;
+}
+#endif
+
+/*
+ * Decode the tiff image in data[0..size-1] into pic. Return 1 on success,
+ * 0 if the image can not be decoded here.
+ */
+static int
+decode_tiff(F_pic *pic, const unsigned char *data, size_t size)
+{
+	struct tiff	t;
+	unsigned char	*strip;
+	unsigned char	*row;
+	unsigned char	*out;
+	unsigned long	s, nstrips, off, count, rows;
+	unsigned long	x, y, maxval, val;
+	size_t		rowbytes, len, n;
+	size_t		bytepp;
+	int		i;
+
+	t.data = data;
+	t.size = size;
+	t.msb = data[0] == 'M';
+	if (!read_ifd(&t))
+		return 0;
+
+	rowbytes = (t.width * t.bits * t.samples + 7) / 8;
+	bytepp = t.photometric == PHOTOMETRIC_RGB ? 3 : 1;
+	if ((strip = malloc(rowbytes * t.rowsperstrip)) == NULL)
+		return 0;
+	if ((pic->bitmap = malloc(bytepp * t.width * t.height)) == NULL) {
+		free(strip);
+		return 0;
+	}
+
+	nstrips = (t.height + t.rowsperstrip - 1) / t.rowsperstrip;
+	out = pic->bitmap;
+	for (s = 0; s < nstrips; ++s) {
+		if (!entry_value(&t, t.offsets, s, &off) ||
+				!entry_value(&t, t.counts, s, &count) ||
+				off > size || count > size - off)
+			goto fail;
+		rows = t.height - s * t.rowsperstrip;
+		if (rows > t.rowsperstrip)
+			rows = t.rowsperstrip;
+		len = rows * rowbytes;
+
+		switch (t.compression) {
+		case COMPRESSION_NONE:
+			n = count < len ? count : len;
+			memcpy(strip, data + off, n);
+			break;
+		case COMPRESSION_PACKBITS:
+			n = unpackbits(data + off, count, strip, len);
+			break;
+		case COMPRESSION_LZW:
+			n = unlzw(data + off, count, strip, len);
+			break;
+#ifdef HAVE_ZLIB_H
+		default:	/* COMPRESSION_DEFLATE, COMPRESSION_OLDDEFLATE*/
+			n = unflate(data + off, count, strip, len);
+			break;
+#else
+		default:
+			n = 0;
+			break;
+#endif
+		}
+		if (n != len)
+			goto fail;
+
+		for (row = strip; row < strip + len; row += rowbytes) {
+			/* horizontal differencing */
+			if (t.predictor == 2)
+				for (n = t.samples; n < rowbytes; ++n)
+					row[n] += row[n - t.samples];
+
+			if (t.photometric == PHOTOMETRIC_RGB) {
+				for (x = 0; x < t.width; ++x) {
+					memcpy(out, row + x * t.samples, 3);
+					out += 3;
+				}
+			} else if (t.bits == 8) {
+				memcpy(out, row, t.width);
+				out += t.width;
+			} else {
+				for (x = 0; x < t.width; ++x) {
+					n = x * t.bits;
+					*out++ = (row[n / 8] >> (8 - t.bits -
+						n % 8)) & ((1 << t.bits) - 1);
+				}
+			}
+		}
+	}
+	free(strip);
+
+	pic->subtype = P_TIF;
+	pic->bit_size.x = t.width;
+	pic->bit_size.y = t.height;
+
+	if (t.photometric == PHOTOMETRIC_RGB) {
+		pic->numcols = 1 << 24;
+		if (grayonly) {
+			/* write the grayscale as indexed image */
+			for (y = 0; y < t.width * t.height; ++y)
+				pic->bitmap[y] = (unsigned char)(255.0 *
+					rgb2luminance(pic->bitmap[3*y] / 255.0,
+						pic->bitmap[3*y + 1] / 255.0,
+						pic->bitmap[3*y + 2] / 255.0));
+			for (i = 0; i < 256; ++i)
+				pic->cmap[RED][i] = pic->cmap[GREEN][i] =
+					pic->cmap[BLUE][i] = (unsigned char)i;
+			pic->numcols = 256;
+		}
+		return 1;
+	}
+
+	pic->numcols = 1 << t.bits;
+	maxval = (unsigned long)pic->numcols - 1;
+	for (i = 0; i < pic->numcols; ++i) {
+		if (t.photometric == PHOTOMETRIC_PALETTE) {
+			/* 16-bit values, first all red, then green, blue */
+			entry_value(&t, t.colormap, i, &val);
+			pic->cmap[RED][i] = val >> 8;
+			entry_value(&t, t.colormap, i + pic->numcols, &val);
+			pic->cmap[GREEN][i] = val >> 8;
+			entry_value(&t, t.colormap, i + 2*pic->numcols, &val);
+			pic->cmap[BLUE][i] = val >> 8;
+			if (grayonly)
+				pic->cmap[RED][i] = pic->cmap[GREEN][i] =
+					pic->cmap[BLUE][i] =
+					(int)(rgb2luminance(
+						pic->cmap[RED][i] / 255.0,
+						pic->cmap[GREEN][i] / 255.0,
+						pic->cmap[BLUE][i] / 255.0)
+						* 255.0);
+		} else {
+			val = i * 255 / maxval;
+			if (t.photometric == PHOTOMETRIC_WHITEISZERO)
+				val = 255 - val;
+			pic->cmap[RED][i] = pic->cmap[GREEN][i] =
+				pic->cmap[BLUE][i] = (unsigned char)val;
+		}
+	}
+	return 1;
+
+fail:
+	free(strip);
+	free(pic->bitmap);
+	pic->bitmap = NULL;
+	return 0;
+}
+
+#ifdef HAVE_TIFFIO_H
+/*
+ * Read any tiff file libtiff can read, as rgb image.
+ */
+static int
+read_libtiff(F_pic *pic, const char *file)
+{
+	TIFF		*tif;
+	uint32_t	w, h;
+	uint32_t	*raster;
+	uint32_t	i;
+	unsigned char	*out;
+
+	TIFFSetWarningHandler(NULL);
+	if ((tif = TIFFOpen(file, "r")) == NULL)
+		return 0;
+	if (!TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &w) ||
+			!TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &h) ||
+			w == 0 || h == 0 || w > MAX_PIXELS / h ||
+			(raster = _TIFFmalloc((tmsize_t)w * h *
+					sizeof(uint32_t))) == NULL) {
+		TIFFClose(tif);
+		return 0;
+	}
+	if (!TIFFReadRGBAImageOriented(tif, w, h, raster, ORIENTATION_TOPLEFT,
+									0) ||
+			(pic->bitmap = malloc((size_t)3 * w * h)) == NULL) {
+		_TIFFfree(raster);
+		TIFFClose(tif);
+		return 0;
+	}
+	TIFFClose(tif);
+
+	out = pic->bitmap;
+	for (i = 0; i < w * h; ++i) {
+		*out++ = TIFFGetR(raster[i]);
+		*out++ = TIFFGetG(raster[i]);
+		*out++ = TIFFGetB(raster[i]);
+	}
+	_TIFFfree(raster);
+
+	pic->subtype = P_TIF;
+	pic->numcols = 1 << 24;
+	pic->bit_size.x = w;
+	pic->bit_size.y = h;
+	return 1;
+}
+#endif /* HAVE_TIFFIO_H */
+
+/*
+ * Convert the tiff file to pcx with tifftopnm and ppmtopcx, or with
+ * ImageMagick or GraphicsMagick, and read the pcx file.
+ */
+static int
+tif_to_pcx(F_pic *pic, struct xfig_stream *restrict pic_stream)
 {
 	char		cmd_buf[128];
 	char		*cmd = cmd_buf;
@@ -55,22 +686,20 @@ read_tif(F_pic *pic, struct xfig_stream *restrict pic_stream, int *llx,int *lly)
 	if (uncompressed_content(pic_stream))
 		return 0;
 
-	*llx = *lly = 0;
-
 	/* find command to convert tiff to pcx */
 	if (cmd_fmt == NULL) {
-		if (!system("{ tifftopnm -version && ppmtopcx -version; } "
-								"2>/dev/null"))
+		if (probe_command("{ tifftopnm -version && ppmtopcx -version; }"
+								" 2>/dev/null"))
 			cmd_fmt = "tifftopnm -quiet '%s' | ppmtopcx -quiet";
-		else if (!system("convert -version >/dev/null"))
+		else if (probe_command("convert -version >/dev/null"))
 			cmd_fmt = "convert tiff:'%s' pcx:-";
-		else if (!system("gm -version >/dev/null"))
+		else if (probe_command("gm -version >/dev/null"))
 			cmd_fmt = "gm convert tiff:'%s' pcx:-";
 		else {
 			cmd_fmt = "";
-			put_msg("Cannot read tiff files.\n"
-	"To read tiff files, install either the netpbm, or the imagemagick,\n"
-	"or the graphicsmagick package.");
+			put_msg("Cannot read tiff file '%s'.\n"
+	"To read this tiff file, install either the netpbm, or the imagemagick,\n"
+	"or the graphicsmagick package.", pic_stream->name);
 			return 0;
 		}
 	}
@@ -78,7 +707,7 @@ read_tif(F_pic *pic, struct xfig_stream *restrict pic_stream, int *llx,int *lly)
 		return 0;
 
 	/* write command string, allocating a buffer if necessary */
-	if ((len = sizeof cmd_fmt + strlen(pic_stream->content) - 2) >
+	if ((len = strlen(cmd_fmt) + strlen(pic_stream->content) - 1) >
 							sizeof cmd_buf &&
 			(cmd = malloc(len)) == NULL) {
 		put_msg(Err_mem);
@@ -95,9 +724,6 @@ read_tif(F_pic *pic, struct xfig_stream *restrict pic_stream, int *llx,int *lly)
 	if (cmd != cmd_buf)
 		free(cmd);
 
-	/* output PostScript comment */
-	fprintf(tfp, "%% Originally from a TIFF File: %s\n\n", pic->file);
-
 	/* now call _read_pcx to read the pcx file */
 	stat = _read_pcx(tiftopcx, pic);
 	/* close the pipe */
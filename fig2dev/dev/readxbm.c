@@ -96,8 +96,6 @@ read_xbm(F_pic *pic, struct xfig_stream *restrict pic_stream, int *llx,int *lly)
 	pic->numcols = 0;
 	pic->bit_size.x = x;
 	pic->bit_size.y = y;
-	/* output PostScript comment */
-	fprintf(tfp, "%% Begin Imported X11 Bitmap File: %s\n\n", pic->file);
 	return 1;
     }
     /* Non Bitmap file */
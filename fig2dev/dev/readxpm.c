@@ -29,6 +29,7 @@
 #include "fig2dev.h"
 #include "object.h"
 #include "messages.h"
+#include "probe.h"
 #include "readpics.h"
 #include "xtmpfile.h"
 
@@ -55,12 +56,12 @@ read_xpm(F_pic *pic, struct xfig_stream *restrict pic_stream, int *llx,int *lly)
 		return 0;
 
 	if (cmd_fmt == NULL) {
-		if (!system("{ xpmtoppm -version && ppmtopcx -version; } "
-								"2>/dev/null"))
+		if (probe_command("{ xpmtoppm -version && ppmtopcx -version; }"
+								" 2>/dev/null"))
 			cmd_fmt = "xpmtoppm | ppmtopcx -quiet >'%s'";
-		else if (!system("convert -version >/dev/null"))
+		else if (probe_command("convert -version >/dev/null"))
 			cmd_fmt = "convert - pcx:'%s'";
-		else if (!system("gm convert -version >/dev/null"))
+		else if (probe_command("gm convert -version >/dev/null"))
 			cmd_fmt = "gm convert - pcx:'%s'";
 		else {
 			cmd_fmt = "";
@@ -75,8 +76,6 @@ read_xpm(F_pic *pic, struct xfig_stream *restrict pic_stream, int *llx,int *lly)
 
 	*llx = *lly = 0;
 
-	fprintf(tfp, "%% Originally from a XPM File: %s\n\n", pic->file);
-
 	/* create a temporary file */
 	if ((pcx = xtmpfile(&pcxname, sizeof pcxname_buf)) == NULL) {
 		if (pcxname != pcxname_buf)
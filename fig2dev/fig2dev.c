@@ -28,6 +28,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <errno.h>
+#include <limits.h>
 #include <string.h>
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
@@ -39,14 +41,21 @@
 #include <io.h>
 #include <fcntl.h>
 #endif
+#ifdef HAVE_WORKING_FORK
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
 
 #include "fig2dev.h"	/* includes bool.h and object.h */
 //#include "object.h"
 #include "alloc.h"
 #include "bound.h"
+#include "free.h"
 #include "drivers.h"
 #include "messages.h"
 #include "read.h"
+#include "simplify.h"
+#include "probe.h"
 
 #ifndef HAVE_GETOPT
 extern int	getopt(int argc, char *argv[], const char *ostr);
@@ -79,7 +88,7 @@ bool	multispec = false;	/* set if the user specs. multiple pages */
 bool	metric;			/* true if file specifies Metric */
 bool	grayonly = false;	/* convert colors to grayscale (-N option) */
 bool	bgspec = false;		/* flag to say -g was specified */
-char	gif_transparent[]="\0"; /* GIF transp color hex name (e.g. #ff00dd) */
+char	gif_transparent[8]=""; /* GIF transp color hex name (e.g. #ff00dd) */
 char	papersize[PAPERSZ_LEN];	/* paper size */
 char	boundingbox[64];	/* boundingbox */
 char	lang[12];		/* selected output language */
@@ -143,12 +152,17 @@ bool	arrows_used, arrow_used[NUMARROWS];
 struct obj_rec {
 	void (*gendev)(void *obj);
 	void *obj;
-	int depth;
 };
 static bool	maxdimspec = false; /* if max size of figure (-Z) was given */
 static float	max_dimension;	/* max. dimension (-Z) of figure */
 static float	mult;		/* multiplier for grid spacing */
 static struct driver	*dev = NULL;
+static char	*batch_file = NULL; /* list of files to convert (-I) */
+static int	num_procs = 1;	/* number of parallel conversions (-J) */
+static bool	stream_objects = false;	/* draw objects while reading (-Q) */
+static double	simplify_tol = 0.0; /* simplify lines, tolerance in points (-u) */
+static double	simplify_dist;	/* the tolerance in Fig units */
+static long	points_before, points_after; /* counts of the simplification */
 static int	depth_index = 0;
 static char	depth_op;		/* '+' for skip all but those listed */
 
@@ -156,6 +170,8 @@ static char	depth_op;		/* '+' for skip all but those listed */
 static struct depth_opts {
 	int d1, d2;
 } depth_opt[NUMDEPTHS + 1];
+/* depth_opt[] compiled by depth_option(), whether a depth is drawn */
+static bool	depth_shown[MAX_DEPTH + 1];
 
 static char	Usage[] =
 "Usage:\n %1$s -hV\n"
@@ -165,11 +181,73 @@ static char	Usage[] =
 static int	 parse_gridspec(char *string, float *numer, float *denom,
 				float *spacing, int *nchrs);
 static void	 grid_usage(void);
+static int	 convert_fp(FILE *fp, FILE *out);
 static int	 gendev_objects(F_compound *objects, struct driver *dev);
+static void	 stream_scan(enum stream_event event, F_compound *obj,
+				long pos, int line_no);
+static int	 gendev_stream(F_compound *objects, FILE *in,
+				struct driver *dev);
+static void	 stream_free(void);
+static void	 simplify_report(void);
 static void	 help_msg(void);
 static void	 depth_option(char *s);
 
 
+/*
+ * Return the points of the line l as an array, and their number in *n.
+ * The array is made from the list l->points on the first call and kept in
+ * l->pos. Whoever changes the list l->points must call line_changed().
+ */
+F_pos *
+line_points(F_line *l, int *n)
+{
+	int	i;
+	F_point	*p;
+
+	if (l->pos == NULL && l->points != NULL) {
+		for (i = 0, p = l->points; p != NULL; p = p->next)
+			++i;
+		if ((l->pos = arena_alloc(i * sizeof(F_pos))) == NULL) {
+			put_msg(Err_mem);
+			exit(EXIT_FAILURE);
+		}
+		l->npos = i;
+		for (i = 0, p = l->points; p != NULL; p = p->next, ++i) {
+			l->pos[i].x = p->x;
+			l->pos[i].y = p->y;
+		}
+	}
+	*n = l->pos ? l->npos : 0;
+	return l->pos;
+}
+
+/*
+ * The list l->points was changed. Count the points again, store the last
+ * two points in l->last[] and discard the array made by line_points().
+ */
+void
+line_changed(F_line *l)
+{
+	int	i;
+	F_point	*p, *q = NULL, *r = NULL;
+
+	for (i = 0, p = l->points; p != NULL; p = p->next, ++i) {
+		r = q;
+		q = p;
+	}
+	l->num_points = i;
+	if (q != NULL) {
+		l->last[0].x = q->x;
+		l->last[0].y = q->y;
+	}
+	if (r != NULL) {
+		l->last[1].x = r->x;
+		l->last[1].y = r->y;
+	}
+	l->pos = NULL;
+	l->npos = 0;
+}
+
 /*
  * print comments to the output file preceded by string1 and
  * succeeded by string2
@@ -193,6 +271,7 @@ void
 get_args(int argc, char *argv[])
 {
 	int	 c, i, nvals, nchars;
+	long	 lval;
 	char	*grid, *p;
 	float	 numer, denom;
 
@@ -223,9 +302,9 @@ get_args(int argc, char *argv[])
 
 
 	/* all option letters must be in this string */
-	/* not in this string: HIJQUu and non-alphabetic chars*/
-	while ((c = getopt(argc, argv, "AaB:b:C:cD:d:E:eFf:G:g:hi:jKkL:l:Mm:Nn:"
-					"OoPp:q:R:rS:s:Tt:VvWwX:x:Y:y:Z:z:?"))
+	/* not in this string: H and non-alphabetic chars*/
+	while ((c = getopt(argc, argv, "AaB:b:C:cD:d:E:eFf:G:g:hI:i:J:jKkL:l:Mm:Nn:"
+					"OoPp:Qq:R:rS:s:Tt:Uu:VvWwX:x:Y:y:Z:z:?"))
 			!= EOF) {
 
 		/* global (all drivers) option handling */
@@ -258,6 +337,47 @@ get_args(int argc, char *argv[])
 				input_encoding = optarg;
 			continue;
 
+		case 'I':		/* batch mode, read file names from list */
+			batch_file = optarg;
+			continue;
+
+		case 'J':		/* number of parallel conversions */
+			errno = 0;
+			lval = strtol(optarg, &p, 10);
+			if (errno || p == optarg || *p != '\0' || lval < 0 ||
+					lval > INT_MAX) {
+				fprintf(stderr, "Invalid number of processes "
+						"for -J: %s\n", optarg);
+				fprintf(stderr, Usage, prog);
+				exit(EXIT_FAILURE);
+			}
+			num_procs = (int)lval;
+			/* -J 0, use all processors */
+#ifdef _SC_NPROCESSORS_ONLN
+			if (num_procs == 0)
+				num_procs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+			if (num_procs < 1)
+				num_procs = 1;
+			continue;
+
+		case 'Q':		/* read and draw one object at a time */
+			stream_objects = true;
+			continue;
+
+		case 'u':		/* simplify lines and splines */
+			simplify_tol = atof(optarg);
+			if (simplify_tol < 0.0) {
+				fprintf(stderr, "Invalid tolerance for -u: "
+						"%s\n", optarg);
+				exit(EXIT_FAILURE);
+			}
+			continue;
+
+		case 'U':		/* probe again for external programs */
+			probe_refresh = true;
+			continue;
+
 		case 'K':
 			/* adjust bounding box according to selected
 			   depth range given with '-D RANGE' option above */
@@ -430,55 +550,79 @@ grid_usage(void)
 	fputs("  Ignoring grid.\n", stderr);
 }
 
-int
-main(int argc, char *argv[])
+/*
+ * Convert the Fig code read from fp, or, if fp is NULL, from the file named
+ * in the global variable from. Write to out or, if out is NULL, to the file
+ * named in to. If to is NULL or "-", write to standard output.
+ * Return 0 on success, or the exit status of the program.
+ */
+static int
+convert_fp(FILE *fp, FILE *out)
 {
-	F_compound	objects;
+	F_compound	*objects;
+	FILE		*in = NULL;	/* the input, if objects are streamed */
 	int		status;
 
-	setlocale(LC_CTYPE, "");
-#ifdef HAVE__SETMODE
-	_setmode(1,O_BINARY); /* stdout is binary */
-#endif
-
-	/* get the options */
-	get_args(argc, argv);
+	if (!Compound_malloc(objects)) {
+		put_msg(Err_mem);
+		return EXIT_FAILURE;
+	}
+	memset((void *)objects, '\0', COMOBJ_SIZE);
 
 	/* read the Fig file */
 
-	if (from && strcmp(from, "-"))
-		status = read_fig(from, &objects);
-	else
-		status = readfp_fig(stdin, &objects);
+	if (fp) {
+		status = readfp_fig(fp, objects);
+	} else if (stream_objects && dev->stream) {
+		/* the initial values of compound_bound() */
+		llx = lly = 10000000;
+		urx = ury = -10000000;
+		status = read_fig_stream(from, objects, stream_scan, &in);
+	} else {
+		status = read_fig(from, objects);
+	}
 	if (status != 0) {
+		stream_free();
 		if (status == -3) {
-			if (from && strcmp(from, "-"))
+			if (fp == NULL)
 				err_msg("File \"%s\" is not accessible", from);
 			else
 				err_msg("Input error");
 		}
-		exit(EXIT_FAILURE);
+		free_compound(&objects);
+		return EXIT_FAILURE;
 	}
 
 	/* multiply grid spacing by unit and scale to get FIG units */
 	grid_minor_spacing = mult * grid_minor_spacing * ppi;
 	grid_major_spacing = mult * grid_major_spacing * ppi;
 
-	if (to == NULL || !strcmp(to, "-"))
+	if (out)
+		tfp = out;
+	else if (to == NULL || !strcmp(to, "-"))
 		tfp = stdout;
 	else {
-		if (strcmp(to + strlen(to) - 4, ".fig") == 0 ){
+		if (strlen(to) >= 4 && strcmp(to + strlen(to) - 4, ".fig") == 0){
 			fprintf(stderr, "Outfile is a .fig file, aborting\n");
-			exit(1);
-		}
-		if ((tfp = fopen(to, "wb")) == NULL) {
+			tfp = NULL;
+		} else if ((tfp = fopen(to, "wb")) == NULL) {
 			fprintf(stderr, "Couldn't open %s\n", to);
-			exit(1);
+		}
+		if (tfp == NULL) {
+			if (in) {
+				(void)fclose(in);
+				stream_free();
+			}
+			free_compound(&objects);
+			return 1;
 		}
 	}
 
-	/* Compute bounding box of objects, supressing texts if indicated */
-	compound_bound(&objects, &llx, &lly, &urx, &ury, dev->text_include);
+	/* Compute bounding box of objects, supressing texts if indicated;
+	   with streamed objects, this was done by stream_scan() */
+	if (in == NULL)
+		compound_bound(objects, &llx, &lly, &urx, &ury,
+				dev->text_include);
 
 	/* make sure bounding box has width and height (if there is only latex
 	   special text, it may be 0 width */
@@ -491,13 +635,14 @@ main(int argc, char *argv[])
 	   adjust mag to produce that */
 	if (maxdimspec) {
 		float maxdim;
+		float maxdimension = max_dimension;
 
 		if (metric)
-			max_dimension /= 2.54;
+			maxdimension /= 2.54;
 		/* find larger of width and height */
 		maxdim = MAX(urx - llx, ury - lly)/ppi;
 		/* override any mag specified in the Fig file */
-		mag = max_dimension/maxdim;
+		mag = maxdimension/maxdim;
 	}
 	/*
 	 * If metric, adjust scale for difference between FIG PIX/CM (450) and
@@ -508,10 +653,349 @@ main(int argc, char *argv[])
 	if (metric)
 		mag *= 80.0/76.2;
 
-	status = gendev_objects(&objects, dev);
-	if ((tfp != stdout) && (tfp != 0))
+	/* the tolerance is given in points of the output */
+	simplify_dist = 0.0;
+	if (simplify_tol > 0.0 && mag > 0.0) {
+		simplify_dist = simplify_tol / 72.0 * ppi / mag;
+		points_before = points_after = 0;
+		if (in == NULL) {
+			simplify_compound(objects, simplify_dist,
+					&points_before, &points_after);
+			simplify_report();
+		}
+	}
+
+	if (in) {
+		status = gendev_stream(objects, in, dev);
+		(void)fclose(in);
+	} else {
+		status = gendev_objects(objects, dev);
+	}
+	if (tfp == stdout || tfp == out)
+		(void)fflush(tfp);
+	else if (tfp)
 		(void)fclose(tfp);
-	exit(status);
+	tfp = NULL;
+	free_compound(&objects);
+	return status;
+}
+
+/* a conversion in batch mode */
+struct job {
+	char	*infile;
+	char	*outfile;
+	int	line_no;	/* line in the list of files */
+	int	status;
+};
+
+/*
+ * Settings given on the command line, which are overridden by the values
+ * found in a Fig file or changed during a conversion. Saved after the
+ * command line was parsed, and restored before each conversion in batch mode.
+ */
+static struct settings {
+	double	mag, fontmag;
+	bool	landscape, center, multi_page;
+	char	papersize[PAPERSZ_LEN];
+	char	gif_transparent[sizeof gif_transparent];
+	char	*input_encoding;
+	float	grid_minor_spacing, grid_major_spacing;
+} settings;
+
+static int	 convert(char *infile, char *outfile);
+static int	 convert_batch(char *listfile);
+static int	 read_joblist(char *listfile, struct job **jobs);
+#ifdef HAVE_WORKING_FORK
+static void	 convert_parallel(struct job *jobs, int n);
+#endif
+static void	 save_settings(void);
+static void	 restore_settings(void);
+
+/*
+ * Convert infile to outfile. If infile or outfile are NULL or "-", read from
+ * standard input or write to standard output, respectively.
+ * Return 0 on success, or the exit status of the program.
+ */
+static int
+convert(char *infile, char *outfile)
+{
+	from = infile;
+	to = outfile;
+	if (from && strcmp(from, "-"))
+		return convert_fp(NULL, NULL);
+	else
+		return convert_fp(stdin, NULL);
+}
+
+/*
+ * Read the list of files to convert from listfile, one pair of input and
+ * output file per line. Empty lines and lines starting with '#' are ignored.
+ * If the output file is missing, the suffix of the input file is replaced by
+ * the name of the output language. Return the number of jobs, or -1 on error.
+ */
+static int
+read_joblist(char *listfile, struct job **jobs)
+{
+	FILE		*fp;
+	char		*line = NULL;
+	size_t		line_len = 0;
+	int		line_no = 0;
+	int		n = 0;
+	int		max = 0;
+	struct job	*job = NULL;
+
+	if (!strcmp(listfile, "-"))
+		fp = stdin;
+	else if ((fp = fopen(listfile, "r")) == NULL) {
+		err_msg("Cannot open list of files %s", listfile);
+		return -1;
+	}
+
+	while (getline(&line, &line_len, fp) != -1) {
+		char	*infile, *outfile, *p;
+		size_t	len;
+
+		++line_no;
+		infile = strtok(line, " \t\r\n");
+		if (infile == NULL || *infile == '#')
+			continue;
+		if (n == max) {
+			struct job	*tmp;
+
+			max = max ? 2 * max : 64;
+			if ((tmp = realloc(job, max * sizeof *job)) == NULL)
+				goto nomem;
+			job = tmp;
+		}
+		if ((job[n].infile = strdup(infile)) == NULL)
+			goto nomem;
+		if ((outfile = strtok(NULL, " \t\r\n"))) {
+			job[n].outfile = strdup(outfile);
+		} else {
+			/* derive the output file name from the input file */
+			len = strlen(infile);
+			if ((p = strrchr(infile, '.')) && !strchr(p, '/'))
+				len = p - infile;
+			if ((job[n].outfile = malloc(len + strlen(lang) + 2)))
+				sprintf(job[n].outfile, "%.*s.%s", (int)len,
+						infile, lang);
+		}
+		if (job[n].outfile == NULL) {
+			free(job[n].infile);
+			goto nomem;
+		}
+		job[n].line_no = line_no;
+		job[n].status = 0;
+		++n;
+	}
+	free(line);
+	if (fp != stdin)
+		fclose(fp);
+	*jobs = job;
+	return n;
+
+nomem:
+	put_msg(Err_mem);
+	while (n-- > 0) {
+		free(job[n].infile);
+		free(job[n].outfile);
+	}
+	free(job);
+	free(line);
+	if (fp != stdin)
+		fclose(fp);
+	return -1;
+}
+
+/*
+ * Batch mode. Convert each pair of input and output files given in
+ * listfile, see read_joblist(). Return 0, if all conversions succeeded,
+ * EXIT_FAILURE otherwise.
+ */
+static int
+convert_batch(char *listfile)
+{
+	int		i, n;
+	int		failed = 0;
+	struct job	*jobs;
+
+	if ((n = read_joblist(listfile, &jobs)) < 0)
+		return EXIT_FAILURE;
+
+	save_settings();
+#ifdef HAVE_WORKING_FORK
+	if (num_procs > 1 && n > 1) {
+		convert_parallel(jobs, n);
+	} else
+#endif
+	{
+		for (i = 0; i < n; ++i) {
+			restore_settings();
+			jobs[i].status = convert(jobs[i].infile,
+							jobs[i].outfile);
+		}
+	}
+
+	for (i = 0; i < n; ++i) {
+		if (jobs[i].status != 0) {
+			put_msg("%s, line %d: conversion of %s to %s failed.",
+					listfile, jobs[i].line_no,
+					jobs[i].infile, jobs[i].outfile);
+			++failed;
+		}
+		free(jobs[i].infile);
+		free(jobs[i].outfile);
+	}
+	free(jobs);
+
+	return failed ? EXIT_FAILURE : 0;
+}
+
+#ifdef HAVE_WORKING_FORK
+/*
+ * Run up to num_procs conversions in parallel. Each conversion is done in
+ * a child process, which inherits the settings from the command line and
+ * leaves the state of this process untouched. A conversion reading from
+ * standard input or writing to standard output runs alone.
+ */
+static void
+convert_parallel(struct job *jobs, int n)
+{
+	int	next = 0;		/* the next job to start */
+	int	running = 0;
+	int	i;
+	int	wstatus;
+	bool	exclusive = false;	/* a job using stdin or stdout runs */
+	pid_t	pid;
+	struct	slot {
+		pid_t	pid;
+		int	job;
+	} *slot;
+
+	if ((slot = malloc(num_procs * sizeof *slot)) == NULL) {
+		put_msg(Err_mem);
+		for (i = 0; i < n; ++i)
+			jobs[i].status = EXIT_FAILURE;
+		return;
+	}
+	for (i = 0; i < num_procs; ++i)
+		slot[i].pid = 0;
+
+	while (next < n || running > 0) {
+		bool	stdio;
+
+		stdio = next < n && (!strcmp(jobs[next].infile, "-") ||
+				!strcmp(jobs[next].outfile, "-"));
+		if (next < n && running < num_procs && !exclusive &&
+				(!stdio || running == 0)) {
+			/* do not duplicate pending output in the child */
+			fflush(NULL);
+			if ((pid = fork()) == 0) {
+				restore_settings();
+				exit(convert(jobs[next].infile,
+							jobs[next].outfile));
+			}
+			if (pid > 0) {
+				for (i = 0; slot[i].pid != 0; ++i)
+					;
+				slot[i].pid = pid;
+				slot[i].job = next++;
+				exclusive = stdio;
+				++running;
+				continue;
+			}
+			if (running == 0) {
+				/* no process can be created, convert here */
+				put_msg("Cannot create a new process.");
+				restore_settings();
+				jobs[next].status = convert(jobs[next].infile,
+							jobs[next].outfile);
+				++next;
+				continue;
+			}
+		}
+
+		/* wait for a conversion to finish */
+		if ((pid = wait(&wstatus)) == -1)
+			break;
+		for (i = 0; i < num_procs && slot[i].pid != pid; ++i)
+			;
+		if (i == num_procs)
+			continue;
+		if (WIFEXITED(wstatus)) {
+			jobs[slot[i].job].status = WEXITSTATUS(wstatus);
+		} else {
+			if (WIFSIGNALED(wstatus))
+				put_msg("Conversion of %s terminated by "
+						"signal %d.",
+						jobs[slot[i].job].infile,
+						WTERMSIG(wstatus));
+			jobs[slot[i].job].status = EXIT_FAILURE;
+		}
+		slot[i].pid = 0;
+		exclusive = false;
+		--running;
+	}
+
+	/* in case wait() failed */
+	for (i = 0; i < num_procs; ++i)
+		if (slot[i].pid != 0)
+			jobs[slot[i].job].status = EXIT_FAILURE;
+	free(slot);
+}
+#endif /* HAVE_WORKING_FORK */
+
+static void
+save_settings(void)
+{
+	settings.mag = mag;
+	settings.fontmag = fontmag;
+	settings.landscape = landscape;
+	settings.center = center;
+	settings.multi_page = multi_page;
+	strcpy(settings.papersize, papersize);
+	strcpy(settings.gif_transparent, gif_transparent);
+	settings.input_encoding = input_encoding;
+	settings.grid_minor_spacing = grid_minor_spacing;
+	settings.grid_major_spacing = grid_major_spacing;
+}
+
+static void
+restore_settings(void)
+{
+	mag = settings.mag;
+	fontmag = settings.fontmag;
+	landscape = settings.landscape;
+	center = settings.center;
+	multi_page = settings.multi_page;
+	strcpy(papersize, settings.papersize);
+	strcpy(gif_transparent, settings.gif_transparent);
+	input_encoding = settings.input_encoding;
+	grid_minor_spacing = settings.grid_minor_spacing;
+	grid_major_spacing = settings.grid_major_spacing;
+}
+
+int
+main(int argc, char *argv[])
+{
+	setlocale(LC_CTYPE, "");
+#ifdef HAVE__SETMODE
+	_setmode(1,O_BINARY); /* stdout is binary */
+#endif
+
+	/* get the options */
+	get_args(argc, argv);
+
+	if (batch_file) {
+		if (from || to) {
+			fputs("Do not give input or output files together "
+					"with -I.\n", stderr);
+			exit(EXIT_FAILURE);
+		}
+		exit(convert_batch(batch_file));
+	}
+
+	exit(convert(from, to));
 }
 
 void
@@ -540,6 +1024,12 @@ help_msg(void)
 "  -K          adjust bounding box according to selected depths\n"
 "                      given with '-D +/-list' option.\n"
 "  -E enc      set the character encoding of the input file\n"
+"  -I listfile convert the pairs of input and output files listed in listfile\n"
+"  -J procs    with -I, run up to procs conversions in parallel\n"
+"  -Q          read and draw one object at a time, to save memory\n"
+"  -U          look again for external programs, renew the cache\n"
+"  -u tol      remove points of lines and splines which deviate less than\n"
+"                tol points from the simplified line (e.g., -u 0.1)\n"
 "  -G minor[:major][unit]    draw light gray grid with thin/thick lines at\n"
 "                minor/major units (e.g., -G .25:1cm)\n"
 "  -m mag      set magnification.  This may not be used with the -Z option\n"
@@ -783,6 +1273,7 @@ help_msg(void)
 "  -o          generate single page output\n"
 "  -P          honor page size, do not crop to bounding box; PDF output only\n"
 "  -p dummyarg portrait mode (dummy argument required after \"-p\")\n"
+"  -q level    compress images with level 0 (none) to 9 (smallest)\n"
 "  -T          add monochrome TIFF preview (for Microsoft apps), not for PDF\n"
 "  -x offset   shift figure left/right by offset units (1/72 inch)\n"
 "  -y offset   shift figure up/down by offset units (1/72 inch)\n"
@@ -790,6 +1281,15 @@ help_msg(void)
 			);
 		}
 
+		if (dev == NULL || !strcmp(lang, "pdf") ||
+				!strcmp(lang, "pdftex")) {
+			puts(
+"PDF and PDFTEX Options:\n"
+"  -w          write the pdf with ghostscript\n"
+"  -Y minor    set the pdf version to 1.minor, default 1.5"
+			);
+		}
+
 		if (dev == NULL || !strcmp(lang, "pstricks")) {
 			puts(
 "PSTricks Options:\n"
@@ -837,6 +1337,15 @@ help_msg(void)
 			);
 		}
 
+		if (dev == NULL || !strcmp(lang, "svg")) {
+			puts(
+"SVG Options:\n"
+"  -c          compact output, without comments, with relative path coordinates\n"
+"  -e          embed pictures as data uris, instead of referring to the files\n"
+"  -z papersize        set the papersize (see man pages for available sizes)"
+			);
+		}
+
 		if (dev == NULL || !strcmp(lang, "tk") || !strcmp(lang,"ptk")) {
 			puts(
 "Tcl/Tk (tk) and Perl/Tk (ptk) Options:\n"
@@ -900,6 +1409,12 @@ help_msg(void)
 "  -S smooth   specify smoothing factor (1 = none, 2 = some, 4 = more)"
 		);
 
+		if (dev == NULL || !strcmp(lang, "png") || !strcmp(lang, "ppm"))
+			puts(
+"PNG and PPM Options:\n"
+"  -w          always render with ghostscript"
+			);
+
 
 		if (dev == NULL || !strcmp(lang, "gif"))
 			puts(
@@ -915,9 +1430,27 @@ help_msg(void)
 	}
 }
 
+/*
+ * Note an object at the given depth, if it passes the depth filter.
+ * Without array, count the objects at each depth in next[]. With array,
+ * store the object at array[next[depth]], and increment next[depth].
+ */
+static void
+dump_object(struct obj_rec *array, size_t *next, void (*gendev)(void *),
+		void *obj, int depth)
+{
+	if (!depth_filter(depth))
+		return;
+	if (array) {
+		array[next[depth]].gendev = gendev;
+		array[next[depth]].obj = obj;
+	}
+	++next[depth];
+}
+
 /* count primitive objects & create pointer array */
 static int compound_dump(F_compound *com, struct obj_rec *array,
-			int count, struct driver *dev)
+			size_t *next, struct driver *dev)
 {
 	F_arc		*a;
 	F_compound	*c;
@@ -925,77 +1458,60 @@ static int compound_dump(F_compound *com, struct obj_rec *array,
 	F_line		*l;
 	F_spline	*s;
 	F_text		*t;
+	int		count = 0;
 
 	for (c = com->compounds; c != NULL; c = c->next)
-		count = compound_dump(c, array, count, dev);
-	for (a = com->arcs; a != NULL; a = a->next) {
-		if (array) {
-			array[count].gendev = (void(*)(void *))dev->arc;
-			array[count].obj = (void *)a;
-			array[count].depth = a->depth;
-		}
-		count += 1;
-	}
-	for (e = com->ellipses; e != NULL; e = e->next) {
-		if (array) {
-			array[count].gendev = (void(*)(void *))dev->ellipse;
-			array[count].obj = (void *)e;
-			array[count].depth = e->depth;
-		}
-		count += 1;
-	}
-	for (l = com->lines; l != NULL; l = l->next) {
-		if (array) {
-			array[count].gendev = (void(*)(void *))dev->line;
-			array[count].obj = (void *)l;
-			array[count].depth = l->depth;
-		}
-		count += 1;
-	}
-	for (s = com->splines; s != NULL; s = s->next) {
-		if (array) {
-			array[count].gendev = (void(*)(void *))dev->spline;
-			array[count].obj = (void *)s;
-			array[count].depth = s->depth;
-		}
-		count += 1;
-	}
-	for (t = com->texts; t != NULL; t = t->next) {
-		if (array) {
-			array[count].gendev = (void(*)(void *))dev->text;
-			array[count].obj = (void *)t;
-			array[count].depth = t->depth;
-		}
-		count += 1;
-	}
+		count += compound_dump(c, array, next, dev);
+	for (a = com->arcs; a != NULL; a = a->next, ++count)
+		dump_object(array, next, (void(*)(void *))dev->arc,
+				(void *)a, a->depth);
+	for (e = com->ellipses; e != NULL; e = e->next, ++count)
+		dump_object(array, next, (void(*)(void *))dev->ellipse,
+				(void *)e, e->depth);
+	for (l = com->lines; l != NULL; l = l->next, ++count)
+		dump_object(array, next, (void(*)(void *))dev->line,
+				(void *)l, l->depth);
+	for (s = com->splines; s != NULL; s = s->next, ++count)
+		dump_object(array, next, (void(*)(void *))dev->spline,
+				(void *)s, s->depth);
+	for (t = com->texts; t != NULL; t = t->next, ++count)
+		dump_object(array, next, (void(*)(void *))dev->text,
+				(void *)t, t->depth);
 	return count;
 }
 
-static int
-rec_comp(struct obj_rec *r1, struct obj_rec *r2)
-{
-	return (r2->depth - r1->depth);
-}
-
 int
 gendev_objects(F_compound *objects, struct driver *dev)
 {
-	int	obj_count;
+	int	d;
 	int	status;
+	size_t	n, num;
+	size_t	next[MAX_DEPTH + 1];
 	struct	obj_rec *rec_array, *r;
 
-	/* dump object pointers to an array */
-	obj_count = compound_dump(objects, 0, 0, dev);
-	if (!obj_count) {
+	/* count the objects at each depth */
+	memset(next, 0, sizeof next);
+	if (!compound_dump(objects, NULL, next, dev)) {
 		fprintf(stderr, "fig2dev: No objects in Fig file\n");
 		return -1;
 	}
-	rec_array = (struct obj_rec *)malloc(obj_count*sizeof(struct obj_rec));
-	(void)compound_dump(objects, rec_array, 0, dev);
 
-	/* sort object array by depth */
-	qsort(rec_array, obj_count, sizeof(struct obj_rec),
-			(int (*)(const void *, const void *))rec_comp);
+	/*
+	 * Sort by depth, the deepest objects first. Use a counting sort, it
+	 * is stable. Objects at the same depth are drawn in the order of
+	 * compound_dump(). Let next[d] point to the first object at depth d.
+	 */
+	for (num = 0, d = MAX_DEPTH; d >= 0; --d) {
+		n = next[d];
+		next[d] = num;
+		num += n;
+	}
+	rec_array = malloc((num ? num : 1) * sizeof(struct obj_rec));
+	if (rec_array == NULL) {
+		put_msg(Err_mem);
+		return -1;
+	}
+	(void)compound_dump(objects, rec_array, next, dev);
 
 	/* generate header */
 	(*dev->start)(objects);
@@ -1004,9 +1520,8 @@ gendev_objects(F_compound *objects, struct driver *dev)
 	(*dev->grid)(grid_major_spacing, grid_minor_spacing);
 
 	/* generate objects in sorted order */
-	for (r = rec_array; r<rec_array+obj_count; r++)
-		if (depth_filter(r->depth))
-			(*(r->gendev))(r->obj);
+	for (r = rec_array; r < rec_array + num; r++)
+		(*(r->gendev))(r->obj);
 
 	/* generate trailer */
 	status = (*dev->end)();
@@ -1016,6 +1531,257 @@ gendev_objects(F_compound *objects, struct driver *dev)
 	return status;
 }
 
+/*
+ * Streaming mode, option -Q.
+ * While reading the input, stream_scan() is called with each primitive
+ * object, and at the start and at the end of each compound. It computes the
+ * bounding box and notes the position of each object in the input. Then,
+ * gendev_stream() reads the objects again, one at a time, depth by depth, and
+ * draws them. Thus, each object is read twice, and only one object is held in
+ * memory at a time.
+ * Objects at the same depth are drawn in the order of gendev_objects(): The
+ * objects in the compounds of a compound come first, then its arcs, ellipses,
+ * lines, splines and texts. Therefore, the objects of a compound are kept in
+ * pending[] until the end of the compound, and are then noted, sorted by their
+ * kind, in the list for the objects of compounds. The top-level objects are
+ * noted in the list for their kind.
+ */
+struct stream_pos {
+	long	pos;		/* the position of the object in the input */
+	int	line_no;	/* the number of the line before the object */
+};
+
+/* the kinds of objects, in the order they are drawn at each depth */
+enum {
+	K_COMPOUND,		/* objects contained in top-level compounds */
+	K_ARC, K_ELLIPSE, K_LINE, K_SPLINE, K_TEXT,
+	NUM_KINDS
+};
+
+static struct stream_list {
+	struct stream_pos	*objs;
+	size_t			num, size;
+} depth_objs[MAX_DEPTH + 1][NUM_KINDS];
+
+/* the number of objects in the input, also those hidden by option -D */
+static size_t	num_streamed = 0;
+
+/* the objects of the compounds that are currently read */
+static struct pending {
+	struct stream_pos	p;
+	int			depth;
+	int			kind;
+} *pending = NULL;
+static size_t	num_pending = 0, size_pending = 0;
+
+/* compound_start[i], the first object in pending[] of the i-th open compound */
+static size_t	*compound_start = NULL;
+static size_t	num_compounds = 0, size_compounds = 0;
+
+/*
+ * Make room for one more element in the array *a, holding n elements of the
+ * given size, with space for *size elements.
+ */
+static void
+grow(void **a, size_t n, size_t *size, size_t elsize)
+{
+	void	*p;
+
+	if (n < *size)
+		return;
+	*size = *size ? 2 * *size : 64;
+	if ((p = realloc(*a, *size * elsize)) == NULL) {
+		put_msg(Err_mem);
+		exit(EXIT_FAILURE);
+	}
+	*a = p;
+}
+
+static void
+note_object(struct stream_list *list, const struct stream_pos *p)
+{
+	grow((void **)&list->objs, list->num, &list->size, sizeof *list->objs);
+	list->objs[list->num++] = *p;
+}
+
+static void
+stream_scan(enum stream_event event, F_compound *obj, long pos, int line_no)
+{
+	int			sx, sy, bx, by;
+	int			depth, kind;
+	size_t			start, i;
+	struct stream_pos	p;
+
+	switch (event) {
+	case STREAM_BEGIN_COMPOUND:
+		grow((void **)&compound_start, num_compounds, &size_compounds,
+				sizeof *compound_start);
+		compound_start[num_compounds++] = num_pending;
+		return;
+	case STREAM_END_COMPOUND:
+		if (num_compounds == 0)
+			return;
+		start = compound_start[--num_compounds];
+		for (kind = K_ARC; kind < NUM_KINDS; ++kind)
+			for (i = start; i < num_pending; ++i)
+				if (pending[i].kind == kind)
+					note_object(&depth_objs[pending[i].depth]
+							[K_COMPOUND],
+							&pending[i].p);
+		num_pending = start;
+		return;
+	case STREAM_OBJECT:
+		break;
+	}
+
+	compound_bound(obj, &sx, &sy, &bx, &by, dev->text_include);
+	llx = MIN(llx, sx);
+	lly = MIN(lly, sy);
+	urx = MAX(urx, bx);
+	ury = MAX(ury, by);
+
+	if (obj->arcs) {
+		kind = K_ARC;
+		depth = obj->arcs->depth;
+	} else if (obj->ellipses) {
+		kind = K_ELLIPSE;
+		depth = obj->ellipses->depth;
+	} else if (obj->lines) {
+		kind = K_LINE;
+		depth = obj->lines->depth;
+	} else if (obj->splines) {
+		kind = K_SPLINE;
+		depth = obj->splines->depth;
+	} else if (obj->texts) {
+		kind = K_TEXT;
+		depth = obj->texts->depth;
+	} else {
+		return;
+	}
+	++num_streamed;
+	if (!depth_filter(depth))
+		return;
+
+	p.pos = pos;
+	p.line_no = line_no;
+	if (num_compounds == 0) {
+		note_object(&depth_objs[depth][kind], &p);
+	} else {
+		grow((void **)&pending, num_pending, &size_pending,
+				sizeof *pending);
+		pending[num_pending].p = p;
+		pending[num_pending].depth = depth;
+		pending[num_pending].kind = kind;
+		++num_pending;
+	}
+}
+
+static void
+stream_free(void)
+{
+	int	d, k;
+
+	for (d = 0; d <= MAX_DEPTH; ++d) {
+		for (k = 0; k < NUM_KINDS; ++k) {
+			free(depth_objs[d][k].objs);
+			depth_objs[d][k].objs = NULL;
+			depth_objs[d][k].num = depth_objs[d][k].size = 0;
+		}
+	}
+	free(pending);
+	pending = NULL;
+	num_pending = size_pending = 0;
+	free(compound_start);
+	compound_start = NULL;
+	num_compounds = size_compounds = 0;
+	num_streamed = 0;
+}
+
+/* draw the primitive object read into com */
+static void
+draw_object(F_compound *com, struct driver *dev)
+{
+	if (com->arcs)
+		dev->arc(com->arcs);
+	else if (com->ellipses)
+		dev->ellipse(com->ellipses);
+	else if (com->lines)
+		dev->line(com->lines);
+	else if (com->splines)
+		dev->spline(com->splines);
+	else if (com->texts)
+		dev->text(com->texts);
+}
+
+static int
+gendev_stream(F_compound *objects, FILE *in, struct driver *dev)
+{
+	F_compound		*obj;
+	struct stream_list	*list;
+	struct stream_pos	*p;
+	int			d, k;
+	int			status = 0;
+
+	/* as in gendev_objects(), fail only on a file without objects */
+	if (num_streamed == 0) {
+		stream_free();
+		fprintf(stderr, "fig2dev: No objects in Fig file\n");
+		return -1;
+	}
+
+	(*dev->start)(objects);
+	(*dev->grid)(grid_major_spacing, grid_minor_spacing);
+
+	for (d = MAX_DEPTH; d >= 0 && status == 0; --d) {
+		for (k = 0; k < NUM_KINDS && status == 0; ++k) {
+			list = &depth_objs[d][k];
+			for (p = list->objs; p < list->objs + list->num; ++p) {
+				if (!Compound_malloc(obj)) {
+					put_msg(Err_mem);
+					status = -1;
+					break;
+				}
+				/* messages were given on the first reading */
+				msg_quiet = 1;
+				status = read_fig_object(in, p->pos, p->line_no,
+						obj);
+				msg_quiet = 0;
+				if (status) {
+					put_msg("Could not read the input file "
+							"again.");
+					free_compound(&obj);
+					arena_use(objects->arena);
+					break;
+				}
+				if (simplify_dist > 0.0)
+					simplify_compound(obj, simplify_dist,
+							&points_before,
+							&points_after);
+				draw_object(obj, dev);
+				free_compound(&obj);
+				/* freeing obj also ended the use of its arena */
+				arena_use(objects->arena);
+			}
+		}
+	}
+	stream_free();
+	if (simplify_dist > 0.0)
+		simplify_report();
+
+	if (status) {
+		(void)(*dev->end)();
+		return -1;
+	}
+	return (*dev->end)();
+}
+
+static void
+simplify_report(void)
+{
+	put_msg("Simplified lines and splines from %ld to %ld points.",
+			points_before, points_after);
+}
+
 /* null operations */
 void
 gendev_null(void)
@@ -1055,6 +1821,7 @@ void
 depth_option(char *s)
 {
 	struct depth_opts *d;
+	int	i, last;
 
 	switch (depth_op = *s++) {
 	case '+':
@@ -1086,22 +1853,23 @@ depth_option(char *s)
 		exit(1);
 	}
 	d->d1 = -1;
+
+	/* compile the list of depths, given with one or more -D options */
+	for (i = 0; i <= MAX_DEPTH; ++i)
+		depth_shown[i] = (depth_op == '-');
+	for (d = depth_opt; d->d1 >= 0; d++) {
+		last = d->d2 >= 0 ? d->d2 : d->d1;
+		for (i = d->d1; i <= last && i <= MAX_DEPTH; ++i)
+			depth_shown[i] = (depth_op == '+');
+	}
 }
 
 int
 depth_filter(int obj_depth)
 {
-	struct depth_opts *d;
-
 	if (depth_index <= 0)		/* no filters were set up */
 		return 1;
-	for (d = depth_opt; d->d1 >= 0; d++)
-		if (d->d2 >= 0) {	/* it's a range comparison */
-			if (obj_depth >= d->d1 && obj_depth <= d->d2)
-				return (depth_op=='+')? 1:0;
-		} else {		/* it's a single-value comparison */
-			if (d->d1 == obj_depth)
-				return (depth_op=='+')? 1:0;
-		}
-	return (depth_op=='-')? 1:0;
+	if (obj_depth < 0 || obj_depth > MAX_DEPTH)
+		return (depth_op=='-')? 1:0;
+	return depth_shown[obj_depth];
 }
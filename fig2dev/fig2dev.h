@@ -63,11 +63,17 @@ struct driver {
 	int text_include;	/* include text length in bounding box */
 #define INCLUDE_TEXT 1
 #define EXCLUDE_TEXT 0
+	int stream;		/* objects can be read and drawn one at a time,
+				   start() only uses the comments of the figure */
+#define STREAM_OBJECTS 1
+#define NO_STREAM 0
 };
 
 extern void	gendev_null(void);
 extern void	gendev_nogrid(float major, float minor);
 extern void	print_comments(char *string1, F_comment *comment,char *string2);
+extern F_pos	*line_points(F_line *l, int *n);
+extern void	line_changed(F_line *l);
 extern int	depth_filter(int obj_depth);
 
 extern const char	prog[];
@@ -21,8 +21,14 @@
 #include <stdlib.h>
 
 #include "object.h"
+#include "arena.h"
 #include "free.h"
 
+/*
+ * Points, control points, arrows and comments are allocated from the arena
+ * of the figure and are released together with the top-level compound.
+ */
+
 void
 free_arc(F_arc **list)
 {
@@ -31,9 +37,6 @@ free_arc(F_arc **list)
 	for (a = *list; a != NULL;) {
 	    arc = a;
 	    a = a->next;
-	    if (arc->for_arrow) free(arc->for_arrow);
-	    if (arc->back_arrow) free(arc->back_arrow);
-	    if (arc->comments) free_comments(arc->comments);
 	    free(arc);
 	}
 	*list = NULL;
@@ -53,7 +56,7 @@ free_compound(F_compound **list)
 	    free_line(&compound->lines);
 	    free_spline(&compound->splines);
 	    free_text(&compound->texts);
-	    if (compound->comments) free_comments(compound->comments);
+	    if (compound->arena) arena_free(compound->arena);
 	    free(compound);
 	}
 	*list = NULL;
@@ -67,7 +70,6 @@ free_ellipse(F_ellipse **list)
 	for (e = *list; e != NULL;) {
 	    ellipse = e;
 	    e = e->next;
-	    if (ellipse->comments) free_comments(ellipse->comments);
 	    free(ellipse);
 	}
 	*list = NULL;
@@ -95,7 +97,6 @@ free_text(F_text **list)
 	    text = t;
 	    t = t->next;
 	    free(text->cstring);
-	    if (text->comments) free_comments(text->comments);
 	    free(text);
 	}
 	*list = NULL;
@@ -117,34 +118,12 @@ free_spline(F_spline **list)
 void
 free_splinestorage(F_spline *s)
 {
-	F_point		*p, *q;
-	F_control	*a, *b;
-
-	for (p = s->points; p != NULL; p = q) {
-	    q = p->next;
-	    free(p);
-	}
-	for (a = s->controls; a != NULL; a = b) {
-	    b = a->next;
-	    free(a);
-	}
-	if (s->for_arrow) free(s->for_arrow);
-	if (s->back_arrow) free(s->back_arrow);
-	if (s->comments) free_comments(s->comments);
 	free(s);
 }
 
 void
 free_linestorage(F_line *l)
 {
-	F_point	*p, *q;
-
-	for (p = l->points; p != NULL; p = q) {
-	    q = p->next;
-	    free(p);
-	    }
-	if (l->for_arrow) free(l->for_arrow);
-	if (l->back_arrow) free(l->back_arrow);
 	if (l->pic) {
 		free(l->pic->file);
 		free(l->pic->bitmap);
@@ -153,18 +132,5 @@ free_linestorage(F_line *l)
 #endif
 		free(l->pic);
 	}
-	if (l->comments) free_comments(l->comments);
 	free(l);
 }
-
-void
-free_comments(F_comment *c)
-{
-	F_comment	*d, *n;
-
-	for (d = c; d != NULL; d = n) {
-		n = d->next;
-		free(d->comment);
-		free(d);
-	}
-}
@@ -27,6 +27,5 @@ void free_text(F_text **list);
 void free_spline(F_spline **list);
 void free_splinestorage(F_spline *s);
 void free_linestorage(F_line *l);
-void free_comments(F_comment *c);
 
 #endif /* FREE_H */
@@ -31,6 +31,8 @@
 char	Err_badarg[] = "Argument -%c unknown to %s driver.";
 char	Err_mem[] = "Running out of memory.";
 
+int	msg_quiet = 0;	/* if set, put_msg() prints nothing */
+
 /*
  * err_msg() is basically a wrapper around
  *   sprintf(msg, fmt, ...);
@@ -65,6 +67,9 @@ void
 put_msg(char *fmt, ...)
 {
 	va_list argptr;
+
+	if (msg_quiet)
+		return;
 	va_start(argptr, fmt);
 	vfprintf(stderr, fmt, argptr);
 	va_end(argptr);
@@ -19,6 +19,7 @@
 
 extern char	Err_badarg[];
 extern char	Err_mem[];
+extern int	msg_quiet;
 
 extern void	err_msg(char *fmt, ...);
 extern void	put_msg(char *fmt, ...);
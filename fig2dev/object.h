@@ -57,9 +57,11 @@ typedef struct f_comment {
 	struct f_comment	*next;
 } F_comment;
 
+#define MAX_DEPTH	999	/* objects have depths 0..MAX_DEPTH */
+
 #define COMMON_PROPERTIES(o)						\
 	o->style < SOLID_LINE || o->style > DASH_3_DOTS_LINE ||		\
-	o->thickness < 0 || o->depth < 0 || o->depth > 999 ||		\
+	o->thickness < 0 || o->depth < 0 || o->depth > MAX_DEPTH ||	\
 	o->fill_style < UNFILLED ||					\
 	o->fill_style >= NUMSHADES + NUMTINTS + NUMPATTERNS ||		\
 	o->style_val < 0.0
@@ -153,6 +155,8 @@ typedef struct f_line {
 	int			radius;	/* for T_ARC_BOX */
 	int			num_points;
 	struct f_pos		last[2]; /* last and penultimate point */
+	struct f_pos		*pos;	/* the points as array, see line_points() */
+	int			npos;	/* number of points in pos */
 	struct f_pic		*pic;
 	struct f_comment	*comments;
 	struct f_line		*next;
@@ -253,7 +257,8 @@ typedef struct f_text {
 	t->type < T_LEFT_JUSTIFIED || t->type > T_RIGHT_JUSTIFIED ||	\
 	t->font < DEFAULT || t->font > MAX_PSFONT || t->size < 0.0 ||	\
 	t->flags < DEFAULT || t->flags >= 2 * HIDDEN_TEXT ||		\
-	t->height < 0 || t->length < 0 || t->angle < -7. || t->angle > 7.
+	t->height < 0 || t->length < 0 || t->angle < -7. || t->angle > 7. ||\
+	t->depth < 0 || t->depth > MAX_DEPTH
 
 typedef struct f_control {
 	double			lx, ly, rx, ry;	/* used by older versions*/
@@ -315,6 +320,7 @@ typedef struct f_compound {
 	struct f_compound	*compounds;
 	struct f_comment	*comments;
 	struct f_compound	*next;
+	struct arena		*arena;	/* only in the top-level compound */
 } F_compound;
 
 #define		ARROW_SIZE		sizeof(struct f_arrow)
@@ -44,6 +44,13 @@
 #include "lib/getline.h"
 #endif
 
+/* the input is read by a single thread, locking the stream is not necessary */
+#ifdef HAVE_GETC_UNLOCKED
+#define	GETC(fp)	getc_unlocked(fp)
+#else
+#define	GETC(fp)	getc(fp)
+#endif
+
 
 User_color	 user_colors[MAX_USR_COLS];		/* fig2dev.h */
 int		 user_col_indx[MAX_USR_COLS];		/* fig2dev.h */
@@ -54,7 +61,13 @@ int		 v21_flag;		/* Protocol V2.1 or higher */
 int		 v30_flag;		/* Protocol V3.0 or higher */
 int		 v32_flag;		/* Protocol V3.2 or higher */
 
+static int		read_fp(FILE *fp, F_compound *obj);
 static int		read_objects(FILE *fp, F_compound *obj);
+static int		read_body(FILE *fp, F_compound *obj,
+					char **restrict line, size_t *line_len,
+					int *line_no, bool single);
+static void		discard_objects(F_compound *obj);
+static void		free_comment_array(void);
 static void		read_colordef(char *line, int line_no);
 static F_ellipse	*read_ellipseobject(char *line, int line_no);
 static F_line		*read_lineobject(FILE *fp, char **restrict line,
@@ -70,7 +83,8 @@ static F_compound	*read_compoundobject(FILE *fp, char **restrict line,
 static F_comment	*attach_comments(void);
 static F_arrow		*make_arrow(int type, int style, double thickness,
 					double wid, double ht, int line_no);
-static void		count_lines_correctly(FILE *fp, int *line_no);
+static int		read_int(FILE *fp, int *val, int *line_no);
+static int		read_double(FILE *fp, double *val, int *line_no);
 static void		init_pats_used(void);
 static ssize_t		get_line(FILE *fp, char **restrict line,
 					size_t *line_len, int *line_no);
@@ -91,7 +105,8 @@ static char	*comments[MAXCOMMENTS];	/* comments saved for current object */
 static int	 numcom;		/* current comment index */
 static bool	 com_alloc = false;	/* whether or not the comment array
 					 * has been initialized */
-
+static object_hook_fn	object_hook = NULL;	/* see read_fig_stream() */
+static struct arena	*stream_arena = NULL;	/* holds the streamed object */
 
 /**********************************************************
 Read_fig returns :
@@ -104,10 +119,13 @@ Read_fig returns :
 The resolution (ppi) is stored in global "ppi"
 **********************************************************/
 
-int
-read_fig(char *file_name, F_compound *obj)
+/*
+ * Open the regular file file_name for reading. Return 0 on success,
+ * otherwise a return value of read_fig().
+ */
+static int
+open_fig(char *file_name, FILE **fp)
 {
-	FILE		*fp;
 	struct stat	sb;
 
 	if (stat(file_name, &sb))
@@ -118,20 +136,114 @@ read_fig(char *file_name, F_compound *obj)
 		return -1;
 	}
 
-	if ((fp = fopen(file_name, "r")) == NULL)
+	if ((*fp = fopen(file_name, "r")) == NULL)
 		return -3;
+	return 0;
+}
+
+int
+read_fig(char *file_name, F_compound *obj)
+{
+	FILE	*fp;
+	int	status;
+
+	if ((status = open_fig(file_name, &fp)))
+		return status;
+	return readfp_fig(fp, obj);
+}
+
+/*
+ * Read the file file_name, but pass each object to hook(), instead of storing
+ * it in obj. Only the figure comments are stored in obj. Each primitive
+ * object, also one inside a compound, is passed alone in a compound, together
+ * with its position in the file and the number of the line before the object,
+ * and is then discarded. Compounds are not passed, but hook() is called at
+ * the start and at the end of each compound. The objects can be read again
+ * with read_fig_object(), from the stream returned in *fpp, which the caller
+ * must close. Figures in the format 1.3 are stored
+ * in obj as usual, hook() is not called and *fpp is set to NULL.
+ * Return values are those of read_fig().
+ */
+int
+read_fig_stream(char *file_name, F_compound *obj, object_hook_fn hook,
+		FILE **fpp)
+{
+	FILE	*fp;
+	int	status;
+
+	*fpp = NULL;
+	if ((status = open_fig(file_name, &fp)))
+		return status;
+
+	object_hook = hook;
+	status = read_fp(fp, obj);
+	object_hook = NULL;
+
+	if (status || obj->arcs || obj->compounds || obj->ellipses ||
+			obj->lines || obj->splines || obj->texts)
+		(void)fclose(fp);
 	else
-		return readfp_fig(fp, obj);
+		*fpp = fp;
+	return status;
+}
+
+/*
+ * Read the object that starts at position pos of the stream fp into obj.
+ * line_no is the number of the line before the object.
+ * The stream and pos must be one passed to the hook of read_fig_stream().
+ */
+int
+read_fig_object(FILE *fp, long pos, int line_no, F_compound *obj)
+{
+	char	*line;
+	size_t	line_len = 256;
+	int	status;
+
+	memset((void *)obj, '\0', COMOBJ_SIZE);
+	if ((obj->arena = arena_new()) == NULL) {
+		put_msg(Err_mem);
+		return -1;
+	}
+	arena_use(obj->arena);
+
+	if (fseek(fp, pos, SEEK_SET))
+		return -3;
+	if ((line = malloc(line_len)) == NULL) {
+		put_msg(Err_mem);
+		return -1;
+	}
+	numcom = 0;
+	status = read_body(fp, obj, &line, &line_len, &line_no, true);
+	free(line);
+	free_comment_array();
+	return status;
 }
 
 int
 readfp_fig(FILE *fp, F_compound *obj)
+{
+	int	status;
+
+	status = read_fp(fp, obj);
+	if (fp != stdin)
+		(void)fclose(fp);
+	return status;
+}
+
+/*
+ * Read a Fig file from fp into obj, but do not close fp.
+ */
+static int
+read_fp(FILE *fp, F_compound *obj)
 {
 	char	c;
 	int	i, status;
 
 	num_usr_cols = 0;
 	init_pats_used();
+	memset(std_color_used, '\0', sizeof std_color_used);
+	arrows_used = false;
+	memset(arrow_used, '\0', sizeof arrow_used);
 
 	/* reset comment number */
 	numcom = 0;
@@ -142,6 +254,13 @@ readfp_fig(FILE *fp, F_compound *obj)
 	com_alloc = true;
 	memset((void *)obj, '\0', COMOBJ_SIZE);
 
+	/* the parts of the objects are released together with obj */
+	if ((obj->arena = arena_new()) == NULL) {
+		put_msg(Err_mem);
+		return -1;
+	}
+	arena_use(obj->arena);
+
 	/* read first character to see if it is "#" (#FIG 1.4 and newer) */
 	c = fgetc(fp);
 	if (feof(fp))
@@ -152,30 +271,29 @@ readfp_fig(FILE *fp, F_compound *obj)
 		status = read_objects(fp, obj);
 	else
 		status = read_1_3_objects(fp, obj);
-	if (fp != stdin)
-		(void)fclose(fp);
-	/* free the comment array */
+	free_comment_array();
+	return status;
+}
+
+/* free the comment array */
+static void
+free_comment_array(void)
+{
+	int	i;
+
 	if (com_alloc)
 		for (i = 0; i < MAXCOMMENTS; ++i)
 			if (comments[i]) {
 				free(comments[i]);
 				comments[i] = NULL;
 			}
-	return status;
 }
 
 int
 read_objects(FILE *fp, F_compound *obj)
 {
-	F_ellipse	*e, *le = NULL;
-	F_line		*l, *ll = NULL;
-	F_text		*t, *lt = NULL;
-	F_spline	*s, *ls = NULL;
-	F_arc		*a, *la = NULL;
-	F_compound	*c, *lc = NULL;
-	bool		objects = false;
-	int		i;
-	int		object, coord_sys;
+	int		i, status;
+	int		coord_sys;
 	int		line_no;
 	int		gif_colnum = 0;
 	char		*line;
@@ -424,29 +542,97 @@ read_objects(FILE *fp, F_compound *obj)
 	/* attach any comments found thus far to the whole figure */
 	obj->comments = attach_comments();
 
-	while (get_line(fp, &line, &line_len, &line_no) > 0) {
-		if (sscanf(line, "%d", &object) != 1) {
-			put_msg("Incorrect format at line %d.", line_no);
+	if (object_hook) {
+		/* read each object into a compound of its own */
+		F_compound	part;
+
+		memset((void *)&part, '\0', COMOBJ_SIZE);
+		if ((part.arena = arena_new()) == NULL) {
+			put_msg(Err_mem);
 			free(line);
 			return -1;
 		}
+		arena_use(part.arena);
+		stream_arena = part.arena;
+		status = read_body(fp, &part, &line, &line_len, &line_no,false);
+		discard_objects(&part);
+		stream_arena = NULL;
+		arena_free(part.arena);
+		arena_use(obj->arena);
+	} else {
+		status = read_body(fp, obj, &line, &line_len, &line_no, false);
+	}
+	free(line);
+	if (status)
+		return status;
+
+	/* if user color was requested for GIF transparent color, get the
+	   rgb values from the user color array now that we've read them in */
+	if (gif_colnum >= NUM_STD_COLS) {
+		int	i;
+		/* read_colordef() counted, but ignored too many user colors */
+		if (num_usr_cols > MAX_USR_COLS)
+			num_usr_cols = MAX_USR_COLS;
+		for (i=0; i < num_usr_cols; ++i)
+			if (user_col_indx[i] == gif_colnum)
+				break;
+		if (i < num_usr_cols)
+			sprintf(gif_transparent, "#%2x%2x%2x", user_colors[i].r,
+					user_colors[i].g, user_colors[i].b);
+	}
+
+	if (feof(fp))
+		return 0;
+	else
+		return -3;
+} /* read_objects */
+
+/*
+ * Read the objects following the header of a Fig file into obj.
+ * If single is true, read only the next object.
+ * If object_hook is set, each object is passed to object_hook() and is then
+ * discarded, see read_fig_stream(). Thus, obj holds only one object at a time.
+ */
+static int
+read_body(FILE *fp, F_compound *obj, char **restrict line, size_t *line_len,
+		int *line_no, bool single)
+{
+	F_ellipse	*e, *le = NULL;
+	F_line		*l, *ll = NULL;
+	F_text		*t, *lt = NULL;
+	F_spline	*s, *ls = NULL;
+	F_arc		*a, *la = NULL;
+	F_compound	*c, *lc = NULL;
+	bool		objects = single;
+	int		object;
+	int		start_line = 0;
+	long		pos = 0;
+
+	for (;;) {
+		if (object_hook) {
+			pos = ftell(fp);
+			start_line = *line_no;
+		}
+		if (get_line(fp, line, line_len, line_no) <= 0)
+			break;
+		if (sscanf(*line, "%d", &object) != 1) {
+			put_msg("Incorrect format at line %d.", *line_no);
+			return -1;
+		}
 		switch (object) {
 		case OBJ_COLOR_DEF:
 			if (objects) {
 				put_msg("Color definitions must come before "
 						"other objects (line %d).",
-						line_no);
-				free(line);
+						*line_no);
 				return -1;
 			}
-			read_colordef(line, line_no);
-			break;
+			read_colordef(*line, *line_no);
+			continue;
 		case OBJ_POLYLINE :
-			if ((l = read_lineobject(fp, &line, &line_len,
-							&line_no)) == NULL) {
-				free(line);
+			if ((l = read_lineobject(fp, line, line_len, line_no))
+					== NULL)
 				return -1;
-			}
 #ifdef V4_0
 			if ((l->pic != NULL) && (l->pic->figure != NULL)) {
 				if (lc)
@@ -468,104 +654,95 @@ read_objects(FILE *fp, F_compound *obj)
 				ll = (ll->next = l);
 			else
 				ll = obj->lines = l;
-			objects = true;
 			break;
 #endif /* V4_0 */
 		case OBJ_SPLINE :
-			if ((s = read_splineobject(fp, &line, &line_len,
-							&line_no)) == NULL) {
-				free(line);
+			if ((s = read_splineobject(fp, line, line_len, line_no))
+					== NULL)
 				return -1;
-			}
 			if (v32_flag){ /* s is a line */
 				if (ll)
 					ll = (ll->next = (F_line *) s);
 				else
 					ll = obj->lines = (F_line *) s;
-				objects = true;
 				break;
 			}
 			if (ls)
 				ls = (ls->next = s);
 			else
 				ls = obj->splines = s;
-			objects = true;
 			break;
 		case OBJ_ELLIPSE :
-			if ((e = read_ellipseobject(line, line_no)) == NULL) {
-				free(line);
+			if ((e = read_ellipseobject(*line, *line_no)) == NULL)
 				return -1;
-			}
 			if (le)
 				le = (le->next = e);
 			else
 				le = obj->ellipses = e;
-			objects = true;
 			break;
 		case OBJ_ARC :
-			if ((a = read_arcobject(fp, &line, &line_len, &line_no))
-					== NULL) {
-				free(line);
+			if ((a = read_arcobject(fp, line, line_len, line_no))
+					== NULL)
 				return -1;
-			}
 			if (la)
 				la = (la->next = a);
 			else
 				la = obj->arcs = a;
-			objects = true;
 			break;
 		case OBJ_TEXT :
-			if ((t = read_textobject(fp, &line, &line_len,
-							&line_no)) == NULL) {
-				free(line);
+			if ((t = read_textobject(fp, line, line_len, line_no))
+					== NULL)
 				return -1;
-			}
 			if (lt)
 				lt = (lt->next = t);
 			else
 				lt = obj->texts = t;
-			objects = true;
 			break;
 		case OBJ_COMPOUND :
-			if ((c = read_compoundobject(fp, &line, &line_len,
-							&line_no)) == NULL) {
-				free(line);
+			if ((c = read_compoundobject(fp, line, line_len,
+							line_no)) == NULL)
 				return -1;
-			}
 			if (lc)
 				lc = (lc->next = c);
 			else
 				lc = obj->compounds = c;
-			objects = true;
 			break;
 		default :
-			put_msg("Incorrect object code at line %d.", line_no);
-			free(line);
+			put_msg("Incorrect object code at line %d.", *line_no);
 			return -1;
 		} /* switch */
-	} /* while (get_line(...)) */
-	free(line);
 
-	/* if user color was requested for GIF transparent color, get the
-	   rgb values from the user color array now that we've read them in */
-	if (gif_colnum >= NUM_STD_COLS) {
-		int	i;
-		/* read_colordef() counted, but ignored too many user colors */
-		if (num_usr_cols > MAX_USR_COLS)
-			num_usr_cols = MAX_USR_COLS;
-		for (i=0; i < num_usr_cols; ++i)
-			if (user_col_indx[i] == gif_colnum)
-				break;
-		if (i < num_usr_cols)
-			sprintf(gif_transparent, "#%2x%2x%2x", user_colors[i].r,
-					user_colors[i].g, user_colors[i].b);
+		objects = true;
+		if (single)
+			return 0;
+		if (object_hook) {
+			/* the objects of a compound were already passed */
+			if (object != OBJ_COMPOUND)
+				(*object_hook)(STREAM_OBJECT, obj, pos,
+						start_line);
+			discard_objects(obj);
+			le = NULL; ll = NULL; lt = NULL;
+			ls = NULL; la = NULL; lc = NULL;
+		}
 	}
+	return 0;
+}
 
-	if (feof(fp))
-		return 0;
-	else
-		return -3;
-} /* read_objects */
+/*
+ * Free the objects in obj and the memory of the arena used while streaming,
+ * but keep obj.
+ */
+static void
+discard_objects(F_compound *obj)
+{
+	free_arc(&obj->arcs);
+	free_compound(&obj->compounds);
+	free_ellipse(&obj->ellipses);
+	free_line(&obj->lines);
+	free_spline(&obj->splines);
+	free_text(&obj->texts);
+	arena_clear(stream_arena);
+}
 
 static void
 read_colordef(char *line, int line_no)
@@ -787,6 +964,8 @@ read_compoundobject(FILE *fp, char **restrict line, size_t *line_len,
 	F_text		*t, *lt = NULL;
 	F_compound	*com, *c, *lc = NULL;
 	int		n, object;
+	int		start_line = 0;
+	long		pos = 0;
 
 	Compound_malloc(com);
 	com->arcs = NULL;
@@ -796,6 +975,7 @@ read_compoundobject(FILE *fp, char **restrict line, size_t *line_len,
 	com->texts = NULL;
 	com->compounds = NULL;
 	com->next = NULL;
+	com->arena = NULL;
 	com->comments = attach_comments();	/* attach any comments */
 
 	n = sscanf(*line, "%*d%d%d%d%d", &com->nwcorner.x, &com->nwcorner.y,
@@ -805,7 +985,18 @@ read_compoundobject(FILE *fp, char **restrict line, size_t *line_len,
 		free(com);
 		return NULL;
 	}
-	while (get_line(fp, line, line_len, line_no) > 0) {
+	if (object_hook) {
+		/* the comments are discarded with the next object */
+		com->comments = NULL;
+		(*object_hook)(STREAM_BEGIN_COMPOUND, NULL, 0L, *line_no);
+	}
+	for (;;) {
+		if (object_hook) {
+			pos = ftell(fp);
+			start_line = *line_no;
+		}
+		if (get_line(fp, line, line_len, line_no) <= 0)
+			break;
 		if (sscanf(*line, "%d", &object) != 1) {
 			put_msg(Err_incomp, "compound", *line_no);
 			free_compound(&com);
@@ -897,17 +1088,32 @@ read_compoundobject(FILE *fp, char **restrict line, size_t *line_len,
 				lc = com->compounds = c;
 			break;
 		case OBJ_END_COMPOUND :
+			if (object_hook)
+				(*object_hook)(STREAM_END_COMPOUND, NULL, 0L,
+						*line_no);
 			return com;
 		default :
 			put_msg("Wrong object code at line %d", *line_no);
 			free_compound(&com);
 			return NULL;
 		} /* switch */
+
+		if (object_hook) {
+			if (object != OBJ_COMPOUND)
+				(*object_hook)(STREAM_OBJECT, com, pos,
+						start_line);
+			discard_objects(com);
+			le = NULL; ll = NULL; lt = NULL;
+			ls = NULL; la = NULL; lc = NULL;
+		}
 	}
-	if (feof(fp))
+	if (feof(fp)) {
+		if (object_hook)
+			(*object_hook)(STREAM_END_COMPOUND, NULL, 0L, *line_no);
 		return com;
-	else
+	} else {
 		return NULL;
+	}
 }
 
 static F_ellipse *
@@ -1008,7 +1214,7 @@ sanitize_lineobject(F_line *l, int line_no)
 			q->x = l->last[0].x;
 			q->y = l->last[0].y;
 			l->points = q;
-			++l->num_points;
+			line_changed(l);
 		}
 
 		/* reject incorrect arc-boxes and picture boxes */
@@ -1051,17 +1257,11 @@ sanitize_lineobject(F_line *l, int line_no)
 				/* the polygon is closed or was closed above,
 				   hence it has at least two points */
 				if (l->num_points == 2) {
-					free(l->points->next);
 					l->points->next = NULL;
-					l->last[0].x = l->points->x;
-					l->last[0].y = l->points->y;
+					line_changed(l);
 				} else if (l->num_points == 3) {
-					free(l->points->next->next);
 					l->points->next->next = NULL;
-					l->last[0].x = l->points->next->x;
-					l->last[0].y = l->points->next->y;
-					l->last[1].x = l->points->x;
-					l->last[1].y = l->points->y;
+					line_changed(l);
 				} /* else (l->num_points == 1) */
 
 			/* convert misformed rectangles to polygons */
@@ -1097,13 +1297,11 @@ sanitize_lineobject(F_line *l, int line_no)
 				/* tests/testsuite -k polyline,read.c */
 				put_msg("A single point with a forward arrow - "
 						"remove the arrow.");
-				free(l->for_arrow);
 				l->for_arrow = NULL;
 			}
 			if (l->back_arrow) {
 				put_msg("A single point with a backward arrow -"
 						" remove the arrow.");
-				free(l->back_arrow);
 				l->back_arrow = NULL;
 			}
 		}
@@ -1124,6 +1322,7 @@ read_lineobject(FILE *fp, char **restrict line, size_t *line_len, int *line_no)
 
 	Line_malloc(l);
 	l->points = NULL;
+	l->pos = NULL;
 	l->pen = 0;
 	l->fill_style = 0;
 	l->for_arrow = NULL;
@@ -1276,7 +1475,7 @@ read_lineobject(FILE *fp, char **restrict line, size_t *line_len, int *line_no)
 
 	/* read first point of line */
 	++(*line_no);
-	if (fscanf(fp, "%d%d", &p->x, &p->y) != 2) {
+	if (read_int(fp, &p->x, line_no) || read_int(fp, &p->y, line_no)) {
 		put_msg(Err_incomp, "line", *line_no);
 		free_linestorage(l);
 		return NULL;
@@ -1288,8 +1487,7 @@ read_lineobject(FILE *fp, char **restrict line, size_t *line_len, int *line_no)
 	else
 		l->num_points = npts;
 	for (--npts; npts > 0; --npts) {
-		count_lines_correctly(fp, line_no);
-		if (fscanf(fp, "%d%d", &x, &y) != 2) {
+		if (read_int(fp, &x, line_no) || read_int(fp, &y, line_no)) {
 			put_msg(Err_incomp, "line", *line_no);
 			free_linestorage(l);
 			return NULL;
@@ -1446,7 +1644,7 @@ read_splineobject(FILE *fp, char **restrict line, size_t *line_len,
 	/* Read points */
 	/* read first point of line */
 	++(*line_no);
-	if ((n = fscanf(fp, "%d%d", &x, &y)) != 2) {
+	if (read_int(fp, &x, line_no) || read_int(fp, &y, line_no)) {
 		put_msg(Err_incomp, "spline", *line_no);
 		free_splinestorage(s);
 		return NULL;
@@ -1466,9 +1664,7 @@ read_splineobject(FILE *fp, char **restrict line, size_t *line_len,
 		return NULL;
 	}
 	for (--npts; npts > 0; --npts) {
-		/* keep track of newlines for line counter */
-		count_lines_correctly(fp, line_no);
-		if (fscanf(fp, "%d%d", &x, &y) != 2) {
+		if (read_int(fp, &x, line_no) || read_int(fp, &y, line_no)) {
 			put_msg(Err_incomp, "spline", *line_no);
 			free_splinestorage(s);
 			return NULL;
@@ -1504,9 +1700,7 @@ read_splineobject(FILE *fp, char **restrict line, size_t *line_len,
 		make_control_factors(s);
 		ptr = s->controls;
 		while (ptr) {	/* read controls */
-			/* keep track of newlines for line counter */
-			count_lines_correctly(fp, line_no);
-			if ((n = fscanf(fp, "%lf", &control_s)) != 1) {
+			if (read_double(fp, &control_s, line_no)) {
 				put_msg(Err_incomp, "spline", *line_no);
 				free_splinestorage(s);
 				return NULL;
@@ -1559,9 +1753,10 @@ read_splineobject(FILE *fp, char **restrict line, size_t *line_len,
 	}
 	++c;
 	while (--c) {
-		/* keep track of newlines for line counter */
-		count_lines_correctly(fp, line_no);
-		if (fscanf(fp, "%lf%lf%lf%lf", &lx, &ly, &rx, &ry) != 4) {
+		if (read_double(fp, &lx, line_no) ||
+				read_double(fp, &ly, line_no) ||
+				read_double(fp, &rx, line_no) ||
+				read_double(fp, &ry, line_no)) {
 			put_msg(Err_incomp, "spline", *line_no);
 			cp->next = NULL;
 			free_splinestorage(s);
@@ -1588,11 +1783,8 @@ read_splineobject(FILE *fp, char **restrict line, size_t *line_len,
 		cp->next = cq;
 		cp = cq;
 	}
-	/* temporarily use cp->next to delete the first, dummy point */
-	cp->next = s->controls;
+	/* skip the first, dummy point */
 	s->controls = s->controls->next;
-	free(cp->next);
-
 	cp->next = NULL;
 
 	/* skip to the end of the line */
@@ -1799,21 +1991,19 @@ static F_comment *
 attach_comments(void)
 {
 	int		i;
-	F_comment	*comp, *icomp;
+	F_comment	*comp, *icomp = NULL;
+	F_comment	**next = &icomp;
 
-	if (numcom == 0)
-		return NULL;
-
-	icomp = comp = (F_comment *) malloc(COMMENT_SIZE);
-	for (i=0; i<numcom; i++) {
-		comp->comment = malloc(strlen(comments[i])+1);
-		strcpy(comp->comment, comments[i]);
-		if (i<numcom-1) {
-			comp->next = (F_comment *) malloc(COMMENT_SIZE);
-			comp = comp->next;
-		} else
-			comp->next = NULL;
+	for (i = 0; i < numcom; i++) {
+		if (!Comment_malloc(comp) ||
+				!(comp->comment = arena_strdup(comments[i]))) {
+			put_msg(Err_mem);
+			break;
+		}
+		*next = comp;
+		next = &comp->next;
 	}
+	*next = NULL;
 	/* reset comment number */
 	numcom = 0;
 	return icomp;
@@ -2033,16 +2223,76 @@ static int pop() {
  * Added by Andreas_Bagge@maush2.han.de (A.Bagge), 14.12.94
  */
 
-static void
-count_lines_correctly(FILE *fp, int *line_no)
+/*
+ * Skip white space. Return the first other character, or EOF.
+ * Newlines are added to *line_no only if they are followed by another
+ * character, so that an error at the end of the file is reported at the
+ * last line, not beyond.
+ */
+static int
+skip_space(FILE *fp, int *line_no)
 {
-	int	cc;
+	int	c;
+	int	lines = 0;
+
+	while ((c = GETC(fp)) == ' ' || c == '\t' || c == '\n' || c == '\r' ||
+			c == '\f' || c == '\v')
+		if (c == '\n')
+			++lines;
+	if (c != EOF)
+		*line_no += lines;
+	return c;
+}
+
+/*
+ * Read a decimal integer, possibly preceded by white space, from fp.
+ * Return 0 on success, -1 on a malformed or out-of-range number.
+ * This replaces fscanf(fp, "%d", val), which is slow on long point lists.
+ */
+static int
+read_int(FILE *fp, int *val, int *line_no)
+{
+	int		c;
+	bool		neg = false;
+	unsigned int	v = 0;
+	unsigned int	max = INT_MAX;
+
+	c = skip_space(fp, line_no);
+	if (c == '-' || c == '+') {
+		neg = c == '-';
+		if (neg)
+			++max;		/* INT_MIN == -INT_MAX - 1 */
+		c = GETC(fp);
+	}
+	if (c < '0' || c > '9') {
+		if (c != EOF)
+			ungetc(c, fp);
+		return -1;
+	}
 	do {
-		cc = getc(fp);
-		if (cc == '\n') {
-			++(*line_no);
-			cc=getc(fp);
-		}
-	} while (cc == ' ' || cc == '\t');
-	ungetc(cc,fp);
+		if (v > (max - (unsigned)(c - '0')) / 10)
+			return -1;
+		v = 10 * v + (unsigned)(c - '0');
+	} while ((c = GETC(fp)) >= '0' && c <= '9');
+	if (c != EOF)
+		ungetc(c, fp);
+
+	/* avoid -(int)v, which overflows for v == INT_MAX + 1 */
+	*val = neg && v ? -(int)(v - 1) - 1 : (int)v;
+	return 0;
+}
+
+/*
+ * Read a floating point number, possibly preceded by white space, from fp.
+ * Return 0 on success, -1 otherwise.
+ */
+static int
+read_double(FILE *fp, double *val, int *line_no)
+{
+	int	c;
+
+	if ((c = skip_space(fp, line_no)) == EOF)
+		return -1;
+	ungetc(c, fp);
+	return fscanf(fp, "%lf", val) == 1 ? 0 : -1;
 }
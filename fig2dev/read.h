@@ -21,8 +21,21 @@
 #include <stdio.h>
 #include "object.h"
 
+/* the calls of the hook of read_fig_stream() */
+enum stream_event {
+	STREAM_OBJECT,		/* obj holds one object, read from pos */
+	STREAM_BEGIN_COMPOUND,	/* obj is NULL */
+	STREAM_END_COMPOUND	/* obj is NULL */
+};
+typedef void	(*object_hook_fn)(enum stream_event event, F_compound *obj,
+				long pos, int line_no);
+
 extern int	read_fig(char *file_name, F_compound *obj);
 extern int	readfp_fig(FILE *fp, F_compound *obj);
+extern int	read_fig_stream(char *file_name, F_compound *obj,
+				object_hook_fn hook, FILE **fpp);
+extern int	read_fig_object(FILE *fp, long pos, int line_no,
+				F_compound *obj);
 extern void	read_fail_message(char *file, int err);
 extern int	read_1_3_objects(FILE *fp, F_compound *obj);
 
@@ -212,6 +212,7 @@ read_compoundobject(FILE *fp)
 	com->compounds = NULL;
 	com->comments = NULL;
 	com->next = NULL;
+	com->arena = NULL;
 	n = fscanf(fp, " %d %d %d %d\n", &com->nwcorner.x, &com->nwcorner.y,
 		&com->secorner.x, &com->secorner.y);
 	if (n != 4) {
@@ -355,6 +356,7 @@ read_lineobject(FILE *fp)
 	l->next = NULL;
 	l->points = Point_malloc(p);
 	l->points->next = NULL;
+	l->pos = NULL;
 	l->pic = NULL;
 	l->comments = NULL;
 	n = fscanf(fp, " %d %d %d %lf %d %d %d %d %d %d", &t,
@@ -0,0 +1,255 @@
+/*
+ * Fig2dev: Translate Fig code to various Devices
+ * Copyright (c) 1991 by Micah Beck
+ * Parts Copyright (c) 1985-1988 by Supoj Sutanthavibul
+ * Parts Copyright (c) 1989-2015 by Brian V. Smith
+ * Parts Copyright (c) 2015-2024 by Thomas Loimer
+ *
+ * Any party obtaining a copy of these files is granted, free of charge, a
+ * full and unrestricted irrevocable, world-wide, paid up, royalty-free,
+ * nonexclusive right and license to deal in this software and documentation
+ * files (the "Software"), including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense and/or sell copies
+ * of the Software, and to permit persons who receive copies from any such
+ * party to do so, with the only requirement being that the above copyright
+ * and this permission notice remain intact.
+ *
+ */
+
+/*
+ * simplify.c: Remove points from polylines and splines which do not
+ * contribute to the drawing.
+ *
+ * Figures produced by other programs, and x-splines of a Fig 3.2 file,
+ * which are converted to polylines by read.c, may contain far more points
+ * than can be resolved in the output. Here, the Douglas-Peucker algorithm
+ * removes all points that lie closer than a given tolerance to the line
+ * through the remaining points. The first and the last point are always
+ * kept, and also the second and the penultimate point, if the line carries
+ * arrows, to not change the direction of the arrowheads.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fig2dev.h"	/* includes "bool.h" */
+#include "object.h"
+#include "messages.h"
+#include "simplify.h"
+
+/* work space, kept between calls */
+static unsigned char	*keep = NULL;	/* keep[i], whether point i stays */
+static int		*stack = NULL;	/* ranges still to be examined */
+static F_pos		*spos = NULL;	/* the points of a spline */
+static size_t		 size = 0;	/* allocated number of each */
+
+static void
+reserve(int n)
+{
+	if ((size_t)n <= size)
+		return;
+	size = (size_t)n + n / 2;
+	free(keep);
+	free(stack);
+	free(spos);
+	keep = malloc(size * sizeof *keep);
+	stack = malloc(2 * size * sizeof *stack);
+	spos = malloc(size * sizeof *spos);
+	if (keep == NULL || stack == NULL || spos == NULL) {
+		put_msg(Err_mem);
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*
+ * Return the square of the distance of point p from the segment a-b.
+ */
+static double
+dist2(const F_pos *p, const F_pos *a, const F_pos *b)
+{
+	double	dx = (double)b->x - a->x;
+	double	dy = (double)b->y - a->y;
+	double	px = (double)p->x - a->x;
+	double	py = (double)p->y - a->y;
+	double	len2 = dx * dx + dy * dy;
+	double	t;
+
+	if (len2 > 0.0) {
+		t = (px * dx + py * dy) / len2;
+		if (t > 1.0)
+			t = 1.0;
+		if (t > 0.0) {
+			px -= t * dx;
+			py -= t * dy;
+		}
+	}
+	return px * px + py * py;
+}
+
+/*
+ * Mark in keep[] the points between first and last, which deviate more
+ * than sqrt(tol2) from the simplified line. The points first and last are
+ * marked by the caller. Do not recurse, lines may contain a million points.
+ */
+static void
+douglas_peucker(const F_pos *pts, int first, int last, double tol2)
+{
+	int	top = 0;
+	int	a, b, i, imax;
+	double	d, dmax;
+
+	stack[top++] = first;
+	stack[top++] = last;
+	while (top > 0) {
+		b = stack[--top];
+		a = stack[--top];
+		dmax = tol2;
+		imax = -1;
+		for (i = a + 1; i < b; ++i) {
+			d = dist2(pts + i, pts + a, pts + b);
+			if (d > dmax) {
+				dmax = d;
+				imax = i;
+			}
+		}
+		if (imax < 0)
+			continue;
+		keep[imax] = 1;
+		stack[top++] = a;
+		stack[top++] = imax;
+		stack[top++] = imax;
+		stack[top++] = b;
+	}
+}
+
+/*
+ * Mark the points of pts[] to keep, return their number.
+ */
+static int
+mark_points(const F_pos *pts, int n, bool arrows, double tol2)
+{
+	int	i, prev, kept;
+
+	for (i = 0; i < n; ++i)
+		keep[i] = 0;
+	keep[0] = keep[n - 1] = 1;
+	if (arrows && n > 3)
+		keep[1] = keep[n - 2] = 1;
+
+	for (prev = 0, i = 1; i < n; ++i) {
+		if (keep[i]) {
+			douglas_peucker(pts, prev, i, tol2);
+			prev = i;
+		}
+	}
+
+	for (kept = 0, i = 0; i < n; ++i)
+		kept += keep[i];
+	return kept;
+}
+
+/*
+ * Remove the points not marked in keep[] from the list points.
+ */
+static void
+remove_points(F_point *points)
+{
+	F_point	*p, *q;
+	int	i;
+
+	/* the first point is always kept */
+	for (q = points, p = points->next, i = 1; p != NULL; p = p->next, ++i) {
+		if (keep[i]) {
+			q->next = p;
+			q = p;
+		}
+	}
+	q->next = NULL;
+}
+
+static void
+simplify_line(F_line *l, double tol2, long *before, long *after)
+{
+	F_pos	*pts;
+	int	n, kept;
+
+	if (l->type != T_POLYLINE && l->type != T_POLYGON)
+		return;
+	pts = line_points(l, &n);
+	*before += n;
+	if (n < 3) {
+		*after += n;
+		return;
+	}
+	reserve(n);
+	kept = mark_points(pts, n, l->for_arrow || l->back_arrow, tol2);
+	/* a polygon needs at least three corners, and the closing point */
+	if (kept == n || (l->type == T_POLYGON && kept < 4)) {
+		*after += n;
+		return;
+	}
+
+	remove_points(l->points);
+	line_changed(l);
+	*after += kept;
+}
+
+/*
+ * Only approximated splines can be simplified. The control points of
+ * interpolated splines, from Fig files before version 3.2, are computed for
+ * the given points and would need to be computed again.
+ */
+static void
+simplify_spline(F_spline *s, double tol2, long *before, long *after)
+{
+	F_point	*p;
+	int	n, kept;
+
+	for (n = 0, p = s->points; p != NULL; p = p->next)
+		++n;
+	*before += n;
+	if (!approx_spline(s) || n < 3) {
+		*after += n;
+		return;
+	}
+	reserve(n);
+	for (n = 0, p = s->points; p != NULL; p = p->next, ++n) {
+		spos[n].x = p->x;
+		spos[n].y = p->y;
+	}
+	kept = mark_points(spos, n, s->for_arrow || s->back_arrow, tol2);
+	if (kept == n || (closed_spline(s) && kept < 3)) {
+		*after += n;
+		return;
+	}
+	remove_points(s->points);
+	*after += kept;
+}
+
+/*
+ * Simplify the polylines, polygons and approximated splines in com and its
+ * sub-compounds, by removing points closer than tol (in Fig units) to the
+ * simplified line. Add the number of points, before and after, to *before
+ * and *after.
+ */
+void
+simplify_compound(F_compound *com, double tol, long *before, long *after)
+{
+	F_compound	*c;
+	F_line		*l;
+	F_spline	*s;
+	double		tol2 = tol * tol;
+
+	for (c = com; c != NULL; c = c->next) {
+		for (l = c->lines; l != NULL; l = l->next)
+			simplify_line(l, tol2, before, after);
+		for (s = c->splines; s != NULL; s = s->next)
+			simplify_spline(s, tol2, before, after);
+		if (c->compounds)
+			simplify_compound(c->compounds, tol, before, after);
+	}
+}
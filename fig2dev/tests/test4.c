@@ -0,0 +1,98 @@
+/*
+ * Fig2dev: Translate Fig code to various Devices
+ * Copyright (c) 1991 by Micah Beck
+ * Parts Copyright (c) 1985-1988 by Supoj Sutanthavibul
+ * Parts Copyright (c) 1989-2015 by Brian V. Smith
+ * Parts Copyright (c) 2015-2024 by Thomas Loimer
+ *
+ * Any party obtaining a copy of these files is granted, free of charge, a
+ * full and unrestricted irrevocable, world-wide, paid up, royalty-free,
+ * nonexclusive right and license to deal in this software and documentation
+ * files (the "Software"), including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense and/or sell copies
+ * of the Software, and to permit persons who receive copies from any such
+ * party to do so, with the only requirement being that the above copyright
+ * and this permission notice remain intact.
+ *
+ */
+
+/*
+ * test4.c: Check, whether the number formatting in outbuf.c writes the same
+ * as printf().
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "outbuf.h"
+
+static struct outbuf	b;
+static int		failed = 0;
+
+static void
+compare(const char *expected, int len)
+{
+	size_t	n = (size_t)(b.p - b.buf);
+
+	if (n != strlen(expected) || (size_t)len != n ||
+			strncmp(b.buf, expected, n)) {
+		fprintf(stderr, "expected %s, got %.*s\n", expected, (int)n,
+				b.buf);
+		++failed;
+	}
+	b.p = b.buf;
+}
+
+int
+main(void)
+{
+	const int	ints[] = {0, 1, -1, 9, 10, -10, 12345, -987654, INT_MAX,
+				INT_MIN};
+	/* halves, quarters and eighths are ties for the rounding */
+	const double	dbls[] = {0.0, -0.0, 0.04, -0.04, 0.05, 0.15, 0.25,
+				-0.25, 0.35, 0.5, 1.5, 2.5, 0.125, 0.375,
+				1234.5625, -7654.3125, 99.95, 999999.96,
+				1e15 + 0.5, 1e20, -3e300};
+	char		expected[400];
+	int		i, prec;
+	double		x;
+
+	outbuf_init(&b, stdout);
+
+	for (i = 0; i < (int)(sizeof ints / sizeof ints[0]); ++i) {
+		sprintf(expected, "%d", ints[i]);
+		compare(expected, outbuf_int(&b, ints[i]));
+	}
+
+	for (prec = 0; prec < 4; ++prec) {
+		for (i = 0; i < (int)(sizeof dbls / sizeof dbls[0]); ++i) {
+			if (dbls[i] > 1e20 || dbls[i] < -1e20)
+				continue;	/* written without buffer */
+			sprintf(expected, "%.*f", prec, dbls[i]);
+			compare(expected, outbuf_fixed(&b, dbls[i], prec));
+		}
+		/* multiples of 1/64, between -1000 and 1000 */
+		for (x = -1000.0; x < 1000.0; x += 0.015625) {
+			sprintf(expected, "%.*f", prec, x);
+			compare(expected, outbuf_fixed(&b, x, prec));
+		}
+		/* decimal fractions, which are not exactly representable */
+		for (i = -100000; i < 100000; i += 7) {
+			x = i / 1000.0;
+			sprintf(expected, "%.*f", prec, x);
+			compare(expected, outbuf_fixed(&b, x, prec));
+		}
+	}
+
+	if (failed) {
+		fprintf(stderr, "%d numbers differ from printf().\n", failed);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -23,6 +23,7 @@
 #include <math.h>
 
 #include "fig2dev.h"	/* includes bool.h and object.h*/
+#include "alloc.h"
 //#include "object.h"
 #include "free.h"
 #include "messages.h"
@@ -521,12 +522,11 @@ create_line_with_spline(F_spline *s)
   /* copy the comments */
   if (s->comments) {
     scomm = s->comments;
-    line->comments = lcomm = (F_comment *) malloc(COMMENT_SIZE);
+    line->comments = Comment_malloc(lcomm);
     while (scomm) {
-	lcomm->comment = malloc(strlen(scomm->comment)+1);
-	strcpy(lcomm->comment, scomm->comment);
+	lcomm->comment = arena_strdup(scomm->comment);
 	if (scomm->next)
-	    lcomm->next = (F_comment *) malloc(COMMENT_SIZE);
+	    Comment_malloc(lcomm->next);
 	else
 	    lcomm->next = NULL;
 	scomm = scomm->next;
@@ -626,7 +626,7 @@ create_cpoint(void)
 {
     F_control	   *cp;
 
-    if ((cp = (F_control *) malloc(CONTROL_SIZE)) == NULL)
+    if (Control_malloc(cp) == NULL)
 	fputs(Err_mem, stderr);
     return cp;
 }
@@ -644,6 +644,7 @@ create_line(void)
     l->for_arrow = NULL;
     l->back_arrow = NULL;
     l->points = NULL;
+    l->pos = NULL;
     l->radius = DEFAULT;
     l->comments = NULL;
     return l;
@@ -655,7 +656,7 @@ create_point(void)
 {
     F_point	   *p;
 
-    if ((p = (F_point *) malloc(POINT_SIZE)) == NULL)
+    if (Point_malloc(p) == NULL)
 	fputs(Err_mem, stderr);
     return p;
 }